@@ -47,7 +47,7 @@ public:
 
   /**
    * @brief Constructor
-   * @param[in] inputCatalogFilename the input catalog to split
+   * @param[in] inputCatalogFilename the input catalog to split, FITS or in the columnar format
    * @param[in] outputCatalogRootName the root name of the output catalogs, that will be completed
    * by the value of the right ascension, declination and redshift indices
    * @param[in] nbCatalogsRa the number of subcatalogs to create over the right ascension
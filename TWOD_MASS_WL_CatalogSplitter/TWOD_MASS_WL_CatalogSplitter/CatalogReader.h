@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_CatalogSplitter/CatalogReader.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_CATALOGSPLITTER_CATALOGREADER_H
+#define TWOD_MASS_WL_CATALOGSPLITTER_CATALOGREADER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <valarray>
+#include <vector>
+
+namespace CCfits {
+class FITS;
+class ExtHDU;
+}
+
+namespace TWOD_MASS_WL_MassMapping {
+class CatalogZoneMap;
+class ColumnarCatalog;
+}
+
+namespace TWOD_MASS_WL_CatalogSplitter {
+
+/**
+ * @class CatalogReader
+ * @brief Reads the columns of a catalog chunk after chunk, whether a FITS table or a catalog
+ * in the columnar format
+ *
+ * The format is found out from the file itself. The columns of a FITS table are given in the
+ * order of their names, the ones of a columnar catalog in the order of the file, as doubles.
+ *
+ * Once the position columns are given, the zone map of the catalog is loaded, or built while all
+ * the rows are read in order and then saved next to the catalog for the next readers.
+ *
+ */
+class CatalogReader {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~CatalogReader();
+
+  /**
+   * @brief Constructor of a CatalogReader
+   * @param[in] filename name of the FITS catalog or of the catalog in the columnar format
+   *
+   * If the catalog can not be opened isValid returns false
+   *
+   */
+  CatalogReader(std::string filename);
+
+  CatalogReader(const CatalogReader&) = delete;
+  CatalogReader& operator=(const CatalogReader&) = delete;
+
+  /**
+   * @brief Tells if the catalog could be opened
+   */
+  bool isValid() const;
+
+  /**
+   * @brief Returns the names of the columns
+   */
+  const std::vector<std::string>& getColumnNames() const;
+
+  /**
+   * @brief Returns the FITS formats of the columns
+   */
+  const std::vector<std::string>& getColumnForms() const;
+
+  /**
+   * @brief Returns the units of the columns
+   */
+  const std::vector<std::string>& getColumnUnits() const;
+
+  /**
+   * @brief Returns the number of rows of the catalog
+   */
+  long getNbRows() const;
+
+  /**
+   * @brief Returns the optimal number of rows to read at once
+   */
+  long getChunkRows() const;
+
+  /**
+   * @brief Reads the values of all the columns for a range of rows
+   * @param[in] firstRow the index of the first row to read, starting at 0
+   * @param[in] nbRows the number of rows to read, clamped to the rows of the catalog
+   * @param[out] columnsValues the values read, for each column name
+   * @return true if the rows could be read, false otherwise
+   */
+  bool readChunk(long firstRow, long nbRows, std::map<std::string, std::valarray<double> > &columnsValues);
+
+  /**
+   * @brief Reads the values of some columns for a range of rows into reusable buffers
+   * @param[in] firstRow the index of the first row to read, starting at 0
+   * @param[in] nbRows the number of rows to read, clamped to the rows of the catalog
+   * @param[in] names the names of the columns to read
+   * @param[out] columnsValues the values read, for each column in the order of the names, the
+   * buffers being only resized to the number of rows read
+   * @return true if the rows could be read, false otherwise
+   */
+  bool readColumns(long firstRow, long nbRows, const std::vector<std::string> &names,
+                   std::vector<std::vector<double> > &columnsValues);
+
+  /**
+   * @brief Sets the columns of the positions, to get the zone map of the catalog
+   * @param[in] keyRa the name of the right ascension column
+   * @param[in] keyDec the name of the declination column
+   * @param[in] keyZ the name of the redshift column, empty if there is none
+   */
+  void setZoneColumns(const std::string &keyRa, const std::string &keyDec, const std::string &keyZ);
+
+  /**
+   * @brief Returns the zone map of the catalog
+   * @return the zone map of all the rows, nullptr if it is not known yet
+   */
+  const TWOD_MASS_WL_MassMapping::CatalogZoneMap* getZoneMap() const;
+
+private:
+
+  /**
+   * @brief Adds rows read in order to the zone map being built, and saves it once complete
+   */
+  void addToZoneMap(long firstRow, long nbRows, const double *ra, const double *dec, const double *z);
+
+  std::shared_ptr<CCfits::FITS> m_fitsFile;
+  CCfits::ExtHDU *m_table;
+  std::unique_ptr<TWOD_MASS_WL_MassMapping::ColumnarCatalog> m_columnarCatalog;
+
+  std::vector<std::string> m_columnNames;
+  std::vector<std::string> m_columnForms;
+  std::vector<std::string> m_columnUnits;
+  long m_nbRows;
+  long m_chunkRows;
+
+  std::string m_filename;
+  std::string m_zoneKeys[3];
+  std::unique_ptr<TWOD_MASS_WL_MassMapping::CatalogZoneMap> m_zoneMap;
+  bool m_zoneMapComplete;
+
+}; /* End of CatalogReader class */
+
+} /* namespace TWOD_MASS_WL_CatalogSplitter */
+
+
+#endif
@@ -27,6 +27,7 @@
 
 #include <boost/program_options.hpp>
 #include "ElementsKernel/ProgramHeaders.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
 #include <string>
 
 namespace po = boost::program_options;
@@ -68,7 +69,8 @@ public:
      * @brief a method to parse input parameters args
      * @return true if parsing of parameters is ok, false if parameters are missing or wrong
      *
-     * This method parses all input parameters and checks that nothing is missing or wrong
+     * This method parses all input parameters and checks that nothing is missing or wrong.
+     * If a sorted catalog is requested, the input catalog is sorted instead of split
      *
      */
    bool parseInputParameters(std::map<std::string, po::variable_value>& args);
@@ -87,6 +89,10 @@ private:
    float m_decMax;
    float m_zMin;
    float m_zMax;
+   std::string m_sortedCatalog;
+   TWOD_MASS_WL_MassMapping::spatialKey m_sortingKey;
+   unsigned int m_sortingOrder;
+   unsigned long m_sortingMaxRows;
 
 }; /* End of CatalogSplitterParser class */
 
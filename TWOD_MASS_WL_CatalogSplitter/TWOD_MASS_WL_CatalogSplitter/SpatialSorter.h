@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_CatalogSplitter/SpatialSorter.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_CATALOGSPLITTER_SPATIALSORTER_H
+#define TWOD_MASS_WL_CATALOGSPLITTER_SPATIALSORTER_H
+
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+
+#include <string>
+#include <vector>
+
+namespace TWOD_MASS_WL_CatalogSplitter {
+
+/**
+ * @class SpatialSorter
+ * @brief Rewrites a catalog sorted along a space filling curve, with the key index of the sorted catalog
+ *
+ * The galaxies of the input catalog, FITS or columnar, are sorted by the key of their position
+ * through an external merge sort: runs of a bounded number of rows are sorted in memory and saved
+ * next to the output catalog, then merged into it. The galaxies with the same key keep the order
+ * of the input catalog. The sorted catalog is written in the columnar format, so that its blocks
+ * cover small regions of the sky, and its CatalogKeyIndex is saved next to it. Its columns are
+ * renamed ra, dec, z, weight, gamma1, gamma2 and kappa as in the catalogs saved by a CatalogHandler,
+ * the input columns being recognized as by the FITS catalog handler.
+ *
+ */
+class SpatialSorter {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~SpatialSorter() = default;
+
+  /**
+   * @brief Constructor of a SpatialSorter
+   * @param[in] inputCatalogFilename name of the FITS or columnar catalog to sort
+   * @param[in] outputCatalogFilename name of the sorted catalog, in the columnar format
+   * @param[in] keyType the space filling curve of the keys
+   * @param[in] order the order of the keys
+   * @param[in] indexOrder the order of the cells of the key index
+   * @param[in] maxRowsInMemory the number of rows sorted in memory at once
+   */
+  SpatialSorter(std::string inputCatalogFilename, std::string outputCatalogFilename,
+                TWOD_MASS_WL_MassMapping::spatialKey keyType = TWOD_MASS_WL_MassMapping::nestedPixelKey,
+                unsigned int order = 20, unsigned int indexOrder = 6, unsigned long maxRowsInMemory = 4194304);
+
+  /**
+   * @brief Sorts the catalog
+   * @return true if the sorted catalog and its index could be written, false otherwise
+   */
+  bool sortCatalog();
+
+private:
+
+  /**
+   * @brief Sorts the rows of a run by key and saves them
+   * @param[in] runFilename the name of the run
+   * @param[in] columnNames the names of the columns
+   * @param[in] columns the values of the rows of the run for each column
+   * @param[in] keys the keys of the rows of the run
+   * @return true if the run could be saved, false otherwise
+   */
+  bool saveRun(const std::string &runFilename, const std::vector<std::string> &columnNames,
+               const std::vector<std::vector<double> > &columns, const std::vector<unsigned long> &keys);
+
+  /**
+   * @brief Merges the runs into the sorted catalog and saves its key index
+   * @param[in] runFilenames the names of the runs
+   * @param[in] columnNames the names of the columns
+   * @param[in] keyRa the name of the right ascension column
+   * @param[in] keyDec the name of the declination column
+   * @param[in] keyZ the name of the redshift column, empty if there is none
+   * @return true if the sorted catalog and its index could be written, false otherwise
+   */
+  bool mergeRuns(const std::vector<std::string> &runFilenames, const std::vector<std::string> &columnNames,
+                 const std::string &keyRa, const std::string &keyDec, const std::string &keyZ);
+
+  std::string m_inputCatalogFilename;
+  std::string m_outputCatalogFilename;
+  TWOD_MASS_WL_MassMapping::spatialKey m_keyType;
+  unsigned int m_order;
+  unsigned int m_indexOrder;
+  unsigned long m_maxRowsInMemory;
+
+}; /* End of SpatialSorter class */
+
+} /* namespace TWOD_MASS_WL_CatalogSplitter */
+
+
+#endif
@@ -23,11 +23,101 @@
  */
 
 #include "TWOD_MASS_WL_CatalogSplitter/BasicSplitter.h"
+#include "TWOD_MASS_WL_CatalogSplitter/CatalogReader.h"
+#include "TWOD_MASS_WL_MassMapping/BlockPrefetcher.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
 
 #include <CCfits/CCfits>
+#include <algorithm>
+
+using namespace TWOD_MASS_WL_MassMapping;
 
 namespace TWOD_MASS_WL_CatalogSplitter {
 
+namespace {
+
+/**
+ * @brief Returns the patch closest to all the points of a box of coordinates
+ * @param[in] patchCenters the coordinates of the patch centers
+ * @param[in] raMin the minimum right ascension of the box
+ * @param[in] raMax the maximum right ascension of the box
+ * @param[in] decMin the minimum declination of the box
+ * @param[in] decMax the maximum declination of the box
+ * @return the index of the patch, -1 if the box is not inside a single patch
+ */
+int getPatchOfBox(std::vector<std::pair<float, float> > const &patchCenters,
+                  double raMin, double raMax, double decMin, double decMax)
+{
+  // Unknown ranges are NaN
+  if ((raMin<=raMax && decMin<=decMax)==false)
+  {
+    return -1;
+  }
+  const double corners[4][2] = {{raMin, decMin}, {raMin, decMax}, {raMax, decMin}, {raMax, decMax}};
+
+  // Patch closest to the first corner
+  unsigned int closestIndex = 0;
+  double minDist = -1.;
+  for (unsigned int i=0; i<patchCenters.size(); i++)
+  {
+    double dist = (corners[0][0]-patchCenters[i].first)*(corners[0][0]-patchCenters[i].first)
+                + (corners[0][1]-patchCenters[i].second)*(corners[0][1]-patchCenters[i].second);
+    if (minDist<0. || dist<minDist)
+    {
+      minDist = dist;
+      closestIndex = i;
+    }
+  }
+
+  // The points closer to that patch than to another one lie in a half plane, which holds the box if
+  // it holds its corners. The margin covers the rounding of the distances computed in float
+  const double margin = 1.;
+  for (unsigned int i=0; i<patchCenters.size(); i++)
+  {
+    if (i==closestIndex)
+    {
+      continue;
+    }
+    for (unsigned int c=0; c<4; c++)
+    {
+      double ra = corners[c][0];
+      double dec = corners[c][1];
+      double closestDist = (ra-patchCenters[closestIndex].first)*(ra-patchCenters[closestIndex].first)
+                         + (dec-patchCenters[closestIndex].second)*(dec-patchCenters[closestIndex].second);
+      double otherDist = (ra-patchCenters[i].first)*(ra-patchCenters[i].first)
+                       + (dec-patchCenters[i].second)*(dec-patchCenters[i].second);
+      if (closestDist-otherDist > -margin)
+      {
+        return -1;
+      }
+    }
+  }
+
+  return closestIndex;
+}
+
+/**
+ * @brief Starts reading all the columns of a catalog, chunk after chunk, in the I/O thread if any
+ * @param[in] reader the reader of the catalog, only used by the I/O thread until all the chunks are processed
+ * @param[in] prefetcher the prefetcher giving the chunks
+ */
+void prefetchAllColumns(CatalogReader &reader, BlockPrefetcher &prefetcher)
+{
+  std::vector<std::pair<long, long> > chunkRows;
+  long rowSize = std::max(reader.getChunkRows(), 1l);
+  for (long readRows=0; readRows<reader.getNbRows(); readRows+=rowSize)
+  {
+    chunkRows.push_back(std::make_pair(readRows, std::min(rowSize, reader.getNbRows()-readRows)));
+  }
+  const std::vector<std::string> &names = reader.getColumnNames();
+  prefetcher.start(chunkRows, [&reader, &names](PrefetchBlock &block)
+  {
+    return reader.readColumns(block.m_firstRow, block.m_nbRows, names, block.m_columns);
+  });
+}
+
+} // anonymous namespace
+
 BasicSplitter::BasicSplitter(std::string inputCatalogFilename, std::string outputCatalogRootName,
                              unsigned int nbCatalogsRa, unsigned int nbCatalogsDec, unsigned int nbCatalogsZ,
                              TWOD_MASS_WL_MassMapping::Boundaries &boundaries):
@@ -44,52 +134,40 @@ bool BasicSplitter::splitCatalog()
     return false;
   }
 
-  try
+  ////////////////////////////////////// Open the FITS or columnar catalog if it exists
+  CatalogReader reader(m_inputCatalogFilename);
+  if (reader.isValid()==false)
   {
-    ////////////////////////////////////// Open the FITS file if it exists
-    // Create a FITS pointer
-    std::shared_ptr<CCfits::FITS> pInputFile(new CCfits::FITS(m_inputCatalogFilename, CCfits::Read));
-
-    // Reading the HDU
-    CCfits::ExtHDU& table = pInputFile->extension(1);
-
-    // Get the map from the FITS file
-    std::map<std::string, CCfits::Column*> myColMap = table.column();
-
-    // Create map of columns and vector of keys
-    std::vector<std::string> mapKeys;
+    return false;
+  }
 
+  try
+  {
     ////////////////////////////////////// Read headers and perform some checks on them
     // Create empty keys for each location info
     std::string keyRa("");
     std::string keyDec("");
     std::string keyZ("");
 
+    std::vector< CCfits::String > colNames = reader.getColumnNames();
+    std::vector< CCfits::String > colForms = reader.getColumnForms();
+    std::vector< CCfits::String > colUnits = reader.getColumnUnits();
 
-    std::vector< CCfits::String > colNames = std::vector< CCfits::String >();
-    std::vector< CCfits::String > colForms = std::vector< CCfits::String >();
-    std::vector< CCfits::String > colUnits = std::vector< CCfits::String >();
-
-    // Create an iterator of the map and loop over it to retrieve the columns keys if they exist
-    std::map<std::string, CCfits::Column*>::iterator it;
-    for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+    // Loop over the column names to retrieve the columns keys if they exist
+    for (auto &colName : colNames)
     {
-      if (it->first.find("ra")!=std::string::npos || it->first.find("RightAsc")!=std::string::npos)
+      if (colName.find("ra")!=std::string::npos || colName.find("RightAsc")!=std::string::npos)
       {
-        keyRa = it->first;
+        keyRa = colName;
       }
-      else if (it->first.find("dec")!=std::string::npos || it->first.find("Declination")!=std::string::npos)
+      else if (colName.find("dec")!=std::string::npos || colName.find("Declination")!=std::string::npos)
       {
-        keyDec = it->first;
+        keyDec = colName;
       }
-      else if (it->first.find("z")!=std::string::npos || it->first.find("redshift")!=std::string::npos)
+      else if (colName.find("z")!=std::string::npos || colName.find("redshift")!=std::string::npos)
       {
-        keyZ = it->first;
+        keyZ = colName;
       }
-
-      colNames.push_back(it->second->name());
-      colForms.push_back(it->second->format());
-      colUnits.push_back(it->second->unit());
     }
     // If there is no ra, dec or redshift return false
     if (keyRa.empty() || keyDec.empty() || keyZ.empty())
@@ -126,38 +204,25 @@ bool BasicSplitter::splitCatalog()
       }
     }
 
-    // Define the total number of rows and rows read
-    long totalNumberOfRows(table.rows());
-    long readRows(0);
-    // Get the optimal number of rows to read by CCfits
-    long rowSize = table.getRowsize();
+    // All the columns are read by an I/O thread while the previous chunks are written, the
+    // reads and the writes going through cfitsio at the same time only if it is reentrant
+    BlockPrefetcher prefetcher(2, fits_is_reentrant()!=0);
+    prefetchAllColumns(reader, prefetcher);
+    unsigned int raColumn = std::find(colNames.begin(), colNames.end(), keyRa) - colNames.begin();
+    unsigned int decColumn = std::find(colNames.begin(), colNames.end(), keyDec) - colNames.begin();
+    unsigned int zColumn = std::find(colNames.begin(), colNames.end(), keyZ) - colNames.begin();
 
-    // Loop as long as all the rows are not read
-    while (readRows<totalNumberOfRows)
+    while (const PrefetchBlock *block = prefetcher.nextBlock())
     {
-      // Create map of columns and vector of keys
-      std::map<std::string, std::valarray<double> > mapColumnsValues;
-
-      // Loop over it to retrieve the columns info
-      for (it = myColMap.begin(); it!= myColMap.end(); ++it)
-      {
-        std::valarray<double> tmpArray;
-        it->second->read(tmpArray, readRows+1, readRows + rowSize);
-
-        // Fill the member mapColumnsValues with the values
-        mapColumnsValues[it->first]=tmpArray;
-        mapKeys.push_back(it->first);
-      }
-
-      // Loop over the values of the valarrays
-      for (unsigned int i = 0; i<mapColumnsValues[keyDec].size(); i++)
+      // Loop over the values of the chunk
+      for (long i = 0; i<block->m_nbRows; i++)
       {
         // Get the index for each value of ra, dec and z
-        unsigned int raIndex = floor((mapColumnsValues[keyRa][i]-m_boundaries.getRaMin())
+        unsigned int raIndex = floor((block->m_columns[raColumn][i]-m_boundaries.getRaMin())
                                /((m_boundaries.getRaMax()-m_boundaries.getRaMin())/m_nbCatalogsRa));
-        unsigned int decIndex = floor((mapColumnsValues[keyDec][i]-m_boundaries.getDecMin())
+        unsigned int decIndex = floor((block->m_columns[decColumn][i]-m_boundaries.getDecMin())
                                 /((m_boundaries.getDecMax()-m_boundaries.getDecMin())/m_nbCatalogsDec));
-        unsigned int zIndex = floor((mapColumnsValues[keyZ][i]- m_boundaries.getZMin())
+        unsigned int zIndex = floor((block->m_columns[zColumn][i]- m_boundaries.getZMin())
                               /((m_boundaries.getZMax()-m_boundaries.getZMin())/m_nbCatalogsZ));
 
         // compute the global index
@@ -172,18 +237,18 @@ bool BasicSplitter::splitCatalog()
         counterTable[globalIndex]++;
 
         // Fill each column
-        int colNumb = 1;
-        for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+        for (unsigned int c=0; c<colNames.size(); c++)
         {
           std::vector<double> tmp;
-          tmp.push_back(mapColumnsValues[it->first][i]);
+          tmp.push_back(block->m_columns[c][i]);
 
-          tableSubCatalogs[globalIndex]->column(colNumb).write(tmp, counterTable[globalIndex]);
-
-          colNumb++;
+          tableSubCatalogs[globalIndex]->column(c+1).write(tmp, counterTable[globalIndex]);
         }
       }
-      readRows+=rowSize;
+    }
+    if (prefetcher.hasFailed())
+    {
+      return false;
     }
 
     // Delete the pointers
@@ -209,52 +274,40 @@ bool BasicSplitter::splitCatalogWithMask()
 
   std::vector<std::pair<float, float> > patchCenters = getMaskOfCatalog(allPatches);
 
-  try
+  ////////////////////////////////////// Open the FITS or columnar catalog if it exists
+  CatalogReader reader(m_inputCatalogFilename);
+  if (reader.isValid()==false)
   {
-    ////////////////////////////////////// Open the FITS file if it exists
-    // Create a FITS pointer
-    std::shared_ptr<CCfits::FITS> pInputFile(new CCfits::FITS(m_inputCatalogFilename, CCfits::Read));
-
-    // Reading the HDU
-    CCfits::ExtHDU& table = pInputFile->extension(1);
-
-    // Get the map from the FITS file
-    std::map<std::string, CCfits::Column*> myColMap = table.column();
-
-    // Create map of columns and vector of keys
-    std::vector<std::string> mapKeys;
+    return false;
+  }
 
+  try
+  {
     ////////////////////////////////////// Read headers and perform some checks on them
     // Create empty keys for each location info
     std::string keyRa("");
     std::string keyDec("");
     std::string keyZ("");
 
+    std::vector< CCfits::String > colNames = reader.getColumnNames();
+    std::vector< CCfits::String > colForms = reader.getColumnForms();
+    std::vector< CCfits::String > colUnits = reader.getColumnUnits();
 
-    std::vector< CCfits::String > colNames = std::vector< CCfits::String >();
-    std::vector< CCfits::String > colForms = std::vector< CCfits::String >();
-    std::vector< CCfits::String > colUnits = std::vector< CCfits::String >();
-
-    // Create an iterator of the map and loop over it to retrieve the columns keys if they exist
-    std::map<std::string, CCfits::Column*>::iterator it;
-    for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+    // Loop over the column names to retrieve the columns keys if they exist
+    for (auto &colName : colNames)
     {
-      if (it->first.find("ra")!=std::string::npos || it->first.find("RightAsc")!=std::string::npos)
+      if (colName.find("ra")!=std::string::npos || colName.find("RightAsc")!=std::string::npos)
       {
-        keyRa = it->first;
+        keyRa = colName;
       }
-      else if (it->first.find("dec")!=std::string::npos || it->first.find("Declination")!=std::string::npos)
+      else if (colName.find("dec")!=std::string::npos || colName.find("Declination")!=std::string::npos)
       {
-        keyDec = it->first;
+        keyDec = colName;
       }
-      else if (it->first.find("z")!=std::string::npos || it->first.find("redshift")!=std::string::npos)
+      else if (colName.find("z")!=std::string::npos || colName.find("redshift")!=std::string::npos)
       {
-        keyZ = it->first;
+        keyZ = colName;
       }
-
-      colNames.push_back(it->second->name());
-      colForms.push_back(it->second->format());
-      colUnits.push_back(it->second->unit());
     }
     // If there is no ra, dec or redshift return false
     if (keyRa.empty() || keyDec.empty() || keyZ.empty())
@@ -279,52 +332,38 @@ bool BasicSplitter::splitCatalogWithMask()
               outputCatalogs[i]->addTable("hduName", 1, colNames, colForms, colUnits, CCfits::BinaryTbl, 1));
     }
 
-    // Define the total number of rows and rows read
-    long totalNumberOfRows(table.rows());
-    long readRows(0);
-    // Get the optimal number of rows to read by CCfits
-    long rowSize = table.getRowsize();
+    // All the columns are read by an I/O thread while the previous chunks are written, the
+    // reads and the writes going through cfitsio at the same time only if it is reentrant
+    BlockPrefetcher prefetcher(2, fits_is_reentrant()!=0);
+    prefetchAllColumns(reader, prefetcher);
+    unsigned int raColumn = std::find(colNames.begin(), colNames.end(), keyRa) - colNames.begin();
+    unsigned int decColumn = std::find(colNames.begin(), colNames.end(), keyDec) - colNames.begin();
 
-    // Loop as long as all the rows are not read
-    while (readRows<totalNumberOfRows)
+    while (const PrefetchBlock *block = prefetcher.nextBlock())
     {
-      // Create map of columns and vector of keys
-      std::map<std::string, std::valarray<double> > mapColumnsValues;
-
-      // Loop over it to retrieve the columns info
-      for (it = myColMap.begin(); it!= myColMap.end(); ++it)
-      {
-        std::valarray<double> tmpArray;
-        it->second->read(tmpArray, readRows+1, readRows + rowSize);
-
-        // Fill the member mapColumnsValues with the values
-        mapColumnsValues[it->first]=tmpArray;
-        mapKeys.push_back(it->first);
-      }
-
-      // Loop over the values of the valarrays
-      for (unsigned int i = 0; i<mapColumnsValues[keyDec].size(); i++)
+      // Loop over the values of the chunk
+      for (long i = 0; i<block->m_nbRows; i++)
       {
         // Get the index of the closest patch
         unsigned int closestIndex =
-            getClosestPatch(patchCenters, mapColumnsValues[keyRa][i], mapColumnsValues[keyDec][i]);
+            getClosestPatch(patchCenters, block->m_columns[raColumn][i], block->m_columns[decColumn][i]);
 
         // Increment the counter of that table
         counterTable[closestIndex]++;
 
         // Fill each column
-        int colNumb = 1;
-        for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+        for (unsigned int c=0; c<colNames.size(); c++)
         {
           std::vector<double> tmp;
-          tmp.push_back(mapColumnsValues[it->first][i]);
-
-          tableSubCatalogs[closestIndex]->column(colNumb).write(tmp, counterTable[closestIndex]);
+          tmp.push_back(block->m_columns[c][i]);
 
-          colNumb++;
+          tableSubCatalogs[closestIndex]->column(c+1).write(tmp, counterTable[closestIndex]);
         }
       }
-      readRows+=rowSize;
+    }
+    if (prefetcher.hasFailed())
+    {
+      return false;
     }
 
     // Delete the pointers
@@ -379,84 +418,101 @@ std::vector<std::pair<float, float> >
   // Create a vector containing true if a patch has information in the catalog
   std::vector<bool> patchInformation(patchCenters.size(), false);
 
-  try
+  ////////////////////////////////////// Open the FITS or columnar catalog if it exists
+  CatalogReader reader(m_inputCatalogFilename);
+  if (reader.isValid()==false)
   {
-    ////////////////////////////////////// Open the FITS file if it exists
-    // Create a FITS pointer
-    std::shared_ptr<CCfits::FITS> pInputFile(new CCfits::FITS(m_inputCatalogFilename, CCfits::Read));
-
-    // Reading the HDU
-    CCfits::ExtHDU& table = pInputFile->extension(1);
-
-    // Get the map from the FITS file
-    std::map<std::string, CCfits::Column*> myColMap = table.column();
-
-    // Create map of columns and vector of keys
-    std::vector<std::string> mapKeys;
+    return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
+  }
 
-    ////////////////////////////////////// Read headers and perform some checks on them
-    // Create empty keys for each location info
-    std::string keyRa("");
-    std::string keyDec("");
+  ////////////////////////////////////// Read headers and perform some checks on them
+  // Create empty keys for each location info
+  std::string keyRa("");
+  std::string keyDec("");
+  std::string keyZ("");
 
-    // Create an iterator of the map and loop over it to retrieve the columns keys if they exist
-    std::map<std::string, CCfits::Column*>::iterator it;
-    for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+  // Loop over the column names to retrieve the columns keys if they exist
+  for (auto &colName : reader.getColumnNames())
+  {
+    if (colName.find("ra")!=std::string::npos || colName.find("RightAsc")!=std::string::npos)
     {
-      if (it->first.find("ra")!=std::string::npos || it->first.find("RightAsc")!=std::string::npos)
-      {
-        keyRa = it->first;
-      }
-      else if (it->first.find("dec")!=std::string::npos || it->first.find("Declination")!=std::string::npos)
-      {
-        keyDec = it->first;
-      }
+      keyRa = colName;
     }
-    // If there is no ra, dec or redshift return false
-    if (keyRa.empty() || keyDec.empty())
+    else if (colName.find("dec")!=std::string::npos || colName.find("Declination")!=std::string::npos)
     {
-      return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
+      keyDec = colName;
     }
+    else if (colName.find("z")!=std::string::npos || colName.find("redshift")!=std::string::npos)
+    {
+      keyZ = colName;
+    }
+  }
+  // If there is no ra, dec or redshift return false
+  if (keyRa.empty() || keyDec.empty())
+  {
+    return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
+  }
 
-    // Define the total number of rows and rows read
-    long totalNumberOfRows(table.rows());
-    long readRows(0);
-    // Get the optimal number of rows to read by CCfits
-    long rowSize = table.getRowsize();
+  // Get the zone map of the catalog, built during this scan if not known yet
+  reader.setZoneColumns(keyRa, keyDec, keyZ);
+  const CatalogZoneMap *zoneMap = reader.getZoneMap();
 
-    // Loop as long as all the rows are not read
-    while (readRows<totalNumberOfRows)
-    {
-      // Create map of columns and vector of keys
-      std::map<std::string, std::valarray<double> > mapColumnsValues;
+  // Define the total number of rows and rows read
+  long totalNumberOfRows(reader.getNbRows());
+  long readRows(0);
+  // Get the optimal number of rows to read, a zone at once if the zone map is known
+  long rowSize = zoneMap!=nullptr ? long(zoneMap->getZoneRows()) : reader.getChunkRows();
 
-      // Loop over it to retrieve the columns info
-      for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+  // List the chunks to read, looping as long as all the rows are not listed
+  std::vector<std::pair<long, long> > chunkRows;
+  while (readRows<totalNumberOfRows)
+  {
+    // A zone lying inside a single patch is not read
+    if (zoneMap!=nullptr)
+    {
+      unsigned long zone = readRows/rowSize;
+      int patch = getPatchOfBox(patchCenters,
+                                zoneMap->getMin(zone, raCoordinate), zoneMap->getMax(zone, raCoordinate),
+                                zoneMap->getMin(zone, decCoordinate), zoneMap->getMax(zone, decCoordinate));
+      if (patch>=0)
       {
-        std::valarray<double> tmpArray;
-        it->second->read(tmpArray, readRows+1, readRows + rowSize);
-
-        // Fill the member mapColumnsValues with the values
-        mapColumnsValues[it->first]=tmpArray;
-        mapKeys.push_back(it->first);
+        patchInformation[patch] = true;
+        readRows+=rowSize;
+        continue;
       }
+    }
 
-      // Loop over the values of the valarrays
-      for (unsigned int i = 0; i<mapColumnsValues[keyDec].size(); i++)
-      {
-        // Get the index of the closest patch
-        unsigned int closestIndex =
-            getClosestPatch(patchCenters, mapColumnsValues[keyRa][i], mapColumnsValues[keyDec][i]);
+    chunkRows.push_back(std::make_pair(readRows, std::min(rowSize, totalNumberOfRows-readRows)));
+    readRows+=rowSize;
+  }
 
-        // Set the boolean associated to this patch to true
-        patchInformation[closestIndex] = true;
-      }
-      readRows+=rowSize;
+  // Only the position columns are read, by an I/O thread while the previous chunks are processed
+  // if cfitsio is reentrant
+  std::vector<std::string> names = {keyRa, keyDec};
+  if (keyZ.empty()==false)
+  {
+    names.push_back(keyZ);
+  }
+  BlockPrefetcher prefetcher(2, fits_is_reentrant()!=0);
+  prefetcher.start(chunkRows, [&reader, &names](PrefetchBlock &block)
+  {
+    return reader.readColumns(block.m_firstRow, block.m_nbRows, names, block.m_columns);
+  });
+
+  while (const PrefetchBlock *block = prefetcher.nextBlock())
+  {
+    // Loop over the values of the chunk
+    for (long i = 0; i<block->m_nbRows; i++)
+    {
+      // Get the index of the closest patch
+      unsigned int closestIndex = getClosestPatch(patchCenters, block->m_columns[0][i], block->m_columns[1][i]);
+
+      // Set the boolean associated to this patch to true
+      patchInformation[closestIndex] = true;
     }
   }
-  catch (CCfits::FitsException&)
+  if (prefetcher.hasFailed())
   {
-    std::cout<<"exception thrown when opening/reading the file"<<std::endl;
     return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
   }
 
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/CatalogReader.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_CatalogSplitter/CatalogReader.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+
+#include <CCfits/CCfits>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+namespace TWOD_MASS_WL_CatalogSplitter {
+
+CatalogReader::~CatalogReader()
+{
+}
+
+CatalogReader::CatalogReader(std::string filename): m_table(nullptr), m_nbRows(0), m_chunkRows(0),
+m_filename(filename), m_zoneMapComplete(false)
+{
+  // Catalog in the columnar format: its columns are mapped
+  if (ColumnarCatalog::isColumnarCatalog(filename))
+  {
+    m_columnarCatalog.reset(new ColumnarCatalog(filename));
+    if (m_columnarCatalog->isValid()==false)
+    {
+      return;
+    }
+    m_columnNames = m_columnarCatalog->getColumnNames();
+    m_columnForms.assign(m_columnNames.size(), "D");
+    m_columnUnits.assign(m_columnNames.size(), "");
+    m_nbRows = m_columnarCatalog->getNbRows();
+    m_chunkRows = m_columnarCatalog->getBlockRows();
+    return;
+  }
+
+  // Otherwise a FITS catalog with its table in the first extension
+  try
+  {
+    m_fitsFile.reset(new CCfits::FITS(filename, CCfits::Read));
+    m_table = &m_fitsFile->extension(1);
+
+    std::map<std::string, CCfits::Column*> myColMap = m_table->column();
+    std::map<std::string, CCfits::Column*>::iterator it;
+    for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+    {
+      m_columnNames.push_back(it->second->name());
+      m_columnForms.push_back(it->second->format());
+      m_columnUnits.push_back(it->second->unit());
+    }
+    m_nbRows = m_table->rows();
+    m_chunkRows = m_table->getRowsize();
+  }
+  catch (CCfits::FitsException&)
+  {
+    std::cout<<"exception thrown when opening/reading the file"<<std::endl;
+    m_fitsFile.reset();
+    m_table = nullptr;
+  }
+}
+
+bool CatalogReader::isValid() const
+{
+  return m_table!=nullptr || (m_columnarCatalog!=nullptr && m_columnarCatalog->isValid());
+}
+
+const std::vector<std::string>& CatalogReader::getColumnNames() const
+{
+  return m_columnNames;
+}
+
+const std::vector<std::string>& CatalogReader::getColumnForms() const
+{
+  return m_columnForms;
+}
+
+const std::vector<std::string>& CatalogReader::getColumnUnits() const
+{
+  return m_columnUnits;
+}
+
+long CatalogReader::getNbRows() const
+{
+  return m_nbRows;
+}
+
+long CatalogReader::getChunkRows() const
+{
+  return m_chunkRows;
+}
+
+bool CatalogReader::readChunk(long firstRow, long nbRows,
+                              std::map<std::string, std::valarray<double> > &columnsValues)
+{
+  columnsValues.clear();
+  if (isValid()==false || firstRow<0 || firstRow>=m_nbRows)
+  {
+    return false;
+  }
+  nbRows = std::min(nbRows, m_nbRows-firstRow);
+
+  // The columns of a columnar catalog are copied from the mapped file
+  if (m_columnarCatalog!=nullptr)
+  {
+    for (auto &name : m_columnNames)
+    {
+      columnsValues[name] = std::valarray<double>(m_columnarCatalog->getColumn(name)+firstRow, nbRows);
+    }
+    return true;
+  }
+
+  try
+  {
+    for (auto &name : m_columnNames)
+    {
+      m_table->column(name).read(columnsValues[name], firstRow+1, firstRow+nbRows);
+    }
+  }
+  catch (CCfits::FitsException&)
+  {
+    std::cout<<"exception thrown when opening/reading the file"<<std::endl;
+    return false;
+  }
+
+  // The zone map is built from the rows read in order
+  if (m_zoneMap!=nullptr && m_zoneMapComplete==false)
+  {
+    const double *z = m_zoneKeys[2].empty() ? nullptr : &columnsValues[m_zoneKeys[2]][0];
+    addToZoneMap(firstRow, nbRows, &columnsValues[m_zoneKeys[0]][0], &columnsValues[m_zoneKeys[1]][0], z);
+  }
+
+  return true;
+}
+
+bool CatalogReader::readColumns(long firstRow, long nbRows, const std::vector<std::string> &names,
+                                std::vector<std::vector<double> > &columnsValues)
+{
+  if (isValid()==false || firstRow<0 || firstRow>=m_nbRows)
+  {
+    return false;
+  }
+  nbRows = std::min(nbRows, m_nbRows-firstRow);
+  columnsValues.resize(names.size());
+
+  try
+  {
+    for (unsigned int c=0; c<names.size(); c++)
+    {
+      // The columns of a columnar catalog are copied from the mapped file
+      if (m_columnarCatalog!=nullptr)
+      {
+        const double *values = m_columnarCatalog->getColumn(names[c]);
+        if (values==nullptr)
+        {
+          return false;
+        }
+        columnsValues[c].assign(values+firstRow, values+firstRow+nbRows);
+      }
+      else
+      {
+        m_table->column(names[c]).read(columnsValues[c], firstRow+1, firstRow+nbRows);
+      }
+    }
+  }
+  catch (CCfits::FitsException&)
+  {
+    std::cout<<"exception thrown when opening/reading the file"<<std::endl;
+    return false;
+  }
+
+  // The zone map is built from the rows read in order, if its columns are read
+  if (m_zoneMap!=nullptr && m_zoneMapComplete==false)
+  {
+    const double *zoneColumns[3] = {nullptr, nullptr, nullptr};
+    for (unsigned int k=0; k<3; k++)
+    {
+      auto it = std::find(names.begin(), names.end(), m_zoneKeys[k]);
+      if (it!=names.end())
+      {
+        zoneColumns[k] = columnsValues[it-names.begin()].data();
+      }
+    }
+    if (zoneColumns[0]!=nullptr && zoneColumns[1]!=nullptr && (m_zoneKeys[2].empty() || zoneColumns[2]!=nullptr))
+    {
+      addToZoneMap(firstRow, nbRows, zoneColumns[0], zoneColumns[1], zoneColumns[2]);
+    }
+  }
+
+  return true;
+}
+
+void CatalogReader::addToZoneMap(long firstRow, long nbRows, const double *ra, const double *dec, const double *z)
+{
+  // Rows not following the ones already indexed can not be indexed
+  if (long(m_zoneMap->getNbRows())!=firstRow)
+  {
+    return;
+  }
+
+  // The zone map is saved once all the rows are read
+  m_zoneMap->addRows(nbRows, ra, dec, z);
+  if (long(m_zoneMap->getNbRows())==m_nbRows)
+  {
+    m_zoneMapComplete = true;
+    if (m_zoneMap->save(m_filename)==false)
+    {
+      std::cout<<"the zone map of "<<m_filename<<" could not be saved"<<std::endl;
+    }
+  }
+}
+
+void CatalogReader::setZoneColumns(const std::string &keyRa, const std::string &keyDec, const std::string &keyZ)
+{
+  m_zoneKeys[0] = keyRa;
+  m_zoneKeys[1] = keyDec;
+  m_zoneKeys[2] = keyZ;
+  m_zoneMap.reset(new CatalogZoneMap());
+  m_zoneMapComplete = false;
+  if (isValid()==false)
+  {
+    m_zoneMap.reset();
+    return;
+  }
+
+  // The block ranges of a columnar catalog are its zone map
+  if (m_columnarCatalog!=nullptr)
+  {
+    if (keyRa=="ra" && keyDec=="dec" && (keyZ=="z" || keyZ.empty()))
+    {
+      m_zoneMapComplete = m_zoneMap->setFromColumnarCatalog(*m_columnarCatalog);
+    }
+    if (m_zoneMapComplete==false)
+    {
+      m_zoneMap.reset();
+    }
+    return;
+  }
+
+  // Otherwise the zone map saved next to the catalog, if it indexes all its rows and the same columns
+  m_zoneMap->setColumnNames(keyRa, keyDec, keyZ);
+  m_zoneMapComplete = m_zoneMap->load(m_filename) && long(m_zoneMap->getNbRows())==m_nbRows;
+  if (m_zoneMapComplete==false)
+  {
+    m_zoneMap->clear();
+  }
+}
+
+const CatalogZoneMap* CatalogReader::getZoneMap() const
+{
+  return m_zoneMapComplete ? m_zoneMap.get() : nullptr;
+}
+
+} // TWOD_MASS_WL_CatalogSplitter namespace
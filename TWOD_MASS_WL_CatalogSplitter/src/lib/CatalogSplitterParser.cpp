@@ -24,6 +24,7 @@
 
 #include "TWOD_MASS_WL_CatalogSplitter/CatalogSplitterParser.h"
 #include "TWOD_MASS_WL_CatalogSplitter/BasicSplitter.h"
+#include "TWOD_MASS_WL_CatalogSplitter/SpatialSorter.h"
 #include "TWOD_MASS_WL_MassMapping/Boundaries.h"
 
 namespace po = boost::program_options;
@@ -32,7 +33,8 @@ namespace TWOD_MASS_WL_CatalogSplitter {
 
 CatalogSplitterParser::CatalogSplitterParser(): m_inputFITSCatalog(""), m_outputFITSCatalogRoot(""), m_workDir(""),
     m_nbCatalogsRa(0), m_nbCatalogsDec(0), m_nbCatalogsZ(0), m_raMin(0), m_raMax(360), m_decMin(-90), m_decMax(90),
-    m_zMin(0), m_zMax(15)
+    m_zMin(0), m_zMax(15), m_sortedCatalog(""), m_sortingKey(TWOD_MASS_WL_MassMapping::nestedPixelKey),
+    m_sortingOrder(20), m_sortingMaxRows(4194304)
 {
 }
 
@@ -62,7 +64,16 @@ po::options_description CatalogSplitterParser::defineSpecificProgramOptions()
       ("nbCatalogsDec", po::value<int>(),
        "number of subcatalogs to be created for declination values")
       ("nbCatalogsZ", po::value<int>(),
-       "number of subcatalogs to be created for redshift values");
+       "number of subcatalogs to be created for redshift values")
+
+      ("sortedCatalog", po::value<std::string>(),
+       "columnar catalog to write with the galaxies sorted along a space filling curve, instead of splitting")
+      ("sortingKey", po::value<std::string>(),
+       "space filling curve of the sorting: nested (HEALPix nested pixels, default) or morton (ra, dec)")
+      ("sortingOrder", po::value<int>(),
+       "order of the keys of the sorting, 20 by default")
+      ("sortingMaxRows", po::value<int>(),
+       "number of rows sorted in memory at once, 4194304 by default");
 
   return options;
 }
@@ -75,6 +86,18 @@ Elements::ExitCode CatalogSplitterParser::mainMethod(std::map<std::string, po::v
     return Elements::ExitCode::OK;
   }
 
+  // Sort the catalog if requested
+  if (m_sortedCatalog.empty()==false)
+  {
+    SpatialSorter mySorter(m_workDir+m_inputFITSCatalog, m_workDir+m_sortedCatalog,
+                           m_sortingKey, m_sortingOrder, 6, m_sortingMaxRows);
+    if (mySorter.sortCatalog()==false)
+    {
+      std::cout<<"the catalog could not be sorted"<<std::endl;
+    }
+    return Elements::ExitCode::OK;
+  }
+
   TWOD_MASS_WL_MassMapping::Boundaries boundaries(m_raMin, m_raMax, m_decMin, m_decMax, m_zMin, m_zMax);
 
   BasicSplitter mySplitter(m_workDir+m_inputFITSCatalog, m_workDir+m_outputFITSCatalogRoot,
@@ -165,7 +188,52 @@ bool CatalogSplitterParser::parseInputParameters(std::map<std::string, po::varia
         return false;
       }
     }
+    else if (it->first=="sortedCatalog")
+    {
+      m_sortedCatalog = args["sortedCatalog"].as<std::string>();
+    }
+    else if (it->first=="sortingKey")
+    {
+      std::string sortingKey = args["sortingKey"].as<std::string>();
+      if (sortingKey=="nested")
+      {
+        m_sortingKey = TWOD_MASS_WL_MassMapping::nestedPixelKey;
+      }
+      else if (sortingKey=="morton")
+      {
+        m_sortingKey = TWOD_MASS_WL_MassMapping::mortonKey;
+      }
+      else
+      {
+        std::cout<<"unknown sorting key "<<sortingKey<<", should be nested or morton"<<std::endl;
+        return false;
+      }
+    }
+    else if (it->first=="sortingOrder")
+    {
+      m_sortingOrder = args["sortingOrder"].as<int>();
+    }
+    else if (it->first=="sortingMaxRows")
+    {
+      if (args["sortingMaxRows"].as<int>()<=0)
+      {
+        std::cout<<"the number of rows sorted in memory should be positive"<<std::endl;
+        return false;
+      }
+      m_sortingMaxRows = args["sortingMaxRows"].as<int>();
+    }
+
+  }
 
+  // Sorting a catalog only needs the input catalog
+  if (m_sortedCatalog.empty()==false)
+  {
+    if (m_inputFITSCatalog.empty()==true)
+    {
+      std::cout<<"Input catalog filename not provided"<<std::endl;
+      return false;
+    }
+    return true;
   }
 
   // Check all values are well filled
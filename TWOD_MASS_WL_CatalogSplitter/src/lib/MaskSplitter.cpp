@@ -23,8 +23,15 @@
  */
 
 #include "TWOD_MASS_WL_CatalogSplitter/MaskSplitter.h"
+#include "TWOD_MASS_WL_CatalogSplitter/CatalogReader.h"
+#include "TWOD_MASS_WL_MassMapping/BlockPrefetcher.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
 
-#include <CCfits/CCfits>
+#include <fitsio.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace TWOD_MASS_WL_MassMapping;
 
 namespace TWOD_MASS_WL_CatalogSplitter {
 
@@ -39,107 +46,142 @@ std::vector<std::pair<float, float> > MaskSplitter::fillBasicMask()
 
   std::vector<std::pair<float, float> > basicMask(numberOfDecBins, std::pair<float, float>(360, 0));
 
-  try
+  ////////////////////////////////////// Open the FITS or columnar catalog if it exists
+  CatalogReader reader(m_inputCatalogFilename);
+  if (reader.isValid()==false)
   {
-    ////////////////////////////////////// Open the FITS file if it exists
-    // Create a FITS pointer
-    std::shared_ptr<CCfits::FITS> pInputFile(new CCfits::FITS(m_inputCatalogFilename, CCfits::Read));
+    return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
+  }
 
-    // Reading the HDU
-    CCfits::ExtHDU& table = pInputFile->extension(1);
+  ////////////////////////////////////// Read headers and perform some checks on them
+  // Create empty keys for each location info
+  std::string keyRa("");
+  std::string keyDec("");
+  std::string keyZ("");
 
-    // Get the map from the FITS file
-    std::map<std::string, CCfits::Column*> myColMap = table.column();
+  // Loop over the column names to retrieve the columns keys if they exist
+  for (auto &colName : reader.getColumnNames())
+  {
+    if (colName.find("ra")!=std::string::npos || colName.find("RightAsc")!=std::string::npos)
+    {
+      keyRa = colName;
+    }
+    else if (colName.find("dec")!=std::string::npos || colName.find("Declination")!=std::string::npos)
+    {
+      keyDec = colName;
+    }
+    else if (colName.find("z")!=std::string::npos || colName.find("edshift")!=std::string::npos)
+    {
+      keyZ = colName;
+    }
+  }
+  // If there is no ra, dec or redshift return false
+  if (keyRa.empty() || keyDec.empty())
+  {
+    return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
+  }
 
-    // Create map of columns and vector of keys
-    std::vector<std::string> mapKeys;
+  // Get the zone map of the catalog, built during this scan if not known yet
+  reader.setZoneColumns(keyRa, keyDec, keyZ);
+  const CatalogZoneMap *zoneMap = reader.getZoneMap();
 
-    ////////////////////////////////////// Read headers and perform some checks on them
-    // Create empty keys for each location info
-    std::string keyRa("");
-    std::string keyDec("");
-    std::string keyZ("");
+  // Define the total number of rows and rows read
+  long totalNumberOfRows(reader.getNbRows());
+  long readRows(0);
+  // Get the optimal number of rows to read, a zone at once if the zone map is known
+  long rowSize = zoneMap!=nullptr ? long(zoneMap->getZoneRows()) : reader.getChunkRows();
 
-    // Create an iterator of the map and loop over it to retrieve the columns keys if they exist
-    std::map<std::string, CCfits::Column*>::iterator it;
-    for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+  // List the chunks to read, looping as long as all the rows are not listed
+  std::vector<std::pair<long, long> > chunkRows;
+  while (readRows<totalNumberOfRows)
+  {
+    // A zone lying in a single declination bin updates the mask from its ranges without being read
+    if (zoneMap!=nullptr)
     {
-      if (it->first.find("ra")!=std::string::npos || it->first.find("RightAsc")!=std::string::npos)
-      {
-        keyRa = it->first;
-      }
-      else if (it->first.find("dec")!=std::string::npos || it->first.find("Declination")!=std::string::npos)
-      {
-        keyDec = it->first;
-      }
-      else if (it->first.find("z")!=std::string::npos || it->first.find("edshift")!=std::string::npos)
+      unsigned long zone = readRows/rowSize;
+      double decMin = zoneMap->getMin(zone, decCoordinate);
+      double decMax = zoneMap->getMax(zone, decCoordinate);
+      double raMin = zoneMap->getMin(zone, raCoordinate);
+      double raMax = zoneMap->getMax(zone, raCoordinate);
+      double zMin = zoneMap->getMin(zone, zCoordinate);
+      double zMax = zoneMap->getMax(zone, zCoordinate);
+      bool knownRanges = decMin>=-90. && decMax<=90. && std::isnan(raMin)==false &&
+                         (keyZ.empty() || std::isnan(zMin)==false);
+      unsigned int minIndex = knownRanges ? (decMin + 90)/m_decStep : 0;
+      unsigned int maxIndex = knownRanges ? (decMax + 90)/m_decStep : 0;
+      if (knownRanges && minIndex==maxIndex && maxIndex<basicMask.size())
       {
-        keyZ = it->first;
+        if (raMin < basicMask[minIndex].first)
+        {
+          basicMask[minIndex].first = raMin;
+        }
+        if (raMax > basicMask[minIndex].second)
+        {
+          basicMask[minIndex].second = raMax;
+        }
+        if (keyZ.empty()==false)
+        {
+          m_zMax = std::max(m_zMax, float(zMax));
+          m_zMin = std::min(m_zMin, float(zMin));
+        }
+        readRows+=rowSize;
+        continue;
       }
     }
-    // If there is no ra, dec or redshift return false
-    if (keyRa.empty() || keyDec.empty())
-    {
-      return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
-    }
 
-    // Define the total number of rows and rows read
-    long totalNumberOfRows(table.rows());
-    long readRows(0);
-    // Get the optimal number of rows to read by CCfits
-    long rowSize = table.getRowsize();
+    chunkRows.push_back(std::make_pair(readRows, std::min(rowSize, totalNumberOfRows-readRows)));
+    readRows+=rowSize;
+  }
 
-    // Loop as long as all the rows are not read
-    while (readRows<totalNumberOfRows)
-    {
-      // Create map of columns and vector of keys
-      std::map<std::string, std::valarray<double> > mapColumnsValues;
+  // Only the position columns are read, by an I/O thread while the previous chunks are processed
+  // if cfitsio is reentrant
+  std::vector<std::string> names = {keyRa, keyDec};
+  if (keyZ.empty()==false)
+  {
+    names.push_back(keyZ);
+  }
+  BlockPrefetcher prefetcher(2, fits_is_reentrant()!=0);
+  prefetcher.start(chunkRows, [&reader, &names](PrefetchBlock &block)
+  {
+    return reader.readColumns(block.m_firstRow, block.m_nbRows, names, block.m_columns);
+  });
 
-      // Loop over it to retrieve the columns info
-      for (it = myColMap.begin(); it!= myColMap.end(); ++it)
-      {
-        std::valarray<double> tmpArray;
-        it->second->read(tmpArray, readRows+1, readRows + rowSize);
+  while (const PrefetchBlock *block = prefetcher.nextBlock())
+  {
+    const std::vector<double> &raValues = block->m_columns[0];
+    const std::vector<double> &decValues = block->m_columns[1];
 
-        // Fill the member mapColumnsValues with the values
-        mapColumnsValues[it->first]=tmpArray;
-        mapKeys.push_back(it->first);
+    // Loop over the values of the chunk
+    for (long i = 0; i<block->m_nbRows; i++)
+    {
+      unsigned int maskIndex = (decValues[i] + 90)/m_decStep;
+      // Keep the min ra value in the first value of the pair
+      if (raValues[i] < basicMask[maskIndex].first)
+      {
+        basicMask[maskIndex].first = raValues[i];
+      }
+      // Keep the max ra value in the second value of the pair
+      if (raValues[i] > basicMask[maskIndex].second)
+      {
+        basicMask[maskIndex].second = raValues[i];
       }
 
-      // Loop over the values of the valarrays
-      for (unsigned int i = 0; i<mapColumnsValues[keyDec].size(); i++)
+      // Keep the min and max redshift value if provided
+      if (keyZ.empty()==false)
       {
-        unsigned int maskIndex = (mapColumnsValues[keyDec][i] + 90)/m_decStep;
-        // Keep the min ra value in the first value of the pair
-        if (mapColumnsValues[keyRa][i] < basicMask[maskIndex].first)
+        if (block->m_columns[2][i] > m_zMax)
         {
-          basicMask[maskIndex].first = mapColumnsValues[keyRa][i];
+          m_zMax = block->m_columns[2][i];
         }
-        // Keep the max ra value in the second value of the pair
-        if (mapColumnsValues[keyRa][i] > basicMask[maskIndex].second)
+        if (block->m_columns[2][i] < m_zMin)
         {
-          basicMask[maskIndex].second = mapColumnsValues[keyRa][i];
-        }
-
-        // Keep the min and max redshift value if provided
-        if (keyZ.empty()==false)
-        {
-          if (mapColumnsValues[keyZ][i] > m_zMax)
-          {
-            m_zMax = mapColumnsValues[keyZ][i];
-          }
-          if (mapColumnsValues[keyZ][i] < m_zMin)
-          {
-            m_zMin = mapColumnsValues[keyZ][i];
-          }
+          m_zMin = block->m_columns[2][i];
         }
       }
-      readRows+=rowSize;
     }
   }
-  catch (CCfits::FitsException&)
+  if (prefetcher.hasFailed())
   {
-    std::cout<<"exception thrown when opening/reading the file"<<std::endl;
     return std::vector<std::pair<float, float> > (1, (std::pair<float, float>(0, 0)));
   }
 
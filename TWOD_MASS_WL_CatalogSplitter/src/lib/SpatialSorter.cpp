@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/SpatialSorter.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_CatalogSplitter/SpatialSorter.h"
+#include "TWOD_MASS_WL_CatalogSplitter/CatalogReader.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <set>
+#include <valarray>
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+namespace TWOD_MASS_WL_CatalogSplitter {
+
+namespace {
+// Name of the column of the keys in the runs
+const std::string keyColumnName("spatialKey");
+
+// Number of rows written at once
+const unsigned long blockRows = 65536;
+
+// Names of the columns of the sorted catalog, the ones read by the columnar catalog handler.
+// The input columns are matched by the rules of the FITS catalog handler, a column keeping
+// its name if a column of the catalog already has the name it would take
+std::vector<std::string> getSortedColumnNames(const std::vector<std::string> &inputNames)
+{
+  std::vector<std::string> names(inputNames);
+  std::set<std::string> usedNames(inputNames.begin(), inputNames.end());
+  for (auto &name : names)
+  {
+    std::string sortedName;
+    if (name.find("ra")!=std::string::npos || name.find("RightAsc")!=std::string::npos)
+    {
+      sortedName = "ra";
+    }
+    else if (name.find("dec")!=std::string::npos || name.find("Dec")!=std::string::npos)
+    {
+      sortedName = "dec";
+    }
+    else if (name.find("kappa")!=std::string::npos)
+    {
+      sortedName = "kappa";
+    }
+    else if (name.find("gamma1")!=std::string::npos)
+    {
+      sortedName = "gamma1";
+    }
+    else if (name.find("gamma2")!=std::string::npos)
+    {
+      sortedName = "gamma2";
+    }
+    else if (name.find("z")!=std::string::npos || name.find("edshift")!=std::string::npos)
+    {
+      sortedName = "z";
+    }
+    else if (name.find("weight")!=std::string::npos)
+    {
+      sortedName = "weight";
+    }
+
+    if (sortedName.empty()==false && usedNames.count(sortedName)==0)
+    {
+      usedNames.insert(sortedName);
+      name = sortedName;
+    }
+  }
+  return names;
+}
+} // anonymous namespace
+
+SpatialSorter::SpatialSorter(std::string inputCatalogFilename, std::string outputCatalogFilename,
+                             spatialKey keyType, unsigned int order, unsigned int indexOrder,
+                             unsigned long maxRowsInMemory):
+m_inputCatalogFilename(inputCatalogFilename), m_outputCatalogFilename(outputCatalogFilename),
+m_keyType(keyType), m_order(order), m_indexOrder(indexOrder),
+m_maxRowsInMemory(maxRowsInMemory>0 ? maxRowsInMemory : 1)
+{
+}
+
+bool SpatialSorter::sortCatalog()
+{
+  ////////////////////////////////////// Open the FITS or columnar catalog if it exists
+  CatalogReader reader(m_inputCatalogFilename);
+  if (reader.isValid()==false)
+  {
+    return false;
+  }
+
+  ////////////////////////////////////// Read headers and perform some checks on them
+  // The sorted catalog has the column names of the columnar catalogs, the input names being
+  // only used to read the input catalog
+  std::vector<std::string> inputNames = reader.getColumnNames();
+  std::vector<std::string> columnNames = getSortedColumnNames(inputNames);
+  long raIndex = std::find(columnNames.begin(), columnNames.end(), "ra") - columnNames.begin();
+  long decIndex = std::find(columnNames.begin(), columnNames.end(), "dec") - columnNames.begin();
+  std::string keyZ(std::find(columnNames.begin(), columnNames.end(), "z")!=columnNames.end() ? "z" : "");
+
+  // If there is no ra or dec return false
+  if (raIndex==long(columnNames.size()) || decIndex==long(columnNames.size()))
+  {
+    std::cout<<"no position columns to sort the catalog"<<std::endl;
+    return false;
+  }
+
+  // The orders of the keys are the ones of the index
+  CatalogKeyIndex keyIndex(m_keyType, m_order, m_indexOrder);
+  unsigned int order = keyIndex.getOrder();
+
+  // Define the total number of rows and rows read
+  long totalNumberOfRows(reader.getNbRows());
+  long readRows(0);
+  // Get the optimal number of rows to read
+  long rowSize = std::max(reader.getChunkRows(), 1l);
+
+  // Read the catalog run after run, each run being sorted and saved next to the sorted catalog
+  std::vector<std::string> runFilenames;
+  std::vector<std::vector<double> > columns(columnNames.size());
+  std::vector<unsigned long> keys;
+  bool sortOK = true;
+  while (readRows<totalNumberOfRows && sortOK)
+  {
+    // Read the values of all the columns of the chunk
+    std::map<std::string, std::valarray<double> > mapColumnsValues;
+    long nbRows = std::min(rowSize, long(m_maxRowsInMemory-keys.size()));
+    if (reader.readChunk(readRows, nbRows, mapColumnsValues)==false)
+    {
+      sortOK = false;
+      break;
+    }
+    nbRows = mapColumnsValues[inputNames[raIndex]].size();
+    for (unsigned int c=0; c<inputNames.size(); c++)
+    {
+      std::valarray<double> &values = mapColumnsValues[inputNames[c]];
+      columns[c].insert(columns[c].end(), std::begin(values), std::end(values));
+    }
+    const std::valarray<double> &raValues = mapColumnsValues[inputNames[raIndex]];
+    const std::valarray<double> &decValues = mapColumnsValues[inputNames[decIndex]];
+    for (long i=0; i<nbRows; i++)
+    {
+      keys.push_back(CatalogKeyIndex::getKey(m_keyType, order, raValues[i], decValues[i]));
+    }
+    readRows+=nbRows;
+
+    if (keys.size()>=m_maxRowsInMemory || readRows>=totalNumberOfRows)
+    {
+      runFilenames.push_back(m_outputCatalogFilename + ".run" + std::to_string(runFilenames.size()));
+      sortOK = saveRun(runFilenames.back(), columnNames, columns, keys);
+      for (auto &column : columns)
+      {
+        column.clear();
+      }
+      keys.clear();
+    }
+  }
+
+  sortOK = sortOK && mergeRuns(runFilenames, columnNames, "ra", "dec", keyZ);
+
+  // Remove the runs
+  for (auto &runFilename : runFilenames)
+  {
+    std::remove(runFilename.c_str());
+  }
+
+  return sortOK;
+}
+
+bool SpatialSorter::saveRun(const std::string &runFilename, const std::vector<std::string> &columnNames,
+                            const std::vector<std::vector<double> > &columns, const std::vector<unsigned long> &keys)
+{
+  // Sort the rows by key, the rows with the same key keeping their order
+  std::vector<unsigned long> sortedRows(keys.size());
+  std::iota(sortedRows.begin(), sortedRows.end(), 0);
+  std::stable_sort(sortedRows.begin(), sortedRows.end(),
+                   [&keys](unsigned long a, unsigned long b) { return keys[a]<keys[b]; });
+
+  // The keys are saved with the rows, block after block
+  std::vector<std::string> runColumnNames(columnNames);
+  runColumnNames.push_back(keyColumnName);
+  ColumnarCatalogWriter writer(runFilename, runColumnNames);
+  std::vector<std::vector<double> > block(runColumnNames.size(), std::vector<double>(blockRows));
+  std::vector<const double*> blockColumns;
+  for (auto &column : block)
+  {
+    blockColumns.push_back(column.data());
+  }
+  for (unsigned long first=0; first<keys.size(); first+=blockRows)
+  {
+    unsigned long nbRows = std::min(blockRows, keys.size()-first);
+    for (unsigned int c=0; c<columns.size(); c++)
+    {
+      for (unsigned long i=0; i<nbRows; i++)
+      {
+        block[c][i] = columns[c][sortedRows[first+i]];
+      }
+    }
+    for (unsigned long i=0; i<nbRows; i++)
+    {
+      block.back()[i] = keys[sortedRows[first+i]];
+    }
+    if (writer.appendRows(blockColumns, nbRows)==false)
+    {
+      return false;
+    }
+  }
+
+  return writer.close();
+}
+
+bool SpatialSorter::mergeRuns(const std::vector<std::string> &runFilenames, const std::vector<std::string> &columnNames,
+                              const std::string &keyRa, const std::string &keyDec, const std::string &keyZ)
+{
+  // Map the runs
+  std::vector<std::unique_ptr<ColumnarCatalog> > runs;
+  std::vector<std::vector<const double*> > runColumns;
+  std::vector<const double*> runKeys;
+  for (auto &runFilename : runFilenames)
+  {
+    runs.emplace_back(new ColumnarCatalog(runFilename));
+    if (runs.back()->isValid()==false)
+    {
+      return false;
+    }
+    runColumns.push_back(std::vector<const double*>());
+    for (auto &name : columnNames)
+    {
+      runColumns.back().push_back(runs.back()->getColumn(name));
+    }
+    runKeys.push_back(runs.back()->getColumn(keyColumnName));
+  }
+
+  // The next row of each run, the runs being taken in their order for the same key
+  typedef std::pair<double, unsigned int> RunHead;
+  std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead> > heads;
+  std::vector<unsigned long> nextRows(runs.size(), 0);
+  for (unsigned int r=0; r<runs.size(); r++)
+  {
+    if (runs[r]->getNbRows()>0)
+    {
+      heads.push(RunHead(runKeys[r][0], r));
+    }
+  }
+
+  // The shear convention of a columnar catalog is kept
+  unsigned int flags = 0;
+  if (ColumnarCatalog::isColumnarCatalog(m_inputCatalogFilename))
+  {
+    flags = ColumnarCatalog(m_inputCatalogFilename).getFlags();
+  }
+
+  // The sorted rows are written block after block, and indexed
+  ColumnarCatalogWriter writer(m_outputCatalogFilename, columnNames, blockRows, flags);
+  CatalogKeyIndex keyIndex(m_keyType, m_order, m_indexOrder);
+  keyIndex.setColumnNames(keyRa, keyDec, keyZ);
+  std::vector<std::vector<double> > block(columnNames.size(), std::vector<double>(blockRows));
+  std::vector<const double*> blockColumns;
+  for (auto &column : block)
+  {
+    blockColumns.push_back(column.data());
+  }
+  std::vector<unsigned long> blockKeys(blockRows);
+  long raIndex = std::find(columnNames.begin(), columnNames.end(), keyRa) - columnNames.begin();
+  long decIndex = std::find(columnNames.begin(), columnNames.end(), keyDec) - columnNames.begin();
+  long zIndex = std::find(columnNames.begin(), columnNames.end(), keyZ) - columnNames.begin();
+  const double *blockZ = keyZ.empty() ? nullptr : block[zIndex].data();
+
+  unsigned long nbRows(0);
+  while (heads.empty()==false || nbRows>0)
+  {
+    if (heads.empty()==false)
+    {
+      unsigned int r = heads.top().second;
+      heads.pop();
+      unsigned long row = nextRows[r]++;
+      for (unsigned int c=0; c<columnNames.size(); c++)
+      {
+        block[c][nbRows] = runColumns[r][c][row];
+      }
+      blockKeys[nbRows] = runKeys[r][row];
+      nbRows++;
+      if (nextRows[r]<runs[r]->getNbRows())
+      {
+        heads.push(RunHead(runKeys[r][nextRows[r]], r));
+      }
+    }
+
+    // Write a full block, or the last one
+    if (nbRows==blockRows || (heads.empty() && nbRows>0))
+    {
+      if (writer.appendRows(blockColumns, nbRows)==false)
+      {
+        return false;
+      }
+      keyIndex.addRows(nbRows, blockKeys.data(), block[raIndex].data(), block[decIndex].data(), blockZ);
+      nbRows = 0;
+    }
+  }
+
+  // The index is saved once the sorted catalog is written, not to be older than it
+  if (writer.close()==false)
+  {
+    return false;
+  }
+  if (keyIndex.save(m_outputCatalogFilename)==false)
+  {
+    std::cout<<"the key index of "<<m_outputCatalogFilename<<" could not be saved"<<std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+} // TWOD_MASS_WL_CatalogSplitter namespace
@@ -26,6 +26,8 @@
 
 #include "TWOD_MASS_WL_CatalogSplitter/BasicSplitter.h"
 
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+
 #include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
 
 using namespace TWOD_MASS_WL_CatalogSplitter;
@@ -94,6 +96,46 @@ BOOST_AUTO_TEST_CASE( getCenterOfPatches_test ) {
 }
 
 
+BOOST_AUTO_TEST_CASE( maskOfCatalogZoneMap_test ) {
+  TWOD_MASS_WL_MassMapping::Boundaries boundaries(0, 90, 0, 90, 0, 10);
+
+  // Galaxies sorted by declination, most blocks lying inside a single patch
+  std::vector<double> ra, dec, z;
+  for (unsigned int i=0; i<2000; i++)
+  {
+    ra.push_back(0.5+0.0245*i);
+    dec.push_back(-40.+0.04*i);
+    z.push_back(0.5);
+  }
+
+  // The same galaxies in a catalog whose block ranges are its zone map, and in a catalog whose
+  // column names are not the ones of the zone map
+  std::string zoneCatalog = pathFiles+"tmp/columnarCatalog_zonePatches.bin";
+  TWOD_MASS_WL_MassMapping::ColumnarCatalogWriter myZoneWriter(zoneCatalog, {"ra", "dec", "z"}, 20);
+  BOOST_REQUIRE(myZoneWriter.appendRows({ra.data(), dec.data(), z.data()}, ra.size())==true);
+  BOOST_REQUIRE(myZoneWriter.close()==true);
+  std::string rowCatalog = pathFiles+"tmp/columnarCatalog_rowPatches.bin";
+  TWOD_MASS_WL_MassMapping::ColumnarCatalogWriter myRowWriter(rowCatalog,
+                                                              {"RightAsc", "Declination", "redshift"}, 20);
+  BOOST_REQUIRE(myRowWriter.appendRows({ra.data(), dec.data(), z.data()}, ra.size())==true);
+  BOOST_REQUIRE(myRowWriter.close()==true);
+
+  // Check the patches holding galaxies are the same whether the zones are read or not
+  BasicSplitter myZoneSplitter(zoneCatalog, pathFiles+"tmp/dummyOutput.fits", 2, 2, 2, boundaries);
+  BasicSplitter myRowSplitter(rowCatalog, pathFiles+"tmp/dummyOutput.fits", 2, 2, 2, boundaries);
+  std::vector<std::pair<float, float> > myZoneCenters = myZoneSplitter.getCenterOfPatches();
+  std::vector<std::pair<float, float> > myRowCenters = myRowSplitter.getCenterOfPatches();
+  std::vector<std::pair<float, float> > myZonePatches = myZoneSplitter.getMaskOfCatalog(myZoneCenters);
+  std::vector<std::pair<float, float> > myRowPatches = myRowSplitter.getMaskOfCatalog(myRowCenters);
+  BOOST_REQUIRE(myZonePatches.size()==myRowPatches.size());
+  BOOST_CHECK(myZonePatches.size()>1);
+  for (unsigned int i=0; i<myZonePatches.size(); i++)
+  {
+    BOOST_CHECK_EQUAL(myZonePatches[i].first, myRowPatches[i].first);
+    BOOST_CHECK_EQUAL(myZonePatches[i].second, myRowPatches[i].second);
+  }
+}
+
 //-----------------------------------------------------------------------------
 
 BOOST_AUTO_TEST_SUITE_END ()
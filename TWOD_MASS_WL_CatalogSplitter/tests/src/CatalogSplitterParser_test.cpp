@@ -67,6 +67,31 @@ BOOST_AUTO_TEST_CASE( missingParameters_test ) {
 
 }
 
+BOOST_AUTO_TEST_CASE( sortingParameters_test ) {
+
+  CatalogSplitterParser myParser;
+  std::map<std::string, po::variable_value> args;
+
+  // Sorting a catalog only needs the input catalog
+  args["sortedCatalog"] = po::variable_value(boost::any(std::string("dummySorted.bin")), false);
+  BOOST_CHECK(myParser.parseInputParameters(args) == false);
+
+  args["inputFITSCatalog"] = po::variable_value(boost::any(std::string("dummyCatalog.fits")), false);
+  BOOST_CHECK(myParser.parseInputParameters(args) == true);
+
+  // The space filling curve should be a known one
+  args["sortingKey"] = po::variable_value(boost::any(std::string("morton")), false);
+  BOOST_CHECK(myParser.parseInputParameters(args) == true);
+
+  args["sortingKey"] = po::variable_value(boost::any(std::string("hilbert")), false);
+  BOOST_CHECK(myParser.parseInputParameters(args) == false);
+
+  // The number of rows sorted in memory should be positive
+  args["sortingKey"] = po::variable_value(boost::any(std::string("nested")), false);
+  args["sortingMaxRows"] = po::variable_value(boost::any(0), false);
+  BOOST_CHECK(myParser.parseInputParameters(args) == false);
+}
+
 //-----------------------------------------------------------------------------
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -26,6 +26,8 @@
 
 #include "TWOD_MASS_WL_CatalogSplitter/MaskSplitter.h"
 
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+
 #include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
 
 using namespace TWOD_MASS_WL_CatalogSplitter;
@@ -92,6 +94,91 @@ BOOST_AUTO_TEST_CASE( basicMaskCatalogwithZ_test ) {
   BOOST_CHECK(myBoundaries.size()!=0);
 }
 
+BOOST_AUTO_TEST_CASE( basicMaskColumnarCatalog_test ) {
+
+  // Write a catalog in the columnar format with galaxies at dec 12 between ra 20 and 30
+  std::string inputCatalog = pathFiles+"tmp/columnarCatalog_mask.bin";
+  std::vector<double> ra, dec, z;
+  for (unsigned int i=0; i<=100; i++)
+  {
+    ra.push_back(20.+0.1*i);
+    dec.push_back(12.);
+    z.push_back(0.5+0.01*i);
+  }
+  TWOD_MASS_WL_MassMapping::ColumnarCatalogWriter myWriter(inputCatalog, {"ra", "dec", "z"}, 16);
+  BOOST_REQUIRE(myWriter.appendRows({ra.data(), dec.data(), z.data()}, ra.size())==true);
+  BOOST_REQUIRE(myWriter.close()==true);
+
+  // Define the steps for ra, dec and z
+  float raStep = 10.;
+  float decStep = 5.;
+  float zStep = 1.;
+
+  // Create the MaskSplitter object
+  MaskSplitter mySplitter(inputCatalog, raStep, decStep, zStep);
+
+  // Get the mask from the catalog
+  std::vector<std::pair<float, float> > myMask = mySplitter.fillBasicMask();
+
+  // Check only the declination band of the galaxies is filled
+  BOOST_REQUIRE(myMask.size()==36);
+  BOOST_CHECK_CLOSE(myMask[20].first, 20., 0.001);
+  BOOST_CHECK_CLOSE(myMask[20].second, 30., 0.001);
+  BOOST_CHECK(myMask[19].first>myMask[19].second);
+
+  // Check the patches cover the galaxies with their redshifts
+  std::vector<TWOD_MASS_WL_MassMapping::Boundaries> myBoundaries = mySplitter.getBoundariesFromBasicMask(myMask);
+  BOOST_REQUIRE(myBoundaries.size()!=0);
+  BOOST_CHECK_CLOSE(myBoundaries[0].getRaMin(), 20., 0.001);
+  BOOST_CHECK_CLOSE(myBoundaries[0].getDecMin(), 10., 0.001);
+  BOOST_CHECK_CLOSE(myBoundaries[0].getZMin(), 0.5, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE( basicMaskZoneMap_test ) {
+
+  // Galaxies sorted by declination, most blocks lying in a single declination band
+  std::vector<double> ra, dec, z;
+  for (unsigned int i=0; i<1000; i++)
+  {
+    ra.push_back(20.+0.037*((i*7)%100));
+    dec.push_back(-30.+0.05*i);
+    z.push_back(0.2+0.001*((i*13)%1000));
+  }
+
+  // The same galaxies in a catalog with ra, dec and z columns, whose block ranges are its zone map,
+  // and in a catalog whose column names are not the ones of the zone map
+  std::string zoneCatalog = pathFiles+"tmp/columnarCatalog_zoneMask.bin";
+  TWOD_MASS_WL_MassMapping::ColumnarCatalogWriter myZoneWriter(zoneCatalog, {"ra", "dec", "z"}, 60);
+  BOOST_REQUIRE(myZoneWriter.appendRows({ra.data(), dec.data(), z.data()}, ra.size())==true);
+  BOOST_REQUIRE(myZoneWriter.close()==true);
+  std::string rowCatalog = pathFiles+"tmp/columnarCatalog_rowMask.bin";
+  TWOD_MASS_WL_MassMapping::ColumnarCatalogWriter myRowWriter(rowCatalog,
+                                                              {"RightAsc", "Declination", "redshift"}, 60);
+  BOOST_REQUIRE(myRowWriter.appendRows({ra.data(), dec.data(), z.data()}, ra.size())==true);
+  BOOST_REQUIRE(myRowWriter.close()==true);
+
+  // Check the masks and redshift ranges are the same whether the zones are read or not
+  MaskSplitter myZoneSplitter(zoneCatalog, 10., 5., 1.);
+  MaskSplitter myRowSplitter(rowCatalog, 10., 5., 1.);
+  std::vector<std::pair<float, float> > myZoneMask = myZoneSplitter.fillBasicMask();
+  std::vector<std::pair<float, float> > myRowMask = myRowSplitter.fillBasicMask();
+  BOOST_REQUIRE(myZoneMask.size()==36);
+  BOOST_REQUIRE(myRowMask.size()==36);
+  for (unsigned int i=0; i<myZoneMask.size(); i++)
+  {
+    BOOST_CHECK_EQUAL(myZoneMask[i].first, myRowMask[i].first);
+    BOOST_CHECK_EQUAL(myZoneMask[i].second, myRowMask[i].second);
+  }
+  std::vector<TWOD_MASS_WL_MassMapping::Boundaries> myZoneBoundaries =
+      myZoneSplitter.getBoundariesFromBasicMask(myZoneMask);
+  std::vector<TWOD_MASS_WL_MassMapping::Boundaries> myRowBoundaries =
+      myRowSplitter.getBoundariesFromBasicMask(myRowMask);
+  BOOST_REQUIRE(myZoneBoundaries.size()==myRowBoundaries.size());
+  BOOST_REQUIRE(myZoneBoundaries.size()!=0);
+  BOOST_CHECK_EQUAL(myZoneBoundaries[0].getZMin(), myRowBoundaries[0].getZMin());
+  BOOST_CHECK_EQUAL(myZoneBoundaries[0].getZMax(), myRowBoundaries[0].getZMax());
+}
+
 //-----------------------------------------------------------------------------
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/SpatialSorter_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_CatalogSplitter/SpatialSorter.h"
+
+#include "TWOD_MASS_WL_MapMaker/ColumnarCatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/FITSCatalogHandler.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+
+using namespace TWOD_MASS_WL_CatalogSplitter;
+using namespace TWOD_MASS_WL_MassMapping;
+using namespace TWOD_MASS_WL_MapMaker;
+
+DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (SpatialSorter_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( badInputCatalog_test ) {
+
+  // Check with a non existing file it will return false
+  SpatialSorter mySorter("fakeCatalog.fits", pathFiles+"tmp/dummySorted.bin");
+  BOOST_CHECK(mySorter.sortCatalog()==false);
+
+  // Check with a catalog without positions it will return false
+  std::string inputCatalog = pathFiles+"tmp/columnarCatalog_noPosition.bin";
+  std::vector<double> gamma(10, 0.1);
+  ColumnarCatalogWriter myWriter(inputCatalog, {"gamma1", "gamma2"});
+  BOOST_REQUIRE(myWriter.appendRows({gamma.data(), gamma.data()}, gamma.size())==true);
+  BOOST_REQUIRE(myWriter.close()==true);
+  SpatialSorter mySorter2(inputCatalog, pathFiles+"tmp/dummySorted.bin");
+  BOOST_CHECK(mySorter2.sortCatalog()==false);
+}
+
+BOOST_AUTO_TEST_CASE( sortedCatalog_test ) {
+
+  // Galaxies ordered by observation tile rather than by position
+  std::vector<double> ra, dec, z, id;
+  for (unsigned int i=0; i<5000; i++)
+  {
+    ra.push_back(30.+0.0073*((i*7919)%5000));
+    dec.push_back(-20.+0.0061*((i*104729)%5000));
+    z.push_back(0.2+0.0002*i);
+    id.push_back(i);
+  }
+  std::string inputCatalog = pathFiles+"tmp/columnarCatalog_unsorted.bin";
+  ColumnarCatalogWriter myWriter(inputCatalog, {"ra", "dec", "z", "id"}, 1000, 1);
+  BOOST_REQUIRE(myWriter.appendRows({ra.data(), dec.data(), z.data(), id.data()}, ra.size())==true);
+  BOOST_REQUIRE(myWriter.close()==true);
+
+  for (spatialKey keyType : {nestedPixelKey, mortonKey})
+  {
+    // Sort the catalog in runs of 700 rows
+    std::string sortedCatalog = pathFiles+"tmp/columnarCatalog_sorted.bin";
+    SpatialSorter mySorter(inputCatalog, sortedCatalog, keyType, 16, 5, 700);
+    BOOST_REQUIRE(mySorter.sortCatalog()==true);
+
+    // Check all the galaxies are kept, sorted by key, and the flags of the catalog too
+    ColumnarCatalog mySortedCatalog(sortedCatalog);
+    BOOST_REQUIRE(mySortedCatalog.isValid());
+    BOOST_REQUIRE(mySortedCatalog.getNbRows()==ra.size());
+    BOOST_CHECK(mySortedCatalog.getFlags()==1);
+    BOOST_CHECK(mySortedCatalog.getColumn("spatialKey")==nullptr);
+    const double *sortedRa = mySortedCatalog.getColumn("ra");
+    const double *sortedDec = mySortedCatalog.getColumn("dec");
+    const double *sortedZ = mySortedCatalog.getColumn("z");
+    const double *sortedId = mySortedCatalog.getColumn("id");
+    std::vector<bool> found(ra.size(), false);
+    unsigned long previousKey = 0;
+    for (unsigned long i=0; i<mySortedCatalog.getNbRows(); i++)
+    {
+      unsigned long galaxy = sortedId[i];
+      BOOST_REQUIRE(galaxy<ra.size());
+      BOOST_CHECK(found[galaxy]==false);
+      found[galaxy] = true;
+      BOOST_CHECK(sortedRa[i]==ra[galaxy] && sortedDec[i]==dec[galaxy] && sortedZ[i]==z[galaxy]);
+      unsigned long key = CatalogKeyIndex::getKey(keyType, 16, sortedRa[i], sortedDec[i]);
+      BOOST_CHECK(key>=previousKey);
+      previousKey = key;
+    }
+
+    // Check the key index gives the galaxies of a patch in a few ranges of rows
+    CatalogKeyIndex myIndex;
+    BOOST_REQUIRE(myIndex.load(sortedCatalog)==true);
+    BOOST_CHECK(myIndex.getKeyType()==keyType);
+    BOOST_CHECK(myIndex.getNbRows()==ra.size());
+    std::vector<std::pair<unsigned long, unsigned long> > ranges = myIndex.getRowRanges(40., 50., -10., 0., 0., 10.);
+    BOOST_REQUIRE(ranges.empty()==false);
+    unsigned long rangeRows = 0;
+    std::vector<bool> inRange(ra.size(), false);
+    for (auto &range : ranges)
+    {
+      rangeRows += range.second;
+      for (unsigned long i=range.first; i<range.first+range.second; i++)
+      {
+        inRange[i] = true;
+      }
+    }
+    BOOST_CHECK(rangeRows<ra.size()/2);
+    for (unsigned long i=0; i<mySortedCatalog.getNbRows(); i++)
+    {
+      if (sortedRa[i]>=40. && sortedRa[i]<=50. && sortedDec[i]>=-10. && sortedDec[i]<=0.)
+      {
+        BOOST_CHECK(inRange[i]);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( fitsColumnNames_test ) {
+
+  // A FITS catalog whose columns do not have the names of the columnar catalogs
+  std::vector<std::vector<double> > data(6);
+  for (unsigned int i=0; i<4000; i++)
+  {
+    data[0].push_back(30.+0.0051*((i*7919)%4000));
+    data[1].push_back(-20.+0.0047*((i*104729)%4000));
+    data[2].push_back(0.2+0.0002*i);
+    data[3].push_back(0.01*((i%11)-5.));
+    data[4].push_back(0.01*((i%13)-6.));
+    data[5].push_back(1.+0.1*(i%7));
+  }
+  std::vector<std::vector<std::string> > columns = {
+    {"RightAsc", "Declination", "redshift", "shear_gamma1", "shear_gamma2", "galweight"},
+    std::vector<std::string>(6, "D"), std::vector<std::string>(6, "")};
+  std::string inputCatalog = pathFiles+"tmp/fitsCatalog_unsorted.fits";
+  FITSCatalogHandler myFITSCatalog(inputCatalog);
+  BOOST_REQUIRE(myFITSCatalog.saveAsFitsCatalog(data, columns)==true);
+
+  // The sorted catalog and its key index have the names read by the columnar catalog handler
+  std::string sortedCatalog = pathFiles+"tmp/fitsCatalog_sorted.bin";
+  SpatialSorter mySorter(inputCatalog, sortedCatalog, nestedPixelKey, 16, 5, 1500);
+  BOOST_REQUIRE(mySorter.sortCatalog()==true);
+  ColumnarCatalog mySortedCatalog(sortedCatalog);
+  BOOST_REQUIRE(mySortedCatalog.isValid());
+  for (std::string name : {"ra", "dec", "z", "gamma1", "gamma2", "weight"})
+  {
+    BOOST_CHECK(mySortedCatalog.getColumn(name)!=nullptr);
+  }
+  CatalogKeyIndex myIndex;
+  myIndex.setColumnNames("ra", "dec", "z");
+  BOOST_REQUIRE(myIndex.load(sortedCatalog)==true);
+  Boundaries bounds(35, 45, -15, -5, 0, 10);
+  unsigned long rangeRows = 0;
+  for (auto &range : myIndex.getRowRanges(35, 45, -15, -5, 0, 10))
+  {
+    rangeRows += range.second;
+  }
+  BOOST_CHECK(rangeRows>0 && rangeRows<data[0].size());
+
+  // The maps of a patch read through the key index are the ones of the input catalog
+  ColumnarCatalogHandler myColumnarCatalog(sortedCatalog);
+  std::vector<productEnum> products = {shearProduct, densityProduct};
+  BOOST_REQUIRE(myFITSCatalog.getMaps(products, bounds, 32, 32)==true);
+  BOOST_REQUIRE(myColumnarCatalog.getMaps(products, bounds, 32, 32)==true);
+  double density(0.);
+  for (unsigned int i=0; i<32; i++)
+  {
+    for (unsigned int j=0; j<32; j++)
+    {
+      density += myColumnarCatalog.getDensityMap()->getBinValue(i, j, 0);
+      BOOST_CHECK_CLOSE(myColumnarCatalog.getDensityMap()->getBinValue(i, j, 0),
+                        myFITSCatalog.getDensityMap()->getBinValue(i, j, 0), 0.0001);
+      BOOST_CHECK_SMALL(myColumnarCatalog.getProductShearMap()->getBinValue(i, j, 0)
+                        -myFITSCatalog.getProductShearMap()->getBinValue(i, j, 0), 1e-9);
+    }
+  }
+  BOOST_CHECK(density>0.);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
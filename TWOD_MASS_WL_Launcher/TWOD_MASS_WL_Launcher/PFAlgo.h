@@ -28,6 +28,11 @@
 #include <string>
 #include "TWOD_MASS_WL_MassMapping/Boundaries.h"
 
+namespace TWOD_MASS_WL_MassMapping {
+class ShearMap;
+class GlobalMap;
+}
+
 namespace TWOD_MASS_WL_Launcher {
 
 /**
@@ -53,7 +58,7 @@ public:
    * @param[in] variancePerScale set to true to force same variance in and out of the mask
    * @param[in] gaussianSmoothing the value of the gaussian smoothing
    * @param[in] denoisingVal the value of the denoising
-   * @param[in] inputFITSCatalog the filename of the input FITS catalog
+   * @param[in] inputFITSCatalog the filename of the input FITS catalog, or of a catalog in the columnar format
    * @param[in] inputSSVCatalog the filename of the input SSV catalog
    * @param[in] outputPeakCatalog the root filename of the output peak catalog
    * @param[in] outputConvergenceMap root the filename of the output convergence map
@@ -78,24 +83,64 @@ public:
    */
   bool checkParameters();
 
+  /**
+   * @brief Method to also save the intermediate maps of each patch
+   * @param[in] intermediateProductFile the filename of the FITS file receiving the shear, density
+   * and convergence maps as extensions, empty for no intermediate output (default)
+   */
+  void setIntermediateProductFile(std::string intermediateProductFile);
+
+  /**
+   * @brief Method to set the number of patches whose maps are extracted in a single pass over the catalog
+   * @param[in] patchesPerScan the number of patches of each pass (32 by default)
+   *
+   * The shear and density maps of each patch of a pass are kept until the patch is processed,
+   * i.e. three plans of doubles of the size of the maps, so that the memory grows as the number
+   * of patches per scan times the number of bins of a patch
+   *
+   */
+  void setPatchesPerScan(unsigned int patchesPerScan);
+
   /**
    * @brief Method to perform all the processing function
    * @param[in] outputPeakMap the filename of the output peak catalog
    * @param[in] outputConvMap the filename of the output convergence map
    * @param[in] boundaries the right ascension, declination and redshift min and max
+   * @param[in] intermediateProductFile the filename of the FITS file receiving the intermediate
+   * maps as extensions, empty for no intermediate output (default)
    * @return true if the processing function is well performed, false otherwise
+   *
+   * The maps are given from one stage to the next in memory, only the requested outputs are written
+   *
    */
   bool performProcessingFunction(std::string outputPeakMap, std::string outputConvMap,
-      TWOD_MASS_WL_MassMapping::Boundaries boundaries);
+      TWOD_MASS_WL_MassMapping::Boundaries boundaries, std::string intermediateProductFile = "");
 
   /**
    * @brief Method that computes the mask and launch the PF parallelized on every patches inside the mask
    * @return true if every patches went through the PF process, false otherwise
+   *
+   * The maps of the patches are extracted by groups of patches, each group in a single pass over the
+   * catalog, and the patches of the group are then processed in parallel
+   *
    */
   bool launchParalPF();
 
 private:
 
+  /**
+   * @brief Method to perform the processing function from the maps of a patch
+   * @param[in] shearMap the shear map of the patch
+   * @param[in] densityMap the galaxy density map of the patch
+   * @param[in] outputPeakMap the filename of the output peak catalog
+   * @param[in] outputConvMap the filename of the output convergence map
+   * @param[in] convMapFITSfile the filename of the intermediate convergence map, empty for none
+   * @return true if the processing function is well performed, false otherwise
+   */
+  bool processPatchMaps(TWOD_MASS_WL_MassMapping::ShearMap &shearMap,
+                        TWOD_MASS_WL_MassMapping::GlobalMap &densityMap,
+                        std::string outputPeakMap, std::string outputConvMap, std::string convMapFITSfile);
+
   bool m_bModes;
   unsigned int m_nbIterInpainting;
   unsigned int m_nbIterReducedShear;
@@ -112,6 +157,8 @@ private:
   float m_zStep;
   bool m_squareMap;
   TWOD_MASS_WL_MassMapping::Boundaries m_boundaries;
+  std::string m_intermediateProductFile;
+  unsigned int m_patchesPerScan;
 
 
 }; /* End of PFAlgo class */
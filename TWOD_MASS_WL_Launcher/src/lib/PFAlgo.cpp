@@ -23,9 +23,14 @@
  */
 
 #include "TWOD_MASS_WL_Launcher/PFAlgo.h"
-#include "TWOD_MASS_WL_MapMaker/MapMakerParser.h"
-#include "TWOD_MASS_WL_MassMapping/MassMappingParser.h"
-#include "TWOD_MASS_WL_PeakCount/PeakCountParser.h"
+#include "TWOD_MASS_WL_MapMaker/ColumnarCatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/FITSCatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/MapMakerStage.h"
+#include "TWOD_MASS_WL_MapMaker/SSVCatalogHandler.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+#include "TWOD_MASS_WL_MassMapping/MassMappingStage.h"
+#include "TWOD_MASS_WL_MassMapping/ReducedShearSolver.h"
+#include "TWOD_MASS_WL_PeakCount/PeakCountStage.h"
 #include "TWOD_MASS_WL_CatalogSplitter/MaskSplitter.h"
 
 #include "TWOD_MASS_WL_MassMapping/ShearMap.h"
@@ -35,12 +40,32 @@
 #include <omp.h>
 #endif
 
+#include <algorithm>
+#include <iostream>
+
 #include <boost/program_options.hpp>
 
 namespace po = boost::program_options;
 
 namespace TWOD_MASS_WL_Launcher {
 
+namespace {
+// Number of bins of the maps on each axis
+const unsigned int nbBins = 1024;
+
+// Gives the file of a patch a unique name, the index of the patch being inserted before the
+// .fits extension or appended to a name without it. An empty name stays empty
+std::string getPatchFilename(const std::string &filename, unsigned int index)
+{
+  std::string patchFilename = filename;
+  if (patchFilename.empty()==false)
+  {
+    std::size_t found = patchFilename.rfind(".fits");
+    patchFilename.insert(found!=std::string::npos ? found : patchFilename.size(), std::to_string(index));
+  }
+  return patchFilename;
+}
+}
 
 PFAlgo::PFAlgo(bool bModes, unsigned int nbIterInpainting, unsigned int nbIterReducedShear,
                unsigned int nbScaleInpainting, bool variancePerScale, float gaussianSmoothing, float denoisingVal,
@@ -54,8 +79,19 @@ PFAlgo::PFAlgo(bool bModes, unsigned int nbIterInpainting, unsigned int nbIterRe
                    m_inputSSVCatalog(inputSSVCatalog), m_outputPeakCatalog(outputPeakCatalog),
                    m_outputConvergenceMap(outputConvergenceMap), m_raStep(raStep),
                    m_decStep(decStep), m_zStep(zStep),
-                   m_squareMap(squareMap), m_boundaries(boundaries)
+                   m_squareMap(squareMap), m_boundaries(boundaries), m_intermediateProductFile(""),
+                   m_patchesPerScan(32)
+{
+}
+
+void PFAlgo::setIntermediateProductFile(std::string intermediateProductFile)
+{
+  m_intermediateProductFile = intermediateProductFile;
+}
+
+void PFAlgo::setPatchesPerScan(unsigned int patchesPerScan)
 {
+  m_patchesPerScan = patchesPerScan>0 ? patchesPerScan : 1;
 }
 
 bool PFAlgo::checkParameters()
@@ -94,7 +130,7 @@ bool PFAlgo::checkParameters()
 }
 
 bool PFAlgo::performProcessingFunction(std::string outputPeakMap, std::string outputConvMap,
-    TWOD_MASS_WL_MassMapping::Boundaries boundaries)
+    TWOD_MASS_WL_MassMapping::Boundaries boundaries, std::string intermediateProductFile)
 {
   // Check parameters are valid
   if (outputPeakMap.empty()==true && outputConvMap.empty()==true)
@@ -108,121 +144,98 @@ bool PFAlgo::performProcessingFunction(std::string outputPeakMap, std::string ou
     return false;
   }
 
-  // Create a map of parameters
-  std::map<std::string, po::variable_value> params;
-
-  // Define the place where to put the temporary shear map
-  std::string shearMapFITSfile = "/tmp/tmpShearMapLauncher"
-#ifdef _OPENMP
-                                 +std::to_string(omp_get_thread_num())
-#endif
-                                 +".fits";
+  // The maps are given from one stage to the next in memory, the intermediate maps
+  // are only written as extensions of a product file if asked
+  std::string shearMapFITSfile = "";
+  std::string densityMapFITSfile = "";
+  std::string convMapFITSfile = "";
+  if (intermediateProductFile.empty()==false)
+  {
+    shearMapFITSfile = intermediateProductFile + "[" + TWOD_MASS_WL_MassMapping::shearExtension + "]";
+    densityMapFITSfile = intermediateProductFile + "[" + TWOD_MASS_WL_MassMapping::densityExtension + "]";
+    convMapFITSfile = intermediateProductFile + "[" + TWOD_MASS_WL_MassMapping::convergenceExtension + "]";
+  }
 
   /////////////////////////////////////
-  /// Provide all needed parameters for the MapMaker module
+  /// Perform the map making from the catalog
   /////////////////////////////////////
 
-  // Temp: add bins, ra and dec min max
-  params["outputMapBinXY"] = po::variable_value(boost::any(std::vector<int>(2, 1024)), false);
-  std::vector<float> raMinMax;
-  raMinMax.push_back(boundaries.getRaMin());
-  raMinMax.push_back(boundaries.getRaMax());
-  params["raMinMax"] = po::variable_value(boost::any(raMinMax), false);
-  std::vector<float> decMinMax;
-  decMinMax.push_back(boundaries.getDecMin());
-  decMinMax.push_back(boundaries.getDecMax());
-  params["decMinMax"] = po::variable_value(boost::any(decMinMax), false);
-  std::vector<float> zMinMax;
-  zMinMax.push_back(boundaries.getZMin());
-  zMinMax.push_back(boundaries.getZMax());
-  params["zMinMax"] = po::variable_value(boost::any(zMinMax), false);
-  params["squareMap"] = po::variable_value(boost::any(m_squareMap?int(1):int(0)), false);
-
-
-  if (m_inputFITSCatalog.empty()==false)
+  TWOD_MASS_WL_MapMaker::MapMakerStage myMapMakerStage(nbBins, nbBins, m_squareMap);
+  myMapMakerStage.setOutputFiles(shearMapFITSfile, densityMapFITSfile);
+
+  bool mapsOK = false;
+  if (TWOD_MASS_WL_MassMapping::ColumnarCatalog::isColumnarCatalog(m_inputFITSCatalog))
   {
-    params["inputFITSCatalog"] = po::variable_value(boost::any(m_inputFITSCatalog), false);
+    TWOD_MASS_WL_MapMaker::ColumnarCatalogHandler myCatalog(m_inputFITSCatalog);
+    mapsOK = myMapMakerStage.extractMaps(myCatalog, boundaries);
+  }
+  else if (m_inputFITSCatalog.empty()==false)
+  {
+    TWOD_MASS_WL_MapMaker::FITSCatalogHandler myCatalog(m_inputFITSCatalog);
+    mapsOK = myMapMakerStage.extractMaps(myCatalog, boundaries);
   }
   else if (m_inputSSVCatalog.empty()==false)
   {
-    params["inputSSVCatalog"] = po::variable_value(boost::any(m_inputSSVCatalog), false);
+    TWOD_MASS_WL_MapMaker::SSVCatalogHandler myCatalog(m_inputSSVCatalog);
+    mapsOK = myMapMakerStage.extractMaps(myCatalog, boundaries);
   }
-  params["outputShearMapFITS"] = po::variable_value(boost::any(std::string(shearMapFITSfile)), false);
-
-  // Perform the map making from the catalog
-  TWOD_MASS_WL_MapMaker::MapMakerParser myMapMakerParser;
-  if (myMapMakerParser.mainMethod(params)!=Elements::ExitCode::OK)
+  if (mapsOK==false || myMapMakerStage.getDensityMap()==nullptr)
   {
     return false;
   }
 
+  return processPatchMaps(*myMapMakerStage.getShearMap(), *myMapMakerStage.getDensityMap(),
+                          outputPeakMap, outputConvMap, convMapFITSfile);
+}
+
+bool PFAlgo::processPatchMaps(TWOD_MASS_WL_MassMapping::ShearMap &shearMap,
+                              TWOD_MASS_WL_MassMapping::GlobalMap &densityMap,
+                              std::string outputPeakMap, std::string outputConvMap, std::string convMapFITSfile)
+{
   /////////////////////////////////////
-  /// Perform the reduced shear iterations
+  /// Perform the mass mapping with the reduced shear iterations
   /////////////////////////////////////
 
-  if (m_nbIterReducedShear<1)
+  //  m_denoisingVal
+  TWOD_MASS_WL_MassMapping::MassMappingStage myMassMappingStage(m_nbIterInpainting, m_nbScaleInpainting,
+                                                                m_variancePerScale, m_bModes);
+  myMassMappingStage.setGaussianFilter(m_gaussianSmoothing, m_gaussianSmoothing);
+  myMassMappingStage.setOutputFile(convMapFITSfile);
+
+  // The reduced shear iterations are performed in memory from the original shear map
+  TWOD_MASS_WL_MassMapping::ReducedShearSolver myReducedShearSolver(shearMap, m_nbIterReducedShear);
+  if (myReducedShearSolver.solve(myMassMappingStage)==false)
   {
-    m_nbIterReducedShear = 1;
+    return false;
   }
-  for (unsigned int reducedIter = 0; reducedIter<m_nbIterReducedShear; reducedIter++)
-  {
-    /////////////////////////////////////
-    /// Provide all needed parameters for the MassMapping module
-    /////////////////////////////////////
+  TWOD_MASS_WL_MassMapping::ConvergenceMap &convMap = *myMassMappingStage.getConvergenceMap();
 
-    // First change the output shear map to an input shear map
-    params["inputShearMapFITS"] = po::variable_value(boost::any(std::string(shearMapFITSfile)), false);
-    params.erase("outputShearMapFITS");
-
-    // Then provide all other input parameters
-    //  m_denoisingVal
+  if (outputConvMap.empty()==false)
+  {
+    std::map<std::string, po::variable_value> params;
     params["numberIteration"] = po::variable_value(boost::any(int(m_nbIterInpainting)), false);
     params["bModeZeros"] = po::variable_value(boost::any(m_bModes?int(1):int(0)), false);
     params["sigmaBounded"] = po::variable_value(boost::any(m_variancePerScale?1:0), false);
-    params["outputConvMapFITS"] = po::variable_value(boost::any(outputConvMap), false);
     params["numberScales"] = po::variable_value(boost::any(int(m_nbScaleInpainting)), false);
-    params["sigmaConvMap"] = po::variable_value(boost::any(std::vector<float>(2, m_gaussianSmoothing)), false);
-    params["ReducedShearIteration"] = po::variable_value(boost::any(int(m_nbIterReducedShear)), false);
-
-    // Perform the mass mapping
-    TWOD_MASS_WL_MassMapping::MassMappingParser myMassMappingParser;
-    if (myMassMappingParser.mainMethod(params)!=Elements::ExitCode::OK)
+    params["ReducedShearIteration"] = po::variable_value(boost::any(int(myReducedShearSolver.getNbIterations())), false);
+    if (convMap.saveToFITSfile(outputConvMap, true, params)==false)
     {
       return false;
     }
-
-    /////////////////////////////////////
-    // Then perform reduced shear computation
-    /////////////////////////////////////
-    TWOD_MASS_WL_MassMapping::ShearMap reducedShear(shearMapFITSfile);
-    TWOD_MASS_WL_MassMapping::ConvergenceMap convMap(outputConvMap);
-
-    reducedShear.computeReducedShear(convMap);
-
-    reducedShear.saveToFITSfile(shearMapFITSfile, true);
   }
 
   /////////////////////////////////////
-  /// Provide all needed parameters for the peak count module
+  /// Perform the peak counting
   /////////////////////////////////////
 
-  // First change the output conv map to an input conv map
-  params["inputConvMapFITS"] = po::variable_value(boost::any(outputConvMap), false);
-  params.erase("outputConvMapFITS");
-
-  // And provide the input density map
-  std::size_t found =  shearMapFITSfile.rfind(".");
-  shearMapFITSfile.insert(found, "_density");
-  params["inputDensityMapFITS"] = po::variable_value(boost::any(shearMapFITSfile), false);
-
-  // Then provide the ouput catalog
-  params["outputPeakCatalogFITS"] = po::variable_value(boost::any(outputPeakMap), false);
-
-  // Perform the peak counting
-  TWOD_MASS_WL_PeakCount::PeakCountParser myPeakCountParser;
-  if (myPeakCountParser.mainMethod(params)!=Elements::ExitCode::OK)
+  if (outputPeakMap.empty()==false)
   {
-    return false;
+    TWOD_MASS_WL_PeakCount::PeakCountStage myPeakCountStage;
+    myPeakCountStage.setOutputFile(outputPeakMap);
+    if (myPeakCountStage.findPeaks(convMap, densityMap)==false)
+    {
+      return false;
+    }
   }
 
   return true;
@@ -236,7 +249,8 @@ bool PFAlgo::launchParalPF()
   {
     if (checkParameters()==true)
     {
-      return performProcessingFunction(m_outputPeakCatalog, m_outputConvergenceMap, m_boundaries);
+      return performProcessingFunction(m_outputPeakCatalog, m_outputConvergenceMap, m_boundaries,
+                                       m_intermediateProductFile);
     }
     else
     {
@@ -269,41 +283,92 @@ bool PFAlgo::launchParalPF()
    std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
    std::cout<<"getting mask done: "<<goodPatches.size()<<" patches"<<std::endl;
  */
-   // Define a boolean telling if it all went fine
-   bool outputOK = true;
+   // The parameters are the same for all the patches
+   if (checkParameters()==false)
+   {
+     return false;
+   }
 
-   // Perform the parallelized PF computation
-   #pragma omp parallel for num_threads(omp_get_max_threads())
-   for (unsigned int i=0; i<goodPatches.size(); i++)
+   // The maps of the patches are extracted by groups, the catalog being read once for each group
+   for (unsigned int first=0; first<goodPatches.size(); first+=m_patchesPerScan)
    {
-     // Give the output catalog and convergence map a unique filename
-     std::string tmpOutputConvMap = m_outputConvergenceMap;
-     std::string tmpOutputPeakCatalog = m_outputPeakCatalog;
-     if (tmpOutputConvMap.empty()==false)
+     unsigned int last = std::min(first+m_patchesPerScan, static_cast<unsigned int>(goodPatches.size()));
+     std::vector<TWOD_MASS_WL_MassMapping::Boundaries> groupPatches(goodPatches.begin()+first,
+                                                                    goodPatches.begin()+last);
+     std::vector<TWOD_MASS_WL_MassMapping::ShearMap*> shearMaps;
+     std::vector<TWOD_MASS_WL_MassMapping::GlobalMap*> densityMaps;
+
+     bool scanOK = false;
+     if (TWOD_MASS_WL_MassMapping::ColumnarCatalog::isColumnarCatalog(m_inputFITSCatalog))
      {
-       std::size_t found = tmpOutputConvMap.rfind(".fits");
-       tmpOutputConvMap.insert(found, std::to_string(i));
-       std::cout<<"name of the conv map: "<<tmpOutputConvMap<<std::endl;
+       TWOD_MASS_WL_MapMaker::ColumnarCatalogHandler myCatalog(m_inputFITSCatalog);
+       scanOK = myCatalog.getPatchMaps(groupPatches, nbBins, nbBins, m_squareMap, shearMaps, densityMaps);
      }
-     if (tmpOutputPeakCatalog.empty()==false)
+     else if (m_inputFITSCatalog.empty()==false)
      {
-       std::size_t found = tmpOutputPeakCatalog.rfind(".fits");
-       tmpOutputPeakCatalog.insert(found, std::to_string(i));
-       std::cout<<"name of the peak catalog: "<<tmpOutputPeakCatalog<<std::endl;
+       TWOD_MASS_WL_MapMaker::FITSCatalogHandler myCatalog(m_inputFITSCatalog);
+       scanOK = myCatalog.getPatchMaps(groupPatches, nbBins, nbBins, m_squareMap, shearMaps, densityMaps);
+     }
+     else
+     {
+       TWOD_MASS_WL_MapMaker::SSVCatalogHandler myCatalog(m_inputSSVCatalog);
+       scanOK = myCatalog.getPatchMaps(groupPatches, nbBins, nbBins, m_squareMap, shearMaps, densityMaps);
+     }
+     if (scanOK==false)
+     {
+       std::cout<<"the maps of the patches could not be extracted from the catalog"<<std::endl;
+       return false;
      }
 
-
-     if (checkParameters()==true)
+     // Give the output catalog, convergence map and intermediate products of each patch a unique
+     // filename, before the parallel region
+     std::vector<std::string> outputConvMaps, outputPeakCatalogs, intermediateProductFiles;
+     for (unsigned int p=0; p<groupPatches.size(); p++)
      {
-       performProcessingFunction(tmpOutputPeakCatalog, tmpOutputConvMap, goodPatches[i]);
+       outputConvMaps.push_back(getPatchFilename(m_outputConvergenceMap, first + p));
+       outputPeakCatalogs.push_back(getPatchFilename(m_outputPeakCatalog, first + p));
+       intermediateProductFiles.push_back(getPatchFilename(m_intermediateProductFile, first + p));
+       if (outputConvMaps.back().empty()==false)
+       {
+         std::cout<<"name of the conv map: "<<outputConvMaps.back()<<std::endl;
+       }
+       if (outputPeakCatalogs.back().empty()==false)
+       {
+         std::cout<<"name of the peak catalog: "<<outputPeakCatalogs.back()<<std::endl;
+       }
      }
-     else
+
+     // Perform the parallelized PF computation on the patches of the group
+     #pragma omp parallel for num_threads(omp_get_max_threads())
+     for (unsigned int p=0; p<groupPatches.size(); p++)
      {
-       outputOK = false;
+       const std::string &tmpOutputConvMap = outputConvMaps[p];
+       const std::string &tmpOutputPeakCatalog = outputPeakCatalogs[p];
+       const std::string &tmpIntermediateProductFile = intermediateProductFiles[p];
+
+       // A patch without any galaxy has no maps to process
+       if (shearMaps[p]!=nullptr && densityMaps[p]!=nullptr)
+       {
+         std::string convMapFITSfile = "";
+         if (tmpIntermediateProductFile.empty()==false)
+         {
+           shearMaps[p]->saveToFITSfile(tmpIntermediateProductFile + "[" +
+                                        TWOD_MASS_WL_MassMapping::shearExtension + "]", true);
+           densityMaps[p]->saveToFITSfile(tmpIntermediateProductFile + "[" +
+                                          TWOD_MASS_WL_MassMapping::densityExtension + "]", true);
+           convMapFITSfile = tmpIntermediateProductFile + "[" + TWOD_MASS_WL_MassMapping::convergenceExtension + "]";
+         }
+         processPatchMaps(*shearMaps[p], *densityMaps[p], tmpOutputPeakCatalog, tmpOutputConvMap,
+                          convMapFITSfile);
+       }
+
+       // The maps of the patch are not needed anymore
+       delete shearMaps[p];
+       delete densityMaps[p];
      }
    }
 
-   return outputOK;
+   return true;
 }
 
 
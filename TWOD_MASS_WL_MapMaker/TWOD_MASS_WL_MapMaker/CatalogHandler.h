@@ -25,19 +25,91 @@
 #ifndef TWOD_MASS_WL_MAPMAKER_CATALOGHANDLER_H
 #define TWOD_MASS_WL_MAPMAKER_CATALOGHANDLER_H
 
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace TWOD_MASS_WL_MassMapping {
 class ShearMap;
 class ConvergenceMap;
 class GlobalMap;
 class Boundaries;
+class CatalogZoneMap;
+class CatalogKeyIndex;
 }
 
 namespace TWOD_MASS_WL_MapMaker {
 
+class MapBinner;
+
 enum mapEnum {convMap, shearMap};
 
+/**
+ * @brief Maps which can be extracted together in a single pass over a catalog
+ *
+ * The density map holds the sum of the weights in each bin, the weight map the sum of the
+ * squared weights (giving the effective number of galaxies with the density map) and the
+ * shape variance map the weighted variance of each shear component in each bin
+ */
+enum productEnum {shearProduct, convergenceProduct, densityProduct, weightProduct, shapeVarianceProduct};
+
+/**
+ * @struct CatalogChunk
+ * @brief Struct of arrays view on a chunk of catalog rows
+ *
+ * Each pointer gives the values of one column for the m_size rows of the chunk, or is
+ * nullptr if the column is not in the catalog or not needed. The pointers are resolved
+ * once per chunk, so that the loops over the galaxies only index plain arrays.
+ *
+ */
+struct CatalogChunk
+{
+  long m_size = 0;
+  const double *m_ra = nullptr;
+  const double *m_dec = nullptr;
+  const double *m_z = nullptr;
+  const double *m_weight = nullptr;
+  const double *m_gamma1 = nullptr;
+  const double *m_gamma2 = nullptr;
+  const double *m_kappa = nullptr;
+};
+
+/**
+ * @brief Function telling whether a range of rows, given by its first row and its number of rows,
+ * may hold selected galaxies according to the zone map of the catalog
+ */
+typedef std::function<bool(const TWOD_MASS_WL_MassMapping::CatalogZoneMap&, long, long)> ChunkFilter;
+
+/**
+ * @brief Function returning the ranges of rows which may hold selected galaxies according to the
+ * key index of a sorted catalog, each range being given by its first row and its number of rows
+ */
+typedef std::function<std::vector<std::pair<unsigned long, unsigned long> >
+                      (const TWOD_MASS_WL_MassMapping::CatalogKeyIndex&)> RowRangeSelector;
+
+/**
+ * @struct ProductArrays
+ * @brief Arrays receiving the sums over the binned galaxies of the requested products
+ *
+ * Each array holds nbBinsX*nbBinsY values per plan, the bin (x, y) being at index y*nbBinsX + x,
+ * or is nullptr if not needed. The weight array is always needed to normalize the maps.
+ *
+ */
+struct ProductArrays
+{
+  // Weighted sums of gamma1 and gamma2, 2 plans
+  double *m_shear = nullptr;
+  // Weighted sum of kappa, 2 plans the second one staying at zero
+  double *m_convergence = nullptr;
+  // Sum of the weights
+  double *m_weight = nullptr;
+  // Sum of the squared weights
+  double *m_squaredWeight = nullptr;
+  // Weighted sum of gamma1^2 + gamma2^2
+  double *m_shapeSquare = nullptr;
+};
+
 /**
  * @class CatalogHandler
  * @brief class that allows to handle catalogs.
@@ -133,42 +205,96 @@ public:
   }
 
   /**
-   * @brief Create a ConvergenceMap
-   * @param[in] arrayPair a pair containing a number of galaxies and an array of
-   * the associated image
-   * @param[in] nbBinsX the number of bins on the X axis
-   * @param[in] nbBinsY the number of bins on the Y axis
+   * @brief Gets the ShearMap from the catalog and returns it
    * @param[in] bounds the object containing ra, dec and z min and max
+   * @param[in] nbBinsX the number of bins needed on the X axis
+   * @param[in] nbBinsY the number of bins needed on the Y axis
+   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
    *
-   * @return a ConvergenceMap based on input array and number of galaxies, or nullptr if no information
+   * @return a ShearMap containing the values extracted from the catalog, nullptr if the needed
+   * columns are missing or no galaxy is selected. Pointer -> need to manage memory!
    *
-   * This method creates a ConvergenceMap based on input pair (array and number of galaxies),
-   * or nullptr if no information in the pair
+   * This method returns a ShearMap containing the data extracted from the input catalog.
+   * Only galaxies satisfying redshift, right ascension and declination (min and max) are taken into account.
+   * The density map is extracted along and is available through getDensityMap.
    *
    */
-  TWOD_MASS_WL_MassMapping::ConvergenceMap* getConvergenceMapFromArray(std::pair<long, double*> arrayPair,
-                                                                      const unsigned int nbBinsX,
-                                                                      const unsigned int nbBinsY,
-                                                                      TWOD_MASS_WL_MassMapping::Boundaries &bounds);
+  TWOD_MASS_WL_MassMapping::ShearMap* getShearMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
+                                                  const unsigned int nbBinsX, const unsigned int nbBinsY,
+                                                  bool squareMap = false);
 
   /**
-   * @brief Create a ShearMap
-   * @param[in] arrayPair a pair containing a number of galaxies and an array of
-   * the associated image
-   * @param[in] nbBinsX the number of bins on the X axis
-   * @param[in] nbBinsY the number of bins on the Y axis
+   * @brief Gets the ConvergenceMap from the catalog and returns it
+   * @param[in] bounds the object containing ra, dec and z min and max
+   * @param[in] nbBinsX the number of bins needed on the X axis
+   * @param[in] nbBinsY the number of bins needed on the Y axis
+   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
+   *
+   * @return a ConvergenceMap containing the values extracted from the catalog, nullptr if the needed
+   * columns are missing or no galaxy is selected. Pointer -> need to manage memory!
+   *
+   * This method returns a ConvergenceMap containing the data extracted from the input catalog.
+   * Only galaxies satisfying redshift, right ascension and declination (min and max) are taken into account.
+   *
+   */
+  TWOD_MASS_WL_MassMapping::ConvergenceMap* getConvergenceMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
+                                                              const unsigned int nbBinsX, const unsigned int nbBinsY,
+                                                              bool squareMap = false);
+
+  /**
+   * @brief Extracts several maps from the catalog in a single pass over its rows
+   * @param[in] products the list of the products to extract
    * @param[in] bounds the object containing ra, dec and z min and max
+   * @param[in] nbBinsX the number of bins needed on the X axis
+   * @param[in] nbBinsY the number of bins needed on the Y axis
+   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
+   *
+   * @return true if the maps could be extracted, false if the needed columns are missing
+   * or no galaxy is selected
+   *
+   * The maps are owned by the handler and replace the ones of a previous call. They are
+   * available through getProductShearMap, getProductConvergenceMap, getDensityMap,
+   * getWeightMap and getShapeVarianceMap.
+   *
+   */
+  bool getMaps(const std::vector<productEnum> &products, TWOD_MASS_WL_MassMapping::Boundaries &bounds,
+               const unsigned int nbBinsX, const unsigned int nbBinsY, bool squareMap = false);
+
+  /**
+   * @brief Extracts the shear and density maps of many patches in a single pass over the catalog
+   * @param[in] patches the ra, dec and z min and max of each patch, which may overlap
+   * @param[in] nbBinsX the number of bins needed on the X axis
+   * @param[in] nbBinsY the number of bins needed on the Y axis
+   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
+   * @param[out] shearMaps the shear map of each patch, nullptr if no galaxy is selected in the patch.
+   * Pointers -> need to manage memory!
+   * @param[out] densityMaps the density map of each patch, nullptr if no galaxy is selected in the patch.
+   * Pointers -> need to manage memory!
+   *
+   * @return true if the catalog could be read, false if the needed columns are missing
+   *
+   * Each chunk of rows is binned in the maps of every patch containing some of its galaxies, so that
+   * the catalog is read once whatever the number of patches. The maps of each patch are the same as the
+   * ones of getShearMap and getDensityMap on this patch.
+   *
+   */
+  bool getPatchMaps(std::vector<TWOD_MASS_WL_MassMapping::Boundaries> &patches,
+                    const unsigned int nbBinsX, const unsigned int nbBinsY, bool squareMap,
+                    std::vector<TWOD_MASS_WL_MassMapping::ShearMap*> &shearMaps,
+                    std::vector<TWOD_MASS_WL_MassMapping::GlobalMap*> &densityMaps);
+
+  /**
+   * @brief Saves the catalog in the columnar format, for the next runs on the same catalog
+   * @param[in] filename the name of the catalog in the columnar format
    *
-   * @return a ShearMap based on input array and number of galaxies, or nullptr if no information
+   * @return true if the catalog could be read and saved, false otherwise
    *
-   * This method creates a ShearMap based on input pair (array and number of galaxies),
-   * or nullptr if no information in the pair
+   * The ra, dec, z, weight, gamma1, gamma2 and kappa columns found in the catalog are saved, under
+   * these names, with the shear rotation of the catalog format. The columnar catalog is then read
+   * through a ColumnarCatalogHandler.
    *
    */
-  TWOD_MASS_WL_MassMapping::ShearMap* getShearMapFromArray(std::pair<long, double*> arrayPair,
-                                                          const unsigned int nbBinsX,
-                                                          const unsigned int nbBinsY,
-                                                          TWOD_MASS_WL_MassMapping::Boundaries &bounds);
+  bool saveAsColumnarCatalog(std::string filename);
 
   /**
    * @brief Returns a density map if any
@@ -176,10 +302,138 @@ public:
    */
   TWOD_MASS_WL_MassMapping::GlobalMap* getDensityMap() const;
 
+  /**
+   * @brief Returns the shear map extracted by the last call to getMaps if requested
+   * @return a ShearMap owned by the handler, nullptr if not extracted
+   */
+  TWOD_MASS_WL_MassMapping::ShearMap* getProductShearMap() const;
+
+  /**
+   * @brief Returns the convergence map extracted by the last call to getMaps if requested
+   * @return a ConvergenceMap owned by the handler, nullptr if not extracted
+   */
+  TWOD_MASS_WL_MassMapping::ConvergenceMap* getProductConvergenceMap() const;
+
+  /**
+   * @brief Returns the map of the sum of the squared weights extracted by the last call to getMaps
+   * if requested
+   * @return a GlobalMap owned by the handler, nullptr if not extracted
+   */
+  TWOD_MASS_WL_MassMapping::GlobalMap* getWeightMap() const;
+
+  /**
+   * @brief Returns the map of the shape variance extracted by the last call to getMaps if requested
+   * @return a GlobalMap owned by the handler, nullptr if not extracted
+   */
+  TWOD_MASS_WL_MassMapping::GlobalMap* getShapeVarianceMap() const;
+
+  /**
+   * @brief Sets the edges of the redshift bins of a tomographic extraction
+   * @param[in] zEdges the increasing edges of the N redshift bins, N+1 values, or an empty
+   * vector to go back to a single map
+   * @return true if the edges are valid, false otherwise and the edges are not changed
+   *
+   * With N redshift bins, getMaps extracts in a single pass a shear (and convergence) map of
+   * 2N plans, the plans 2k and 2k+1 holding the two components of the bin k, and density,
+   * weight and shape variance maps of N plans. The catalog then needs a redshift column.
+   *
+   */
+  bool setRedshiftBins(const std::vector<double> &zEdges);
+
+  /**
+   * @brief Returns the number of redshift bins of the extraction
+   * @return the number of redshift bins, 1 without tomography
+   */
+  unsigned int getNbRedshiftBins() const;
+
+  /**
+   * @brief Checks whether a product is in a list of requested products
+   * @param[in] products the list of requested products
+   * @param[in] product the product to look for
+   * @return true if the product is requested
+   */
+  static bool isRequested(const std::vector<productEnum> &products, productEnum product);
+
 protected:
 
+  /**
+   * @brief Reads the catalog chunk after chunk
+   * @param[in] needShear true if the gamma1 and gamma2 columns are needed
+   * @param[in] needKappa true if the kappa column is needed
+   * @param[in] needZ true if the redshift column is needed
+   * @param[in] processChunk the function called on each chunk read, the chunk being only valid
+   * during the call
+   * @param[in] isChunkNeeded the function telling which rows may hold selected galaxies, the rows
+   * of the other zones of the catalog being possibly skipped, or an empty function to read all the rows
+   * @param[in] selectRows the function giving the ranges of rows to read from the key index of a
+   * sorted catalog, the other rows being skipped, or an empty function to read all the rows
+   * @return true if the whole catalog could be read, false if a needed column is missing
+   * or the catalog could not be read
+   *
+   * The chunks only give the columns needed and the optional z and weight columns
+   *
+   */
+  virtual bool readChunks(bool needShear, bool needKappa, bool needZ,
+                          const std::function<void(const CatalogChunk&)> &processChunk,
+                          const ChunkFilter &isChunkNeeded, const RowRangeSelector &selectRows);
+
+  /**
+   * @brief Sets the projection, the selection and the redshift bins of a binner for a patch
+   * @param[in,out] binner the binner of the patch
+   * @param[in] bounds the object containing ra, dec and z min and max
+   * @param[in] nbBinsX the number of bins on the X axis
+   * @param[in] nbBinsY the number of bins on the Y axis
+   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
+   */
+  void setBinnerGeometry(MapBinner &binner, TWOD_MASS_WL_MassMapping::Boundaries &bounds,
+                         const unsigned int nbBinsX, const unsigned int nbBinsY, bool squareMap);
+
+  /**
+   * @brief Deletes the maps extracted by a previous call to getMaps
+   */
+  void clearProducts();
+
+  /**
+   * @brief Allocates the arrays, initialized to zeros, needed to bin the requested products
+   * in each redshift bin
+   * @param[in] products the list of requested products
+   * @param[in] nbBinsX the number of bins on the X axis
+   * @param[in] nbBinsY the number of bins on the Y axis
+   * @return the arrays, to be released with deleteProductArrays
+   */
+  ProductArrays initializeProductArrays(const std::vector<productEnum> &products,
+                                        const unsigned int nbBinsX, const unsigned int nbBinsY);
+
+  /**
+   * @brief Deletes the arrays allocated by initializeProductArrays
+   * @param[in,out] arrays the arrays to delete, set to nullptr
+   */
+  void deleteProductArrays(ProductArrays &arrays);
+
+  /**
+   * @brief Normalizes the binned sums and creates the maps of the requested products
+   * with the plans of all the redshift bins
+   * @param[in] products the list of requested products
+   * @param[in,out] arrays the arrays filled by the binning, deleted by this method
+   * @param[in] selGalCount the number of galaxies selected
+   * @param[in] nbBinsX the number of bins on the X axis
+   * @param[in] nbBinsY the number of bins on the Y axis
+   * @param[in] bounds the object containing ra, dec and z min and max
+   * @return true if some galaxies were selected and the maps created, false otherwise
+   */
+  bool setProducts(const std::vector<productEnum> &products, ProductArrays &arrays, long selGalCount,
+                   const unsigned int nbBinsX, const unsigned int nbBinsY,
+                   TWOD_MASS_WL_MassMapping::Boundaries &bounds);
+
   std::string m_catalogFilename;
   TWOD_MASS_WL_MassMapping::GlobalMap* m_galDensity;
+  TWOD_MASS_WL_MassMapping::ShearMap* m_productShearMap;
+  TWOD_MASS_WL_MassMapping::ConvergenceMap* m_productConvergenceMap;
+  TWOD_MASS_WL_MassMapping::GlobalMap* m_weightMap;
+  TWOD_MASS_WL_MassMapping::GlobalMap* m_shapeVarianceMap;
+  std::vector<double> m_zEdges;
+  // Whether the shear is rotated to the local frame of the projection
+  bool m_rotateShear;
 
 
 }; /* End of CatalogHandler class */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MapMaker/ColumnarCatalogHandler.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MAPMAKER_COLUMNARCATALOGHANDLER_H
+#define TWOD_MASS_WL_MAPMAKER_COLUMNARCATALOGHANDLER_H
+
+#include "TWOD_MASS_WL_MapMaker/CatalogHandler.h"
+
+#include <memory>
+
+namespace TWOD_MASS_WL_MassMapping {
+class ColumnarCatalog;
+}
+
+namespace TWOD_MASS_WL_MapMaker {
+
+// Flag of the columnar catalogs whose shear is not to be rotated to the frame of the projection
+const unsigned int unrotatedShearFlag = 1;
+
+/**
+ * @class ColumnarCatalogHandler
+ * @brief Class that allows to extract maps from a catalog in the columnar format. Deriving from CatalogHandler.
+ *
+ * The catalog is memory mapped and its columns are binned in place, without any parsing. The columns
+ * are named ra, dec, z, weight, gamma1, gamma2 and kappa, as written by CatalogHandler::saveAsColumnarCatalog.
+ *
+ */
+class ColumnarCatalogHandler : public CatalogHandler {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~ColumnarCatalogHandler();
+
+  /**
+   * @brief Constructor of the ColumnarCatalogHandler
+   * @param[in] filename path and name of the catalog
+   *
+   * This method creates a ColumnarCatalogHandler for a given catalog input file, which is mapped
+   *
+   */
+  ColumnarCatalogHandler(std::string filename);
+
+protected:
+
+  /**
+   * @brief Hands over the blocks of the mapped columns as chunks, without any copy
+   *
+   * The blocks whose ranges, saved in the catalog, lie outside the selection are skipped. For a
+   * catalog sorted along a space filling curve, only the ranges of rows given by its key index are read.
+   *
+   * @see CatalogHandler::readChunks
+   */
+  bool readChunks(bool needShear, bool needKappa, bool needZ,
+                  const std::function<void(const CatalogChunk&)> &processChunk,
+                  const ChunkFilter &isChunkNeeded, const RowRangeSelector &selectRows) override;
+
+private:
+
+  std::unique_ptr<TWOD_MASS_WL_MassMapping::ColumnarCatalog> m_catalog;
+
+}; /* End of ColumnarCatalogHandler class */
+
+} /* namespace TWOD_MASS_WL_MapMaker */
+
+
+#endif
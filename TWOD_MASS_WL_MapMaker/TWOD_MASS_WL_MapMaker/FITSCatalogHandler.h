@@ -53,43 +53,6 @@ public:
    */
   FITSCatalogHandler(std::string filename);
 
-  /**
-   * @brief Gets the ShearMap from the FITS catalog and returns it
-   * @param[in] bounds the object containing ra, dec and z min and max
-   * @param[in] nbBinsX the number of bins needed on the X axis
-   * @param[in] nbBinsY the number of bins needed on the Y axis
-   *
-   * @return a ShearMap containing the values extracted from the catalog.
-   * Pointer -> need to manage memory!
-   *
-   * This method returns a ShearMap containing the data extracted from the input FITS catalog.
-   * Only galaxies satisfying redshift, right ascension and declination (min and max) are taken into account.
-   *
-   */
-  TWOD_MASS_WL_MassMapping::ShearMap* getShearMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                  const unsigned int nbBinsX,
-                                                  const unsigned int nbBinsY,
-                                                  bool squareMap = false);
-
-  /**
-   * @brief Gets the ConvergenceMap from the FITS catalog and returns it
-   * @param[in] bounds the object containing ra, dec and z min and max
-   * @param[in] nbBinsX the number of bins needed on the X axis
-   * @param[in] nbBinsY the number of bins needed on the Y axis
-   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
-   *
-   * @return a ConvergenceMap containing the values extracted from the FITScatalog.
-   * Pointer -> need to manage memory!
-   *
-   * This method returns a ConvergenceMap containing the data extracted from the input FITS catalog.
-   * Only galaxies satisfying redshift, right ascension and declination (min and max) are taken into account.
-   *
-   */
-  TWOD_MASS_WL_MassMapping::ConvergenceMap* getConvergenceMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                              const unsigned int nbBinsX,
-                                                              const unsigned int nbBinsY,
-                                                              bool squareMap = false);
-
   /**
    * @brief Saves the input data into a FITS catalog
    * @param[in] inputData a vector of vector containing the input data to save into a catalog
@@ -107,26 +70,21 @@ public:
    */
   bool saveAsFitsCatalog(std::vector<std::vector<double> > inputData, std::vector<std::vector<std::string> > columns);
 
-private:
+protected:
 
   /**
-   * @brief Returns a pair containing the number of galaxies selected as well as an array of the map data
-   * @param[in] mapType an enum to tell what type of map is needed
-   * @param[in] bounds the object containing ra, dec and z min and max
-   * @param[in] nbBinsX the number of bins needed on the X axis
-   * @param[in] nbBinsY the number of bins needed on the Y axis
-   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
-   *
-   * @return a pair containing the number of galaxies selected as well as an array of the map data
+   * @brief Reads the FITS catalog chunk after chunk, only the needed columns being read
    *
-   * This method is generic to both kind of maps (shear and convergence) and returns the
-   * number of galaxies selected as well as the array with the data of the map for all
-   * given input parameters (z, ra, dec and binning)
+   * The zone map saved next to the catalog is used to skip the chunks which are not needed.
+   * Without an up to date zone map, it is computed while reading the whole catalog and saved.
+   * The chunks are read by an I/O thread, a few chunks ahead of the one being processed.
+   * A sorted catalog being written in the columnar format, there is no key index to select the rows.
    *
+   * @see CatalogHandler::readChunks
    */
-  std::pair<long, double*> getMap(mapEnum mapType, TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                  const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                  bool squareMap);
+  bool readChunks(bool needShear, bool needKappa, bool needZ,
+                  const std::function<void(const CatalogChunk&)> &processChunk,
+                  const ChunkFilter &isChunkNeeded, const RowRangeSelector &selectRows) override;
 
 }; /* End of FITSCatalogHandler class */
 
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MapMaker/GnomonicProjector.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MAPMAKER_GNOMONICPROJECTOR_H
+#define TWOD_MASS_WL_MAPMAKER_GNOMONICPROJECTOR_H
+
+namespace TWOD_MASS_WL_MapMaker {
+
+/**
+ * @class GnomonicProjector
+ * @brief Gnomonic projection of whole arrays of galaxies around a fixed tangent point
+ *
+ * The trigonometry of the tangent point is computed once at construction. The projection
+ * loops only compute the sine and cosine of the galaxy coordinates, without function
+ * call nor branch, so that they can be vectorised. The rotation of the shear due to the
+ * projection is derived analytically from the same terms.
+ *
+ */
+class GnomonicProjector {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~GnomonicProjector() = default;
+
+  /**
+   * @brief Constructor of a GnomonicProjector
+   * @param[in] ra0 the right ascension of the tangent point in degrees
+   * @param[in] dec0 the declination of the tangent point in degrees
+   */
+  GnomonicProjector(double ra0, double dec0);
+
+  /**
+   * @brief Projects an array of galaxies
+   * @param[in] nbGalaxies the number of galaxies
+   * @param[in] ra the right ascensions of the galaxies in degrees
+   * @param[in] dec the declinations of the galaxies in degrees
+   * @param[out] x the projected X values
+   * @param[out] y the projected Y values
+   *
+   * The values are the ones of CatalogHandler::getGnomonicProjection
+   *
+   */
+  void project(long nbGalaxies, const double *ra, const double *dec, double *x, double *y) const;
+
+  /**
+   * @brief Projects an array of galaxies and computes the rotation of their shear
+   * @param[in] nbGalaxies the number of galaxies
+   * @param[in] ra the right ascensions of the galaxies in degrees
+   * @param[in] dec the declinations of the galaxies in degrees
+   * @param[out] x the projected X values
+   * @param[out] y the projected Y values
+   * @param[out] cos2angle the cosine of twice the rotation angle of each galaxy
+   * @param[out] sin2angle the sine of twice the rotation angle of each galaxy
+   *
+   * The rotation angle is the angle between the projected direction of increasing
+   * declination and the Y axis. The corrected shear is
+   * gamma1*cos2angle - gamma2*sin2angle, gamma1*sin2angle + gamma2*cos2angle
+   *
+   */
+  void project(long nbGalaxies, const double *ra, const double *dec, double *x, double *y,
+               double *cos2angle, double *sin2angle) const;
+
+private:
+
+  double m_ra0;
+  double m_sinDec0;
+  double m_cosDec0;
+
+}; /* End of GnomonicProjector class */
+
+} /* namespace TWOD_MASS_WL_MapMaker */
+
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MapMaker/MapBinner.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MAPMAKER_MAPBINNER_H
+#define TWOD_MASS_WL_MAPMAKER_MAPBINNER_H
+
+#include "TWOD_MASS_WL_MapMaker/CatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/GnomonicProjector.h"
+
+#include <vector>
+
+namespace TWOD_MASS_WL_MapMaker {
+
+/**
+ * @class MapBinner
+ * @brief Multi-threaded binning of catalog chunks into map arrays
+ *
+ * The galaxies of a chunk are selected, projected and given a bin by blocks of fixed size
+ * distributed to the threads. They are then accumulated by tiles of map rows small enough
+ * to stay in cache, each tile being filled by one thread in the order of the catalog.
+ * The sums of each bin are thus made in the same order whatever the number of threads,
+ * and the maps are bit-reproducible. The total weights are summed in the order of the
+ * catalog too, so they do not depend either on the chunks the catalog is read by.
+ *
+ */
+class MapBinner {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~MapBinner() = default;
+
+  /**
+   * @brief Constructor of a MapBinner
+   * @param[in] mapType the type of map to fill
+   * @param[in] nbBinsX the number of bins on the X axis
+   * @param[in] nbBinsY the number of bins on the Y axis
+   * @param[in,out] mapArray the map array to fill, with 2 plans of nbBinsX*nbBinsY values,
+   * the bin (x, y) being at index y*nbBinsX + x
+   * @param[in,out] countArray the array of nbBinsX*nbBinsY values receiving the sum of the
+   * weights in each bin
+   *
+   * The arrays are not owned by the binner, the values are added to their current values
+   *
+   */
+  MapBinner(mapEnum mapType, unsigned int nbBinsX, unsigned int nbBinsY, double *mapArray, double *countArray);
+
+  /**
+   * @brief Constructor of a MapBinner filling several products at once
+   * @param[in] nbBinsX the number of bins on the X axis
+   * @param[in] nbBinsY the number of bins on the Y axis
+   * @param[in,out] arrays the arrays to fill, the chunks needing the columns of each non null array
+   *
+   * The arrays are not owned by the binner, the values are added to their current values
+   *
+   */
+  MapBinner(unsigned int nbBinsX, unsigned int nbBinsY, const ProductArrays &arrays);
+
+  /**
+   * @brief Sets the projection and the binning in the projection plane
+   * @param[in] ra0 the right ascension of the tangent point in degrees
+   * @param[in] dec0 the declination of the tangent point in degrees
+   * @param[in] xOrigin the X value of the lower edge of the first bin
+   * @param[in] yOrigin the Y value of the lower edge of the first bin
+   * @param[in] binXSize the size of the bins on the X axis
+   * @param[in] binYSize the size of the bins on the Y axis
+   * @param[in] rotateShear set to true to correct the shear for the rotation due to the projection
+   */
+  void setProjection(double ra0, double dec0, double xOrigin, double yOrigin,
+                     double binXSize, double binYSize, bool rotateShear = true);
+
+  /**
+   * @brief Sets the ranges of the galaxies to select
+   * @param[in] raMin the minimum right ascension in degrees
+   * @param[in] raMax the maximum right ascension in degrees
+   * @param[in] decMin the minimum declination in degrees
+   * @param[in] decMax the maximum declination in degrees
+   * @param[in] zMin the minimum redshift, used only if the chunks have redshifts
+   * @param[in] zMax the maximum redshift
+   */
+  void setSelection(double raMin, double raMax, double decMin, double decMax, double zMin, double zMax);
+
+  /**
+   * @brief Sets the edges of the redshift bins of a tomographic binning
+   * @param[in] zEdges the increasing edges of the N redshift bins, N+1 values
+   *
+   * The arrays then hold the plans of each redshift bin one after the other: the plans 2k and
+   * 2k+1 of the shear and convergence arrays and the plan k of the other arrays for the bin k.
+   * The galaxies outside the edges are not selected, the chunks need redshifts.
+   *
+   */
+  void setRedshiftBins(const std::vector<double> &zEdges);
+
+  /**
+   * @brief Bins the galaxies of a chunk
+   * @param[in] chunk the chunk of catalog rows, with the columns needed by the map type
+   */
+  void binChunk(const CatalogChunk &chunk);
+
+  /**
+   * @brief Tells whether a range of catalog rows may hold galaxies of the selection
+   * @param[in] zoneMap the zone map of the catalog
+   * @param[in] firstRow the index of the first row of the range
+   * @param[in] nbRows the number of rows of the range
+   * @return false if the zone map shows that no galaxy of the rows is selected, true otherwise
+   */
+  bool mayOverlap(const TWOD_MASS_WL_MassMapping::CatalogZoneMap &zoneMap, long firstRow, long nbRows) const;
+
+  /**
+   * @brief Returns the ranges of catalog rows which may hold galaxies of the selection
+   * @param[in] keyIndex the key index of the sorted catalog
+   * @return the first row and the number of rows of each range, in the order of the rows
+   */
+  std::vector<std::pair<unsigned long, unsigned long> >
+    getRowRanges(const TWOD_MASS_WL_MassMapping::CatalogKeyIndex &keyIndex) const;
+
+  /**
+   * @brief Returns the sum of the weights of all the galaxies binned so far
+   */
+  double getGalaxyWeight() const;
+
+  /**
+   * @brief Returns the sum of the weights of the galaxies inside the map
+   */
+  double getSelectedWeight() const;
+
+private:
+
+  /**
+   * @brief Computes the number of map rows of a tile from the number of plans filled
+   */
+  void setTileRows();
+
+  /**
+   * @brief Bins a part of a chunk, small enough for the buffers of each galaxy
+   */
+  void binPart(const CatalogChunk &chunk);
+
+  unsigned int m_nbBinsX;
+  unsigned int m_nbBinsY;
+  ProductArrays m_arrays;
+
+  GnomonicProjector m_projector;
+  double m_xOrigin;
+  double m_yOrigin;
+  double m_binXSize;
+  double m_binYSize;
+  bool m_rotateShear;
+
+  double m_raMin;
+  double m_raMax;
+  double m_decMin;
+  double m_decMax;
+  double m_zMin;
+  double m_zMax;
+
+  // Edges of the redshift bins, empty without tomography
+  std::vector<double> m_zEdges;
+  unsigned int m_nbSlices;
+
+  // Number of map rows of a tile
+  unsigned int m_tileRows;
+
+  // Bin and weighted values of each galaxy of the chunk, bin -1 for the galaxies outside the map
+  std::vector<int> m_bins;
+  std::vector<int> m_slices;
+  std::vector<double> m_values1;
+  std::vector<double> m_values2;
+  std::vector<double> m_kappaValues;
+  std::vector<double> m_shapeSquares;
+  std::vector<double> m_weights;
+
+  // Galaxies of the chunk sorted by tile, keeping the catalog order inside a tile
+  std::vector<long> m_tileOffsets;
+  std::vector<long> m_tileGalaxies;
+
+  double m_galaxyWeight;
+  double m_selectedWeight;
+
+}; /* End of MapBinner class */
+
+} /* namespace TWOD_MASS_WL_MapMaker */
+
+
+#endif
@@ -27,6 +27,7 @@
 
 #include <boost/program_options.hpp>
 #include "ElementsKernel/ProgramHeaders.h"
+#include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
 #include <string>
 
 namespace po = boost::program_options;
@@ -39,6 +40,8 @@ class GlobalMap;
 
 namespace TWOD_MASS_WL_MapMaker {
 
+class CatalogHandler;
+
 /**
  * @class MapMakerParser
  * @brief
@@ -79,7 +82,8 @@ public:
     * @brief a method to extract the map from the input parameters
     * @return true if a map could be extracted, false otherwise
     *
-    * This method extracts a map (either from an input catalog, or directly from an input map).
+    * This method extracts all the requested maps (shear, convergence, density, weight and
+    * shape variance) in a single pass over the input catalog.
     * To be called only after parseInputParameters(args) returned true
     *
     */
@@ -87,20 +91,33 @@ public:
 
 private:
 
+  /**
+    * @brief Extracts and saves the requested maps with a catalog handler
+    * @param[in] catalog the handler of the input catalog
+    * @param[in] bounds the object containing ra, dec and z min and max
+    * @return true if the maps could be extracted, false otherwise
+    */
+  bool extractMapsFromHandler(CatalogHandler &catalog, TWOD_MASS_WL_MassMapping::Boundaries &bounds);
+
   TWOD_MASS_WL_MassMapping::ShearMap *m_ShearMap;
   TWOD_MASS_WL_MassMapping::ConvergenceMap *m_ConvergenceMap;
 
   std::string m_inputSSVcatalog;
   std::string m_inputFITScatalog;
+  std::string m_inputColumnarCatalog;
+  std::string m_outputColumnarCatalog;
   std::string m_outputFITSshearMap;
   std::string m_outputFITSconvergenceMap;
   std::string m_outputFITSdensityMap;
+  std::string m_outputFITSweightMap;
+  std::string m_outputFITSshapeVarianceMap;
   float m_raMin;
   float m_raMax;
   float m_decMin;
   float m_decMax;
   float m_zMin;
   float m_zMax;
+  std::vector<double> m_zBinEdges;
   unsigned int m_nbBinsX;
   unsigned int m_nbBinsY;
 
@@ -108,6 +125,9 @@ private:
 
   bool squareMap;
 
+  TWOD_MASS_WL_MassMapping::fitsCompression m_outputCompression;
+  std::string m_outputFITSproduct;
+
   clock_t tStart = clock();
 
 }; /* End of MapMakerParser class */
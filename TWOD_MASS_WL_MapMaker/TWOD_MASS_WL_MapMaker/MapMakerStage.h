@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MapMaker/MapMakerStage.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MAPMAKER_MAPMAKERSTAGE_H
+#define TWOD_MASS_WL_MAPMAKER_MAPMAKERSTAGE_H
+
+#include "TWOD_MASS_WL_MapMaker/CatalogHandler.h"
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+#include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+
+#include <string>
+
+namespace TWOD_MASS_WL_MapMaker {
+
+/**
+ * @class MapMakerStage
+ * @brief In memory map making stage, extracting the shear and density maps of a patch
+ *
+ * The stage extracts the shear map and the galaxy density map of a patch from a catalog
+ * handler and keeps them in memory to be given to the next stages. The maps are only saved
+ * to FITS files if output files are given.
+ *
+ */
+class MapMakerStage {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~MapMakerStage();
+
+  /**
+   * @brief Constructor of a MapMakerStage
+   * @param[in] nbBinsX the number of bins of the maps on the X axis
+   * @param[in] nbBinsY the number of bins of the maps on the Y axis
+   * @param[in] squareMap set to true to have a square map in the projection plane
+   */
+  MapMakerStage(unsigned int nbBinsX, unsigned int nbBinsY, bool squareMap = true);
+
+  MapMakerStage(const MapMakerStage&) = delete;
+  MapMakerStage& operator=(const MapMakerStage&) = delete;
+
+  /**
+   * @brief Sets the files in which to save the maps at each extraction
+   * @param[in] shearMapFile name of the FITS file of the shear map, or file.fits[EXTNAME]
+   * for a product file extension, no file is written if empty (default)
+   * @param[in] densityMapFile name of the FITS file of the density map, same conventions
+   * @param[in] compression tile compression of the images
+   */
+  void setOutputFiles(std::string shearMapFile, std::string densityMapFile,
+                      TWOD_MASS_WL_MassMapping::fitsCompression compression = TWOD_MASS_WL_MassMapping::noCompression);
+
+  /**
+   * @brief Extracts the shear and density maps of a patch from a catalog
+   * @param[in] catalog the handler of the catalog, of any format
+   * @param[in] bounds the ra, dec and z min and max of the patch
+   * @return true if the maps could be extracted, false otherwise
+   *
+   * The previous maps of the stage are replaced
+   *
+   */
+  bool extractMaps(CatalogHandler &catalog, TWOD_MASS_WL_MassMapping::Boundaries &bounds);
+
+  /**
+   * @brief Returns the last extracted shear map
+   * @return the shear map owned by the stage, nullptr if none was extracted
+   */
+  TWOD_MASS_WL_MassMapping::ShearMap* getShearMap() const;
+
+  /**
+   * @brief Returns the last extracted density map
+   * @return the density map owned by the stage, nullptr if none was extracted
+   */
+  TWOD_MASS_WL_MassMapping::GlobalMap* getDensityMap() const;
+
+private:
+
+  /**
+   * @brief Deletes the maps of the stage
+   */
+  void clearMaps();
+
+  unsigned int m_nbBinsX;
+  unsigned int m_nbBinsY;
+  bool m_squareMap;
+
+  std::string m_outputShearMapFile;
+  std::string m_outputDensityMapFile;
+  TWOD_MASS_WL_MassMapping::fitsCompression m_outputCompression;
+
+  TWOD_MASS_WL_MassMapping::ShearMap *m_shearMap;
+  TWOD_MASS_WL_MassMapping::GlobalMap *m_densityMap;
+
+}; /* End of MapMakerStage class */
+
+} /* namespace TWOD_MASS_WL_MapMaker */
+
+
+#endif
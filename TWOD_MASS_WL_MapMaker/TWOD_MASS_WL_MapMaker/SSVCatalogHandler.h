@@ -52,62 +52,18 @@ public:
    */
   SSVCatalogHandler(std::string filename);
 
+protected:
 
   /**
-   * @brief Gets the ShearMap from the catalog and returns it
-   * @param[in] bounds the object containing ra, dec and z min and max
-   * @param[in] nbBinsX the number of bins needed on the X axis
-   * @param[in] nbBinsY the number of bins needed on the Y axis
-   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
+   * @brief Reads the SSV catalog line after line, gathering the needed columns in chunks
    *
-   * @return a ShearMap containing the values extracted from the catalog. Pointer -> need to manage memory!
-   *
-   * This method returns a ShearMap containing the data extracted from the input catalog.
-   * Only galaxies satisfying redshift, right ascension and declination (min and max) are taken into account.
-   *
-   * Works only for text catalogs!
-   */
-  TWOD_MASS_WL_MassMapping::ShearMap* getShearMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                  const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                                  bool squareMap = false);
-
-  /**
-   * @brief Gets the ConvergenceMap from the catalog and returns it
-   * @param[in] bounds the object containing ra, dec and z min and max
-   * @param[in] nbBinsX the number of bins needed on the X axis
-   * @param[in] nbBinsY the number of bins needed on the Y axis
-   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
-   *
-   * @return a ConvergenceMap containing the values extracted from the catalog. Pointer -> need to manage memory!
-   *
-   * This method returns a ConvergenceMap containing the data extracted from the input catalog.
-   * Only galaxies satisfying redshift, right ascension and declination (min and max) are taken into account.
-   *
-   * Works only for text catalogs!
-   */
-  TWOD_MASS_WL_MassMapping::ConvergenceMap* getConvergenceMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                              const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                                              bool squareMap = false);
-
-private:
-
-  /**
-   * @brief Returns a pair containing the number of galaxies selected as well as an array of the map data
-   * @param[in] mapType an enum to tell what type of map is needed
-   * @param[in] bounds the object containing ra, dec and z min and max
-   * @param[in] nbBinsX the number of bins needed on the X axis
-   * @param[in] nbBinsY the number of bins needed on the Y axis
-   * @param[in] squareMap a bool to be set to true to have a square map on projected plan
-   *
-   * @return a pair containing the number of galaxies selected as well as an array of the map data
-   *
-   * This method is generic to both kind of maps (shear and convergence) and returns the number of galaxies selected
-   * as well as the array with the data of the map for all given input parameters (z, ra, dec and binning)
+   * All the lines of a text catalog are parsed, so that no zone is skipped
    *
+   * @see CatalogHandler::readChunks
    */
-  std::pair<long, double*> getMap(mapEnum mapType, TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                  const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                  bool squareMap);
+  bool readChunks(bool needShear, bool needKappa, bool needZ,
+                  const std::function<void(const CatalogChunk&)> &processChunk,
+                  const ChunkFilter &isChunkNeeded, const RowRangeSelector &selectRows) override;
 
 }; /* End of SSVCatalogHandler class */
 
@@ -23,12 +23,20 @@
  */
 
 #include "TWOD_MASS_WL_MapMaker/CatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/ColumnarCatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/MapBinner.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
 #include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
 #include "TWOD_MASS_WL_MassMapping/ShearMap.h"
 #include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <iostream>
+#include <memory>
 
 
 const double pi = 3.14159265358979323846;
@@ -39,14 +47,12 @@ namespace TWOD_MASS_WL_MapMaker {
 
 CatalogHandler::~CatalogHandler()
 {
-  if (m_galDensity!=nullptr)
-  {
-    delete m_galDensity;
-    m_galDensity = nullptr;
-  }
+  clearProducts();
 }
 
-CatalogHandler::CatalogHandler(std::string filename): m_catalogFilename(filename), m_galDensity(nullptr)
+CatalogHandler::CatalogHandler(std::string filename): m_catalogFilename(filename), m_galDensity(nullptr),
+m_productShearMap(nullptr), m_productConvergenceMap(nullptr), m_weightMap(nullptr), m_shapeVarianceMap(nullptr),
+m_rotateShear(true)
 {
 }
 
@@ -194,58 +200,298 @@ bool CatalogHandler::checkRaDecZ(TWOD_MASS_WL_MassMapping::Boundaries &bounds)
   return true;
 }
 
-ConvergenceMap* CatalogHandler::getConvergenceMapFromArray(std::pair<long, double*> arrayPair,
-                                                           const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                                           TWOD_MASS_WL_MassMapping::Boundaries &bounds)
+ShearMap* CatalogHandler::getShearMap(Boundaries &bounds, const unsigned int nbBinsX, const unsigned int nbBinsY,
+                                      bool squareMap)
 {
-  // If there is no output return a nullptr
-  if (arrayPair.second==nullptr)
+  // Extract the map through the products, the map being then handed over to the caller
+  if (getMaps({shearProduct, densityProduct}, bounds, nbBinsX, nbBinsY, squareMap)==false)
   {
     return nullptr;
   }
-  if (arrayPair.first==0)
+  ShearMap *myShearMap = m_productShearMap;
+  m_productShearMap = nullptr;
+
+  return myShearMap;
+}
+
+ConvergenceMap* CatalogHandler::getConvergenceMap(Boundaries &bounds, const unsigned int nbBinsX,
+                                                  const unsigned int nbBinsY, bool squareMap)
+{
+  // Extract the map through the products, the map being then handed over to the caller
+  if (getMaps({convergenceProduct}, bounds, nbBinsX, nbBinsY, squareMap)==false)
   {
-    delete [] arrayPair.second;
-    arrayPair.second = nullptr;
     return nullptr;
   }
+  ConvergenceMap *myConvergenceMap = m_productConvergenceMap;
+  m_productConvergenceMap = nullptr;
 
-  // Otherwise create the map
-  ConvergenceMap *myConvMap = new ConvergenceMap(arrayPair.second, nbBinsX, nbBinsY, 2, bounds, arrayPair.first);
+  return myConvergenceMap;
+}
+
+bool CatalogHandler::getMaps(const std::vector<productEnum> &products, Boundaries &bounds,
+                             const unsigned int nbBinsX, const unsigned int nbBinsY, bool squareMap)
+{
+  // Remove the maps of a previous extraction
+  clearProducts();
+
+  // Check variables inputs ra, dec and z are fine
+  if (checkRaDecZ(bounds)==false)
+  {
+    return false;
+  }
 
-  // Destroy the memory of the array
-  delete [] arrayPair.second;
-  arrayPair.second = nullptr;
+  // Check some products are requested
+  if (products.empty())
+  {
+    return false;
+  }
 
-  // And finally return the map
-  return myConvMap;
+  // Find out the columns needed by the products
+  bool needShear = isRequested(products, shearProduct) || isRequested(products, shapeVarianceProduct);
+  bool needKappa = isRequested(products, convergenceProduct);
+
+  // Create and initialize to zeros the arrays of all the products
+  ProductArrays arrays = initializeProductArrays(products, nbBinsX, nbBinsY);
+
+  // The binning of the chunks is shared by the threads, all the products being filled at once
+  MapBinner binner(nbBinsX, nbBinsY, arrays);
+  setBinnerGeometry(binner, bounds, nbBinsX, nbBinsY, squareMap);
+
+  // The zones and the ranges of rows of the catalog outside the selection of the binner are skipped
+  if (readChunks(needShear, needKappa, m_zEdges.size()>1,
+                 [&binner](const CatalogChunk &chunk) { binner.binChunk(chunk); },
+                 [&binner](const CatalogZoneMap &zoneMap, long firstRow, long nbRows)
+                 { return binner.mayOverlap(zoneMap, firstRow, nbRows); },
+                 [&binner](const CatalogKeyIndex &keyIndex) { return binner.getRowRanges(keyIndex); })==false)
+  {
+    deleteProductArrays(arrays);
+    return false;
+  }
+
+  // Get the counters of the galaxies watched and selected
+  unsigned long galCount(binner.getGalaxyWeight());
+  unsigned long selGalCount(binner.getSelectedWeight());
+
+  std::cout<<"number of galaxies selected: "<<selGalCount<<std::endl;
+  std::cout<<"over the total number of galaxies: "<<galCount<<std::endl;
+
+  // Normalize the sums and create the maps
+  return setProducts(products, arrays, selGalCount, nbBinsX, nbBinsY, bounds);
 }
 
-ShearMap* CatalogHandler::getShearMapFromArray(std::pair<long, double*> arrayPair,
-                                               const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                               TWOD_MASS_WL_MassMapping::Boundaries &bounds)
+bool CatalogHandler::getPatchMaps(std::vector<Boundaries> &patches,
+                                  const unsigned int nbBinsX, const unsigned int nbBinsY, bool squareMap,
+                                  std::vector<ShearMap*> &shearMaps, std::vector<GlobalMap*> &densityMaps)
 {
-  // If there is no output return a nullptr
-  if (arrayPair.second==nullptr)
+  shearMaps.assign(patches.size(), nullptr);
+  densityMaps.assign(patches.size(), nullptr);
+  std::vector<productEnum> products = {shearProduct, densityProduct};
+
+  // Create a binner with its arrays for each patch, the patches with wrong boundaries being skipped
+  std::vector<ProductArrays> arrays(patches.size());
+  std::vector<std::unique_ptr<MapBinner> > binners(patches.size());
+  for (unsigned int p=0; p<patches.size(); p++)
   {
-    return nullptr;
+    if (checkRaDecZ(patches[p])==false)
+    {
+      continue;
+    }
+    arrays[p] = initializeProductArrays(products, nbBinsX, nbBinsY);
+    binners[p].reset(new MapBinner(nbBinsX, nbBinsY, arrays[p]));
+    setBinnerGeometry(*binners[p], patches[p], nbBinsX, nbBinsY, squareMap);
   }
-  if (arrayPair.first==0)
+
+  // Read the catalog once, each chunk being binned in the maps of all the patches and the
+  // zones and the ranges of rows of the catalog outside all the patches being skipped
+  bool readOK = readChunks(true, false, m_zEdges.size()>1, [&binners](const CatalogChunk &chunk)
   {
-    delete [] arrayPair.second;
-    arrayPair.second = nullptr;
-    return nullptr;
+    for (unsigned int p=0; p<binners.size(); p++)
+    {
+      if (binners[p]!=nullptr)
+      {
+        binners[p]->binChunk(chunk);
+      }
+    }
+  },
+  [&binners](const CatalogZoneMap &zoneMap, long firstRow, long nbRows)
+  {
+    for (unsigned int p=0; p<binners.size(); p++)
+    {
+      if (binners[p]!=nullptr && binners[p]->mayOverlap(zoneMap, firstRow, nbRows))
+      {
+        return true;
+      }
+    }
+    return false;
+  },
+  [&binners](const CatalogKeyIndex &keyIndex)
+  {
+    std::vector<std::pair<unsigned long, unsigned long> > rowRanges;
+    for (unsigned int p=0; p<binners.size(); p++)
+    {
+      if (binners[p]!=nullptr)
+      {
+        std::vector<std::pair<unsigned long, unsigned long> > patchRanges = binners[p]->getRowRanges(keyIndex);
+        rowRanges.insert(rowRanges.end(), patchRanges.begin(), patchRanges.end());
+      }
+    }
+    CatalogKeyIndex::mergeRowRanges(rowRanges);
+    return rowRanges;
+  });
+
+  // Create the maps of each patch, which are handed over to the caller
+  for (unsigned int p=0; p<patches.size(); p++)
+  {
+    if (binners[p]==nullptr)
+    {
+      continue;
+    }
+    if (readOK==false)
+    {
+      deleteProductArrays(arrays[p]);
+      continue;
+    }
+    clearProducts();
+    if (setProducts(products, arrays[p], long(binners[p]->getSelectedWeight()), nbBinsX, nbBinsY, patches[p]))
+    {
+      shearMaps[p] = m_productShearMap;
+      densityMaps[p] = m_galDensity;
+      m_productShearMap = nullptr;
+      m_galDensity = nullptr;
+    }
   }
 
-  // Otherwise create the map
-  ShearMap *myShearMap = new ShearMap(arrayPair.second, nbBinsX, nbBinsY, 2, bounds, arrayPair.first);
+  return readOK;
+}
 
-  // Destroy the memory of the array
-  delete [] arrayPair.second;
-  arrayPair.second = nullptr;
+bool CatalogHandler::saveAsColumnarCatalog(std::string filename)
+{
+  // The catalog may lack the shear or the convergence, the largest set of columns being looked for
+  std::vector<std::pair<bool, bool> > columnSets = {{true, true}, {true, false}, {false, true}, {false, false}};
+  for (auto &columnSet : columnSets)
+  {
+    // The writer is created on the first chunk, once the columns of the catalog are known
+    std::unique_ptr<ColumnarCatalogWriter> writer;
+    bool writeOK(true);
+    bool readOK = readChunks(columnSet.first, columnSet.second, false,
+                             [&](const CatalogChunk &chunk)
+    {
+      std::vector<std::string> names = {"ra", "dec", "z", "weight", "gamma1", "gamma2", "kappa"};
+      std::vector<const double*> columns = {chunk.m_ra, chunk.m_dec, chunk.m_z, chunk.m_weight,
+                                            chunk.m_gamma1, chunk.m_gamma2, chunk.m_kappa};
+      std::vector<std::string> chunkNames;
+      std::vector<const double*> chunkColumns;
+      for (unsigned int c=0; c<columns.size(); c++)
+      {
+        if (columns[c]!=nullptr)
+        {
+          chunkNames.push_back(names[c]);
+          chunkColumns.push_back(columns[c]);
+        }
+      }
+      if (writer==nullptr)
+      {
+        writer.reset(new ColumnarCatalogWriter(filename, chunkNames, 65536,
+                                               m_rotateShear ? 0 : unrotatedShearFlag));
+      }
+      writeOK = writer->appendRows(chunkColumns, chunk.m_size) && writeOK;
+    }, ChunkFilter(), RowRangeSelector());
+
+    if (readOK)
+    {
+      // An empty catalog has all its columns
+      if (writer==nullptr)
+      {
+        writer.reset(new ColumnarCatalogWriter(filename, {"ra", "dec", "z", "weight", "gamma1", "gamma2", "kappa"},
+                                               65536, m_rotateShear ? 0 : unrotatedShearFlag));
+      }
+      return writer->close() && writeOK;
+    }
 
-  // And finally return the map
-  return myShearMap;
+    // A catalog failing once some rows are read can not be saved
+    if (writer!=nullptr)
+    {
+      std::cout<<m_catalogFilename<<": could not be read to be saved as columnar catalog"<<std::endl;
+      return false;
+    }
+  }
+
+  return false;
+}
+
+bool CatalogHandler::readChunks(bool, bool, bool, const std::function<void(const CatalogChunk&)>&,
+                                const ChunkFilter&, const RowRangeSelector&)
+{
+  // A catalog of unknown format cannot be read
+  return false;
+}
+
+void CatalogHandler::setBinnerGeometry(MapBinner &binner, Boundaries &bounds,
+                                       const unsigned int nbBinsX, const unsigned int nbBinsY, bool squareMap)
+{
+  // Define variables of ra and dec min and max
+  double raMin = bounds.getRaMin();
+  double raMax = bounds.getRaMax();
+  double decMin = bounds.getDecMin();
+  double decMax = bounds.getDecMax();
+
+  // Define ra0 and dec0 at the center of min and max values
+  double ra0 = 0.5*(raMax + raMin);
+  double dec0 = 0.5*(decMax + decMin);
+  double raRange = (raMax - raMin);
+  double decRange = (decMax - decMin);
+
+  // Declare the bins size on X and Y
+  double binXSize, binYSize;
+
+  std::pair<double, double> xyMin = getGnomonicProjection(raMin, decMin, ra0, dec0);
+
+  // In case a square map is not expected, perform some basic radec projection ranges selection
+  if (squareMap == false)
+  {
+    std::pair<double, double> xyMax = getGnomonicProjection(raMax, decMax, ra0, dec0);
+
+    // Define the bins sizes
+    binXSize = (xyMax.first - xyMin.first)/nbBinsX;
+    binYSize = (xyMax.second - xyMin.second)/nbBinsY;
+  }
+  // In case a square map is expected, perform some fancier computation to find out radec projection ranges
+  else
+  {
+    std::pair<double, double> raDec1 = getInverseGnomonicProjection(-0.5*raRange*pi/180.,
+                                                                    -0.5*decRange*pi/180.,
+                                                                    ra0, dec0);
+    std::pair<double, double> raDec2 = getInverseGnomonicProjection(0,
+                                                                    -0.5*decRange*pi/180.,
+                                                                    ra0, dec0);
+    std::pair<double, double> raDec3 = getInverseGnomonicProjection(0.5*raRange*pi/180.,
+                                                                    -0.5*decRange*pi/180.,
+                                                                    ra0, dec0);
+    std::pair<double, double> raDec4 = getInverseGnomonicProjection(0.5*raRange*pi/180.,
+                                                                    0.5*decRange*pi/180.,
+                                                                    ra0, dec0);
+    std::pair<double, double> raDec5 = getInverseGnomonicProjection(0,
+                                                                    0.5*decRange*pi/180.,
+                                                                    ra0, dec0);
+    std::pair<double, double> raDec6 = getInverseGnomonicProjection(-0.5*raRange*pi/180.,
+                                                                    0.5*decRange*pi/180.,
+                                                                    ra0, dec0);
+
+    // Get the min and max values of ra and dec according to the geometrical effects of projection
+    raMin = raDec1.first < raDec6.first ? raDec1.first : raDec6.first;
+    decMin = raDec1.second < raDec2.second ? raDec1.second : raDec2.second;
+    raMax = raDec3.first > raDec4.first ? raDec3.first : raDec4.first;
+    decMax = raDec4.second > raDec5.second ? raDec4.second : raDec5.second;
+
+    // Define the bins sizes
+    binXSize = raRange*pi/180./nbBinsX;
+    binYSize = decRange*pi/180./nbBinsY;
+  }
+
+  binner.setProjection(ra0, dec0, squareMap ? -0.5*raRange*pi/180. : xyMin.first,
+                       squareMap ? -0.5*decRange*pi/180. : xyMin.second, binXSize, binYSize, m_rotateShear);
+  binner.setSelection(raMin, raMax, decMin, decMax, bounds.getZMin(), bounds.getZMax());
+  binner.setRedshiftBins(m_zEdges);
 }
 
 TWOD_MASS_WL_MassMapping::GlobalMap* CatalogHandler::getDensityMap() const
@@ -253,4 +499,198 @@ TWOD_MASS_WL_MassMapping::GlobalMap* CatalogHandler::getDensityMap() const
   return m_galDensity;
 }
 
+ShearMap* CatalogHandler::getProductShearMap() const
+{
+  return m_productShearMap;
+}
+
+ConvergenceMap* CatalogHandler::getProductConvergenceMap() const
+{
+  return m_productConvergenceMap;
+}
+
+GlobalMap* CatalogHandler::getWeightMap() const
+{
+  return m_weightMap;
+}
+
+GlobalMap* CatalogHandler::getShapeVarianceMap() const
+{
+  return m_shapeVarianceMap;
+}
+
+bool CatalogHandler::setRedshiftBins(const std::vector<double> &zEdges)
+{
+  // A single edge does not define any bin
+  if (zEdges.size()==1)
+  {
+    return false;
+  }
+  for (unsigned int i=1; i<zEdges.size(); i++)
+  {
+    if (zEdges[i]<=zEdges[i-1])
+    {
+      return false;
+    }
+  }
+  m_zEdges = zEdges;
+  return true;
+}
+
+unsigned int CatalogHandler::getNbRedshiftBins() const
+{
+  return m_zEdges.size()>1 ? m_zEdges.size()-1 : 1;
+}
+
+bool CatalogHandler::isRequested(const std::vector<productEnum> &products, productEnum product)
+{
+  return std::find(products.begin(), products.end(), product)!=products.end();
+}
+
+void CatalogHandler::clearProducts()
+{
+  if (m_galDensity!=nullptr)
+  {
+    delete m_galDensity;
+    m_galDensity = nullptr;
+  }
+  if (m_productShearMap!=nullptr)
+  {
+    delete m_productShearMap;
+    m_productShearMap = nullptr;
+  }
+  if (m_productConvergenceMap!=nullptr)
+  {
+    delete m_productConvergenceMap;
+    m_productConvergenceMap = nullptr;
+  }
+  if (m_weightMap!=nullptr)
+  {
+    delete m_weightMap;
+    m_weightMap = nullptr;
+  }
+  if (m_shapeVarianceMap!=nullptr)
+  {
+    delete m_shapeVarianceMap;
+    m_shapeVarianceMap = nullptr;
+  }
+}
+
+ProductArrays CatalogHandler::initializeProductArrays(const std::vector<productEnum> &products,
+                                                      const unsigned int nbBinsX, const unsigned int nbBinsY)
+{
+  ProductArrays arrays;
+  unsigned int nbSlices = getNbRedshiftBins();
+
+  // The shape variance needs the mean shear of each bin
+  if (isRequested(products, shearProduct) || isRequested(products, shapeVarianceProduct))
+  {
+    arrays.m_shear = initializeArray<double>(nbBinsX, nbBinsY, 2*nbSlices);
+  }
+  if (isRequested(products, convergenceProduct))
+  {
+    arrays.m_convergence = initializeArray<double>(nbBinsX, nbBinsY, 2*nbSlices);
+  }
+  arrays.m_weight = initializeArray<double>(nbBinsX, nbBinsY, nbSlices);
+  if (isRequested(products, weightProduct))
+  {
+    arrays.m_squaredWeight = initializeArray<double>(nbBinsX, nbBinsY, nbSlices);
+  }
+  if (isRequested(products, shapeVarianceProduct))
+  {
+    arrays.m_shapeSquare = initializeArray<double>(nbBinsX, nbBinsY, nbSlices);
+  }
+
+  return arrays;
+}
+
+void CatalogHandler::deleteProductArrays(ProductArrays &arrays)
+{
+  for (double **array : {&arrays.m_shear, &arrays.m_convergence, &arrays.m_weight,
+                         &arrays.m_squaredWeight, &arrays.m_shapeSquare})
+  {
+    if (*array!=nullptr)
+    {
+      delete [] *array;
+      *array = nullptr;
+    }
+  }
+}
+
+bool CatalogHandler::setProducts(const std::vector<productEnum> &products, ProductArrays &arrays, long selGalCount,
+                                 const unsigned int nbBinsX, const unsigned int nbBinsY,
+                                 TWOD_MASS_WL_MassMapping::Boundaries &bounds)
+{
+  if (selGalCount==0)
+  {
+    deleteProductArrays(arrays);
+    return false;
+  }
+
+  unsigned int planSize = nbBinsX*nbBinsY;
+  unsigned int nbSlices = getNbRedshiftBins();
+  for (unsigned int slice = 0; slice<nbSlices; slice++)
+  {
+    for (unsigned int j = 0; j<planSize; j++)
+    {
+      // Index of the bin in the plan of the redshift bin and in the first of its two plans
+      unsigned int i = slice*planSize + j;
+      unsigned int k = 2*slice*planSize + j;
+      double weight = arrays.m_weight[i];
+
+      // The shape variance of each component is computed before the shear is normalized
+      if (arrays.m_shapeSquare!=nullptr)
+      {
+        if (weight>0)
+        {
+          double meanGamma1 = arrays.m_shear[k]/weight;
+          double meanGamma2 = arrays.m_shear[k + planSize]/weight;
+          arrays.m_shapeSquare[i] = 0.5*(arrays.m_shapeSquare[i]/weight - meanGamma1*meanGamma1
+                                         - meanGamma2*meanGamma2);
+        }
+      }
+
+      // Normalize the values to have the mean shear and convergence in each bin
+      if (weight>1)
+      {
+        if (arrays.m_shear!=nullptr)
+        {
+          arrays.m_shear[k] /= weight;
+          arrays.m_shear[k + planSize] /= weight;
+        }
+        if (arrays.m_convergence!=nullptr)
+        {
+          arrays.m_convergence[k] /= weight;
+        }
+      }
+    }
+  }
+
+  // Create the maps of the requested products
+  if (isRequested(products, shearProduct))
+  {
+    m_productShearMap = new ShearMap(arrays.m_shear, nbBinsX, nbBinsY, 2*nbSlices, bounds, selGalCount);
+  }
+  if (isRequested(products, convergenceProduct))
+  {
+    m_productConvergenceMap = new ConvergenceMap(arrays.m_convergence, nbBinsX, nbBinsY, 2*nbSlices,
+                                                 bounds, selGalCount);
+  }
+  if (isRequested(products, densityProduct))
+  {
+    m_galDensity = new GlobalMap(arrays.m_weight, nbBinsX, nbBinsY, nbSlices, bounds, selGalCount);
+  }
+  if (isRequested(products, weightProduct))
+  {
+    m_weightMap = new GlobalMap(arrays.m_squaredWeight, nbBinsX, nbBinsY, nbSlices, bounds, selGalCount);
+  }
+  if (isRequested(products, shapeVarianceProduct))
+  {
+    m_shapeVarianceMap = new GlobalMap(arrays.m_shapeSquare, nbBinsX, nbBinsY, nbSlices, bounds, selGalCount);
+  }
+
+  deleteProductArrays(arrays);
+  return true;
+}
+
 } // TWOD_MASS_WL_MapMaker namespace
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/ColumnarCatalogHandler.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MapMaker/ColumnarCatalogHandler.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+#include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+#include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+namespace TWOD_MASS_WL_MapMaker {
+
+ColumnarCatalogHandler::~ColumnarCatalogHandler()
+{
+}
+
+ColumnarCatalogHandler::ColumnarCatalogHandler(std::string filename):CatalogHandler(filename),
+m_catalog(new ColumnarCatalog(filename))
+{
+  // The writer of the catalog tells whether its shear is to be rotated
+  m_rotateShear = (m_catalog->getFlags() & unrotatedShearFlag)==0;
+}
+
+bool ColumnarCatalogHandler::readChunks(bool needShear, bool needKappa, bool needZ,
+                                        const std::function<void(const CatalogChunk&)> &processChunk,
+                                        const ChunkFilter &isChunkNeeded,
+                                        const RowRangeSelector &selectRows)
+{
+  if (m_catalog->isValid()==false)
+  {
+    return false;
+  }
+
+  // The columns are used in place in the mapped file
+  const double *ra = m_catalog->getColumn("ra");
+  const double *dec = m_catalog->getColumn("dec");
+  const double *z = m_catalog->getColumn("z");
+  const double *weight = m_catalog->getColumn("weight");
+  const double *gamma1 = needShear ? m_catalog->getColumn("gamma1") : nullptr;
+  const double *gamma2 = needShear ? m_catalog->getColumn("gamma2") : nullptr;
+  const double *kappa = needKappa ? m_catalog->getColumn("kappa") : nullptr;
+
+  // If the convergence is needed but no kappa info return false
+  if (needKappa && kappa==nullptr)
+  {
+    return false;
+  }
+
+  // If the shear is needed but no gamma info return false
+  if (needShear && (gamma1==nullptr || gamma2==nullptr))
+  {
+    return false;
+  }
+
+  // A tomographic extraction needs the redshifts
+  if (needZ && z==nullptr)
+  {
+    std::cout<<"no redshift column to extract the maps of the redshift bins"<<std::endl;
+    return false;
+  }
+
+  // If there is no ra or dec info then return false
+  if (ra==nullptr || dec==nullptr)
+  {
+    return false;
+  }
+
+  // The ranges of the blocks saved in the catalog are its zone map
+  CatalogZoneMap zoneMap;
+  zoneMap.setFromColumnarCatalog(*m_catalog);
+
+  // A sorted catalog only has its ranges of rows given by its key index to be read
+  long nbRows = m_catalog->getNbRows();
+  std::vector<std::pair<unsigned long, unsigned long> > rowRanges(1, std::make_pair(0, nbRows));
+  CatalogKeyIndex keyIndex;
+  keyIndex.setColumnNames("ra", "dec", z!=nullptr ? "z" : "");
+  if (selectRows && keyIndex.load(m_catalogFilename) && long(keyIndex.getNbRows())==nbRows)
+  {
+    rowRanges = selectRows(keyIndex);
+  }
+
+  // Each block of rows of the ranges is a chunk pointing into the columns, the blocks lying
+  // outside the selection being skipped without their pages being touched
+  for (auto &chunkRows : CatalogKeyIndex::splitRowRanges(rowRanges, m_catalog->getBlockRows()))
+  {
+    long first = chunkRows.first;
+    if (isChunkNeeded && isChunkNeeded(zoneMap, first, chunkRows.second)==false)
+    {
+      continue;
+    }
+    CatalogChunk chunk;
+    chunk.m_size = chunkRows.second;
+    chunk.m_ra = ra + first;
+    chunk.m_dec = dec + first;
+    chunk.m_z = z!=nullptr ? z + first : nullptr;
+    chunk.m_weight = weight!=nullptr ? weight + first : nullptr;
+    chunk.m_gamma1 = gamma1!=nullptr ? gamma1 + first : nullptr;
+    chunk.m_gamma2 = gamma2!=nullptr ? gamma2 + first : nullptr;
+    chunk.m_kappa = kappa!=nullptr ? kappa + first : nullptr;
+    processChunk(chunk);
+  }
+
+  return true;
+}
+
+} // TWOD_MASS_WL_MapMaker namespace
@@ -23,40 +23,65 @@
  */
 
 #include "TWOD_MASS_WL_MapMaker/FITSCatalogHandler.h"
+#include "TWOD_MASS_WL_MassMapping/BlockPrefetcher.h"
 #include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
 #include "TWOD_MASS_WL_MassMapping/ShearMap.h"
 #include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
 
 #include <CCfits/CCfits>
+#include <fitsio.h>
 
-const double pi = 3.14159265358979323846;
+#include <algorithm>
+#include <iostream>
 
 using namespace TWOD_MASS_WL_MassMapping;
 
 namespace TWOD_MASS_WL_MapMaker {
 
-FITSCatalogHandler::FITSCatalogHandler(std::string filename): CatalogHandler(filename)
+/**
+ * @brief One catalog column, read as doubles chunk after chunk into reusable buffers
+ *
+ * An empty column name gives a column that is never read
+ *
+ */
+struct ColumnReader
 {
-}
+  ColumnReader(CCfits::ExtHDU &table, const std::string &name): m_name(name), m_index(0)
+  {
+    if (name.empty()==false)
+    {
+      m_index = table.column(name).index();
+    }
+  }
 
-ShearMap* FITSCatalogHandler::getShearMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                          const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                          bool squareMap)
-{
-  // Retrieve the map from the private method
-  std::pair<long, double*> myPair = getMap(shearMap, bounds, nbBinsX, nbBinsY, squareMap);
+  bool read(fitsfile *fptr, long firstRow, long nbRows, std::vector<double> &values) const
+  {
+    if (m_index==0)
+    {
+      return true;
+    }
+    if (long(values.size())<nbRows)
+    {
+      values.resize(nbRows);
+    }
+    int status(0);
+    int anynul(0);
+    fits_read_col(fptr, TDOUBLE, m_index, firstRow, 1, nbRows, nullptr, values.data(), &anynul, &status);
+    return status==0;
+  }
 
-  return getShearMapFromArray(myPair, nbBinsX, nbBinsY, bounds);
-}
+  const double* data(const std::vector<double> &values) const
+  {
+    return m_index==0 ? nullptr : values.data();
+  }
 
-ConvergenceMap* FITSCatalogHandler::getConvergenceMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                      const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                                      bool squareMap)
-{
-  // Retrieve the map from the private method
-  std::pair<long, double*> myPair = getMap(convMap, bounds, nbBinsX, nbBinsY, squareMap);
+  std::string m_name;
+  int m_index;
+};
 
-  return getConvergenceMapFromArray(myPair, nbBinsX, nbBinsY, bounds);
+FITSCatalogHandler::FITSCatalogHandler(std::string filename): CatalogHandler(filename)
+{
 }
 
 bool FITSCatalogHandler::saveAsFitsCatalog(std::vector<std::vector<double> > inputData)
@@ -171,23 +196,10 @@ bool FITSCatalogHandler::saveAsFitsCatalog(std::vector<std::vector<double> > inp
   }
 }
 
-std::pair<long, double*> FITSCatalogHandler::getMap(mapEnum mapType, TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                    const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                                    bool squareMap)
+bool FITSCatalogHandler::readChunks(bool needShear, bool needKappa, bool needZ,
+                                    const std::function<void(const CatalogChunk&)> &processChunk,
+                                    const ChunkFilter &isChunkNeeded, const RowRangeSelector&)
 {
-
-  // Check variables inputs ra, dec and z are fine
-  if (checkRaDecZ(bounds)==false)
-  {
-    return std::pair<long, double*> (0, nullptr);
-  }
-
-  // Check the enum type is well provided
-  if (mapType!=convMap && mapType!=shearMap)
-  {
-    return std::pair<long, double*> (0, nullptr);
-  }
-
   try
   {
     ////////////////////////////////////// Open the FITS file if it exists
@@ -200,10 +212,6 @@ std::pair<long, double*> FITSCatalogHandler::getMap(mapEnum mapType, TWOD_MASS_W
     // Get the map from the FITS file
     std::map<std::string, CCfits::Column*> myColMap = table.column();
 
-    // Create map of columns and vector of keys
-//      std::map<std::string, std::valarray<double> > mapColumnsValues;
-    std::vector<std::string> mapKeys;
-
     ////////////////////////////////////// Read headers and perform some checks on them
     // Create empty keys for each info
     std::string keyRa("");
@@ -248,269 +256,128 @@ std::pair<long, double*> FITSCatalogHandler::getMap(mapEnum mapType, TWOD_MASS_W
       }
     }
 
-    // If the convMap is needed but no kappa info return false
-    if (mapType==convMap && keyKappa.empty())
+    // If the convergence is needed but no kappa info return false
+    if (needKappa && keyKappa.empty())
+    {
+      return false;
+    }
+
+    // If the shear is needed but no gamma info return false
+    if (needShear && (keyGamma1.empty() || keyGamma2.empty()))
     {
-      return std::pair<long, double*> (0, nullptr);
+      return false;
     }
 
-    // If the shearMap is needed but no gamma info return false
-    if (mapType==shearMap && (keyGamma1.empty() || keyGamma2.empty()))
+    // A tomographic extraction needs the redshifts
+    if (needZ && keyZ.empty())
     {
-      return std::pair<long, double*> (0, nullptr);
+      std::cout<<"no redshift column to extract the maps of the redshift bins"<<std::endl;
+      return false;
     }
 
     // If there is no ra or dec info then return false
     if (keyRa.empty() || keyDec.empty())
     {
-      return std::pair<long, double*> (0, nullptr);
+      return false;
     }
 
-    // Create references to the valarrays of the catalog values
-//      std::valarray<double> &decArray = mapColumnsValues[mapKeys[0]];
-//      std::valarray<double> &raArray = mapColumnsValues[mapKeys[3]];
-//      std::valarray<double> &gamma1Array = mapColumnsValues[mapKeys[1]];
-//      std::valarray<double> &gamma2Array = mapColumnsValues[mapKeys[2]];
-//      std::valarray<double> &zArray = mapColumnsValues[m_mapKeys[4]];
-
-    // Define variables of ra and dec min and max
-    double raMin = bounds.getRaMin();
-    double raMax = bounds.getRaMax();
-    double decMin = bounds.getDecMin();
-    double decMax = bounds.getDecMax();
-
     // Define the total number of rows and rows read
     long totalNumberOfRows(table.rows());
     long readRows(0);
     // Get the optimal number of rows to read by CCfits
     long rowSize = table.getRowsize()*1000;
 
-    // Define ra0 and dec0 at the center of min and max values
-    double ra0 = 0.5*(raMax + raMin);
-    double dec0 = 0.5*(decMax + decMin);
-    double raRange = (raMax - raMin);
-    double decRange = (decMax - decMin);
-
-    // Declare the bins size on X and Y
-    double binXSize, binYSize;
-
-    std::pair<double, double> xyMin = getGnomonicProjection(raMin, decMin, ra0, dec0);
-
-    // In case a square map is not expected, perform some basic radec projection ranges selection
-    if (squareMap == false)
-    {
-      std::pair<double, double> xyMax = getGnomonicProjection(raMax, decMax, ra0, dec0);
-
-//      std::cout<<"ra min and max: "<<raMin<<" "<<raMax<<std::endl;
-//      std::cout<<"dec min and max: "<<decMin<<" "<<decMax<<std::endl;
-//      std::cout<<"X min and max: "<<xyMin.first<<" "<<xyMax.first<<std::endl;
-//      std::cout<<"Y min and max: "<<xyMin.second<<" "<<xyMax.second<<std::endl;
-
-      // Define the bins sizes
-      binXSize = (xyMax.first - xyMin.first)/nbBinsX;
-      binYSize = (xyMax.second - xyMin.second)/nbBinsY;
-    }
-    // In case a square map is expected, perform some fancier computation to find out radec projection ranges
-    else
+    // Only the columns needed for the map are read, chunk after chunk, straight into
+    // buffers allocated once. The other columns of the table are never read
+    std::vector<ColumnReader> columns = {ColumnReader(table, keyRa), ColumnReader(table, keyDec),
+                                         ColumnReader(table, keyZ), ColumnReader(table, keyWeight),
+                                         ColumnReader(table, needShear ? keyGamma1 : std::string("")),
+                                         ColumnReader(table, needShear ? keyGamma2 : std::string("")),
+                                         ColumnReader(table, needKappa ? keyKappa : std::string(""))};
+
+    // The columns are read through cfitsio on the table HDU
+    table.makeThisCurrent();
+    fitsfile *fptr = pInputFile->fitsPointer();
+
+    // Load the zone map of the catalog, or compute it while reading all the rows
+    CatalogZoneMap zoneMap;
+    zoneMap.setColumnNames(keyRa, keyDec, keyZ);
+    bool zoneMapLoaded = zoneMap.load(m_catalogFilename) && long(zoneMap.getNbRows())==totalNumberOfRows;
+    if (zoneMapLoaded==false)
     {
-      std::pair<double, double> raDec1 = getInverseGnomonicProjection(-0.5*raRange*pi/180.,
-                                                                      -0.5*decRange*pi/180.,
-                                                                      ra0, dec0);
-      std::pair<double, double> raDec2 = getInverseGnomonicProjection(0,
-                                                                      -0.5*decRange*pi/180.,
-                                                                      ra0, dec0);
-      std::pair<double, double> raDec3 = getInverseGnomonicProjection(0.5*raRange*pi/180.,
-                                                                      -0.5*decRange*pi/180.,
-                                                                      ra0, dec0);
-      std::pair<double, double> raDec4 = getInverseGnomonicProjection(0.5*raRange*pi/180.,
-                                                                      0.5*decRange*pi/180.,
-                                                                      ra0, dec0);
-      std::pair<double, double> raDec5 = getInverseGnomonicProjection(0,
-                                                                      0.5*decRange*pi/180.,
-                                                                      ra0, dec0);
-      std::pair<double, double> raDec6 = getInverseGnomonicProjection(-0.5*raRange*pi/180.,
-                                                                      0.5*decRange*pi/180.,
-                                                                      ra0, dec0);
-
-      // Get the min and max values of ra and dec according to the geometrical effects of projection
-      raMin = raDec1.first < raDec6.first ? raDec1.first : raDec6.first;
-      decMin = raDec1.second < raDec2.second ? raDec1.second : raDec2.second;
-      raMax = raDec3.first > raDec4.first ? raDec3.first : raDec4.first;
-      decMax = raDec4.second > raDec5.second ? raDec4.second : raDec5.second;
-
-      std::cout<<"ra dec 1: "<<raDec1.first<<" "<<raDec1.second<<std::endl;
-      std::cout<<"ra dec 2: "<<raDec2.first<<" "<<raDec2.second<<std::endl;
-      std::cout<<"ra dec 3: "<<raDec3.first<<" "<<raDec3.second<<std::endl;
-      std::cout<<"ra dec 4: "<<raDec4.first<<" "<<raDec4.second<<std::endl;
-      std::cout<<"ra dec 5: "<<raDec5.first<<" "<<raDec5.second<<std::endl;
-      std::cout<<"ra dec 6: "<<raDec6.first<<" "<<raDec6.second<<std::endl;
-      std::cout<<"ra min and max: "<<raMin<<" "<<raMax<<std::endl;
-      std::cout<<"dec min and max: "<<decMin<<" "<<decMax<<std::endl;
-
-      // Define the bins sizes
-      binXSize = raRange*pi/180./nbBinsX;
-      binYSize = decRange*pi/180./nbBinsY;
+      zoneMap.clear();
     }
-//      std::cout<<"size of bins on X and Y: "<<binXSize<<" "<<binYSize<<std::endl;
-
-    // Create and initialize to zeros maps
-    double *mapArray = initializeArray<double>(nbBinsX, nbBinsY, 2);
-    double *countArray = initializeArray<double>(nbBinsX, nbBinsY, 1);
 
-    // Create a counter of the galaxies watched
-    unsigned int galCount(0);
-    // Create a counter of the galaxies selected
-    unsigned int selGalCount(0);
-
-    // Loop as long as all the rows are not read
+    // List the chunks to read, skipping the ones lying outside the selection
+    std::vector<std::pair<long, long> > chunkRows;
     while (readRows<totalNumberOfRows)
     {
-      // Create map of columns and vector of keys
-      std::map<std::string, std::valarray<double> > mapColumnsValues;
-      // Loop over it to retrieve the columns info
-//        std::map<std::string, CCfits::Column*>::iterator it;
-      for (it = myColMap.begin(); it!= myColMap.end(); ++it)
+      long nbRows = std::min(rowSize, totalNumberOfRows-readRows);
+      if (zoneMapLoaded==false || !isChunkNeeded || isChunkNeeded(zoneMap, readRows, nbRows))
       {
-        std::valarray<double> tmpArray;
-//        it->second->read(tmpArray, readRows+1, readRows + rowSize);
-
-        // Doing here some crazy bullshit to avoid memory increasing
-        CCfits::ColumnData<float> *myCol = dynamic_cast< CCfits::ColumnData<float>* >(it->second);
-        CCfits::ColumnData<float> *tmpCol = new CCfits::ColumnData<float>(*myCol);
-        tmpCol->read(tmpArray, readRows+1, readRows + rowSize);
-
-        // Fill the member mapColumnsValues with the values
-        mapColumnsValues[it->first]=tmpArray;
-
-        //          std::cout<<it->second->format()<<std::endl;
-        //          std::cout<<it->second->name()<<std::endl;
-        //          std::cout<<it->second->unit()<<std::endl;
-
-        // Fill the member mapColumnsValues with the values
-        mapColumnsValues[it->first]=tmpArray;
-        mapKeys.push_back(it->first);
-
-        delete tmpCol;
+        chunkRows.push_back(std::make_pair(readRows, nbRows));
       }
+      readRows+=nbRows;
+    }
 
-      // Loop over the values of the valarrays and keep the ones fulfilling the criteria
-      for (unsigned int i = 0; i<mapColumnsValues[keyDec].size(); i++)
+    // The chunks are read by an I/O thread while the previous ones are binned, the file
+    // being only used by that thread until all the chunks are processed. A cfitsio which
+    // is not reentrant can not be used from another thread, the chunks are then read in turn
+    BlockPrefetcher prefetcher(2, fits_is_reentrant()!=0);
+    prefetcher.start(chunkRows, [&columns, fptr](PrefetchBlock &block)
+    {
+      block.m_columns.resize(columns.size());
+      for (unsigned int c=0; c<columns.size(); c++)
       {
-        // Define the weight of each galaxy if any
-        double weight = 1.;
-        if (keyWeight.empty()==false)
+        if (columns[c].read(fptr, block.m_firstRow+1, block.m_nbRows, block.m_columns[c])==false)
         {
-          weight = mapColumnsValues[keyWeight][i];
+          std::cout<<"could not read the column "<<columns[c].m_name<<std::endl;
+          return false;
         }
-
-        // Check the values fulfil the right ascension and declination constraints
-        if ( mapColumnsValues[keyDec][i] >= decMin && mapColumnsValues[keyDec][i] <= decMax )
-        {
-          if ( mapColumnsValues[keyRa][i] >= raMin && mapColumnsValues[keyRa][i] <= raMax )
-          {
-            // If the redshift is provided check the values are ok too
-            bool redshiftOk = !keyZ.empty() &&
-                              mapColumnsValues[keyZ][i] >= bounds.getZMin() &&
-                              mapColumnsValues[keyZ][i] <= bounds.getZMax();
-            // If no redshift provided in the file then just go ahead
-            if (redshiftOk || keyZ.empty())
-            {
-              int tmpx, tmpy;
-              // In case square map needed
-              if (squareMap == true)
-              {
-                // project the selected radec on gnomonic plan
-                std::pair<double, double> tmpXY = getGnomonicProjection(mapColumnsValues[keyRa][i],
-                                                                        mapColumnsValues[keyDec][i],
-                                                                        ra0, dec0);
-
-                //  calculate where it is on the binning
-                tmpx = int(floor((tmpXY.first+0.5*raRange*pi/180.)/binXSize));
-                tmpy = int(floor((tmpXY.second+0.5*decRange*pi/180.)/binYSize));
-              }
-              // in case square map not needed
-              else
-              {
-                std::pair<double, double> tmpXY = getGnomonicProjection(mapColumnsValues[keyRa][i],
-                                                                        mapColumnsValues[keyDec][i],
-                                                                        ra0, dec0);
-
-                tmpx = int(floor((tmpXY.first-xyMin.first)/binXSize));
-                tmpy = int(floor((tmpXY.second-xyMin.second)/binYSize));
-              }
-              //          if (tmpx > nbBinsX || tmpx<0) std::cout<<tmpx<<std::endl;
-              //          if (tmpy > nbBinsY || tmpy<0) std::cout<<tmpy<<std::endl;
-              if (tmpx>=0 && tmpx<int(nbBinsX) && tmpy>=0 && tmpy<int(nbBinsY))
-              {
-                if (mapType==shearMap)
-                {
-                  // Apply correction for the projection
-                  std::pair<double, double> xy1 = getGnomonicProjection(mapColumnsValues[keyRa][i],
-                                                                        mapColumnsValues[keyDec][i],
-                                                                        ra0, dec0);
-                  std::pair<double, double> xy2 = getGnomonicProjection(mapColumnsValues[keyRa][i],
-                                                                        (mapColumnsValues[keyDec][i]+0.01),
-                                                                        ra0, dec0);
-
-                  double rotationAngle = -atan((xy2.first-xy1.first)/(xy2.second-xy1.second));
-
-                  double gamma1cor = mapColumnsValues[keyGamma1][i]*cos(2*rotationAngle)
-                                    -mapColumnsValues[keyGamma2][i]*sin(2*rotationAngle);
-                  double gamma2cor = mapColumnsValues[keyGamma1][i]*sin(2*rotationAngle)
-                                    +mapColumnsValues[keyGamma2][i]*cos(2*rotationAngle);
-
-                  mapArray[tmpy*nbBinsX + tmpx] += gamma1cor*weight;
-                  mapArray[nbBinsX*nbBinsY + tmpy*nbBinsX + tmpx] += gamma2cor*weight;
-                }
-                else if (mapType==convMap)
-                {
-                  mapArray[tmpy*nbBinsX + tmpx] += mapColumnsValues[keyKappa][i]*weight;
-                }
-                countArray[tmpy*nbBinsX + tmpx] += weight;
-                selGalCount+=weight;
-              }
-            }
-          }
-        }
-        galCount+=weight;
       }
+      return true;
+    });
 
-      readRows+=rowSize;
-//        std::cout<<"read "<<readRows<<" rows over a total of "<<totalNumberOfRows<<std::endl;
-    }
-
-    std::cout<<"number of galaxies selected: "<<selGalCount<<std::endl;
-    std::cout<<"over the total number of galaxies: "<<galCount<<std::endl;
-
-
-    // Normalize the values to have the mean shear in each bin
-    for (unsigned int i = 0; i<nbBinsX*nbBinsY; i++)
+    while (const PrefetchBlock *block = prefetcher.nextBlock())
     {
-      if (countArray[i]>1)
+      // Struct of arrays view on the chunk, the column pointers being resolved once per chunk
+      CatalogChunk chunk;
+      chunk.m_size = block->m_nbRows;
+      chunk.m_ra = columns[0].data(block->m_columns[0]);
+      chunk.m_dec = columns[1].data(block->m_columns[1]);
+      chunk.m_z = columns[2].data(block->m_columns[2]);
+      chunk.m_weight = columns[3].data(block->m_columns[3]);
+      chunk.m_gamma1 = columns[4].data(block->m_columns[4]);
+      chunk.m_gamma2 = columns[5].data(block->m_columns[5]);
+      chunk.m_kappa = columns[6].data(block->m_columns[6]);
+
+      processChunk(chunk);
+
+      if (zoneMapLoaded==false)
       {
-        mapArray[i] /= countArray[i];
-        mapArray[i + nbBinsX*nbBinsY] /= countArray[i];
+        zoneMap.addRows(chunk.m_size, chunk.m_ra, chunk.m_dec, chunk.m_z);
       }
     }
-
-    if (mapType==shearMap)
+    if (prefetcher.hasFailed())
     {
-      // Save the density map
-      m_galDensity = new GlobalMap(countArray, nbBinsX, nbBinsY, 1, bounds, selGalCount);
+      return false;
     }
 
-    // Delete dynamic arrays
-    delete [] countArray;
+    // Save the zone map for the next reads, the catalog being possibly read only
+    if (zoneMapLoaded==false && zoneMap.save(m_catalogFilename)==false)
+    {
+      std::cout<<"the zone map of "<<m_catalogFilename<<" could not be saved"<<std::endl;
+    }
 
-    return std::pair<long, double*> (selGalCount, mapArray);
+    return true;
   }
   catch (CCfits::FitsException&)
   {
     std::cout<<"exception thrown when opening/reading the file"<<std::endl;
-    return std::pair<long, double*> (0, nullptr);
+    return false;
   }
 
-  return std::pair<long, double*> (0, nullptr);
+  return false;
 }
 
 } // TWOD_MASS_WL_MapMaker namespace
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/GnomonicProjector.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MapMaker/GnomonicProjector.h"
+
+#include <cmath>
+
+namespace TWOD_MASS_WL_MapMaker {
+
+namespace {
+const double degToRad = 3.14159265358979323846/180.;
+}
+
+GnomonicProjector::GnomonicProjector(double ra0, double dec0):
+m_ra0(ra0*degToRad), m_sinDec0(sin(dec0*degToRad)), m_cosDec0(cos(dec0*degToRad))
+{
+}
+
+void GnomonicProjector::project(long nbGalaxies, const double *ra, const double *dec, double *x, double *y) const
+{
+  const double ra0 = m_ra0;
+  const double sinDec0 = m_sinDec0;
+  const double cosDec0 = m_cosDec0;
+
+  #pragma omp simd
+  for (long i=0; i<nbGalaxies; i++)
+  {
+    double deltaRa = ra[i]*degToRad - ra0;
+    double sinDec = sin(dec[i]*degToRad);
+    double cosDec = cos(dec[i]*degToRad);
+    double sinDeltaRa = sin(deltaRa);
+    double cosDeltaRa = cos(deltaRa);
+
+    double invCosc = 1./(sinDec0*sinDec + cosDec0*cosDec*cosDeltaRa);
+    x[i] = invCosc*cosDec*sinDeltaRa;
+    y[i] = invCosc*(cosDec0*sinDec - sinDec0*cosDec*cosDeltaRa);
+  }
+}
+
+void GnomonicProjector::project(long nbGalaxies, const double *ra, const double *dec, double *x, double *y,
+                                double *cos2angle, double *sin2angle) const
+{
+  const double ra0 = m_ra0;
+  const double sinDec0 = m_sinDec0;
+  const double cosDec0 = m_cosDec0;
+
+  #pragma omp simd
+  for (long i=0; i<nbGalaxies; i++)
+  {
+    double deltaRa = ra[i]*degToRad - ra0;
+    double sinDec = sin(dec[i]*degToRad);
+    double cosDec = cos(dec[i]*degToRad);
+    double sinDeltaRa = sin(deltaRa);
+    double cosDeltaRa = cos(deltaRa);
+
+    // x = a/c and y = b/c
+    double a = cosDec*sinDeltaRa;
+    double b = cosDec0*sinDec - sinDec0*cosDec*cosDeltaRa;
+    double c = sinDec0*sinDec + cosDec0*cosDec*cosDeltaRa;
+    double invCosc = 1./c;
+    x[i] = invCosc*a;
+    y[i] = invCosc*b;
+
+    // Derivatives along the declination, the common 1/c^2 factor of dx and dy cancels in the angle
+    double da = -sinDec*sinDeltaRa;
+    double db = cosDec0*cosDec + sinDec0*sinDec*cosDeltaRa;
+    double dc = sinDec0*cosDec - cosDec0*sinDec*cosDeltaRa;
+    double dx = da*c - a*dc;
+    double dy = db*c - b*dc;
+
+    // The rotation angle is -atan(dx/dy), its double angle follows from its tangent
+    double norm = 1./(dx*dx + dy*dy);
+    cos2angle[i] = (dy*dy - dx*dx)*norm;
+    sin2angle[i] = -2.*dx*dy*norm;
+  }
+}
+
+} // TWOD_MASS_WL_MapMaker namespace
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/MapBinner.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MapMaker/MapBinner.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace TWOD_MASS_WL_MapMaker {
+
+namespace {
+// Number of galaxies of the blocks given to the threads
+const long blockSize = 4096;
+// Size in bytes of a tile of the map arrays
+const unsigned long tileBytes = 256*1024;
+// Number of galaxies of the parts of a chunk binned one after the other, a multiple of the block size
+const long partSize = 16*blockSize;
+
+// Arrays filled for a single type of map
+ProductArrays mapTypeArrays(mapEnum mapType, double *mapArray, double *countArray)
+{
+  ProductArrays arrays;
+  if (mapType==shearMap)
+  {
+    arrays.m_shear = mapArray;
+  }
+  else
+  {
+    arrays.m_convergence = mapArray;
+  }
+  arrays.m_weight = countArray;
+  return arrays;
+}
+}
+
+MapBinner::MapBinner(mapEnum mapType, unsigned int nbBinsX, unsigned int nbBinsY,
+                     double *mapArray, double *countArray):
+MapBinner(nbBinsX, nbBinsY, mapTypeArrays(mapType, mapArray, countArray))
+{
+}
+
+MapBinner::MapBinner(unsigned int nbBinsX, unsigned int nbBinsY, const ProductArrays &arrays):
+m_nbBinsX(nbBinsX), m_nbBinsY(nbBinsY), m_arrays(arrays),
+m_projector(0., 0.), m_xOrigin(0.), m_yOrigin(0.), m_binXSize(1.), m_binYSize(1.), m_rotateShear(true),
+m_raMin(0.), m_raMax(0.), m_decMin(0.), m_decMax(0.), m_zMin(0.), m_zMax(0.), m_nbSlices(1),
+m_galaxyWeight(0.), m_selectedWeight(0.)
+{
+  setTileRows();
+}
+
+void MapBinner::setTileRows()
+{
+  // Count the plans filled for each bin
+  unsigned long nbPlans(1);
+  nbPlans += m_arrays.m_shear!=nullptr ? 2 : 0;
+  nbPlans += m_arrays.m_convergence!=nullptr ? 1 : 0;
+  nbPlans += m_arrays.m_squaredWeight!=nullptr ? 1 : 0;
+  nbPlans += m_arrays.m_shapeSquare!=nullptr ? 1 : 0;
+  unsigned long rowBytes = m_nbSlices*nbPlans*sizeof(double)*std::max(m_nbBinsX, 1u);
+  m_tileRows = std::max(1ul, tileBytes/rowBytes);
+}
+
+void MapBinner::setProjection(double ra0, double dec0, double xOrigin, double yOrigin,
+                              double binXSize, double binYSize, bool rotateShear)
+{
+  m_projector = GnomonicProjector(ra0, dec0);
+  m_xOrigin = xOrigin;
+  m_yOrigin = yOrigin;
+  m_binXSize = binXSize;
+  m_binYSize = binYSize;
+  m_rotateShear = rotateShear;
+}
+
+void MapBinner::setSelection(double raMin, double raMax, double decMin, double decMax, double zMin, double zMax)
+{
+  m_raMin = raMin;
+  m_raMax = raMax;
+  m_decMin = decMin;
+  m_decMax = decMax;
+  m_zMin = zMin;
+  m_zMax = zMax;
+}
+
+void MapBinner::setRedshiftBins(const std::vector<double> &zEdges)
+{
+  m_zEdges = zEdges;
+  m_nbSlices = zEdges.size()>1 ? zEdges.size()-1 : 1;
+  setTileRows();
+}
+
+void MapBinner::binChunk(const CatalogChunk &chunk)
+{
+  // Large chunks are binned by parts, bounding the memory of the buffers of each galaxy
+  for (long first=0; first<chunk.m_size; first+=partSize)
+  {
+    CatalogChunk part;
+    part.m_size = std::min(partSize, chunk.m_size-first);
+    auto shifted = [first](const double *column) { return column!=nullptr ? column+first : nullptr; };
+    part.m_ra = shifted(chunk.m_ra);
+    part.m_dec = shifted(chunk.m_dec);
+    part.m_z = shifted(chunk.m_z);
+    part.m_weight = shifted(chunk.m_weight);
+    part.m_gamma1 = shifted(chunk.m_gamma1);
+    part.m_gamma2 = shifted(chunk.m_gamma2);
+    part.m_kappa = shifted(chunk.m_kappa);
+    binPart(part);
+  }
+}
+
+void MapBinner::binPart(const CatalogChunk &chunk)
+{
+  long nbGalaxies = chunk.m_size;
+  if (nbGalaxies<=0)
+  {
+    return;
+  }
+  if (long(m_bins.size())<nbGalaxies)
+  {
+    m_bins.resize(nbGalaxies);
+    m_slices.resize(nbGalaxies);
+    m_values1.resize(nbGalaxies);
+    m_values2.resize(nbGalaxies);
+    m_kappaValues.resize(nbGalaxies);
+    m_shapeSquares.resize(nbGalaxies);
+    m_weights.resize(nbGalaxies);
+    m_tileGalaxies.resize(nbGalaxies);
+  }
+
+  bool hasWeight = chunk.m_weight!=nullptr;
+  bool hasZ = chunk.m_z!=nullptr;
+  bool isTomographic = m_zEdges.size()>1;
+  if (isTomographic && hasZ==false)
+  {
+    std::cout<<"no redshift to perform a tomographic binning"<<std::endl;
+    return;
+  }
+  bool isShear = m_arrays.m_shear!=nullptr;
+  bool isConvergence = m_arrays.m_convergence!=nullptr;
+  bool hasShapeSquare = m_arrays.m_shapeSquare!=nullptr;
+  long nbBlocks = (nbGalaxies + blockSize - 1)/blockSize;
+
+  // Selection, projection and bin of each galaxy, by blocks of galaxies
+  #pragma omp parallel
+  {
+    std::vector<long> selIndex(blockSize);
+    std::vector<double> selRa(blockSize), selDec(blockSize), selX(blockSize), selY(blockSize);
+    std::vector<double> selCos2angle(blockSize), selSin2angle(blockSize);
+
+    #pragma omp for schedule(static)
+    for (long block=0; block<nbBlocks; block++)
+    {
+      long first = block*blockSize;
+      long last = std::min(nbGalaxies, first + blockSize);
+
+      // Select the galaxies inside the patch
+      long nbSelected(0);
+      for (long i=first; i<last; i++)
+      {
+        m_bins[i] = -1;
+
+        bool inside = (chunk.m_dec[i] >= m_decMin) & (chunk.m_dec[i] <= m_decMax) &
+                      (chunk.m_ra[i] >= m_raMin) & (chunk.m_ra[i] <= m_raMax);
+        if (hasZ)
+        {
+          inside &= (chunk.m_z[i] >= m_zMin) & (chunk.m_z[i] <= m_zMax);
+        }
+        // Find the redshift bin of the galaxy, the last edge being in the last bin
+        if (isTomographic)
+        {
+          inside &= (chunk.m_z[i] >= m_zEdges.front()) & (chunk.m_z[i] <= m_zEdges.back());
+          long slice = std::upper_bound(m_zEdges.begin(), m_zEdges.end(), chunk.m_z[i]) - m_zEdges.begin() - 1;
+          m_slices[i] = std::min(std::max(slice, 0l), long(m_nbSlices)-1);
+        }
+        else
+        {
+          m_slices[i] = 0;
+        }
+        if (inside)
+        {
+          selIndex[nbSelected] = i;
+          selRa[nbSelected] = chunk.m_ra[i];
+          selDec[nbSelected] = chunk.m_dec[i];
+          nbSelected++;
+        }
+      }
+
+      // Project them all at once
+      if (isShear && m_rotateShear)
+      {
+        m_projector.project(nbSelected, selRa.data(), selDec.data(), selX.data(), selY.data(),
+                            selCos2angle.data(), selSin2angle.data());
+      }
+      else
+      {
+        m_projector.project(nbSelected, selRa.data(), selDec.data(), selX.data(), selY.data());
+      }
+
+      // Find their bin and weighted values
+      for (long s=0; s<nbSelected; s++)
+      {
+        int binX = int(floor((selX[s]-m_xOrigin)/m_binXSize));
+        int binY = int(floor((selY[s]-m_yOrigin)/m_binYSize));
+        if (binX<0 || binX>=int(m_nbBinsX) || binY<0 || binY>=int(m_nbBinsY))
+        {
+          continue;
+        }
+        long i = selIndex[s];
+        double weight = hasWeight ? chunk.m_weight[i] : 1.;
+        m_bins[i] = binY*m_nbBinsX + binX;
+        m_weights[i] = weight;
+        if (isShear)
+        {
+          double gamma1 = chunk.m_gamma1[i];
+          double gamma2 = chunk.m_gamma2[i];
+          if (m_rotateShear)
+          {
+            // Apply correction for the projection
+            m_values1[i] = (gamma1*selCos2angle[s] - gamma2*selSin2angle[s])*weight;
+            m_values2[i] = (gamma1*selSin2angle[s] + gamma2*selCos2angle[s])*weight;
+          }
+          else
+          {
+            m_values1[i] = gamma1*weight;
+            m_values2[i] = gamma2*weight;
+          }
+          if (hasShapeSquare)
+          {
+            m_shapeSquares[i] = (gamma1*gamma1 + gamma2*gamma2)*weight;
+          }
+        }
+        if (isConvergence)
+        {
+          m_kappaValues[i] = chunk.m_kappa[i]*weight;
+        }
+      }
+    }
+  }
+
+  // Sums of the weights in the order of the catalog, as the bins, so that they do not depend on
+  // the chunks the catalog is read by
+  for (long i=0; i<nbGalaxies; i++)
+  {
+    m_galaxyWeight += hasWeight ? chunk.m_weight[i] : 1.;
+    if (m_bins[i]>=0)
+    {
+      m_selectedWeight += m_weights[i];
+    }
+  }
+
+  // Sort the galaxies by tile, keeping the catalog order inside each tile
+  unsigned int nbTiles = (m_nbBinsY + m_tileRows - 1)/m_tileRows;
+  unsigned int tileBins = m_tileRows*m_nbBinsX;
+  m_tileOffsets.assign(nbTiles+1, 0);
+  for (long i=0; i<nbGalaxies; i++)
+  {
+    if (m_bins[i]>=0)
+    {
+      m_tileOffsets[m_bins[i]/tileBins + 1]++;
+    }
+  }
+  for (unsigned int tile=0; tile<nbTiles; tile++)
+  {
+    m_tileOffsets[tile+1] += m_tileOffsets[tile];
+  }
+  std::vector<long> tileFill(m_tileOffsets.begin(), m_tileOffsets.end()-1);
+  for (long i=0; i<nbGalaxies; i++)
+  {
+    if (m_bins[i]>=0)
+    {
+      m_tileGalaxies[tileFill[m_bins[i]/tileBins]++] = i;
+    }
+  }
+
+  // Accumulate each tile in one thread, the tiles being disjoint parts of the maps
+  unsigned long planSize = m_nbBinsX*m_nbBinsY;
+  #pragma omp parallel for schedule(dynamic)
+  for (int tile=0; tile<int(nbTiles); tile++)
+  {
+    for (long k=m_tileOffsets[tile]; k<m_tileOffsets[tile+1]; k++)
+    {
+      long i = m_tileGalaxies[k];
+      // Index of the bin in the plan of its redshift bin and in the first of its two plans
+      unsigned long bin = m_slices[i]*planSize + m_bins[i];
+      unsigned long pairBin = 2*m_slices[i]*planSize + m_bins[i];
+      if (isShear)
+      {
+        m_arrays.m_shear[pairBin] += m_values1[i];
+        m_arrays.m_shear[planSize + pairBin] += m_values2[i];
+      }
+      if (isConvergence)
+      {
+        m_arrays.m_convergence[pairBin] += m_kappaValues[i];
+      }
+      m_arrays.m_weight[bin] += m_weights[i];
+      if (m_arrays.m_squaredWeight!=nullptr)
+      {
+        m_arrays.m_squaredWeight[bin] += m_weights[i]*m_weights[i];
+      }
+      if (hasShapeSquare)
+      {
+        m_arrays.m_shapeSquare[bin] += m_shapeSquares[i];
+      }
+    }
+  }
+}
+
+bool MapBinner::mayOverlap(const TWOD_MASS_WL_MassMapping::CatalogZoneMap &zoneMap, long firstRow, long nbRows) const
+{
+  return zoneMap.mayOverlap(firstRow, nbRows, m_raMin, m_raMax, m_decMin, m_decMax, m_zMin, m_zMax);
+}
+
+std::vector<std::pair<unsigned long, unsigned long> >
+  MapBinner::getRowRanges(const TWOD_MASS_WL_MassMapping::CatalogKeyIndex &keyIndex) const
+{
+  return keyIndex.getRowRanges(m_raMin, m_raMax, m_decMin, m_decMax, m_zMin, m_zMax);
+}
+
+double MapBinner::getGalaxyWeight() const
+{
+  return m_galaxyWeight;
+}
+
+double MapBinner::getSelectedWeight() const
+{
+  return m_selectedWeight;
+}
+
+} // TWOD_MASS_WL_MapMaker namespace
@@ -25,6 +25,7 @@
 #include "TWOD_MASS_WL_MapMaker/MapMakerParser.h"
 #include "TWOD_MASS_WL_MassMapping/Boundaries.h"
 #include "TWOD_MASS_WL_MapMaker/SSVCatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/ColumnarCatalogHandler.h"
 #include "TWOD_MASS_WL_MapMaker/FITSCatalogHandler.h"
 #include "TWOD_MASS_WL_MassMapping/ShearMap.h"
 #include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
@@ -55,9 +56,9 @@ MapMakerParser::~MapMakerParser()
 }
 
 MapMakerParser::MapMakerParser(): m_ShearMap(nullptr), m_ConvergenceMap(nullptr), m_inputSSVcatalog(""),
-m_inputFITScatalog(""), m_outputFITSshearMap(""), m_outputFITSconvergenceMap(""), m_outputFITSdensityMap(""),
-m_raMin(360.), m_raMax(0.), m_decMin(90.), m_decMax(-90.), m_zMin(0.), m_zMax(100.), m_nbBinsX(0), m_nbBinsY(0),
-m_workDir(""), squareMap(true)
+m_inputFITScatalog(""), m_inputColumnarCatalog(""), m_outputColumnarCatalog(""), m_outputFITSshearMap(""), m_outputFITSconvergenceMap(""), m_outputFITSdensityMap(""),
+m_outputFITSweightMap(""), m_outputFITSshapeVarianceMap(""), m_raMin(360.), m_raMax(0.), m_decMin(90.), m_decMax(-90.), m_zMin(0.), m_zMax(100.), m_nbBinsX(0), m_nbBinsY(0),
+m_workDir(""), squareMap(true), m_outputCompression(noCompression), m_outputFITSproduct("")
 {
 }
 
@@ -76,11 +77,26 @@ po::options_description MapMakerParser::defineSpecificProgramOptions()
 
       ("inputFITSCatalog", po::value<std::string>(), "input FITS catalog to read")
       ("inputSSVCatalog", po::value<std::string>(), "input SSV catalog to read")
+      ("inputColumnarCatalog", po::value<std::string>(),
+       "input catalog in the columnar format to read, as saved with outputColumnarCatalog")
+      ("outputColumnarCatalog", po::value<std::string>(),
+       "output file in which to save the input catalog in the columnar format, much faster to read"
+       " in the next runs")
 
       ("outputConvMapFITS", po::value<std::string>(), "output file in which to save the convergence map")
       ("outputShearMapFITS", po::value<std::string>(), "output file in which to save the shear map")
+      ("outputCompression", po::value<std::string>()->default_value("none"),
+       "tile compression of the output maps: none, rice (quantized) or gzip (lossless) (default none)")
       ("outputShearDensityMapFITS", po::value<std::string>(),
        "output file in which to save the density map (default is [outputShearMapFITS]_density.fits)")
+      ("outputWeightMapFITS", po::value<std::string>(),
+       "output file in which to save the map of the sum of the squared weights")
+      ("outputShapeVarianceMapFITS", po::value<std::string>(),
+       "output file in which to save the map of the shape variance")
+      ("outputProductFITS", po::value<std::string>(),
+       "product file in which to save the extracted maps as extensions, SHEAR (unless only"
+       " outputConvMapFITS is given), CONVERGENCE if outputConvMapFITS is given, DENSITY, and"
+       " WEIGHT and SHAPE_VARIANCE if their output is given")
 
       ("outputMapBinXY", po::value<std::vector<int> >()->multitoken(),
        "number of bins X and Y into the output map")
@@ -90,6 +106,9 @@ po::options_description MapMakerParser::defineSpecificProgramOptions()
        "declination min and max values for which to extract the map")
       ("zMinMax", po::value<std::vector<float> >()->multitoken(),
        "redshift min and max values for which to extract the map")
+      ("zBinEdges", po::value<std::vector<float> >()->multitoken(),
+       "increasing edges of redshift bins, the maps of all the bins being extracted in a single pass"
+       " as the plans of the output maps (2 plans per bin for the shear and convergence)")
       ("pixelSize", po::value<std::vector<float> >()->multitoken(),
        "physical pixel size in degrees")
       ("mapSize", po::value<std::vector<float> >()->multitoken(),
@@ -153,6 +172,15 @@ bool MapMakerParser::parseInputParameters(std::map<std::string, po::variable_val
       countInputs++;
       //        std::cout<<"value of inputSSVCatalog: "<<inputSSVcatalog<<std::endl;
     }
+    else if (it->first=="inputColumnarCatalog")
+    {
+      m_inputColumnarCatalog = args["inputColumnarCatalog"].as<std::string>();
+      countInputs++;
+    }
+    else if (it->first=="outputColumnarCatalog")
+    {
+      m_outputColumnarCatalog = args["outputColumnarCatalog"].as<std::string>();
+    }
     else if (it->first=="outputConvMapFITS")
     {
       m_outputFITSconvergenceMap = args["outputConvMapFITS"].as<std::string>();
@@ -163,10 +191,38 @@ bool MapMakerParser::parseInputParameters(std::map<std::string, po::variable_val
       m_outputFITSshearMap = args["outputShearMapFITS"].as<std::string>();
       //        std::cout<<"value of outputFITSshearMap: "<<m_outputFITSshearMap<<std::endl;
     }
+    else if (it->first=="outputCompression")
+    {
+      std::string compression = args["outputCompression"].as<std::string>();
+      if (compression=="rice")
+      {
+        m_outputCompression = riceCompression;
+      }
+      else if (compression=="gzip")
+      {
+        m_outputCompression = gzipCompression;
+      }
+      else if (compression!="none")
+      {
+        std::cout<<"unknown output compression "<<compression<<", maps saved without compression"<<std::endl;
+      }
+    }
     else if (it->first=="outputShearDensityMapFITS")
     {
       m_outputFITSdensityMap = args["outputShearDensityMapFITS"].as<std::string>();
     }
+    else if (it->first=="outputWeightMapFITS")
+    {
+      m_outputFITSweightMap = args["outputWeightMapFITS"].as<std::string>();
+    }
+    else if (it->first=="outputShapeVarianceMapFITS")
+    {
+      m_outputFITSshapeVarianceMap = args["outputShapeVarianceMapFITS"].as<std::string>();
+    }
+    else if (it->first=="outputProductFITS")
+    {
+      m_outputFITSproduct = args["outputProductFITS"].as<std::string>();
+    }
     else if (it->first=="outputMapBinXY")
     {
       std::vector<int> binsXY = args["outputMapBinXY"].as<std::vector<int> >();
@@ -226,6 +282,24 @@ bool MapMakerParser::parseInputParameters(std::map<std::string, po::variable_val
       }
       //        std::cout<<"value of dec min and max: "<<m_decMin<<" "<<m_decMax<<std::endl;
     }
+    else if (it->first=="zBinEdges")
+    {
+      std::vector<float> zBinEdges = args["zBinEdges"].as<std::vector<float> >();
+      m_zBinEdges.assign(zBinEdges.begin(), zBinEdges.end());
+      if (m_zBinEdges.size()<2)
+      {
+        std::cout<<"at least two redshift bin edges are needed"<<std::endl;
+        return false;
+      }
+      for (unsigned int i=1; i<m_zBinEdges.size(); i++)
+      {
+        if (m_zBinEdges[i]<=m_zBinEdges[i-1])
+        {
+          std::cout<<"the redshift bin edges are not increasing"<<std::endl;
+          return false;
+        }
+      }
+    }
     else if (it->first=="pixelSize")
     {
       std::vector<float> pixelSize = args["pixelSize"].as<std::vector<float> >();
@@ -324,17 +398,32 @@ bool MapMakerParser::parseInputParameters(std::map<std::string, po::variable_val
     return false;
   }
 
-  // Check an output file for the shear or the convergence map is provided
-  if (m_outputFITSshearMap.empty() && m_outputFITSconvergenceMap.empty())
+  // With a product file the maps are saved as its extensions, the shear map by default
+  if (m_outputFITSproduct.empty()==false)
   {
-    std::cout<<"no output file is provided to save an extracted map"<<std::endl;
-    return false;
+    if (m_outputFITSconvergenceMap.empty() || m_outputFITSshearMap.empty()==false)
+    {
+      m_outputFITSshearMap = m_outputFITSproduct + "[" + shearExtension + "]";
+    }
+    if (m_outputFITSconvergenceMap.empty()==false)
+    {
+      m_outputFITSconvergenceMap = m_outputFITSproduct + "[" + convergenceExtension + "]";
+    }
+    m_outputFITSdensityMap = m_outputFITSproduct + "[" + densityExtension + "]";
+    if (m_outputFITSweightMap.empty()==false)
+    {
+      m_outputFITSweightMap = m_outputFITSproduct + "[" + weightExtension + "]";
+    }
+    if (m_outputFITSshapeVarianceMap.empty()==false)
+    {
+      m_outputFITSshapeVarianceMap = m_outputFITSproduct + "[" + shapeVarianceExtension + "]";
+    }
   }
 
-  // If both shear and convergence want to be extracted: not handled
-  if (m_outputFITSshearMap.empty() == false && m_outputFITSconvergenceMap.empty() == false)
+  // Check an output file for the shear or the convergence map is provided
+  if (m_outputFITSshearMap.empty() && m_outputFITSconvergenceMap.empty())
   {
-    std::cout<<"both shear and convergence maps can not be extracted at the same time"<<std::endl;
+    std::cout<<"no output file is provided to save an extracted map"<<std::endl;
     return false;
   }
 
@@ -364,139 +453,111 @@ bool MapMakerParser::extractMap()
     }
   }
 
-  /// Case of a SSV catalog: retrieve the needed map out of it
+  /// Case of a SSV catalog: retrieve the needed maps out of it
   if (m_inputSSVcatalog.empty()==false)
   {
     // Create the catalog handler
     SSVCatalogHandler mySSVhandler(m_workDir + m_inputSSVcatalog);
 
-    // In case the shear map has to be extracted
-    if (m_outputFITSshearMap.empty() == false)
-    {
-      tStart = clock();
-      m_ShearMap = mySSVhandler.getShearMap(bounds, m_nbBinsX, m_nbBinsY, squareMap);
-
-      std::cout<<"time to extract the shear map of the SSV catalog: ";
-      std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
-
-      // In case no shear map could be extracted from the catalog warn the user
-      if (m_ShearMap==nullptr)
-      {
-        std::cout<<"needed information to build a shear map not provided into the catalog"<<std::endl;
-        return false;
-      }
-
-      // Save the extracted map
-      m_ShearMap->saveToFITSfile(m_workDir + m_outputFITSshearMap, true);
-
-      // Save the density map if any
-      if (mySSVhandler.getDensityMap()!=nullptr)
-      {
-        mySSVhandler.getDensityMap()->saveToFITSfile(m_workDir + m_outputFITSdensityMap, true);
-      }
-    }
-    // In case the convergence map has to be extracted
-    else if (m_outputFITSconvergenceMap.empty() == false)
-    {
-      tStart = clock();
-      m_ConvergenceMap = mySSVhandler.getConvergenceMap(bounds, m_nbBinsX, m_nbBinsY, squareMap);
-
-      std::cout<<"time to extract the convergence map of the SSV catalog: ";
-      std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
-
-      // In case no shear map could be extracted from the catalog warn the user
-      if (m_ConvergenceMap==nullptr)
-      {
-        std::cout<<"needed information to build a convergence map not provided into the catalog"<<std::endl;
-        return false;
-      }
+    return extractMapsFromHandler(mySSVhandler, bounds);
+  }
+  /// Case of a columnar catalog: retrieve the needed maps out of it
+  else if (m_inputColumnarCatalog.empty()==false)
+  {
+    // Create the catalog handler
+    ColumnarCatalogHandler myColumnarHandler(m_workDir + m_inputColumnarCatalog);
 
-      // Save the extracted map
-      m_ConvergenceMap->saveToFITSfile(m_workDir + m_outputFITSconvergenceMap, true);
-      // Save the density map if any
-      if (mySSVhandler.getDensityMap()!=nullptr)
-      {
-        mySSVhandler.getDensityMap()->saveToFITSfile(m_workDir + m_outputFITSdensityMap, true);
-      }
-    }
+    return extractMapsFromHandler(myColumnarHandler, bounds);
   }
-  /// Case of a FITS catalog: retrieve the needed map out of it
+  /// Case of a FITS catalog: retrieve the needed maps out of it
   else if (m_inputFITScatalog.empty()==false)
   {
     // Create the catalog handler
     FITSCatalogHandler myFITShandler(m_workDir + m_inputFITScatalog);
 
-    // In case the shear map has to be extracted
-    if (m_outputFITSshearMap.empty() == false)
-    {
-      tStart = clock();
-
-      m_ShearMap = myFITShandler.getShearMap(bounds, m_nbBinsX, m_nbBinsY, squareMap);
-
-      std::cout<<"time to extract the shear map of the FITS catalog: ";
-      std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
-
-      // In case no shear map could be extracted from the catalog warn the user
-      if (m_ShearMap==nullptr)
-      {
-        std::cout<<"needed information to build a shear map not provided into the catalog"<<std::endl;
-        return false;
-      }
+    return extractMapsFromHandler(myFITShandler, bounds);
+  }
 
-      // Save the extracted map
-      m_ShearMap->saveToFITSfile(m_workDir + m_outputFITSshearMap, true);
+  /// case no input provided
+  return false;
+}
 
-      // Save the density map if any
-      if (myFITShandler.getDensityMap()!=nullptr)
-      {
-        myFITShandler.getDensityMap()->saveToFITSfile(m_workDir + m_outputFITSdensityMap, true);
-      }
-    }
-    // In case the convergence map has to be extracted
-    else if (m_outputFITSconvergenceMap.empty() == false)
+bool MapMakerParser::extractMapsFromHandler(CatalogHandler &catalog, TWOD_MASS_WL_MassMapping::Boundaries &bounds)
+{
+  // Save the catalog in the columnar format for the next runs if requested
+  if (m_outputColumnarCatalog.empty() == false)
+  {
+    tStart = clock();
+    if (catalog.saveAsColumnarCatalog(m_workDir + m_outputColumnarCatalog) == false)
     {
-      tStart = clock();
-      m_ConvergenceMap = myFITShandler.getConvergenceMap(bounds, m_nbBinsX, m_nbBinsY, squareMap);
+      std::cout<<"the catalog could not be saved in the columnar format"<<std::endl;
+      return false;
+    }
+    std::cout<<"time to save the catalog in the columnar format: ";
+    std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
+  }
 
-      std::cout<<"time to extract the convergence map of the FITS catalog: ";
-      std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
+  // Gather the requested products, the density map going along with the shear map
+  std::vector<productEnum> products;
+  if (m_outputFITSshearMap.empty() == false)
+  {
+    products.push_back(shearProduct);
+  }
+  if (m_outputFITSconvergenceMap.empty() == false)
+  {
+    products.push_back(convergenceProduct);
+  }
+  if (m_outputFITSshearMap.empty() == false || m_outputFITSproduct.empty() == false)
+  {
+    products.push_back(densityProduct);
+  }
+  if (m_outputFITSweightMap.empty() == false)
+  {
+    products.push_back(weightProduct);
+  }
+  if (m_outputFITSshapeVarianceMap.empty() == false)
+  {
+    products.push_back(shapeVarianceProduct);
+  }
 
-      // In case no convergence map could be extracted from the catalog warn the user
-      if (m_ConvergenceMap==nullptr)
-      {
-        std::cout<<"needed information to build a convergence map not provided into the catalog"<<std::endl;
-        return false;
-      }
+  // Extract all the maps, of all the redshift bins, in a single pass over the catalog
+  catalog.setRedshiftBins(m_zBinEdges);
+  tStart = clock();
+  bool extracted = catalog.getMaps(products, bounds, m_nbBinsX, m_nbBinsY, squareMap);
 
-      // Save the extracted map
-      m_ConvergenceMap->saveToFITSfile(m_workDir + m_outputFITSconvergenceMap, true);
+  std::cout<<"time to extract the maps of the catalog: ";
+  std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
 
-      // Save the density map if any
-      if (myFITShandler.getDensityMap()!=nullptr)
-      {
-        myFITShandler.getDensityMap()->saveToFITSfile(m_workDir + m_outputFITSdensityMap, true);
-      }
-    }
-  }
-  /// case no input provided
-  else
+  // In case no map could be extracted from the catalog warn the user
+  if (extracted == false)
   {
+    std::cout<<"needed information to build the maps not provided into the catalog"<<std::endl;
     return false;
   }
 
-  // Delete the pointers and leave
-  if (m_ConvergenceMap!=nullptr)
+  // Save the extracted maps
+  if (catalog.getProductShearMap()!=nullptr)
   {
-    delete m_ConvergenceMap;
-    m_ConvergenceMap = nullptr;
+    catalog.getProductShearMap()->saveToFITSfile(m_workDir + m_outputFITSshearMap, true, m_outputCompression);
   }
-  if (m_ShearMap!=nullptr)
+  if (catalog.getProductConvergenceMap()!=nullptr)
   {
-    delete m_ShearMap;
-    m_ShearMap = nullptr;
+    catalog.getProductConvergenceMap()->saveToFITSfile(m_workDir + m_outputFITSconvergenceMap, true,
+                                                       m_outputCompression);
+  }
+  if (catalog.getDensityMap()!=nullptr)
+  {
+    catalog.getDensityMap()->saveToFITSfile(m_workDir + m_outputFITSdensityMap, true, m_outputCompression);
+  }
+  if (catalog.getWeightMap()!=nullptr)
+  {
+    catalog.getWeightMap()->saveToFITSfile(m_workDir + m_outputFITSweightMap, true, m_outputCompression);
+  }
+  if (catalog.getShapeVarianceMap()!=nullptr)
+  {
+    catalog.getShapeVarianceMap()->saveToFITSfile(m_workDir + m_outputFITSshapeVarianceMap, true,
+                                                  m_outputCompression);
   }
-
-  return true;
 
   return true;
 }
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/MapMakerStage.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MapMaker/MapMakerStage.h"
+
+#include <iostream>
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+namespace TWOD_MASS_WL_MapMaker {
+
+MapMakerStage::~MapMakerStage()
+{
+  clearMaps();
+}
+
+MapMakerStage::MapMakerStage(unsigned int nbBinsX, unsigned int nbBinsY, bool squareMap):
+m_nbBinsX(nbBinsX), m_nbBinsY(nbBinsY), m_squareMap(squareMap), m_outputShearMapFile(""),
+m_outputDensityMapFile(""), m_outputCompression(noCompression), m_shearMap(nullptr), m_densityMap(nullptr)
+{
+}
+
+void MapMakerStage::setOutputFiles(std::string shearMapFile, std::string densityMapFile,
+                                   fitsCompression compression)
+{
+  m_outputShearMapFile = shearMapFile;
+  m_outputDensityMapFile = densityMapFile;
+  m_outputCompression = compression;
+}
+
+bool MapMakerStage::extractMaps(CatalogHandler &catalog, Boundaries &bounds)
+{
+  clearMaps();
+
+  if (m_nbBinsX==0 || m_nbBinsY==0)
+  {
+    return false;
+  }
+
+  m_shearMap = catalog.getShearMap(bounds, m_nbBinsX, m_nbBinsY, m_squareMap);
+  if (m_shearMap==nullptr)
+  {
+    std::cout<<"no shear map could be extracted from the catalog"<<std::endl;
+    return false;
+  }
+
+  // The density map belongs to the handler, keep a copy of it
+  if (catalog.getDensityMap()!=nullptr)
+  {
+    m_densityMap = new GlobalMap(*catalog.getDensityMap());
+  }
+
+  // Save the maps only if asked
+  if (m_outputShearMapFile.empty()==false)
+  {
+    m_shearMap->saveToFITSfile(m_outputShearMapFile, true, m_outputCompression);
+  }
+  if (m_outputDensityMapFile.empty()==false && m_densityMap!=nullptr)
+  {
+    m_densityMap->saveToFITSfile(m_outputDensityMapFile, true, m_outputCompression);
+  }
+
+  return true;
+}
+
+ShearMap* MapMakerStage::getShearMap() const
+{
+  return m_shearMap;
+}
+
+GlobalMap* MapMakerStage::getDensityMap() const
+{
+  return m_densityMap;
+}
+
+void MapMakerStage::clearMaps()
+{
+  if (m_shearMap!=nullptr)
+  {
+    delete m_shearMap;
+    m_shearMap = nullptr;
+  }
+  if (m_densityMap!=nullptr)
+  {
+    delete m_densityMap;
+    m_densityMap = nullptr;
+  }
+}
+
+} // TWOD_MASS_WL_MapMaker namespace
@@ -29,64 +29,136 @@
 
 #include <CCfits/CCfits>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace TWOD_MASS_WL_MassMapping;
 
 namespace TWOD_MASS_WL_MapMaker {
 
+namespace {
+// Size in bytes of the blocks of the catalog read at once
+const std::size_t blockBytes = 16*1024*1024;
 
-SSVCatalogHandler::SSVCatalogHandler(std::string filename):CatalogHandler(filename)
+/**
+ * @brief Columns of the rows parsed from a part of a block
+ */
+struct ParsedPart
 {
-}
+  std::vector<std::vector<double> > m_values;
+  long m_nbRows = 0;
+  long m_nbSkipped = 0;
+};
 
-ShearMap* SSVCatalogHandler::getShearMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                         const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                         bool squareMap)
+// Moves to the first character of the line which is not a space
+inline const char* skipSpaces(const char *c, const char *end)
 {
-  // Retrieve the map from the private method
-  std::pair<long, double*> myPair = getMap(shearMap, bounds, nbBinsX, nbBinsY, squareMap);
+  while (c<end && (*c==' ' || *c=='\t' || *c=='\r'))
+  {
+    c++;
+  }
+  return c;
+}
 
-  return getShearMapFromArray(myPair, nbBinsX, nbBinsY, bounds);
+// Moves to the end of the current field
+inline const char* skipField(const char *c, const char *end)
+{
+  while (c<end && *c!=' ' && *c!='\t' && *c!='\r' && *c!='\n')
+  {
+    c++;
+  }
+  return c;
 }
 
-ConvergenceMap* SSVCatalogHandler::getConvergenceMap(TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                     const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                                     bool squareMap)
+/**
+ * @brief Parses the lines of [begin, end), which ends with a new line
+ *
+ * fieldColumns gives for each field the column receiving its value, or -1 if not needed. The fields
+ * not needed are skipped without being converted, as well as the fields after the last needed one.
+ * The lines missing a needed field, or whose needed field is not a number, are skipped
+ *
+ */
+void parseLines(const char *begin, const char *end, const std::vector<int> &fieldColumns, ParsedPart &part)
 {
-  // Retrieve the map from the private method
-  std::pair<long, double*> myPair = getMap(convMap, bounds, nbBinsX, nbBinsY, squareMap);
+  // Make room for one row per line
+  unsigned long nbLines = std::count(begin, end, '\n');
+  for (unsigned int f=0; f<fieldColumns.size(); f++)
+  {
+    if (fieldColumns[f]!=-1 && part.m_values[fieldColumns[f]].size()<nbLines)
+    {
+      part.m_values[fieldColumns[f]].resize(nbLines);
+    }
+  }
 
-  return getConvergenceMapFromArray(myPair, nbBinsX, nbBinsY, bounds);
+  part.m_nbRows = 0;
+  part.m_nbSkipped = 0;
+  const char *c = begin;
+  while (c<end)
+  {
+    // Convert the needed fields of the line
+    unsigned int field(0);
+    bool lineOK(true);
+    c = skipSpaces(c, end);
+    while (field<fieldColumns.size() && c<end && *c!='\n')
+    {
+      if (fieldColumns[field]!=-1)
+      {
+        char *fieldEnd;
+        double value = strtod(c, &fieldEnd);
+        if (fieldEnd==c)
+        {
+          lineOK = false;
+          break;
+        }
+        part.m_values[fieldColumns[field]][part.m_nbRows] = value;
+        c = fieldEnd;
+      }
+      c = skipSpaces(skipField(c, end), end);
+      field++;
+    }
+
+    // Keep the row if complete, the empty lines being ignored
+    if (lineOK && field==fieldColumns.size())
+    {
+      part.m_nbRows++;
+    }
+    else if (field>0 || lineOK==false)
+    {
+      part.m_nbSkipped++;
+    }
+
+    // Go to the next line
+    c = static_cast<const char*>(memchr(c, '\n', end-c));
+    c = c==nullptr ? end : c+1;
+  }
+}
 }
 
 
-std::pair<long, double*> SSVCatalogHandler::getMap(mapEnum mapType, TWOD_MASS_WL_MassMapping::Boundaries &bounds,
-                                                   const unsigned int nbBinsX, const unsigned int nbBinsY,
-                                                   bool squareMap)
+SSVCatalogHandler::SSVCatalogHandler(std::string filename):CatalogHandler(filename)
 {
-  /////////////////////////////////// Perform some prior checks on the inputs
-  // Check variables inputs ra, dec and z are fine
-  if (checkRaDecZ(bounds)==false)
-  {
-    return std::pair<long, double*> (0, nullptr);
-  }
+  // The shear of SSV catalogs is not rotated
+  m_rotateShear = false;
+}
 
+bool SSVCatalogHandler::readChunks(bool needShear, bool needKappa, bool needZ,
+                                   const std::function<void(const CatalogChunk&)> &processChunk,
+                                   const ChunkFilter&, const RowRangeSelector&)
+{
   // Open the file containing the data
   std::ifstream catalog(m_catalogFilename);
 
   // Check the file was correctly opened
   if (catalog.is_open()==false)
   {
-    return std::pair<long, double*> (0, nullptr);
-  }
-
-  // Check the enum type is well provided
-  if (mapType!=convMap && mapType!=shearMap)
-  {
-    return std::pair<long, double*> (0, nullptr);
+    return false;
   }
 
   /////////////////////////////////// Read headers to perform some checks and gather info
@@ -153,218 +225,149 @@ std::pair<long, double*> SSVCatalogHandler::getMap(mapEnum mapType, TWOD_MASS_WL
   }
 
   /////////////////////////////////// Perform some checks on headers info
-  // If the convMap is needed but no kappa info return false
-  if (mapType==convMap && idxKappa==-1)
+  // If the convergence is needed but no kappa info return false
+  if (needKappa && idxKappa==-1)
   {
-    return std::pair<long, double*> (0, nullptr);
+    return false;
   }
 
-  // If the shearMap is needed but no gamma info return false
-  if (mapType==shearMap && (idxGamma1==-1 || idxGamma2==-1))
+  // If the shear is needed but no gamma info return false
+  if (needShear && (idxGamma1==-1 || idxGamma2==-1))
   {
-    return std::pair<long, double*> (0, nullptr);
+    return false;
+  }
+
+  // A tomographic extraction needs the redshifts
+  if (needZ && idxZ==-1)
+  {
+    std::cout<<"no redshift column to extract the maps of the redshift bins"<<std::endl;
+    return false;
   }
 
   // If there is no ra or dec info then return false
   if (idxRa == -1 || idxDec == -1)
   {
-    return std::pair<long, double*> (0, nullptr);
+    return false;
   }
 
-  /////////////////////////////////// Define some variables to read the data and create the map
-  // Define variables of ra and dec min and max
-  double raMin = bounds.getRaMin();
-  double raMax = bounds.getRaMax();
-  double decMin = bounds.getDecMin();
-  double decMax = bounds.getDecMax();
-
-  // Create a buffer for each columns and initialize it to zeros
-  double *buffer = new double[headers.size()];
-
-  // Define ra0 and dec0 at the center of min and max values
-  double ra0 = 0.5*(raMax + raMin);
-  double dec0 = 0.5*(decMax + decMin);
-  double raRange = (raMax - raMin);
-  double decRange = (decMax - decMin);
-
-  // Declare the bins size on X and Y
-  double binXSize, binYSize;
-
-  std::pair<double, double> xyMin = getGnomonicProjection(raMin, decMin, ra0, dec0);
-
-  // In case a square map is not expected, perform some basic radec projection ranges selection
-  if (squareMap == false)
+  // The chunks only give the needed columns, each field of a line going to its column if needed
+  std::vector<int> chunkIndices = {idxRa, idxDec, idxZ, idxWeight,
+                                   needShear ? idxGamma1 : -1,
+                                   needShear ? idxGamma2 : -1,
+                                   needKappa ? idxKappa : -1};
+  std::vector<int> fieldColumns(*std::max_element(chunkIndices.begin(), chunkIndices.end())+1, -1);
+  for (unsigned int c=0; c<chunkIndices.size(); c++)
   {
-    std::pair<double, double> xyMax = getGnomonicProjection(raMax, decMax, ra0, dec0);
-
-//      std::cout<<"ra min and max: "<<raMin<<" "<<raMax<<std::endl;
-//      std::cout<<"dec min and max: "<<decMin<<" "<<decMax<<std::endl;
-//      std::cout<<"X min and max: "<<xyMin.first<<" "<<xyMax.first<<std::endl;
-//      std::cout<<"Y min and max: "<<xyMin.second<<" "<<xyMax.second<<std::endl;
-
-    // Define the bins sizes
-    binXSize = (xyMax.first - xyMin.first)/nbBinsX;
-    binYSize = (xyMax.second - xyMin.second)/nbBinsY;
+    if (chunkIndices[c]!=-1)
+    {
+      fieldColumns[chunkIndices[c]] = c;
+    }
   }
-  // In case a square map is expected, perform some fancier computation to find out radec projection ranges
-  else
+
+  // The file is read by large blocks, each block being split at line boundaries
+  // in parts parsed in parallel, one per thread
+  int nbParts(1);
+#ifdef _OPENMP
+  nbParts = omp_get_max_threads();
+#endif
+  std::vector<ParsedPart> parts(nbParts);
+  for (int p=0; p<nbParts; p++)
   {
-    std::pair<double, double> raDec1 = getInverseGnomonicProjection(-0.5*raRange*3.14159/180.,
-                                                                    -0.5*decRange*3.14159/180.,
-                                                                    ra0, dec0);
-    std::pair<double, double> raDec2 = getInverseGnomonicProjection(0,
-                                                                    -0.5*decRange*3.14159/180.,
-                                                                    ra0, dec0);
-    std::pair<double, double> raDec3 = getInverseGnomonicProjection(0.5*raRange*3.14159/180.,
-                                                                    -0.5*decRange*3.14159/180.,
-                                                                    ra0, dec0);
-    std::pair<double, double> raDec4 = getInverseGnomonicProjection(0.5*raRange*3.14159/180.,
-                                                                    0.5*decRange*3.14159/180.,
-                                                                    ra0, dec0);
-    std::pair<double, double> raDec5 = getInverseGnomonicProjection(0,
-                                                                    0.5*decRange*3.14159/180.,
-                                                                    ra0, dec0);
-    std::pair<double, double> raDec6 = getInverseGnomonicProjection(-0.5*raRange*3.14159/180.,
-                                                                    0.5*decRange*3.14159/180.,
-                                                                    ra0, dec0);
-
-    // Get the min and max values of ra and dec according to the geometrical effects of projection
-    raMin = raDec1.first < raDec6.first ? raDec1.first : raDec6.first;
-    decMin = raDec1.second < raDec2.second ? raDec1.second : raDec2.second;
-    raMax = raDec3.first > raDec4.first ? raDec3.first : raDec4.first;
-    decMax = raDec4.second > raDec5.second ? raDec4.second : raDec5.second;
-
-    std::cout<<"ra dec 1: "<<raDec1.first<<" "<<raDec1.second<<std::endl;
-    std::cout<<"ra dec 2: "<<raDec2.first<<" "<<raDec2.second<<std::endl;
-    std::cout<<"ra dec 3: "<<raDec3.first<<" "<<raDec3.second<<std::endl;
-    std::cout<<"ra dec 4: "<<raDec4.first<<" "<<raDec4.second<<std::endl;
-    std::cout<<"ra dec 5: "<<raDec5.first<<" "<<raDec5.second<<std::endl;
-    std::cout<<"ra dec 6: "<<raDec6.first<<" "<<raDec6.second<<std::endl;
-    std::cout<<"ra min and max: "<<raMin<<" "<<raMax<<std::endl;
-    std::cout<<"dec min and max: "<<decMin<<" "<<decMax<<std::endl;
-
-    // Define the bins sizes
-    binXSize = raRange*3.14159/180./nbBinsX;
-    binYSize = decRange*3.14159/180./nbBinsY;
+    parts[p].m_values.resize(chunkIndices.size());
   }
-
-//    std::cout<<"size of bins on X and Y: "<<binXSize<<" "<<binYSize<<std::endl;
-
-  // Create and initialize to zeros maps
-  double *mapArray = initializeArray<double>(nbBinsX, nbBinsY, 2);
-  double *countArray = initializeArray<double>(nbBinsX, nbBinsY, 1);
-
-  // Create a counter of the galaxies watched
-  unsigned long galCount(0);
-  // Create a counter of the galaxies selected
-  unsigned long selGalCount(0);
-
-  // Loop over all the lines of the test file shearMap 1
-  while ( getline(catalog, line) ) // && galCount<10000000)
+  std::vector<char> block(blockBytes+1);
+  std::vector<std::size_t> partBounds(nbParts+1);
+  std::size_t carry(0);
+  long nbLines(0);
+  long nbSkipped(0);
+
+  bool lastBlock(false);
+  while (lastBlock==false)
   {
-    std::istringstream in(line);
-    for (unsigned int i=0; i<headers.size(); i++)
+    // Complete the beginning of line left by the previous block, one byte being kept for a last new line
+    catalog.read(block.data()+carry, block.size()-1-carry);
+    std::size_t size = carry + catalog.gcount();
+    lastBlock = catalog.good()==false;
+    if (lastBlock && size>0 && block[size-1]!='\n')
     {
-      in>>buffer[i];
-      //        std::cout<<buffer[i]<<" ";
+      block[size++] = '\n';
     }
-    //      std::cout<<std::endl;
-    //std::cout<<"gal ID: "<<galID<<" Ra: "<<tmpRa<<" dec: "<<tmpDec<<" kappa: ";
-    //std::cout<<tmpKappa<<" G1: "<<tmpGamma1<<" G2: "<<tmpGamma2<<std::endl;
 
-    // If the weight is provided then use it, otherwise set it to 1
-    double weight(1.);
-    if (idxWeight!=-1)
+    // Only the complete lines are parsed, a line longer than a block making the block grow
+    std::size_t complete(size);
+    if (lastBlock==false)
     {
-      weight = buffer[idxWeight];
+      while (complete>0 && block[complete-1]!='\n')
+      {
+        complete--;
+      }
+      if (complete==0)
+      {
+        carry = size;
+        block.resize(2*block.size());
+        continue;
+      }
     }
 
-    // Check the values fulfill the right ascension and declination constraints
-    if ( buffer[idxDec] >= decMin && buffer[idxDec] <= decMax )
+    // Split the block at the new lines following the even splits
+    partBounds[0] = 0;
+    for (int p=1; p<nbParts; p++)
     {
-      if ( buffer[idxRa] >= raMin && buffer[idxRa] <= raMax )
+      std::size_t bound = std::max(partBounds[p-1], p*complete/nbParts);
+      while (bound>partBounds[p-1] && bound<complete && block[bound-1]!='\n')
       {
-        // If the redshift is provided check the values are ok too
-        bool redshiftOk = idxZ!=-1 && buffer[idxZ] >= bounds.getZMin() && buffer[idxZ] <= bounds.getZMax();
-        // If no redshift provided in the file then just go ahead
-        if (redshiftOk || idxZ==-1)
-        {
-          int tmpx, tmpy;
-          // In case square map needed
-          if (squareMap == true)
-          {
-            // project the selected radec on gnomonic plan
-            std::pair<double, double> tmpXY = getGnomonicProjection(buffer[idxRa], buffer[idxDec], ra0, dec0);
-
-            //  calculate where it is on the binning
-            tmpx = int(floor((tmpXY.first+0.5*raRange*3.14159/180.)/binXSize));
-            tmpy = int(floor((tmpXY.second+0.5*decRange*3.14159/180.)/binYSize));
-          }
-          // in case square map not needed
-          else
-          {
-            std::pair<double, double> projXY = getGnomonicProjection(buffer[idxRa], buffer[idxDec], ra0, dec0);
-
-            tmpx = int(floor((projXY.first-xyMin.first)/binXSize));
-            tmpy = int(floor((projXY.second-xyMin.second)/binYSize));
-          }
-
-//            if (tmpx > nbBinsX || tmpx<0) std::cout<<tmpx<<std::endl;
-//            if (tmpy > nbBinsY || tmpy<0) std::cout<<tmpy<<std::endl;
-          if (tmpx>=0 && tmpx<int(nbBinsX) && tmpy>=0 && tmpy<int(nbBinsY))
-          {
-            if (mapType==shearMap)
-            {
-              mapArray[tmpy*nbBinsX + tmpx] += buffer[idxGamma1]*weight;
-              mapArray[nbBinsX*nbBinsY + tmpy*nbBinsX + tmpx] += buffer[idxGamma2]*weight;
-            }
-            else if (mapType==convMap)
-            {
-              mapArray[tmpy*nbBinsX + tmpx] += buffer[idxKappa]*weight;
-  //            mapArray[nbBinsX*nbBinsY + tmpy*nbBinsX + tmpx] += 0;
-            }
-            countArray[tmpy*nbBinsX + tmpx] += weight;
-            selGalCount+=weight;
-          }
-        }
+        bound++;
       }
+      partBounds[p] = bound;
     }
-    galCount+=weight;
+    partBounds[nbParts] = complete;
 
-    if (galCount%100000000 == 0)
+    #pragma omp parallel for schedule(static, 1)
+    for (int p=0; p<nbParts; p++)
     {
-      std::cout<<"galaxy number "<<galCount<<" read"<<std::endl;
+      parseLines(block.data()+partBounds[p], block.data()+partBounds[p+1], fieldColumns, parts[p]);
     }
-  }
 
-  std::cout<<"number of galaxies selected: "<<selGalCount<<std::endl;
-  std::cout<<"over the total number of galaxies: "<<galCount<<std::endl;
+    // The parts are processed in the order of the lines
+    long previousLines(nbLines);
+    for (int p=0; p<nbParts; p++)
+    {
+      CatalogChunk chunk;
+      chunk.m_size = parts[p].m_nbRows;
+      chunk.m_ra = parts[p].m_values[0].data();
+      chunk.m_dec = parts[p].m_values[1].data();
+      chunk.m_z = idxZ!=-1 ? parts[p].m_values[2].data() : nullptr;
+      chunk.m_weight = idxWeight!=-1 ? parts[p].m_values[3].data() : nullptr;
+      chunk.m_gamma1 = chunkIndices[4]!=-1 ? parts[p].m_values[4].data() : nullptr;
+      chunk.m_gamma2 = chunkIndices[5]!=-1 ? parts[p].m_values[5].data() : nullptr;
+      chunk.m_kappa = chunkIndices[6]!=-1 ? parts[p].m_values[6].data() : nullptr;
+      if (chunk.m_size>0)
+      {
+        processChunk(chunk);
+      }
+      nbLines += parts[p].m_nbRows;
+      nbSkipped += parts[p].m_nbSkipped;
+    }
 
-  // Normalize the values to have the mean shear in each bin
-  for (unsigned int i = 0; i<nbBinsX*nbBinsY; i++)
-  {
-    if (countArray[i]>1)
+    if (nbLines/100000000 != previousLines/100000000)
     {
-      mapArray[i] /= countArray[i];
-      mapArray[i + nbBinsX*nbBinsY] /= countArray[i];
+      std::cout<<"galaxy number "<<(nbLines/100000000)*100000000<<" read"<<std::endl;
     }
+
+    // Keep the incomplete last line for the next block
+    carry = size - complete;
+    memmove(block.data(), block.data()+complete, carry);
   }
 
-  if (mapType==shearMap)
+  if (nbSkipped>0)
   {
-    // Save the density map
-    m_galDensity = new GlobalMap(countArray, nbBinsX, nbBinsY, 1, bounds, selGalCount);
+    std::cout<<nbSkipped<<" lines of the catalog could not be parsed and were skipped"<<std::endl;
   }
 
   // Close the file
   catalog.close();
 
-  // Delete dynamic arrays
-  delete [] buffer;
-  delete [] countArray;
-
-  // Return the map and the number of galaxies selected
-  return std::pair<long, double*> (selGalCount, mapArray);
+  return true;
 }
 
 } // TWOD_MASS_WL_MapMaker namespace
@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/ColumnarCatalogHandler_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdio>
+
+#include "TWOD_MASS_WL_MapMaker/ColumnarCatalogHandler.h"
+#include "TWOD_MASS_WL_MapMaker/SSVCatalogHandler.h"
+
+#include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+#include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+using namespace TWOD_MASS_WL_MapMaker;
+
+DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (ColumnarCatalogHandler_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( sameMapsAsSSV_test ) {
+
+  // Save a SSV catalog in the columnar format
+  std::string ssvCatalogPath(pathFiles+"SSVcatalog_ok_withz.txt");
+  std::string columnarCatalogPath(pathFiles+"tmp/SSVcatalog_ok_withz.bin");
+  SSVCatalogHandler mySSVCatalog(ssvCatalogPath);
+  BOOST_REQUIRE(mySSVCatalog.saveAsColumnarCatalog(columnarCatalogPath)==true);
+  BOOST_CHECK(ColumnarCatalog::isColumnarCatalog(columnarCatalogPath)==true);
+  BOOST_CHECK(ColumnarCatalog::isColumnarCatalog(ssvCatalogPath)==false);
+
+  // The shear of a SSV catalog stays unrotated
+  ColumnarCatalog myColumns(columnarCatalogPath);
+  BOOST_CHECK((myColumns.getFlags() & unrotatedShearFlag)!=0);
+  BOOST_CHECK(myColumns.getColumn("kappa")!=nullptr);
+
+  // All the products are the same as the ones of the SSV catalog
+  ColumnarCatalogHandler myColumnarCatalog(columnarCatalogPath);
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  std::vector<productEnum> products = {shearProduct, convergenceProduct, densityProduct,
+                                       weightProduct, shapeVarianceProduct};
+  BOOST_REQUIRE(mySSVCatalog.getMaps(products, bounds, 64, 64)==true);
+  BOOST_REQUIRE(myColumnarCatalog.getMaps(products, bounds, 64, 64)==true);
+  for (unsigned int i=0; i<64; i++)
+  {
+    for (unsigned int j=0; j<64; j++)
+    {
+      for (unsigned int k=0; k<2; k++)
+      {
+        BOOST_CHECK(myColumnarCatalog.getProductShearMap()->getBinValue(i, j, k)==
+                    mySSVCatalog.getProductShearMap()->getBinValue(i, j, k));
+      }
+      BOOST_CHECK(myColumnarCatalog.getProductConvergenceMap()->getBinValue(i, j, 0)==
+                  mySSVCatalog.getProductConvergenceMap()->getBinValue(i, j, 0));
+      BOOST_CHECK(myColumnarCatalog.getDensityMap()->getBinValue(i, j, 0)==
+                  mySSVCatalog.getDensityMap()->getBinValue(i, j, 0));
+      BOOST_CHECK(myColumnarCatalog.getWeightMap()->getBinValue(i, j, 0)==
+                  mySSVCatalog.getWeightMap()->getBinValue(i, j, 0));
+      BOOST_CHECK(myColumnarCatalog.getShapeVarianceMap()->getBinValue(i, j, 0)==
+                  mySSVCatalog.getShapeVarianceMap()->getBinValue(i, j, 0));
+    }
+  }
+
+  // The redshift bins need the redshift column, which is kept
+  BOOST_CHECK(myColumnarCatalog.setRedshiftBins({0., 0.5, 1., 10.})==true);
+  BOOST_CHECK(myColumnarCatalog.getMaps({shearProduct}, bounds, 64, 64)==true);
+  BOOST_CHECK(myColumnarCatalog.getProductShearMap()->getZdim()==6);
+
+  // The maps can be handed over to the caller
+  ShearMap *myShearMap = myColumnarCatalog.getShearMap(bounds, 64, 64);
+  BOOST_CHECK(myShearMap!=nullptr);
+  delete myShearMap;
+}
+
+BOOST_AUTO_TEST_CASE( skippedBlocks_test ) {
+
+  // Galaxies sorted by declination, written in small blocks whose ranges let most of them be skipped,
+  // and in a single block which is always read
+  std::vector<double> ra, dec, z, weight, gamma1, gamma2, kappa;
+  for (unsigned int i=0; i<20000; i++)
+  {
+    ra.push_back(35.+0.001*((i*7919)%20000));
+    dec.push_back(-5.+0.0015*i);
+    z.push_back(0.1+0.0001*((i*31)%20000));
+    weight.push_back(1.+0.1*(i%7));
+    gamma1.push_back(0.01*((i%11)-5.));
+    gamma2.push_back(0.01*((i%13)-6.));
+    kappa.push_back(0.001*(i%17));
+  }
+  std::vector<std::string> names = {"ra", "dec", "z", "weight", "gamma1", "gamma2", "kappa"};
+  std::vector<const double*> columns = {ra.data(), dec.data(), z.data(), weight.data(),
+                                        gamma1.data(), gamma2.data(), kappa.data()};
+  std::string blocksCatalogPath(pathFiles+"tmp/sortedCatalog_blocks.bin");
+  ColumnarCatalogWriter myBlocksWriter(blocksCatalogPath, names, 500);
+  BOOST_REQUIRE(myBlocksWriter.appendRows(columns, ra.size())==true);
+  BOOST_REQUIRE(myBlocksWriter.close()==true);
+  std::string singleCatalogPath(pathFiles+"tmp/sortedCatalog_single.bin");
+  ColumnarCatalogWriter mySingleWriter(singleCatalogPath, names, ra.size());
+  BOOST_REQUIRE(mySingleWriter.appendRows(columns, ra.size())==true);
+  BOOST_REQUIRE(mySingleWriter.close()==true);
+
+  // The maps are the same whether blocks are skipped or not
+  ColumnarCatalogHandler myBlocksCatalog(blocksCatalogPath);
+  ColumnarCatalogHandler mySingleCatalog(singleCatalogPath);
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  std::vector<productEnum> products = {shearProduct, convergenceProduct, densityProduct};
+  BOOST_REQUIRE(myBlocksCatalog.getMaps(products, bounds, 64, 64)==true);
+  BOOST_REQUIRE(mySingleCatalog.getMaps(products, bounds, 64, 64)==true);
+  for (unsigned int i=0; i<64; i++)
+  {
+    for (unsigned int j=0; j<64; j++)
+    {
+      for (unsigned int k=0; k<2; k++)
+      {
+        BOOST_CHECK(myBlocksCatalog.getProductShearMap()->getBinValue(i, j, k)==
+                    mySingleCatalog.getProductShearMap()->getBinValue(i, j, k));
+      }
+      BOOST_CHECK(myBlocksCatalog.getProductConvergenceMap()->getBinValue(i, j, 0)==
+                  mySingleCatalog.getProductConvergenceMap()->getBinValue(i, j, 0));
+      BOOST_CHECK(myBlocksCatalog.getDensityMap()->getBinValue(i, j, 0)==
+                  mySingleCatalog.getDensityMap()->getBinValue(i, j, 0));
+    }
+  }
+
+  // So are the maps of several patches extracted together
+  std::vector<Boundaries> patches = {Boundaries(40, 45, 0, 5, 0, 10), Boundaries(45, 50, 15, 20, 0, 10)};
+  std::vector<ShearMap*> blocksShearMaps, singleShearMaps;
+  std::vector<GlobalMap*> blocksDensityMaps, singleDensityMaps;
+  BOOST_REQUIRE(myBlocksCatalog.getPatchMaps(patches, 32, 32, false, blocksShearMaps, blocksDensityMaps)==true);
+  BOOST_REQUIRE(mySingleCatalog.getPatchMaps(patches, 32, 32, false, singleShearMaps, singleDensityMaps)==true);
+  for (unsigned int p=0; p<patches.size(); p++)
+  {
+    BOOST_REQUIRE(blocksShearMaps[p]!=nullptr);
+    BOOST_REQUIRE(singleShearMaps[p]!=nullptr);
+    for (unsigned int i=0; i<32; i++)
+    {
+      for (unsigned int j=0; j<32; j++)
+      {
+        BOOST_CHECK(blocksShearMaps[p]->getBinValue(i, j, 0)==singleShearMaps[p]->getBinValue(i, j, 0));
+        BOOST_CHECK(blocksDensityMaps[p]->getBinValue(i, j, 0)==singleDensityMaps[p]->getBinValue(i, j, 0));
+      }
+    }
+    delete blocksShearMaps[p];
+    delete singleShearMaps[p];
+    delete blocksDensityMaps[p];
+    delete singleDensityMaps[p];
+  }
+}
+
+BOOST_AUTO_TEST_CASE( keyIndex_test ) {
+
+  // Galaxies of a grid sorted by key, written in a single block which the zone map never skips
+  std::vector<double> gridRa, gridDec;
+  std::vector<unsigned long> gridKeys;
+  for (unsigned int i=0; i<10000; i++)
+  {
+    gridRa.push_back(30.05+0.3*(i%100));
+    gridDec.push_back(-9.95+0.3*(i/100));
+    gridKeys.push_back(CatalogKeyIndex::getKey(mortonKey, 16, gridRa.back(), gridDec.back()));
+  }
+  std::vector<unsigned int> order(gridKeys.size());
+  for (unsigned int i=0; i<order.size(); i++)
+  {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&gridKeys](unsigned int a, unsigned int b)
+                   { return gridKeys[a]<gridKeys[b]; });
+  std::vector<double> ra, dec, z, weight, gamma1, gamma2;
+  std::vector<unsigned long> keys;
+  for (unsigned int i=0; i<order.size(); i++)
+  {
+    ra.push_back(gridRa[order[i]]);
+    dec.push_back(gridDec[order[i]]);
+    keys.push_back(gridKeys[order[i]]);
+    z.push_back(0.5);
+    weight.push_back(1.+0.1*(i%7));
+    gamma1.push_back(0.01*((i%11)-5.));
+    gamma2.push_back(0.01*((i%13)-6.));
+  }
+  std::vector<std::string> names = {"ra", "dec", "z", "weight", "gamma1", "gamma2"};
+  std::vector<const double*> columns = {ra.data(), dec.data(), z.data(), weight.data(), gamma1.data(), gamma2.data()};
+  std::string sortedCatalogPath(pathFiles+"tmp/sortedCatalog_keyIndex.bin");
+  ColumnarCatalogWriter myWriter(sortedCatalogPath, names, ra.size());
+  BOOST_REQUIRE(myWriter.appendRows(columns, ra.size())==true);
+  BOOST_REQUIRE(myWriter.close()==true);
+  std::remove(CatalogKeyIndex::getSidecarFilename(sortedCatalogPath).c_str());
+
+  // Maps of the whole catalog
+  ColumnarCatalogHandler myCatalog(sortedCatalogPath);
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  std::vector<productEnum> products = {shearProduct, densityProduct};
+  BOOST_REQUIRE(myCatalog.getMaps(products, bounds, 32, 32)==true);
+  std::vector<double> shearValues, densityValues;
+  double density(0.);
+  for (unsigned int i=0; i<32; i++)
+  {
+    for (unsigned int j=0; j<32; j++)
+    {
+      shearValues.push_back(myCatalog.getProductShearMap()->getBinValue(i, j, 0));
+      densityValues.push_back(myCatalog.getDensityMap()->getBinValue(i, j, 0));
+      density += densityValues.back();
+    }
+  }
+  BOOST_REQUIRE(density>0.);
+
+  // The maps are the same when only the ranges of rows given by the key index are read
+  CatalogKeyIndex myIndex(mortonKey, 16, 4);
+  myIndex.addRows(keys.size(), keys.data(), ra.data(), dec.data(), z.data());
+  BOOST_REQUIRE(myIndex.save(sortedCatalogPath)==true);
+  BOOST_REQUIRE(myIndex.getRowRanges(40, 50, 0, 10, 0, 10).size()>0);
+  BOOST_REQUIRE(myCatalog.getMaps(products, bounds, 32, 32)==true);
+  for (unsigned int i=0; i<32; i++)
+  {
+    for (unsigned int j=0; j<32; j++)
+    {
+      BOOST_CHECK(myCatalog.getProductShearMap()->getBinValue(i, j, 0)==shearValues[32*i+j]);
+      BOOST_CHECK(myCatalog.getDensityMap()->getBinValue(i, j, 0)==densityValues[32*i+j]);
+    }
+  }
+  std::vector<Boundaries> patches = {bounds, Boundaries(55, 60, 15, 20, 0, 10)};
+  std::vector<ShearMap*> shearMaps;
+  std::vector<GlobalMap*> densityMaps;
+  BOOST_REQUIRE(myCatalog.getPatchMaps(patches, 32, 32, false, shearMaps, densityMaps)==true);
+  BOOST_REQUIRE(shearMaps[0]!=nullptr);
+  for (unsigned int i=0; i<32; i++)
+  {
+    for (unsigned int j=0; j<32; j++)
+    {
+      BOOST_CHECK(shearMaps[0]->getBinValue(i, j, 0)==shearValues[32*i+j]);
+      BOOST_CHECK(densityMaps[0]->getBinValue(i, j, 0)==densityValues[32*i+j]);
+    }
+  }
+  for (unsigned int p=0; p<patches.size(); p++)
+  {
+    delete shearMaps[p];
+    delete densityMaps[p];
+  }
+
+  // An index whose cells of the western half of the patch are moved away shows the other rows are skipped
+  std::vector<double> movedRa(ra);
+  for (auto &value : movedRa)
+  {
+    if (value<45.)
+    {
+      value += 100.;
+    }
+  }
+  CatalogKeyIndex myMovedIndex(mortonKey, 16, 4);
+  myMovedIndex.addRows(keys.size(), keys.data(), movedRa.data(), dec.data(), z.data());
+  BOOST_REQUIRE(myMovedIndex.save(sortedCatalogPath)==true);
+  BOOST_REQUIRE(myCatalog.getMaps(products, bounds, 32, 32)==true);
+  double movedDensity(0.);
+  for (unsigned int i=0; i<32; i++)
+  {
+    for (unsigned int j=0; j<32; j++)
+    {
+      movedDensity += myCatalog.getDensityMap()->getBinValue(i, j, 0);
+    }
+  }
+  BOOST_CHECK(movedDensity>0.);
+  BOOST_CHECK(movedDensity<density);
+
+  // An index of other columns is not used
+  CatalogKeyIndex myOtherIndex(mortonKey, 16, 4);
+  myOtherIndex.setColumnNames("ra", "dec", "");
+  myOtherIndex.addRows(keys.size(), keys.data(), movedRa.data(), dec.data(), nullptr);
+  BOOST_REQUIRE(myOtherIndex.save(sortedCatalogPath)==true);
+  BOOST_REQUIRE(myCatalog.getMaps(products, bounds, 32, 32)==true);
+  for (unsigned int i=0; i<32; i++)
+  {
+    for (unsigned int j=0; j<32; j++)
+    {
+      BOOST_CHECK(myCatalog.getDensityMap()->getBinValue(i, j, 0)==densityValues[32*i+j]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( missingKappaCatalog_test ) {
+
+  // Save a SSV catalog without kappa in the columnar format
+  std::string columnarCatalogPath(pathFiles+"tmp/SSVcatalog_noK_noz.bin");
+  SSVCatalogHandler mySSVCatalog(pathFiles+"SSVcatalog_noK_noz.txt");
+  BOOST_REQUIRE(mySSVCatalog.saveAsColumnarCatalog(columnarCatalogPath)==true);
+
+  // It should be possible to create a shear map out of this catalog
+  ColumnarCatalogHandler myColumnarCatalog(columnarCatalogPath);
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  ShearMap *myShearMap = myColumnarCatalog.getShearMap(bounds, 256, 256);
+  BOOST_CHECK(myShearMap!=nullptr);
+  delete myShearMap;
+
+  // But it should not be able to create a convergence map
+  ConvergenceMap *myConvMap = myColumnarCatalog.getConvergenceMap(bounds, 256, 256);
+  BOOST_CHECK(myConvMap==nullptr);
+}
+
+BOOST_AUTO_TEST_CASE( fakeCatalog_test ) {
+
+  // Provide files that are not columnar catalogs
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  for (std::string catalogPath : {pathFiles+"dummy.bin", pathFiles+"SSVcatalog_ok_withz.txt"})
+  {
+    ColumnarCatalogHandler myCatalog(catalogPath);
+
+    // It should not be possible to create any map out of this catalog
+    ShearMap *myShearMap = myCatalog.getShearMap(bounds, 256, 256);
+    BOOST_CHECK(myShearMap==nullptr);
+    ConvergenceMap *myConvMap = myCatalog.getConvergenceMap(bounds, 256, 256);
+    BOOST_CHECK(myConvMap==nullptr);
+  }
+
+  // A catalog which can not be read can not be saved
+  SSVCatalogHandler mySSVCatalog(pathFiles+"dummy.txt");
+  BOOST_CHECK(mySSVCatalog.saveAsColumnarCatalog(pathFiles+"tmp/dummy.bin")==false);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -114,6 +114,53 @@ BOOST_AUTO_TEST_CASE( goodCatalogWithZ_test ) {
   myShearMap = nullptr;
 }
 
+BOOST_AUTO_TEST_CASE( singlePassProducts_test ) {
+
+  // Open a FITS catalog with data about ra, dec, gamma and kappa but no z
+  std::string catalogPath(pathFiles+"FITScatalog_ok_noz.fits");
+  FITSCatalogHandler myCatalog(catalogPath);
+
+  // Extract all the products in a single pass
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  std::vector<productEnum> products = {shearProduct, convergenceProduct, densityProduct,
+                                       weightProduct, shapeVarianceProduct};
+  BOOST_CHECK(myCatalog.getMaps(products, bounds, 64, 64)==true);
+  BOOST_CHECK(myCatalog.getProductShearMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getProductConvergenceMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getDensityMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getWeightMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getShapeVarianceMap()!=nullptr);
+
+  // The maps are the same as the ones extracted one by one
+  FITSCatalogHandler myOtherCatalog(catalogPath);
+  ShearMap *myShearMap = myOtherCatalog.getShearMap(bounds, 64, 64);
+  ConvergenceMap *myConvMap = myOtherCatalog.getConvergenceMap(bounds, 64, 64);
+  for (unsigned int i=0; i<64; i++)
+  {
+    for (unsigned int j=0; j<64; j++)
+    {
+      BOOST_CHECK(myCatalog.getProductShearMap()->getBinValue(i, j, 0)==myShearMap->getBinValue(i, j, 0));
+      BOOST_CHECK(myCatalog.getProductShearMap()->getBinValue(i, j, 1)==myShearMap->getBinValue(i, j, 1));
+      BOOST_CHECK(myCatalog.getProductConvergenceMap()->getBinValue(i, j, 0)==myConvMap->getBinValue(i, j, 0));
+
+      // The sum of the squared weights is bounded by the squared sum of the weights
+      BOOST_CHECK(myCatalog.getWeightMap()->getBinValue(i, j, 0)<=
+                  myCatalog.getDensityMap()->getBinValue(i, j, 0)*myCatalog.getDensityMap()->getBinValue(i, j, 0));
+      BOOST_CHECK(myCatalog.getShapeVarianceMap()->getBinValue(i, j, 0)>=-1e-12);
+    }
+  }
+  delete myShearMap;
+  delete myConvMap;
+
+  // Only the requested products are extracted, a missing column giving no map
+  products = {convergenceProduct};
+  BOOST_CHECK(myCatalog.getMaps(products, bounds, 64, 64)==true);
+  BOOST_CHECK(myCatalog.getProductShearMap()==nullptr);
+  BOOST_CHECK(myCatalog.getDensityMap()==nullptr);
+  BOOST_CHECK(myCatalog.getProductConvergenceMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getMaps(std::vector<productEnum>(), bounds, 64, 64)==false);
+}
+
 BOOST_AUTO_TEST_CASE( fakeCatalog_test ) {
 
   // Provide a FITS file that does not exist
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/GnomonicProjector_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MapMaker/GnomonicProjector.h"
+#include "TWOD_MASS_WL_MapMaker/CatalogHandler.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace TWOD_MASS_WL_MapMaker;
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (GnomonicProjector_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( project_test )
+{
+  // Galaxies spread over a 10 degrees patch
+  double ra0(45.), dec0(-30.);
+  std::vector<double> ra, dec;
+  for (unsigned int i=0; i<21; i++)
+  {
+    for (unsigned int j=0; j<21; j++)
+    {
+      ra.push_back(ra0 - 5. + 0.5*i);
+      dec.push_back(dec0 - 5. + 0.5*j);
+    }
+  }
+  long nbGalaxies = ra.size();
+
+  GnomonicProjector myProjector(ra0, dec0);
+  std::vector<double> x(nbGalaxies), y(nbGalaxies);
+  std::vector<double> xRot(nbGalaxies), yRot(nbGalaxies), cos2angle(nbGalaxies), sin2angle(nbGalaxies);
+  myProjector.project(nbGalaxies, ra.data(), dec.data(), x.data(), y.data());
+  myProjector.project(nbGalaxies, ra.data(), dec.data(), xRot.data(), yRot.data(), cos2angle.data(), sin2angle.data());
+
+  CatalogHandler myHandler("");
+  for (long i=0; i<nbGalaxies; i++)
+  {
+    // The projection is the one of the catalog handler
+    std::pair<double, double> xy1 = myHandler.getGnomonicProjection(ra[i], dec[i], ra0, dec0);
+    BOOST_CHECK_SMALL(x[i] - xy1.first, 1e-12);
+    BOOST_CHECK_SMALL(y[i] - xy1.second, 1e-12);
+    BOOST_CHECK_SMALL(xRot[i] - xy1.first, 1e-12);
+    BOOST_CHECK_SMALL(yRot[i] - xy1.second, 1e-12);
+
+    // The analytic rotation matches the one obtained by offsetting the declination
+    std::pair<double, double> xy2 = myHandler.getGnomonicProjection(ra[i], dec[i]+0.01, ra0, dec0);
+    double rotationAngle = -atan((xy2.first-xy1.first)/(xy2.second-xy1.second));
+    BOOST_CHECK_SMALL(cos2angle[i] - cos(2*rotationAngle), 1e-4);
+    BOOST_CHECK_SMALL(sin2angle[i] - sin(2*rotationAngle), 1e-4);
+  }
+
+  // No rotation on the meridian of the tangent point
+  double raMeridian[2] = {ra0, ra0};
+  double decMeridian[2] = {dec0, dec0 + 3.};
+  double xMeridian[2], yMeridian[2], cosMeridian[2], sinMeridian[2];
+  myProjector.project(2, raMeridian, decMeridian, xMeridian, yMeridian, cosMeridian, sinMeridian);
+  for (unsigned int i=0; i<2; i++)
+  {
+    BOOST_CHECK_SMALL(xMeridian[i], 1e-12);
+    BOOST_CHECK_CLOSE(cosMeridian[i], 1., 1e-9);
+    BOOST_CHECK_SMALL(sinMeridian[i], 1e-12);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
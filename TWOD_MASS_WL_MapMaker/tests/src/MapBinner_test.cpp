@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/MapBinner_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MapMaker/MapBinner.h"
+#include "TWOD_MASS_WL_MapMaker/GnomonicProjector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace TWOD_MASS_WL_MapMaker;
+
+//-----------------------------------------------------------------------------
+
+struct MapBinnerDataFixture {
+
+  MapBinnerDataFixture(): nbBinsX(64), nbBinsY(48), ra0(45.), dec0(-30.),
+                          xOrigin(-0.05), yOrigin(-0.04), binXSize(0.1/64), binYSize(0.08/48)
+  {
+    // Galaxies spread a bit further than the map, in a reproducible order, the chunk
+    // being large enough to be binned in several parts
+    srand(17);
+    for (long i=0; i<100000; i++)
+    {
+      ra.push_back(ra0 - 3.5 + 7.*rand()/RAND_MAX);
+      dec.push_back(dec0 - 3. + 6.*rand()/RAND_MAX);
+      z.push_back(2.*rand()/RAND_MAX);
+      weight.push_back(0.5 + double(rand())/RAND_MAX);
+      gamma1.push_back(-0.1 + 0.2*rand()/RAND_MAX);
+      gamma2.push_back(-0.1 + 0.2*rand()/RAND_MAX);
+    }
+    chunk.m_size = ra.size();
+    chunk.m_ra = ra.data();
+    chunk.m_dec = dec.data();
+    chunk.m_z = z.data();
+    chunk.m_weight = weight.data();
+    chunk.m_gamma1 = gamma1.data();
+    chunk.m_gamma2 = gamma2.data();
+    chunk.m_kappa = gamma1.data();
+  }
+
+  // Bins the chunk with a given number of threads, by chunks of chunkSize galaxies
+  void bin(mapEnum mapType, int nbThreads, std::vector<double> &mapArray, std::vector<double> &countArray,
+           double &selectedWeight, double *galaxyWeight = nullptr, long chunkSize = 0)
+  {
+#ifdef _OPENMP
+    int previousThreads = omp_get_max_threads();
+    omp_set_num_threads(nbThreads);
+#else
+    (void)nbThreads;
+#endif
+    mapArray.assign(2*nbBinsX*nbBinsY, 0.);
+    countArray.assign(nbBinsX*nbBinsY, 0.);
+    MapBinner myBinner(mapType, nbBinsX, nbBinsY, mapArray.data(), countArray.data());
+    myBinner.setProjection(ra0, dec0, xOrigin, yOrigin, binXSize, binYSize);
+    myBinner.setSelection(ra0-3., ra0+3., dec0-2.5, dec0+2.5, 0.2, 1.8);
+    chunkSize = chunkSize>0 ? chunkSize : chunk.m_size;
+    for (long first=0; first<chunk.m_size; first+=chunkSize)
+    {
+      CatalogChunk part(chunk);
+      part.m_size = std::min(chunkSize, chunk.m_size-first);
+      part.m_ra += first;
+      part.m_dec += first;
+      part.m_z += first;
+      part.m_weight += first;
+      part.m_gamma1 += first;
+      part.m_gamma2 += first;
+      part.m_kappa += first;
+      myBinner.binChunk(part);
+    }
+    selectedWeight = myBinner.getSelectedWeight();
+    if (galaxyWeight!=nullptr)
+    {
+      *galaxyWeight = myBinner.getGalaxyWeight();
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(previousThreads);
+#endif
+  }
+
+  unsigned int nbBinsX, nbBinsY;
+  double ra0, dec0, xOrigin, yOrigin, binXSize, binYSize;
+  std::vector<double> ra, dec, z, weight, gamma1, gamma2;
+  CatalogChunk chunk;
+};
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (MapBinner_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( serial_test, MapBinnerDataFixture )
+{
+  std::vector<double> mapArray, countArray;
+  double selectedWeight;
+  bin(shearMap, 1, mapArray, countArray, selectedWeight);
+
+  // Serial binning of the galaxies, one by one
+  GnomonicProjector myProjector(ra0, dec0);
+  std::vector<double> refMapArray(2*nbBinsX*nbBinsY, 0.), refCountArray(nbBinsX*nbBinsY, 0.);
+  double refSelectedWeight(0.);
+  for (unsigned long i=0; i<ra.size(); i++)
+  {
+    if (ra[i]<ra0-3. || ra[i]>ra0+3. || dec[i]<dec0-2.5 || dec[i]>dec0+2.5 || z[i]<0.2 || z[i]>1.8)
+    {
+      continue;
+    }
+    double x, y, cos2angle, sin2angle;
+    myProjector.project(1, &ra[i], &dec[i], &x, &y, &cos2angle, &sin2angle);
+    int binX = int(floor((x-xOrigin)/binXSize));
+    int binY = int(floor((y-yOrigin)/binYSize));
+    if (binX<0 || binX>=int(nbBinsX) || binY<0 || binY>=int(nbBinsY))
+    {
+      continue;
+    }
+    int bin = binY*nbBinsX + binX;
+    refMapArray[bin] += (gamma1[i]*cos2angle - gamma2[i]*sin2angle)*weight[i];
+    refMapArray[nbBinsX*nbBinsY + bin] += (gamma1[i]*sin2angle + gamma2[i]*cos2angle)*weight[i];
+    refCountArray[bin] += weight[i];
+    refSelectedWeight += weight[i];
+  }
+
+  BOOST_CHECK(refSelectedWeight>0.);
+  BOOST_CHECK_CLOSE(selectedWeight, refSelectedWeight, 1e-9);
+  for (unsigned int i=0; i<nbBinsX*nbBinsY; i++)
+  {
+    BOOST_CHECK_SMALL(mapArray[i] - refMapArray[i], 1e-12);
+    BOOST_CHECK_SMALL(mapArray[nbBinsX*nbBinsY + i] - refMapArray[nbBinsX*nbBinsY + i], 1e-12);
+    BOOST_CHECK_SMALL(countArray[i] - refCountArray[i], 1e-12);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( reproducibility_test, MapBinnerDataFixture )
+{
+  for (mapEnum mapType : {shearMap, convMap})
+  {
+    std::vector<double> mapArray1, countArray1, mapArray4, countArray4;
+    double selectedWeight1, selectedWeight4, galaxyWeight1, galaxyWeight4;
+    bin(mapType, 1, mapArray1, countArray1, selectedWeight1, &galaxyWeight1);
+    bin(mapType, 4, mapArray4, countArray4, selectedWeight4, &galaxyWeight4);
+
+    // The maps and the total weights are the same bit to bit whatever the number of threads
+    BOOST_CHECK(selectedWeight1==selectedWeight4);
+    BOOST_CHECK(galaxyWeight1==galaxyWeight4);
+    BOOST_CHECK(mapArray1==mapArray4);
+    BOOST_CHECK(countArray1==countArray4);
+
+    // and whatever the chunks the catalog is read by, e.g. one chunk per thread
+    std::vector<double> mapArrayChunks, countArrayChunks;
+    double selectedWeightChunks, galaxyWeightChunks;
+    bin(mapType, 4, mapArrayChunks, countArrayChunks, selectedWeightChunks, &galaxyWeightChunks, 25001);
+    BOOST_CHECK(selectedWeight1==selectedWeightChunks);
+    BOOST_CHECK(galaxyWeight1==galaxyWeightChunks);
+    BOOST_CHECK(mapArray1==mapArrayChunks);
+    BOOST_CHECK(countArray1==countArrayChunks);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( products_test, MapBinnerDataFixture )
+{
+  std::vector<double> shearArray, convArray, countArray;
+  double selectedWeight;
+  bin(shearMap, 4, shearArray, countArray, selectedWeight);
+  bin(convMap, 4, convArray, countArray, selectedWeight);
+
+  // Fill all the products at once
+  unsigned int planSize = nbBinsX*nbBinsY;
+  std::vector<double> shear(2*planSize, 0.), convergence(2*planSize, 0.), weight(planSize, 0.);
+  std::vector<double> squaredWeight(planSize, 0.), shapeSquare(planSize, 0.);
+  ProductArrays arrays;
+  arrays.m_shear = shear.data();
+  arrays.m_convergence = convergence.data();
+  arrays.m_weight = weight.data();
+  arrays.m_squaredWeight = squaredWeight.data();
+  arrays.m_shapeSquare = shapeSquare.data();
+  MapBinner myBinner(nbBinsX, nbBinsY, arrays);
+  myBinner.setProjection(ra0, dec0, xOrigin, yOrigin, binXSize, binYSize);
+  myBinner.setSelection(ra0-3., ra0+3., dec0-2.5, dec0+2.5, 0.2, 1.8);
+  myBinner.binChunk(chunk);
+
+  // The maps are the same as the ones binned one by one
+  BOOST_CHECK(shear==shearArray);
+  BOOST_CHECK(convergence==convArray);
+  BOOST_CHECK(weight==countArray);
+  BOOST_CHECK(myBinner.getSelectedWeight()==selectedWeight);
+  for (unsigned int i=0; i<planSize; i++)
+  {
+    BOOST_CHECK(squaredWeight[i]<=weight[i]*weight[i]*(1+1e-12));
+    BOOST_CHECK(shapeSquare[i]>=0.);
+    BOOST_CHECK((shapeSquare[i]>0.)==(weight[i]>0.));
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( redshiftBins_test, MapBinnerDataFixture )
+{
+  // Bin all the redshift bins at once
+  std::vector<double> zEdges = {0.2, 0.7, 1.1, 1.8};
+  unsigned int planSize = nbBinsX*nbBinsY;
+  std::vector<double> shear(6*planSize, 0.), weight(3*planSize, 0.);
+  ProductArrays arrays;
+  arrays.m_shear = shear.data();
+  arrays.m_weight = weight.data();
+  MapBinner myBinner(nbBinsX, nbBinsY, arrays);
+  myBinner.setProjection(ra0, dec0, xOrigin, yOrigin, binXSize, binYSize);
+  myBinner.setSelection(ra0-3., ra0+3., dec0-2.5, dec0+2.5, 0., 10.);
+  myBinner.setRedshiftBins(zEdges);
+  myBinner.binChunk(chunk);
+
+  // Each redshift bin gives the same plans as a binning restricted to its redshift range
+  double selectedWeight(0.);
+  for (unsigned int k=0; k<3; k++)
+  {
+    std::vector<double> sliceShear(2*planSize, 0.), sliceWeight(planSize, 0.);
+    MapBinner mySliceBinner(shearMap, nbBinsX, nbBinsY, sliceShear.data(), sliceWeight.data());
+    mySliceBinner.setProjection(ra0, dec0, xOrigin, yOrigin, binXSize, binYSize);
+    mySliceBinner.setSelection(ra0-3., ra0+3., dec0-2.5, dec0+2.5, zEdges[k], zEdges[k+1]);
+    mySliceBinner.binChunk(chunk);
+    selectedWeight += mySliceBinner.getSelectedWeight();
+
+    BOOST_CHECK(std::equal(sliceShear.begin(), sliceShear.end(), shear.begin() + 2*k*planSize));
+    BOOST_CHECK(std::equal(sliceWeight.begin(), sliceWeight.end(), weight.begin() + k*planSize));
+  }
+  BOOST_CHECK_CLOSE(myBinner.getSelectedWeight(), selectedWeight, 1e-9);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
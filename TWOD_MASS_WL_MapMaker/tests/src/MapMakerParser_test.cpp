@@ -203,11 +203,11 @@ BOOST_AUTO_TEST_CASE( badZInputs_test ) {
 
 
   // Add a second output file
-  // Provide an output file for the shear map
+  // Provide an output file for the convergence map
   args["outputConvMapFITS"] = po::variable_value(boost::any(std::string(pathFiles+"tmp/trash.fits")), false);
 
-  // check the parameters parsing returns false (two outputs)
-  BOOST_CHECK(myParser.parseInputParameters(args) == false);
+  // check the parameters parsing returns true (both maps extracted in the same pass)
+  BOOST_CHECK(myParser.parseInputParameters(args) == true);
 }
 
 BOOST_AUTO_TEST_CASE( badBinsInputs_test ) {
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/MapMakerStage_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MapMaker/MapMakerStage.h"
+#include "TWOD_MASS_WL_MapMaker/FITSCatalogHandler.h"
+
+#include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+using namespace TWOD_MASS_WL_MapMaker;
+
+DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (MapMakerStage_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( extractMaps_test ) {
+
+  FITSCatalogHandler myCatalog(pathFiles+"FITScatalog_ok_noz.fits");
+  MapMakerStage myStage(256, 256);
+
+  // No maps before the first extraction
+  BOOST_CHECK(myStage.getShearMap()==nullptr);
+  BOOST_CHECK(myStage.getDensityMap()==nullptr);
+
+  // The shear and density maps are kept in memory by the stage
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  BOOST_CHECK(myStage.extractMaps(myCatalog, bounds)==true);
+  BOOST_REQUIRE(myStage.getShearMap()!=nullptr);
+  BOOST_REQUIRE(myStage.getDensityMap()!=nullptr);
+  BOOST_CHECK(myStage.getShearMap()->getXdim()==256);
+  BOOST_CHECK(myStage.getShearMap()->getYdim()==256);
+  BOOST_CHECK(myStage.getDensityMap()->getXdim()==256);
+  BOOST_CHECK(myStage.getDensityMap()->getYdim()==256);
+
+  // Bad boundaries give no maps
+  Boundaries badRaBounds(50, 40, 0, 10, 0, 10);
+  BOOST_CHECK(myStage.extractMaps(myCatalog, badRaBounds)==false);
+  BOOST_CHECK(myStage.getShearMap()==nullptr);
+  BOOST_CHECK(myStage.getDensityMap()==nullptr);
+}
+
+BOOST_AUTO_TEST_CASE( outputFiles_test ) {
+
+  FITSCatalogHandler myCatalog(pathFiles+"FITScatalog_ok_noz.fits");
+  MapMakerStage myStage(256, 256);
+
+  // The maps are saved as extensions of a product file when asked
+  std::string productFile(pathFiles+"tmp/mapMakerStageProduct.fits");
+  myStage.setOutputFiles(productFile+"["+shearExtension+"]", productFile+"["+densityExtension+"]");
+
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  BOOST_REQUIRE(myStage.extractMaps(myCatalog, bounds)==true);
+
+  ShearMap savedShearMap(productFile, shearExtension);
+  GlobalMap savedDensityMap(productFile, densityExtension);
+  BOOST_CHECK(savedShearMap.getXdim()==256);
+  BOOST_CHECK(savedDensityMap.getXdim()==256);
+  BOOST_CHECK_CLOSE(savedShearMap.getBinValue(128, 128, 0),
+                    myStage.getShearMap()->getBinValue(128, 128, 0), 0.001);
+  BOOST_CHECK_CLOSE(savedDensityMap.getBinValue(128, 128, 0),
+                    myStage.getDensityMap()->getBinValue(128, 128, 0), 0.001);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
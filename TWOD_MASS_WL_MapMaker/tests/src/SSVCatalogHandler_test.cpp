@@ -32,6 +32,8 @@
 
 #include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
 
+#include <fstream>
+
 using namespace TWOD_MASS_WL_MassMapping;
 using namespace TWOD_MASS_WL_MapMaker;
 
@@ -123,6 +125,198 @@ BOOST_AUTO_TEST_CASE( goodCatalogwithZ_test ) {
   myConvMap = nullptr;
 }
 
+BOOST_AUTO_TEST_CASE( singlePassProducts_test ) {
+
+  // Open a SSV catalog with data about ra, dec, z, gamma and kappa
+  std::string catalogPath(pathFiles+"SSVcatalog_ok_withz.txt");
+  SSVCatalogHandler myCatalog(catalogPath);
+
+  // Extract all the products in a single pass
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  std::vector<productEnum> products = {shearProduct, convergenceProduct, densityProduct,
+                                       weightProduct, shapeVarianceProduct};
+  BOOST_CHECK(myCatalog.getMaps(products, bounds, 64, 64)==true);
+  BOOST_CHECK(myCatalog.getProductShearMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getProductConvergenceMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getDensityMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getWeightMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getShapeVarianceMap()!=nullptr);
+
+  // The maps are the same as the ones extracted one by one
+  SSVCatalogHandler myOtherCatalog(catalogPath);
+  ShearMap *myShearMap = myOtherCatalog.getShearMap(bounds, 64, 64);
+  ConvergenceMap *myConvMap = myOtherCatalog.getConvergenceMap(bounds, 64, 64);
+  for (unsigned int i=0; i<64; i++)
+  {
+    for (unsigned int j=0; j<64; j++)
+    {
+      BOOST_CHECK(myCatalog.getProductShearMap()->getBinValue(i, j, 0)==myShearMap->getBinValue(i, j, 0));
+      BOOST_CHECK(myCatalog.getProductShearMap()->getBinValue(i, j, 1)==myShearMap->getBinValue(i, j, 1));
+      BOOST_CHECK(myCatalog.getProductConvergenceMap()->getBinValue(i, j, 0)==myConvMap->getBinValue(i, j, 0));
+
+      // The sum of the squared weights is bounded by the squared sum of the weights
+      BOOST_CHECK(myCatalog.getWeightMap()->getBinValue(i, j, 0)<=
+                  myCatalog.getDensityMap()->getBinValue(i, j, 0)*myCatalog.getDensityMap()->getBinValue(i, j, 0));
+      BOOST_CHECK(myCatalog.getShapeVarianceMap()->getBinValue(i, j, 0)>=-1e-12);
+    }
+  }
+  delete myShearMap;
+  delete myConvMap;
+
+  // Only the requested products are extracted, a missing column giving no map
+  products = {convergenceProduct};
+  BOOST_CHECK(myCatalog.getMaps(products, bounds, 64, 64)==true);
+  BOOST_CHECK(myCatalog.getProductShearMap()==nullptr);
+  BOOST_CHECK(myCatalog.getDensityMap()==nullptr);
+  BOOST_CHECK(myCatalog.getProductConvergenceMap()!=nullptr);
+  BOOST_CHECK(myCatalog.getMaps(std::vector<productEnum>(), bounds, 64, 64)==false);
+}
+
+BOOST_AUTO_TEST_CASE( redshiftBins_test ) {
+
+  // Open a SSV catalog with data about ra, dec, z, gamma and kappa
+  std::string catalogPath(pathFiles+"SSVcatalog_ok_withz.txt");
+  SSVCatalogHandler myCatalog(catalogPath);
+
+  // Edges which are not increasing are refused
+  BOOST_CHECK(myCatalog.setRedshiftBins(std::vector<double>({0.5, 0.2}))==false);
+  BOOST_CHECK(myCatalog.setRedshiftBins(std::vector<double>({0.5}))==false);
+  BOOST_CHECK(myCatalog.getNbRedshiftBins()==1);
+
+  // Extract the maps of 3 redshift bins in a single pass
+  BOOST_CHECK(myCatalog.setRedshiftBins(std::vector<double>({0., 0.5, 1., 10.}))==true);
+  BOOST_CHECK(myCatalog.getNbRedshiftBins()==3);
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  std::vector<productEnum> products = {shearProduct, densityProduct};
+  BOOST_CHECK(myCatalog.getMaps(products, bounds, 64, 64)==true);
+  BOOST_CHECK(myCatalog.getProductShearMap()->getZdim()==6);
+  BOOST_CHECK(myCatalog.getDensityMap()->getZdim()==3);
+
+  // The density of all the redshift bins is the one of the full redshift range
+  SSVCatalogHandler myOtherCatalog(catalogPath);
+  Boundaries rangeBounds(40, 50, 0, 10, 0, 10);
+  BOOST_CHECK(myOtherCatalog.getMaps(products, rangeBounds, 64, 64)==true);
+  for (unsigned int i=0; i<64; i++)
+  {
+    for (unsigned int j=0; j<64; j++)
+    {
+      double density(0.);
+      for (unsigned int k=0; k<3; k++)
+      {
+        density += myCatalog.getDensityMap()->getBinValue(i, j, k);
+      }
+      BOOST_CHECK_CLOSE(density, myOtherCatalog.getDensityMap()->getBinValue(i, j, 0), 1e-9);
+    }
+  }
+
+  // A catalog without redshift gives no map
+  SSVCatalogHandler myCatalogNoZ(pathFiles+"SSVcatalog_ok_noz.txt");
+  myCatalogNoZ.setRedshiftBins(std::vector<double>({0., 0.5, 1., 10.}));
+  BOOST_CHECK(myCatalogNoZ.getMaps(products, bounds, 64, 64)==false);
+}
+
+BOOST_AUTO_TEST_CASE( patchMaps_test ) {
+
+  // Open a SSV catalog with data about ra, dec, z, gamma and kappa
+  std::string catalogPath(pathFiles+"SSVcatalog_ok_withz.txt");
+  SSVCatalogHandler myCatalog(catalogPath);
+
+  // Extract in a single pass the maps of overlapping patches and of a patch without galaxies
+  std::vector<Boundaries> patches = {Boundaries(40, 50, 0, 10, 0, 10), Boundaries(45, 50, 5, 10, 0, 10),
+                                     Boundaries(42, 47, 2, 7, 0, 10), Boundaries(200, 210, 60, 70, 0, 10)};
+  std::vector<ShearMap*> shearMaps;
+  std::vector<GlobalMap*> densityMaps;
+  BOOST_CHECK(myCatalog.getPatchMaps(patches, 64, 64, false, shearMaps, densityMaps)==true);
+  BOOST_CHECK(shearMaps.size()==4);
+  BOOST_CHECK(densityMaps.size()==4);
+  BOOST_CHECK(shearMaps[3]==nullptr);
+  BOOST_CHECK(densityMaps[3]==nullptr);
+
+  // The maps of each patch are the ones extracted patch by patch
+  for (unsigned int p=0; p<3; p++)
+  {
+    BOOST_REQUIRE(shearMaps[p]!=nullptr);
+    BOOST_REQUIRE(densityMaps[p]!=nullptr);
+    SSVCatalogHandler myPatchCatalog(catalogPath);
+    ShearMap *myShearMap = myPatchCatalog.getShearMap(patches[p], 64, 64);
+    for (unsigned int i=0; i<64; i++)
+    {
+      for (unsigned int j=0; j<64; j++)
+      {
+        BOOST_CHECK(shearMaps[p]->getBinValue(i, j, 0)==myShearMap->getBinValue(i, j, 0));
+        BOOST_CHECK(shearMaps[p]->getBinValue(i, j, 1)==myShearMap->getBinValue(i, j, 1));
+        BOOST_CHECK(densityMaps[p]->getBinValue(i, j, 0)==myPatchCatalog.getDensityMap()->getBinValue(i, j, 0));
+      }
+    }
+    delete myShearMap;
+  }
+
+  // Delete the pointers
+  for (unsigned int p=0; p<patches.size(); p++)
+  {
+    delete shearMaps[p];
+    delete densityMaps[p];
+  }
+
+  // A catalog which cannot be read gives no map
+  SSVCatalogHandler myCatalogNoFile(pathFiles+"dummy.fits");
+  BOOST_CHECK(myCatalogNoFile.getPatchMaps(patches, 64, 64, false, shearMaps, densityMaps)==false);
+  BOOST_CHECK(shearMaps[0]==nullptr);
+}
+
+BOOST_AUTO_TEST_CASE( parser_test ) {
+
+  // Write the same galaxies in a clean catalog and in a catalog with various separators,
+  // extra columns, an empty line, lines which cannot be parsed and no final new line
+  std::string cleanPath(pathFiles+"tmp/SSVcatalog_clean.txt");
+  std::string messyPath(pathFiles+"tmp/SSVcatalog_messy.txt");
+  std::ofstream clean(cleanPath);
+  std::ofstream messy(messyPath);
+  clean<<"ra dec z gamma1 gamma2 weight"<<std::endl;
+  messy<<"ra dec z gamma1 gamma2 weight comment"<<std::endl;
+  for (int i=0; i<1000; i++)
+  {
+    double ra = 40.005 + 0.01*i;
+    double dec = 0.003 + 0.0099*i;
+    clean<<ra<<" "<<dec<<" 0.5 "<<0.001*i<<" "<<-0.001*i<<" "<<1+i%3<<std::endl;
+    messy<<"  "<<ra<<"\t"<<dec<<"   0.5\t"<<0.001*i<<" "<<-0.001*i<<" "<<1+i%3<<" extra";
+    if (i%100==0)
+    {
+      messy<<std::endl<<std::endl<<"40.5 0.5 0.5 0.1";
+      messy<<std::endl<<"40.5 0.5 0.5 abc 0.1 1";
+    }
+    if (i<999)
+    {
+      messy<<"\r"<<std::endl;
+    }
+  }
+  clean.close();
+  messy.close();
+
+  // The maps are the same
+  Boundaries bounds(40, 50, 0, 10, 0, 10);
+  SSVCatalogHandler myCleanCatalog(cleanPath);
+  SSVCatalogHandler myMessyCatalog(messyPath);
+  ShearMap *myCleanMap = myCleanCatalog.getShearMap(bounds, 32, 32);
+  ShearMap *myMessyMap = myMessyCatalog.getShearMap(bounds, 32, 32);
+  BOOST_REQUIRE(myCleanMap!=nullptr);
+  BOOST_REQUIRE(myMessyMap!=nullptr);
+  for (unsigned int i=0; i<32; i++)
+  {
+    for (unsigned int j=0; j<32; j++)
+    {
+      BOOST_CHECK(myCleanMap->getBinValue(i, j, 0)==myMessyMap->getBinValue(i, j, 0));
+      BOOST_CHECK(myCleanMap->getBinValue(i, j, 1)==myMessyMap->getBinValue(i, j, 1));
+      BOOST_CHECK(myCleanCatalog.getDensityMap()->getBinValue(i, j, 0)==
+                  myMessyCatalog.getDensityMap()->getBinValue(i, j, 0));
+    }
+  }
+
+  // Delete the pointers
+  delete myCleanMap;
+  delete myMessyMap;
+}
+
 BOOST_AUTO_TEST_CASE( fakeCatalog_test ) {
 
   // Provide a SSV file that does not exist
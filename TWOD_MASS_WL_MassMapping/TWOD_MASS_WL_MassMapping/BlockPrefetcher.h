@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/BlockPrefetcher.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_BLOCKPREFETCHER_H
+#define TWOD_MASS_WL_MASSMAPPING_BLOCKPREFETCHER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+/**
+ * @struct PrefetchBlock
+ * @brief A block of rows of a catalog, read by the I/O thread of a BlockPrefetcher
+ */
+struct PrefetchBlock {
+  long m_firstRow = 0;
+  long m_nbRows = 0;
+  // Values of each column read, kept allocated from one block to the next
+  std::vector<std::vector<double> > m_columns;
+};
+
+/**
+ * @class BlockPrefetcher
+ * @brief Reads the blocks of rows of a catalog in an I/O thread, ahead of their processing
+ *
+ * The blocks are read in order by a dedicated thread into a bounded pool of buffers, while the
+ * caller processes the previous ones, so that the reads of the file and the binning of the
+ * galaxies overlap. A buffer is recycled once the caller asks for the next block, the number of
+ * blocks read ahead being bounded by the number of buffers.
+ *
+ * The read function is only called from the I/O thread, one block at a time, so that the reader
+ * of the file (e.g. a cfitsio file) must not be used by the caller until all the blocks are
+ * processed or the prefetcher is destroyed. A library which is not thread safe, like a cfitsio
+ * built without reentrancy, can not be used by the caller at all while the blocks are read: the
+ * prefetcher is then created without I/O thread, each block being read by nextBlock.
+ *
+ */
+class BlockPrefetcher {
+
+public:
+
+  /**
+   * @brief Reads the rows of a block, from m_firstRow to m_firstRow+m_nbRows, into its columns
+   * @return true if the block could be read, false otherwise
+   */
+  typedef std::function<bool(PrefetchBlock&)> BlockReader;
+
+  /**
+   * @brief Destructor, stops the I/O thread
+   */
+  virtual ~BlockPrefetcher();
+
+  /**
+   * @brief Constructor of a BlockPrefetcher
+   * @param[in] nbPrefetched the number of blocks read ahead of the block being processed
+   * @param[in] useThread false to read each block in nextBlock, without reading ahead
+   */
+  BlockPrefetcher(unsigned int nbPrefetched = 2, bool useThread = true);
+
+  BlockPrefetcher(const BlockPrefetcher&) = delete;
+  BlockPrefetcher& operator=(const BlockPrefetcher&) = delete;
+
+  /**
+   * @brief Starts reading blocks in the I/O thread
+   * @param[in] blocks the first row and the number of rows of each block to read, in order
+   * @param[in] readBlock the function reading a block
+   */
+  void start(const std::vector<std::pair<long, long> > &blocks, const BlockReader &readBlock);
+
+  /**
+   * @brief Waits for the next block, the previous one being recycled
+   * @return the next block, valid until the next call, nullptr once all the blocks are processed
+   * or if a block could not be read
+   */
+  const PrefetchBlock* nextBlock();
+
+  /**
+   * @brief Tells if a block could not be read
+   */
+  bool hasFailed() const;
+
+private:
+
+  /**
+   * @brief Reads the blocks, run by the I/O thread
+   */
+  void readBlocks();
+
+  /**
+   * @brief Stops the I/O thread and waits for it
+   */
+  void stop();
+
+  std::vector<PrefetchBlock> m_buffers;
+  std::vector<std::pair<long, long> > m_blocks;
+  BlockReader m_readBlock;
+  bool m_useThread;
+
+  // Next block read by nextBlock when there is no I/O thread
+  std::size_t m_nextBlock;
+
+  // Buffers free to be read, and buffers read in the order of the blocks
+  std::deque<PrefetchBlock*> m_freeBuffers;
+  std::deque<PrefetchBlock*> m_readBuffers;
+  PrefetchBlock *m_currentBuffer;
+  bool m_readDone;
+  bool m_failed;
+  bool m_stopped;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::thread m_thread;
+
+}; /* End of BlockPrefetcher class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
@@ -50,6 +50,8 @@ public:
    * @param[in] zMin the minimum redshift
    * @param[in] zMax the maximum redshift
    *
+   * The tangent point of the projection is the center of the ra and dec ranges
+   *
    */
   Boundaries(double raMin, double raMax, double decMin, double decMax, double zMin, double zMax);
 
@@ -89,6 +91,28 @@ public:
     */
   double getZMax() const;
 
+  /**
+    * @brief Sets the tangent point of the gnomonic projection of the area
+    * @param[in] ra the right ascension of the tangent point
+    * @param[in] dec the declination of the tangent point
+    *
+    * A cutout of a map keeps the tangent point of the full map, which is then
+    * not at the center of its ranges
+    *
+    */
+  void setTangentPoint(double ra, double dec);
+
+  /**
+    * @brief Returns the right ascension of the tangent point of the projection
+    * @return the right ascension of the tangent point of the projection
+    */
+  double getRaTangent() const;
+
+  /**
+    * @brief Returns the declination of the tangent point of the projection
+    * @return the declination of the tangent point of the projection
+    */
+  double getDecTangent() const;
 
 private:
 
@@ -98,6 +122,8 @@ private:
   double m_decMax;
   double m_zMin;
   double m_zMax;
+  double m_raTangent;
+  double m_decTangent;
 
 
 }; /* End of Boundaries class */
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_CATALOGKEYINDEX_H
+#define TWOD_MASS_WL_MASSMAPPING_CATALOGKEYINDEX_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+enum spatialKey {mortonKey, nestedPixelKey};
+
+/**
+ * @class CatalogKeyIndex
+ * @brief Index of a catalog sorted along a space filling curve
+ *
+ * The key of a galaxy is its position along a space filling curve, either the Morton curve over
+ * the plate carree projection of (ra, dec) or the nested pixel index of the equal area HEALPix
+ * tessellation. Both curves are nested, so that the galaxies of a cell of a coarser order follow
+ * each other in a catalog sorted by key. The index keeps, for each cell of the index order holding
+ * some galaxies, its first row, its number of rows and the ranges of ra, dec and z of its galaxies.
+ * The galaxies of a patch are then read as a few contiguous ranges of rows.
+ *
+ * A range is NaN when it is unknown, i.e. when the cell holds a NaN value, and it then never
+ * excludes the cell. The galaxies without a position have the key getNbKeys() and come last.
+ * The index of a catalog is saved next to it, in the columnar format, with the names of the catalog
+ * columns indexed as ra, dec and z, and is only loaded if not older than the catalog.
+ *
+ */
+class CatalogKeyIndex {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~CatalogKeyIndex() = default;
+
+  /**
+   * @brief Constructor of an empty CatalogKeyIndex
+   * @param[in] keyType the space filling curve of the keys
+   * @param[in] order the order of the keys, with 4^order cells over the sky for the Morton curve and
+   * 12*4^order pixels for the nested pixels, clamped to 24
+   * @param[in] indexOrder the order of the cells of the index, clamped to the order of the keys
+   */
+  CatalogKeyIndex(spatialKey keyType = nestedPixelKey, unsigned int order = 20, unsigned int indexOrder = 6);
+
+  /**
+   * @brief Returns the name of the file in which the index of a catalog is saved
+   * @param[in] catalogFilename the name of the catalog
+   */
+  static std::string getSidecarFilename(const std::string &catalogFilename);
+
+  /**
+   * @brief Returns the number of keys of a space filling curve
+   * @param[in] keyType the space filling curve
+   * @param[in] order the order of the keys
+   */
+  static unsigned long getNbKeys(spatialKey keyType, unsigned int order);
+
+  /**
+   * @brief Returns the key of a position
+   * @param[in] keyType the space filling curve
+   * @param[in] order the order of the keys
+   * @param[in] ra the right ascension in degrees
+   * @param[in] dec the declination in degrees
+   * @return the key, getNbKeys(keyType, order) if the position is NaN
+   */
+  static unsigned long getKey(spatialKey keyType, unsigned int order, double ra, double dec);
+
+  /**
+   * @brief Sorts ranges of rows and merges the overlapping or contiguous ones
+   * @param[in,out] rowRanges the first row and the number of rows of each range
+   */
+  static void mergeRowRanges(std::vector<std::pair<unsigned long, unsigned long> > &rowRanges);
+
+  /**
+   * @brief Splits ranges of rows into chunks not crossing the limits of the blocks of a catalog
+   * @param[in] rowRanges the first row and the number of rows of each range, in the order of the rows
+   * @param[in] blockRows the number of rows of the blocks, the largest number of rows of a chunk
+   * @return the first row and the number of rows of each chunk
+   */
+  static std::vector<std::pair<long, long> >
+    splitRowRanges(const std::vector<std::pair<unsigned long, unsigned long> > &rowRanges, long blockRows);
+
+  /**
+   * @brief Sets the names of the catalog columns indexed as ra, dec and z, "ra", "dec" and "z" by default
+   * @param[in] raName the name of the right ascension column
+   * @param[in] decName the name of the declination column
+   * @param[in] zName the name of the redshift column, empty if the catalog has none
+   *
+   * The names are saved with the index, and an index saved for other columns is not loaded
+   *
+   */
+  void setColumnNames(const std::string &raName, const std::string &decName, const std::string &zName);
+
+  /**
+   * @brief Returns the names of the catalog columns indexed as ra, dec and z
+   */
+  const std::vector<std::string>& getColumnNames() const;
+
+  /**
+   * @brief Returns the space filling curve of the keys
+   */
+  spatialKey getKeyType() const;
+
+  /**
+   * @brief Returns the order of the keys
+   */
+  unsigned int getOrder() const;
+
+  /**
+   * @brief Returns the order of the cells of the index
+   */
+  unsigned int getIndexOrder() const;
+
+  /**
+   * @brief Removes all the cells
+   */
+  void clear();
+
+  /**
+   * @brief Appends rows of the catalog to the index
+   * @param[in] nbRows the number of rows
+   * @param[in] keys the keys of the rows, which must not be lower than the keys of the previous rows
+   * @param[in] ra the right ascensions of the rows
+   * @param[in] dec the declinations of the rows
+   * @param[in] z the redshifts of the rows, nullptr if the catalog has none
+   */
+  void addRows(unsigned long nbRows, const unsigned long *keys, const double *ra, const double *dec,
+               const double *z);
+
+  /**
+   * @brief Loads the index saved next to a catalog
+   * @param[in] catalogFilename the name of the catalog
+   * @return true if an index not older than the catalog could be loaded, false otherwise and the
+   * index is then empty
+   */
+  bool load(const std::string &catalogFilename);
+
+  /**
+   * @brief Saves the index next to a catalog
+   * @param[in] catalogFilename the name of the catalog
+   * @return true if the index could be saved, false otherwise
+   */
+  bool save(const std::string &catalogFilename) const;
+
+  /**
+   * @brief Returns the number of rows indexed
+   */
+  unsigned long getNbRows() const;
+
+  /**
+   * @brief Returns the number of cells holding some rows
+   */
+  unsigned long getNbCells() const;
+
+  /**
+   * @brief Returns the ranges of rows which may hold galaxies of a selection
+   * @param[in] raMin the minimum right ascension of the selection
+   * @param[in] raMax the maximum right ascension of the selection
+   * @param[in] decMin the minimum declination of the selection
+   * @param[in] decMax the maximum declination of the selection
+   * @param[in] zMin the minimum redshift of the selection
+   * @param[in] zMax the maximum redshift of the selection
+   * @return the first row and the number of rows of each range, in the order of the rows, the
+   * contiguous ranges being merged
+   */
+  std::vector<std::pair<unsigned long, unsigned long> > getRowRanges(double raMin, double raMax,
+                                                                     double decMin, double decMax,
+                                                                     double zMin, double zMax) const;
+
+private:
+
+  spatialKey m_keyType;
+  unsigned int m_order;
+  unsigned int m_indexOrder;
+  unsigned long m_nbRows;
+  std::vector<std::string> m_columnNames;
+
+  // Cell, first row and number of rows of each cell holding some rows
+  std::vector<unsigned long> m_cells;
+  std::vector<unsigned long> m_firstRows;
+  std::vector<unsigned long> m_cellRows;
+
+  // Min and max of ra, dec and z of each cell
+  std::vector<double> m_ranges;
+
+}; /* End of CatalogKeyIndex class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
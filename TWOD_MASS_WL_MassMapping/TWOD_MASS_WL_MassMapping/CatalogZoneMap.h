@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/CatalogZoneMap.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_CATALOGZONEMAP_H
+#define TWOD_MASS_WL_MASSMAPPING_CATALOGZONEMAP_H
+
+#include <string>
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+class ColumnarCatalog;
+
+enum zoneCoordinate {raCoordinate, decCoordinate, zCoordinate};
+
+/**
+ * @class CatalogZoneMap
+ * @brief Index of the ranges of right ascension, declination and redshift of the zones of a catalog
+ *
+ * The rows of the catalog are gathered in zones of a fixed number of rows, each zone keeping the
+ * min and max values of its ra, dec and z. A reader looking for the galaxies of a patch can then
+ * skip the zones lying outside the patch without reading them.
+ *
+ * A range is NaN when it is unknown, i.e. when the zone holds a NaN value or the catalog has no
+ * such column, and it then never excludes the zone. The index of a catalog is saved next to it,
+ * in the columnar format, with the names of the catalog columns it indexes. It is only loaded if
+ * not older than the catalog and if it indexes the same columns as the ones of the reader. The index
+ * of a catalog in the columnar format is given by the block ranges of the catalog itself.
+ *
+ */
+class CatalogZoneMap {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~CatalogZoneMap() = default;
+
+  /**
+   * @brief Constructor of an empty CatalogZoneMap
+   * @param[in] zoneRows the number of rows of the zones
+   */
+  CatalogZoneMap(unsigned long zoneRows = 65536);
+
+  /**
+   * @brief Returns the name of the file in which the index of a catalog is saved
+   * @param[in] catalogFilename the name of the catalog
+   */
+  static std::string getSidecarFilename(const std::string &catalogFilename);
+
+  /**
+   * @brief Sets the names of the catalog columns indexed as ra, dec and z, "ra", "dec" and "z" by default
+   * @param[in] raName the name of the right ascension column
+   * @param[in] decName the name of the declination column
+   * @param[in] zName the name of the redshift column, empty if the catalog has none
+   *
+   * The names are saved with the index, and an index saved for other columns is not loaded
+   *
+   */
+  void setColumnNames(const std::string &raName, const std::string &decName, const std::string &zName);
+
+  /**
+   * @brief Returns the names of the catalog columns indexed as ra, dec and z
+   */
+  const std::vector<std::string>& getColumnNames() const;
+
+  /**
+   * @brief Removes all the zones, the column names being kept
+   */
+  void clear();
+
+  /**
+   * @brief Appends rows of the catalog to the index, the zones being completed in order
+   * @param[in] nbRows the number of rows
+   * @param[in] ra the right ascensions of the rows
+   * @param[in] dec the declinations of the rows
+   * @param[in] z the redshifts of the rows, nullptr if the catalog has none
+   */
+  void addRows(unsigned long nbRows, const double *ra, const double *dec, const double *z);
+
+  /**
+   * @brief Sets the index from the block ranges of a catalog in the columnar format
+   * @param[in] catalog the columnar catalog, with ra and dec columns and an optional z column
+   * @return true if the catalog is valid and has ra and dec columns, false otherwise
+   *
+   * The column names are set to "ra", "dec" and "z"
+   *
+   */
+  bool setFromColumnarCatalog(const ColumnarCatalog &catalog);
+
+  /**
+   * @brief Loads the index saved next to a catalog
+   * @param[in] catalogFilename the name of the catalog
+   * @return true if an index not older than the catalog and of the same columns could be loaded,
+   * false otherwise and the index is then empty
+   */
+  bool load(const std::string &catalogFilename);
+
+  /**
+   * @brief Saves the index next to a catalog
+   * @param[in] catalogFilename the name of the catalog
+   * @return true if the index could be saved, false otherwise, e.g. if a column name is too long
+   * to be saved
+   */
+  bool save(const std::string &catalogFilename) const;
+
+  /**
+   * @brief Returns the number of rows indexed
+   */
+  unsigned long getNbRows() const;
+
+  /**
+   * @brief Returns the number of rows of the zones, the last zone being possibly shorter
+   */
+  unsigned long getZoneRows() const;
+
+  /**
+   * @brief Returns the number of zones
+   */
+  unsigned long getNbZones() const;
+
+  /**
+   * @brief Returns the min value of a coordinate in a zone, NaN if unknown
+   */
+  double getMin(unsigned long zone, zoneCoordinate coordinate) const;
+
+  /**
+   * @brief Returns the max value of a coordinate in a zone, NaN if unknown
+   */
+  double getMax(unsigned long zone, zoneCoordinate coordinate) const;
+
+  /**
+   * @brief Tells whether some rows of a range may lie inside a selection
+   * @param[in] firstRow the index of the first row of the range
+   * @param[in] nbRows the number of rows of the range
+   * @param[in] raMin the minimum right ascension of the selection
+   * @param[in] raMax the maximum right ascension of the selection
+   * @param[in] decMin the minimum declination of the selection
+   * @param[in] decMax the maximum declination of the selection
+   * @param[in] zMin the minimum redshift of the selection
+   * @param[in] zMax the maximum redshift of the selection
+   * @return false if all the zones of the range are known to lie outside the selection, true otherwise
+   */
+  bool mayOverlap(unsigned long firstRow, unsigned long nbRows, double raMin, double raMax,
+                  double decMin, double decMax, double zMin, double zMax) const;
+
+private:
+
+  unsigned long m_zoneRows;
+  unsigned long m_nbRows;
+
+  // Names of the catalog columns of ra, dec and z
+  std::vector<std::string> m_columnNames;
+
+  // Min and max of ra, dec and z of each zone
+  std::vector<double> m_ranges;
+
+}; /* End of CatalogZoneMap class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
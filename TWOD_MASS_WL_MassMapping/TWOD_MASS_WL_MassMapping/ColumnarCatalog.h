@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/ColumnarCatalog.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_COLUMNARCATALOG_H
+#define TWOD_MASS_WL_MASSMAPPING_COLUMNARCATALOG_H
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+/**
+ * @class ColumnarCatalog
+ * @brief Read only access to a catalog saved in the native columnar format
+ *
+ * The columnar format keeps each column of the catalog as a contiguous array of little endian
+ * doubles, after a small header giving the names of the columns and, for each block of rows,
+ * the min and max values of each column. The file is memory mapped, so that the columns are
+ * used in place without any parsing or conversion, and several processes reading the same
+ * catalog share the page cache. The format is written by ColumnarCatalogWriter.
+ *
+ * Layout of the file, all the values being little endian:
+ * - "2DMWLCOL" magic, uint32 byte order mark 0x01020304, uint32 version,
+ *   uint64 number of rows, uint64 rows per block, uint32 number of columns, uint32 flags
+ * - for each column: its name on 32 characters and the uint64 offset of its values
+ * - for each column and each block: the min and max values of the column in the block,
+ *   NaN if the block holds a NaN value
+ * - the values of each column
+ *
+ */
+class ColumnarCatalog {
+
+public:
+
+  /**
+   * @brief Destructor, unmaps the file
+   */
+  virtual ~ColumnarCatalog();
+
+  /**
+   * @brief Constructor of a ColumnarCatalog
+   * @param[in] filename name of the catalog in the columnar format
+   *
+   * If the file can not be mapped (e.g. it does not exist or is not in the columnar format)
+   * the catalog is empty and isValid returns false
+   *
+   */
+  ColumnarCatalog(std::string filename);
+
+  ColumnarCatalog(const ColumnarCatalog&) = delete;
+  ColumnarCatalog& operator=(const ColumnarCatalog&) = delete;
+
+  /**
+   * @brief Tells if a file is a catalog in the columnar format, by reading its magic
+   * @param[in] filename name of the file
+   * @return true if the file starts as a columnar catalog
+   */
+  static bool isColumnarCatalog(std::string filename);
+
+  /**
+   * @brief Tells if the file has been mapped
+   * @return true if the columns are accessible, false otherwise
+   */
+  bool isValid() const;
+
+  /**
+   * @brief Returns the number of rows of the catalog
+   */
+  unsigned long getNbRows() const;
+
+  /**
+   * @brief Returns the number of rows of the blocks, the last block being possibly shorter
+   */
+  unsigned long getBlockRows() const;
+
+  /**
+   * @brief Returns the number of blocks of rows
+   */
+  unsigned long getNbBlocks() const;
+
+  /**
+   * @brief Returns the flags saved with the catalog by its writer
+   */
+  unsigned int getFlags() const;
+
+  /**
+   * @brief Returns the names of the columns, in the order of the file
+   */
+  const std::vector<std::string>& getColumnNames() const;
+
+  /**
+   * @brief Returns the values of a column
+   * @param[in] name the name of the column
+   * @return a pointer to the getNbRows() values of the column, valid as long as the catalog
+   * exists, nullptr if there is no such column
+   */
+  const double* getColumn(const std::string &name) const;
+
+  /**
+   * @brief Returns the min value of a column in a block of rows
+   * @param[in] name the name of the column
+   * @param[in] block the index of the block
+   * @return the min value, NaN if the column or the block does not exist or if the block
+   * holds a NaN value
+   */
+  double getBlockMin(const std::string &name, unsigned long block) const;
+
+  /**
+   * @brief Returns the max value of a column in a block of rows
+   * @param[in] name the name of the column
+   * @param[in] block the index of the block
+   * @return the max value, NaN if the column or the block does not exist or if the block
+   * holds a NaN value
+   */
+  double getBlockMax(const std::string &name, unsigned long block) const;
+
+private:
+
+  /**
+   * @brief Returns the index of a column, -1 if there is no such column
+   */
+  int findColumn(const std::string &name) const;
+
+  unsigned char *m_mappedFile;
+  unsigned long m_mappedSize;
+
+  unsigned long m_nbRows;
+  unsigned long m_blockRows;
+  unsigned int m_flags;
+  std::vector<std::string> m_columnNames;
+  std::vector<const double*> m_columns;
+  std::vector<const double*> m_blockRanges;
+
+}; /* End of ColumnarCatalog class */
+
+/**
+ * @class ColumnarCatalogWriter
+ * @brief Writes a catalog in the columnar format read by ColumnarCatalog
+ *
+ * The rows are appended chunk after chunk, each column going to a temporary file next to
+ * the catalog, so that the number of rows does not need to be known in advance. The catalog
+ * is written when closed, the temporary files being then removed.
+ *
+ */
+class ColumnarCatalogWriter {
+
+public:
+
+  /**
+   * @brief Destructor, removes the temporary files if the catalog was not closed
+   */
+  virtual ~ColumnarCatalogWriter();
+
+  /**
+   * @brief Constructor of a ColumnarCatalogWriter
+   * @param[in] filename name of the catalog to write
+   * @param[in] columnNames the names of the columns, of at most 31 characters
+   * @param[in] blockRows the number of rows of the blocks whose min and max values are saved
+   * @param[in] flags flags saved with the catalog, for its readers
+   */
+  ColumnarCatalogWriter(std::string filename, std::vector<std::string> columnNames,
+                        unsigned long blockRows = 65536, unsigned int flags = 0);
+
+  ColumnarCatalogWriter(const ColumnarCatalogWriter&) = delete;
+  ColumnarCatalogWriter& operator=(const ColumnarCatalogWriter&) = delete;
+
+  /**
+   * @brief Appends rows to the catalog
+   * @param[in] columns the values of each column, in the order of the column names
+   * @param[in] nbRows the number of rows to append
+   * @return true if the rows could be written, false otherwise
+   */
+  bool appendRows(const std::vector<const double*> &columns, unsigned long nbRows);
+
+  /**
+   * @brief Writes the catalog
+   * @return true if the catalog could be written, false otherwise
+   */
+  bool close();
+
+private:
+
+  /**
+   * @brief Removes the temporary files of the columns
+   */
+  void removeColumnFiles();
+
+  std::string m_filename;
+  std::vector<std::string> m_columnNames;
+  unsigned long m_blockRows;
+  unsigned int m_flags;
+  unsigned long m_nbRows;
+  bool m_writeOK;
+  std::vector<std::unique_ptr<std::ofstream> > m_columnFiles;
+  std::vector<std::vector<double> > m_blockRanges;
+
+}; /* End of ColumnarCatalogWriter class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
@@ -87,6 +87,25 @@ public:
    */
   ConvergenceMap(std::string filename);
 
+  /**
+   * @brief Constructor of a ConvergenceMap from a pixel cutout of a FITS file
+   * @see GlobalMap(std::string, unsigned int, unsigned int, unsigned int, unsigned int)
+   */
+  ConvergenceMap(std::string filename, unsigned int offsetX, unsigned int offsetY,
+     unsigned int sizeX, unsigned int sizeY);
+
+  /**
+   * @brief Constructor of a ConvergenceMap from a sky cutout of a FITS file
+   * @see GlobalMap(std::string, const Boundaries&)
+   */
+  ConvergenceMap(std::string filename, const Boundaries &skyCutout);
+
+  /**
+   * @brief Constructor of a ConvergenceMap from a named extension of a product file
+   * @see GlobalMap(std::string, std::string)
+   */
+  ConvergenceMap(std::string filename, std::string extName);
+
   /**
     * @brief Returns a ShearMap using K&S algorithm
     * @return a ShearMap corresponding to the input ConvergenceMap
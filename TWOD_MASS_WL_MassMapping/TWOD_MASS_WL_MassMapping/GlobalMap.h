@@ -28,15 +28,79 @@
 #include "TWOD_MASS_WL_MassMapping/Boundaries.h"
 
 #include "fftw3.h"
+#include "fitsio.h"
 #include "boost/multi_array.hpp"
 #include <string>
 #include <vector>
+#include <atomic>
+#include <memory>
 #include <boost/program_options.hpp>
 
 namespace po = boost::program_options;
 
 namespace TWOD_MASS_WL_MassMapping {
 
+/**
+ * @brief Non owning view on a sub-rectangle of a map, indexed as view[i][j][k]
+ * from zero whatever the position of the sub-rectangle in the map.
+ * Note that assigning a view to another one copies the values.
+ * The view shares a token with its map, so that the map does not use its cached
+ * Fourier transform as long as a writable view on it is alive.
+ */
+class MapView: public boost::multi_array<double, 3>::array_view<3>::type
+{
+
+public:
+
+  typedef boost::multi_array<double, 3>::array_view<3>::type BaseView;
+
+  /**
+   * @brief Constructor of a view holding the token of the views of its map
+   * @param[in] view the view on the values of the map
+   * @param[in] viewToken the token of the views of the map
+   */
+  MapView(const BaseView &view, const std::shared_ptr<int> &viewToken): BaseView(view), m_viewToken(viewToken)
+  {
+  }
+
+  MapView(const MapView &copyView) = default;
+
+  using BaseView::operator=;
+
+  /**
+   * @brief Copies the values of another view, the views keeping their maps
+   */
+  MapView& operator=(const MapView &otherView)
+  {
+    BaseView::operator=(otherView);
+    return *this;
+  }
+
+private:
+
+  std::shared_ptr<int> m_viewToken;
+
+}; /* End of MapView class */
+
+/**
+ * @brief Read only view on a sub-rectangle of a map
+ */
+typedef boost::multi_array<double, 3>::const_array_view<3>::type ConstMapView;
+
+/**
+ * @brief Tile compression of the FITS images of the maps
+ */
+enum fitsCompression {noCompression, riceCompression, gzipCompression};
+
+/**
+ * @brief Names of the extensions of a product file gathering the maps of a patch
+ */
+const std::string shearExtension("SHEAR");
+const std::string convergenceExtension("CONVERGENCE");
+const std::string densityExtension("DENSITY");
+const std::string weightExtension("WEIGHT");
+const std::string shapeVarianceExtension("SHAPE_VARIANCE");
+
 /**
  * @class GlobalMap
  * @brief Generic class for maps
@@ -62,6 +126,7 @@ public:
    * This constructor builds a generic Map of dimensions sizeXaxis, sizeYaxis, sizeZaxis
    * from the input data array, which should be arranged such that:
    * array(i,j,k) = array[i + j*sizeXaxis + k*sizeXaxis*sizeYaxis]
+   * If array is nullptr the map is filled with zeros.
    *
    */
   GlobalMap(double* array, unsigned int sizeXaxis, unsigned int sizeYaxis, unsigned int sizeZaxis,
@@ -79,6 +144,7 @@ public:
    * This constructor builds a generic Map of dimensions sizeXaxis, sizeYaxis, sizeZaxis
    * from the input data array, which should be arranged such that:
    * array(i,j,k) = array[i + j*sizeXaxis + k*sizeXaxis*sizeYaxis]
+   * If array is nullptr the map is filled with zeros.
    *
    */
   GlobalMap(double* array, unsigned int sizeXaxis, unsigned int sizeYaxis, unsigned int sizeZaxis,
@@ -96,6 +162,45 @@ public:
    */
   GlobalMap(std::string filename);
 
+  /**
+   * @brief Constructor of a Map from a pixel cutout of a FITS file
+   * @param[in] filename name of a FITS input file
+   * @param[in] offsetX first pixel of the cutout along the X axis
+   * @param[in] offsetY first pixel of the cutout along the Y axis
+   * @param[in] sizeX number of pixels of the cutout along the X axis, 0 to go to the image edge
+   * @param[in] sizeY number of pixels of the cutout along the Y axis, 0 to go to the image edge
+   *
+   * Only the pixels of the cutout are read from the file. The cutout is truncated to
+   * the image, and its boundaries are the sky area covered by its pixels, with the
+   * tangent point of the full image.
+   *
+   */
+  GlobalMap(std::string filename, unsigned int offsetX, unsigned int offsetY,
+            unsigned int sizeX, unsigned int sizeY);
+
+  /**
+   * @brief Constructor of a Map from a sky cutout of a FITS file
+   * @param[in] filename name of a FITS input file
+   * @param[in] skyCutout the right ascension and declination range to read,
+   * the redshift range is not used, a range with raMin>raMax wraps around ra=0
+   *
+   * The cutout contains all the pixels overlapping the requested range, so its
+   * boundaries are rounded out to the pixel edges. The file must have boundaries keys.
+   *
+   */
+  GlobalMap(std::string filename, const Boundaries &skyCutout);
+
+  /**
+   * @brief Constructor of a Map from a named extension of a product file
+   * @param[in] filename name of a FITS input file
+   * @param[in] extName name of the image extension to read
+   *
+   * This is the same as reading the file filename[extName] with the cfitsio
+   * extended filename syntax.
+   *
+   */
+  GlobalMap(std::string filename, std::string extName);
+
   /**
    * @brief Copy constructor of a Map
    * @param[in] copyMap the Map to copy
@@ -148,24 +253,64 @@ public:
    * @brief Saves the map as a FITS file
    * @param[in] filename name of the file where to save the map
    * @param[in] overwrite to be set to true to overwrite eventually already existing file filename
+   * @param[in] compression tile compression of the image, none by default
    * @return false if could not save properly (e.g. file already exists and overwrite to false) true otherwise
    *
-   * This method saves the map as a FITS file into the provided filename
+   * This method saves the map as a FITS file of floats into the provided filename
    *
    */
-  bool saveToFITSfile(std::string filename, bool overwrite);
+  bool saveToFITSfile(std::string filename, bool overwrite, fitsCompression compression = noCompression);
 
   /**
    * @brief Saves the map as a FITS file
    * @param[in] filename name of the file where to save the map
    * @param[in] overwrite to be set to true to overwrite eventually already existing file filename
    * @param[in] param a map that contains information to be saved in the header of the FITS image
+   * @param[in] compression tile compression of the image, none by default
    * @return false if could not save properly (e.g. file already exists and overwrite to false) true otherwise
    *
-   * This method saves the map as a FITS file into the provided filename
+   * This method saves the map as a FITS file of floats into the provided filename. The rows
+   * of the map are converted and written by blocks without any copy of the whole map.
+   * With a compression the image is written in the first extension as a tile compressed
+   * image, one tile per row. The Rice compression quantizes the values while keeping the
+   * zeros exact, the GZIP compression is lossless
    *
    */
-  bool saveToFITSfile(std::string filename, bool overwrite, std::map<std::string, po::variable_value> param);
+  bool saveToFITSfile(std::string filename, bool overwrite, std::map<std::string, po::variable_value> param,
+                      fitsCompression compression = noCompression);
+
+  /**
+   * @brief Saves the map as a named image extension of a product file
+   * @param[in] filename name of the product file, created with an empty primary HDU if needed
+   * @param[in] extName name of the extension
+   * @param[in] overwrite to be set to true to replace an already existing extension extName
+   * @param[in] compression tile compression of the image, none by default
+   * @return false if could not save properly (e.g. extension already exists and overwrite to false)
+   * true otherwise
+   *
+   */
+  bool saveToFITSextension(std::string filename, std::string extName, bool overwrite,
+                           fitsCompression compression = noCompression);
+
+  /**
+   * @brief Saves the map as a named image extension of a product file
+   * @param[in] filename name of the product file, created with an empty primary HDU if needed
+   * @param[in] extName name of the extension
+   * @param[in] overwrite to be set to true to replace an already existing extension extName
+   * @param[in] param a map that contains information to be saved in the header of the extension
+   * @param[in] compression tile compression of the image, none by default
+   * @return false if could not save properly (e.g. extension already exists and overwrite to false)
+   * true otherwise
+   *
+   * All the maps of a patch can be gathered as extensions of one file, which saves the file
+   * creations. Every extension has the same header as a map saved alone, including the WCS
+   * keys, so the maps of a patch share the same WCS. The new extension is appended at the
+   * end of the file. saveToFITSfile calls this method for a filename given as file.fits[EXTNAME]
+   *
+   */
+  bool saveToFITSextension(std::string filename, std::string extName, bool overwrite,
+                           std::map<std::string, po::variable_value> param,
+                           fitsCompression compression = noCompression);
 
   /**
    * @brief Performs a forward Fourier transform
@@ -249,6 +394,23 @@ public:
    */
   bool pixelate(unsigned int xBinning, unsigned int yBinning);
 
+  /**
+   * @brief Rebins the map by any integer factor on the X and Y axis
+   * @param[in] xFactor number of pixels of the X axis merged in one bin
+   * @param[in] yFactor number of pixels of the Y axis merged in one bin
+   * @param[in] mean set to true to output the mean of the merged pixels, false to output their sum
+   * @param[in] weights optional map of weights (e.g. number of galaxies per pixel) with the same
+   * X and Y dimensions as this map, using its first Z plan for all Z plans of this map
+   * @return false if a factor is zero, higher than the dimension of its axis or if the weights map
+   * dimensions do not match or it has no Z plan, true otherwise
+   *
+   * This method rebins the map into bins of xFactor x yFactor pixels. The last pixels of an
+   * axis whose size is not a multiple of the factor are dropped. With weights the sum is the
+   * weighted sum and the mean is the weighted mean (zero for bins of zero total weight)
+   *
+   */
+  bool rebin(unsigned int xFactor, unsigned int yFactor, bool mean = true, const GlobalMap *weights = nullptr);
+
   /**
     * @brief Applies a gaussian filter of the ConvergenceMap
     * @param sigmaX sigma of the gaussian kernel on the X direction
@@ -291,14 +453,160 @@ public:
     */
   void removeBorders();
 
+  /**
+    * @brief Pads the map to a bigger size, placing the current map at a given offset
+    * @param[in] newSizeX number of pixels of the padded map on the X axis
+    * @param[in] newSizeY number of pixels of the padded map on the Y axis
+    * @param[in] offsetX X position of the current map inside the padded map
+    * @param[in] offsetY Y position of the current map inside the padded map
+    * @param[in] mirror set to true to fill the borders with the mirrored map, false to fill them with zeros
+    * @return false if the current map does not fit in the padded map at this offset, true otherwise
+    */
+  bool padMap(unsigned int newSizeX, unsigned int newSizeY, unsigned int offsetX, unsigned int offsetY,
+              bool mirror = false);
+
+  /**
+    * @brief Crops the map to the sub-rectangle starting at a given offset
+    * @param[in] newSizeX number of pixels of the cropped map on the X axis
+    * @param[in] newSizeY number of pixels of the cropped map on the Y axis
+    * @param[in] offsetX X position of the sub-rectangle inside the current map
+    * @param[in] offsetY Y position of the sub-rectangle inside the current map
+    * @return false if the sub-rectangle does not fit in the current map, true otherwise
+    *
+    * No value is copied: the map keeps its storage and only the origin of the indices
+    * is moved to the sub-rectangle
+    *
+    */
+  bool cropMap(unsigned int newSizeX, unsigned int newSizeY, unsigned int offsetX, unsigned int offsetY);
+
+  /**
+    * @brief Returns a view on a sub-rectangle of the map
+    * @param[in] offsetX X position of the sub-rectangle inside the map
+    * @param[in] offsetY Y position of the sub-rectangle inside the map
+    * @param[in] sizeX number of pixels of the sub-rectangle on the X axis
+    * @param[in] sizeY number of pixels of the sub-rectangle on the Y axis
+    * @return a view on the sub-rectangle, for all the Z plans, truncated to the map limits
+    *
+    * The values are not copied: writing in the view writes in the map. The view
+    * is valid as long as the map is not resized (e.g. pixelate, padMap).
+    * As the map may be written through the view, the cached Fourier transform is dropped,
+    * and it is not used by getFourierTransform as long as the view, or a copy of it, is alive
+    *
+    */
+  MapView getView(unsigned int offsetX, unsigned int offsetY, unsigned int sizeX, unsigned int sizeY);
+
+  /**
+    * @brief Returns a read only view on a sub-rectangle of the map
+    * @param[in] offsetX X position of the sub-rectangle inside the map
+    * @param[in] offsetY Y position of the sub-rectangle inside the map
+    * @param[in] sizeX number of pixels of the sub-rectangle on the X axis
+    * @param[in] sizeY number of pixels of the sub-rectangle on the Y axis
+    * @return a read only view on the sub-rectangle, for all the Z plans, truncated to the map limits
+    */
+  ConstMapView getView(unsigned int offsetX, unsigned int offsetY, unsigned int sizeX, unsigned int sizeY) const;
+
+  /**
+    * @brief Returns the Fourier transform of the complex map made of the two first Z plans
+    * @return the forward transform of plan0 + i plan1, the mode (i, j) being at index j*sizeXaxis + i
+    *
+    * The transform is computed at the first call only and then cached until the map is
+    * modified, so that consecutive Fourier space operations do not transform the map again.
+    * The cache is not used while a writable view on the map is alive, nor when it was
+    * computed while one was alive.
+    * The returned array is owned by the map and is valid until the map is modified
+    *
+    */
+  const fftw_complex* getFourierTransform();
+
+  /**
+    * @brief Sets the cached Fourier transform of the map
+    * @param[in] fourierValues forward transform of plan0 + i plan1 allocated with fftw_malloc,
+    * the map takes its ownership
+    *
+    * To be used by the operations computing a map from its Fourier transform, e.g. the
+    * Kaiser & Squires inversion, so that the next Fourier space operation reuses it
+    *
+    */
+  void setFourierTransform(fftw_complex* fourierValues);
+
+  /**
+    * @brief Tells if the Fourier transform of the map is cached
+    * @return true if the Fourier transform is cached and usable, false otherwise
+    */
+  bool hasFourierTransform() const;
+
+  /**
+    * @brief Drops the cached Fourier transform, to be called after the map is modified
+    */
+  void invalidateFourierTransform();
+
+  /**
+    * @brief Returns the number of map Fourier transforms computed by getFourierTransform
+    * @return the number of transforms computed since the last reset, for all maps
+    */
+  static unsigned long getNumberOfTransformsPerformed();
+
+  /**
+    * @brief Returns the number of map Fourier transforms served by the cache
+    * @return the number of transforms avoided since the last reset, for all maps
+    */
+  static unsigned long getNumberOfTransformsAvoided();
+
+  /**
+    * @brief Resets the counters of performed and avoided transforms
+    */
+  static void resetTransformCounters();
+
 
 protected:
 
+  /**
+    * @brief Reads the image of a FITS file, or a cutout of it, into the map
+    * @param[in] filename name of the FITS input file
+    * @param[in] offsetX first pixel of the cutout along the X axis
+    * @param[in] offsetY first pixel of the cutout along the Y axis
+    * @param[in] sizeX number of pixels of the cutout along the X axis, 0 to go to the image edge
+    * @param[in] sizeY number of pixels of the cutout along the Y axis, 0 to go to the image edge
+    * @param[in] skyCutout if not nullptr, sky range of the cutout replacing the pixel one
+    * @return false if the file could not be read as a 2D or 3D image, if the image has an
+    * empty axis or if the cutout is outside of it, true otherwise
+    *
+    * The image is read by blocks of rows directly into the map storage and only the
+    * keys used by the map are read. The image is the primary one, or the first extension
+    * if the primary HDU is empty as for tile compressed images
+    *
+    */
+  bool readFITSimage(const std::string &filename, unsigned int offsetX=0, unsigned int offsetY=0,
+                     unsigned int sizeX=0, unsigned int sizeY=0, const Boundaries *skyCutout=nullptr);
+
+  /**
+    * @brief Writes the map as a new image HDU of an open FITS file
+    * @param[in] fptr the open FITS file
+    * @param[in] param a map that contains information to be saved in the header of the image
+    * @param[in] compression tile compression of the image
+    * @param[in] extName name of the HDU, none if empty
+    * @return false if an error occurred while writing, true otherwise
+    *
+    */
+  bool writeFITSimage(fitsfile *fptr, std::map<std::string, po::variable_value> &param,
+                      fitsCompression compression, const std::string &extName = "");
+
   unsigned int m_sizeXaxis;
   unsigned int m_sizeYaxis;
   unsigned int m_sizeZaxis;
   boost::multi_array<double, 3> *m_mapValues;
 
+  // Cached Fourier transform of plan0 + i plan1, nullptr if not computed
+  fftw_complex *m_fourierValues;
+
+  // Token shared by the writable views of the map, and whether the cached transform was
+  // computed while one of them was alive, the map being then possibly written afterwards
+  std::shared_ptr<int> m_viewToken = std::make_shared<int>(0);
+  bool m_transformWithView = false;
+
+  static std::atomic<unsigned long> s_transformsPerformed;
+  static std::atomic<unsigned long> s_transformsAvoided;
+
   unsigned long m_numberOfGalaxies;
 
   Boundaries m_boundaries;
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/MapStatistics.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_MAPSTATISTICS_H
+#define TWOD_MASS_WL_MASSMAPPING_MAPSTATISTICS_H
+
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+class GlobalMap;
+class Image;
+
+/**
+ * @class MapStatistics
+ * @brief Computes the statistics of all the Z plans of a map in a single parallel pass
+ *
+ * For each plan the mean, variance (per row two-pass sums merged with the
+ * parallel Welford formula), min, max and optionally the median absolute
+ * deviation and an histogram on a fixed range are computed.
+ *
+ */
+class MapStatistics {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~MapStatistics() = default;
+
+  /**
+   * @brief Constructor of a MapStatistics object
+   * @param[in] computeMAD set to true to compute the median and median absolute deviation,
+   * which needs a copy of the values
+   * @param[in] nbHistogramBins number of bins of the histogram, 0 for no histogram
+   * @param[in] histogramMin lower edge of the histogram
+   * @param[in] histogramMax upper edge of the histogram, values outside of
+   * [histogramMin, histogramMax[ are not counted in the histogram
+   *
+   */
+  MapStatistics(bool computeMAD = false, unsigned int nbHistogramBins = 0,
+                double histogramMin = 0., double histogramMax = 1.);
+
+  /**
+   * @brief Computes the statistics of all the Z plans of a map
+   * @param[in] map the map on which to compute the statistics
+   * @param[in] removeOffset set to true to also remove the mean value of each plan from the map
+   * @return false if the map is empty, true otherwise
+   *
+   * When removeOffset is true the offset removal is performed in the same parallel region
+   * and all the statistics describe the map after the removal
+   *
+   */
+  bool computeStatistics(GlobalMap &map, bool removeOffset = false);
+
+  /**
+   * @brief Computes the statistics of an image, seen as a single plan
+   * @param[in] image the image on which to compute the statistics
+   * @return false if the image is empty, true otherwise
+   */
+  bool computeStatistics(const Image &image);
+
+  /**
+   * @brief Returns the number of plans on which the statistics were computed
+   * @return the number of plans
+   */
+  unsigned int getNumberOfPlans() const;
+
+  /**
+   * @brief Returns the number of pixels of a plan
+   * @param[in] plan the Z plan
+   * @return the number of pixels
+   */
+  unsigned long getCount(unsigned int plan) const;
+
+  /**
+   * @brief Returns the mean value of a plan
+   * @param[in] plan the Z plan
+   * @return the mean value
+   */
+  double getMean(unsigned int plan) const;
+
+  /**
+   * @brief Returns the mean values of all the plans
+   * @return a vector of size number of plans with the mean values
+   */
+  std::vector<double> getMeanValues() const;
+
+  /**
+   * @brief Returns the variance of a plan
+   * @param[in] plan the Z plan
+   * @return the variance
+   */
+  double getVariance(unsigned int plan) const;
+
+  /**
+   * @brief Returns the standard deviation of a plan
+   * @param[in] plan the Z plan
+   * @return the standard deviation
+   */
+  double getStandardDeviation(unsigned int plan) const;
+
+  /**
+   * @brief Returns the minimum value of a plan
+   * @param[in] plan the Z plan
+   * @return the minimum value
+   */
+  double getMin(unsigned int plan) const;
+
+  /**
+   * @brief Returns the maximum value of a plan
+   * @param[in] plan the Z plan
+   * @return the maximum value
+   */
+  double getMax(unsigned int plan) const;
+
+  /**
+   * @brief Returns the median value of a plan
+   * @param[in] plan the Z plan
+   * @return the median value, 0 if computeMAD was not asked
+   */
+  double getMedian(unsigned int plan) const;
+
+  /**
+   * @brief Returns the median absolute deviation of a plan
+   * @param[in] plan the Z plan
+   * @return the median absolute deviation, 0 if computeMAD was not asked
+   */
+  double getMAD(unsigned int plan) const;
+
+  /**
+   * @brief Returns the histogram of a plan
+   * @param[in] plan the Z plan
+   * @return the number of pixels in each bin of the histogram
+   */
+  std::vector<unsigned long> getHistogram(unsigned int plan) const;
+
+private:
+
+  /**
+   * @brief Computes the statistics of a set of rows of nbPlans interleaved plans
+   */
+  void computeRows(double **rows, unsigned long nbRows, unsigned long rowLength, unsigned int nbPlans,
+                   bool removeOffset);
+
+  /**
+   * @brief Returns the median of values, which are reordered
+   */
+  double getMedianValue(std::vector<double> &values) const;
+
+  /**
+   * @brief Adds a value to the histogram of a plan
+   */
+  void fillHistogram(std::vector<unsigned long> &histogram, double value) const;
+
+  bool m_computeMAD;
+  unsigned int m_nbHistogramBins;
+  double m_histogramMin;
+  double m_histogramMax;
+
+  std::vector<unsigned long> m_count;
+  std::vector<double> m_mean;
+  std::vector<double> m_variance;
+  std::vector<double> m_min;
+  std::vector<double> m_max;
+  std::vector<double> m_median;
+  std::vector<double> m_MAD;
+  std::vector<std::vector<unsigned long> > m_histogram;
+
+}; /* End of MapStatistics class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/MappedFITSMap.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_MAPPEDFITSMAP_H
+#define TWOD_MASS_WL_MASSMAPPING_MAPPEDFITSMAP_H
+
+#include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+/**
+ * @class MappedFITSMap
+ * @brief Read only access to a map saved as an uncompressed FITS image, without loading it
+ *
+ * The data block of the image is memory mapped, so opening the map does not read
+ * the values and several processes reading the same file share the page cache. The big
+ * endian values are converted to double by blocks of rows, at the first access to a block.
+ * The values are indexed as in GlobalMap, the rows of the image being along the X axis.
+ * The blocks may be accessed from several threads.
+ *
+ */
+class MappedFITSMap {
+
+public:
+
+  /**
+   * @brief Destructor, unmaps the file
+   */
+  virtual ~MappedFITSMap();
+
+  /**
+   * @brief Constructor of a MappedFITSMap
+   * @param[in] filename name of a FITS file with an uncompressed 2D or 3D image, the first
+   * HDU with data being mapped, or name of an image extension given as file.fits[EXTNAME]
+   *
+   * If the file can not be mapped (e.g. it does not exist, it is compressed or the extension
+   * is not found) the map is empty and isValid returns false
+   *
+   */
+  MappedFITSMap(std::string filename);
+
+  MappedFITSMap(const MappedFITSMap&) = delete;
+  MappedFITSMap& operator=(const MappedFITSMap&) = delete;
+
+  /**
+   * @brief Tells if the file has been mapped
+   * @return true if the image is accessible, false otherwise
+   */
+  bool isValid() const;
+
+  /**
+   * @brief Returns the value of the X dimension
+   */
+  unsigned int getXdim() const;
+
+  /**
+   * @brief Returns the value of the Y dimension
+   */
+  unsigned int getYdim() const;
+
+  /**
+   * @brief Returns the value of the Z dimension
+   */
+  unsigned int getZdim() const;
+
+  /**
+   * @brief Returns a row of the map along the X axis
+   * @param[in] biny bin on y axis
+   * @param[in] binz bin on z axis
+   * @return a pointer to the getXdim() values of the row, valid as long as the map exists
+   */
+  const double* getRow(unsigned int biny, unsigned int binz) const;
+
+  /**
+   * @brief Returns the value of the needed bin in the map
+   * @param[in] binx bin on x axis
+   * @param[in] biny bin on y axis
+   * @param[in] binz bin on z axis
+   * @return the value of the bin, 0 if the bin is out of the map
+   */
+  double getBinValue(unsigned int binx, unsigned int biny, unsigned int binz) const;
+
+  /**
+   * @brief Returns the number of galaxies in the map, read in the header
+   * @return the number of galaxies if known, 0 otherwise
+   */
+  unsigned long getNumberOfGalaxies() const;
+
+  /**
+   * @brief Returns the boundaries of the map, read in the header
+   * @return the boundaries of the map, with the tangent point of the CRVAL keys if any
+   */
+  Boundaries getBoundaries() const;
+
+private:
+
+  /**
+   * @brief Parses the header cards of the HDU starting at headerOffset, gives the offset
+   * and size of its data unit and its name. Returns false if the HDU can not be mapped,
+   * the data offset being 0 if a value of the header is malformed
+   */
+  bool parseHeader(unsigned long headerOffset, unsigned long &dataOffset, unsigned long &dataSize,
+                   std::string &extName);
+
+  /**
+   * @brief Converts a block of rows from the big endian data to double
+   */
+  void convertBlock(unsigned long block) const;
+
+  unsigned char *m_mappedFile;
+  unsigned long m_mappedSize;
+
+  unsigned int m_sizeXaxis;
+  unsigned int m_sizeYaxis;
+  unsigned int m_sizeZaxis;
+
+  int m_bitpix;
+  double m_bscale;
+  double m_bzero;
+  const unsigned char *m_data;
+
+  unsigned long m_numberOfGalaxies;
+  Boundaries m_boundaries;
+
+  unsigned int m_rowsPerBlock;
+  mutable std::vector<std::unique_ptr<std::vector<double> > > m_convertedBlocks;
+  std::unique_ptr<std::once_flag[]> m_blockFlags;
+
+}; /* End of MappedFITSMap class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
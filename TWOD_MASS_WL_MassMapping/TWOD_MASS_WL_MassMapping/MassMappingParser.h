@@ -27,6 +27,8 @@
 
 #include <boost/program_options.hpp>
 #include "ElementsKernel/ProgramHeaders.h"
+#include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
+#include "TWOD_MASS_WL_MassMapping/PaddingPolicy.h"
 #include <string>
 
 namespace po = boost::program_options;
@@ -142,6 +144,9 @@ private:
 
    bool m_bModes;
    bool m_addBorders;
+   unsigned int m_borderWidth;
+   bool m_mirrorBorders;
+   PaddingPolicy m_paddingPolicy;
    bool m_sigmaBounded;
    unsigned int m_nbScales;
 
@@ -150,6 +155,15 @@ private:
 
    unsigned int m_numberIter;
 
+   std::string m_outputFITSpowerSpectrum;
+   unsigned int m_powerSpectrumBins;
+   float m_ellMin;
+   float m_ellMax;
+   bool m_powerSpectrumLogBins;
+
+   fitsCompression m_outputCompression;
+   std::string m_outputFITSproduct;
+
    clock_t tStart = clock();
 
 }; /* End of MassMappingParser class */
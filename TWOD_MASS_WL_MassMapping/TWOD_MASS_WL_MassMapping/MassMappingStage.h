@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/MassMappingStage.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_MASSMAPPINGSTAGE_H
+#define TWOD_MASS_WL_MASSMAPPING_MASSMAPPINGSTAGE_H
+
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+#include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+#include "TWOD_MASS_WL_MassMapping/PaddingPolicy.h"
+
+#include <map>
+#include <string>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+/**
+ * @class MassMappingStage
+ * @brief In memory mass mapping stage, computing the convergence map of a shear map
+ *
+ * The stage performs the same processing as the MassMapping program for an input shear
+ * map: optional borders, Kaiser & Squires inversion, optional gaussian filter of the
+ * convergence map and optional inpainting. The input and output maps stay in memory,
+ * the convergence map is only saved to a FITS file if an output file is given.
+ *
+ */
+class MassMappingStage {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~MassMappingStage();
+
+  /**
+   * @brief Constructor of a MassMappingStage
+   * @param[in] nbIterInpainting the number of iterations of the inpainting, 0 for no inpainting
+   * @param[in] nbScales the number of scales of the inpainting, 0 to compute it from the map size
+   * @param[in] sigmaBounded set to true to force the same variance in and out of the mask
+   * @param[in] bModeZeros set to true to force the B modes at zero in the inpainting iterations
+   *
+   */
+  MassMappingStage(unsigned int nbIterInpainting = 0, unsigned int nbScales = 0,
+                   bool sigmaBounded = false, bool bModeZeros = false);
+
+  MassMappingStage(const MassMappingStage&) = delete;
+  MassMappingStage& operator=(const MassMappingStage&) = delete;
+
+  /**
+   * @brief Sets the gaussian filter applied to the convergence map
+   * @param[in] sigmaX standard deviation along the X axis, no filter if 0
+   * @param[in] sigmaY standard deviation along the Y axis
+   */
+  void setGaussianFilter(double sigmaX, double sigmaY);
+
+  /**
+   * @brief Sets the borders added to the shear map during the computation
+   * @param[in] borderWidth minimum width of the borders in pixels, no borders if 0
+   * @param[in] mode the way the borders are filled
+   */
+  void setBorders(unsigned int borderWidth, paddingMode mode = zeroPadding);
+
+  /**
+   * @brief Sets a file in which to save the convergence map at each computation
+   * @param[in] filename name of the FITS file, or file.fits[EXTNAME] for a product file
+   * extension, no file is written if empty (default)
+   * @param[in] compression tile compression of the image
+   */
+  void setOutputFile(std::string filename, fitsCompression compression = noCompression);
+
+  /**
+   * @brief Computes the convergence map of a shear map
+   * @param[in] shearMap the input shear map, its values are not modified
+   * @return true if the convergence map could be computed, false otherwise
+   *
+   * The previous convergence map of the stage is replaced
+   *
+   */
+  bool computeConvergenceMap(ShearMap &shearMap);
+
+  /**
+   * @brief Returns the last computed convergence map
+   * @return the convergence map owned by the stage, nullptr if none was computed
+   */
+  ConvergenceMap* getConvergenceMap() const;
+
+private:
+
+  /**
+   * @brief Returns the parameters of the stage written in the header of the saved map
+   */
+  std::map<std::string, po::variable_value> getHeaderParameters() const;
+
+  unsigned int m_nbIterInpainting;
+  unsigned int m_nbScales;
+  bool m_sigmaBounded;
+  bool m_bModeZeros;
+
+  double m_sigmaX;
+  double m_sigmaY;
+
+  unsigned int m_borderWidth;
+  paddingMode m_paddingMode;
+
+  std::string m_outputFile;
+  fitsCompression m_outputCompression;
+
+  ConvergenceMap *m_convergenceMap;
+
+}; /* End of MassMappingStage class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/PaddingPolicy.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_PADDINGPOLICY_H
+#define TWOD_MASS_WL_MASSMAPPING_PADDINGPOLICY_H
+
+#include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
+
+namespace TWOD_MASS_WL_MassMapping {
+
+/**
+ * @brief the way the borders added to a map are filled
+ */
+enum paddingMode {zeroPadding, mirrorPadding};
+
+/**
+ * @class PaddingPolicy
+ * @brief Class that adds FFT friendly borders to a map and crops them back
+ *
+ * The padded size of each axis is the smallest number of the form 2^a*3^b*5^c*7^d
+ * covering the map plus a border of the requested width on each side, for which FFTW
+ * is efficient. The original map is centered in the padded one.
+ *
+ */
+class PaddingPolicy {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~PaddingPolicy() = default;
+
+  /**
+   * @brief Constructor of a PaddingPolicy object
+   * @param[in] borderWidth minimum number of pixels to add on each side of the map
+   * @param[in] mode zeroPadding to fill the borders with zeros, mirrorPadding to fill
+   * them with the mirrored map
+   *
+   */
+  PaddingPolicy(unsigned int borderWidth = 0, paddingMode mode = zeroPadding);
+
+  /**
+   * @brief Returns the smallest number of the form 2^a*3^b*5^c*7^d greater or equal to minSize
+   * @param[in] minSize the minimum size needed
+   * @return the FFT friendly size
+   */
+  static unsigned int getFFTFriendlySize(unsigned int minSize);
+
+  /**
+   * @brief Returns the padded size of an axis of size
+   * @param[in] size number of pixels of the axis before padding
+   * @return the FFT friendly size covering size plus the borders on both sides
+   */
+  unsigned int getPaddedSize(unsigned int size) const;
+
+  /**
+   * @brief Sets the geometry of the padding for a map of the given size
+   * @param[in] sizeX number of pixels of the map to pad on the X axis
+   * @param[in] sizeY number of pixels of the map to pad on the Y axis
+   *
+   * This method allows to build the padded map directly, e.g. a map of
+   * getPaddedSize(sizeX) x getPaddedSize(sizeY) filled with zeros in which values are
+   * written through getInnerView, instead of padding an existing map with padMap
+   *
+   */
+  void preparePadding(unsigned int sizeX, unsigned int sizeY);
+
+  /**
+   * @brief Returns a view on the original map area of a padded map
+   * @param[in] paddedMap a map with the padded dimensions
+   * @return a view on the area of the original map, without copying any value
+   *
+   * As for GlobalMap::getView, the cached Fourier transform of the map is not used while the view is alive
+   *
+   */
+  MapView getInnerView(GlobalMap &paddedMap) const;
+
+  /**
+   * @brief Adds the borders to the map
+   * @param[in] map the map to pad
+   * @return true if the map was padded, false otherwise
+   *
+   * This method pads the map and keeps track of its original size and
+   * position so that it can be cropped back with cropMap
+   *
+   */
+  bool padMap(GlobalMap &map);
+
+  /**
+   * @brief Removes the borders previously added by padMap
+   * @param[in] map the map to crop
+   * @return true if the map was cropped, false otherwise (e.g. no map was padded
+   * or the dimensions of the map do not match the padded ones)
+   *
+   * The borders are removed without copying the values of the map
+   *
+   */
+  bool cropMap(GlobalMap &map) const;
+
+  /**
+   * @brief Returns the X position of the original map inside the padded map
+   * @return the X offset in pixels
+   */
+  unsigned int getXoffset() const;
+
+  /**
+   * @brief Returns the Y position of the original map inside the padded map
+   * @return the Y offset in pixels
+   */
+  unsigned int getYoffset() const;
+
+private:
+
+  unsigned int m_borderWidth;
+  paddingMode m_mode;
+
+  unsigned int m_originalSizeX;
+  unsigned int m_originalSizeY;
+  unsigned int m_paddedSizeX;
+  unsigned int m_paddedSizeY;
+
+}; /* End of PaddingPolicy class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/PowerSpectrum.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_POWERSPECTRUM_H
+#define TWOD_MASS_WL_MASSMAPPING_POWERSPECTRUM_H
+
+#include "TWOD_MASS_WL_MassMapping/Boundaries.h"
+
+#include "fftw3.h"
+#include <string>
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+class ConvergenceMap;
+class ShearMap;
+
+/**
+ * @class PowerSpectrum
+ * @brief Flat sky estimator of the E and B modes angular power spectra of a map
+ *
+ * The squared modules of the Fourier modes are averaged in annuli of multipole ell,
+ * with logarithmic or linear bins. The E and B modes are both extracted from the
+ * single complex transform of kappaE + i kappaB. The multipoles are computed from the
+ * pixel sizes given by the boundaries of the map, or in units of 2pi/pixels if the
+ * boundaries are not set. The Fourier transform cached in the maps is reused when
+ * available.
+ *
+ */
+class PowerSpectrum {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~PowerSpectrum() = default;
+
+  /**
+   * @brief Constructor of a PowerSpectrum object
+   * @param[in] nbBins number of ell bins
+   * @param[in] ellMin lower edge of the first bin, 0 to use the fundamental mode of the map
+   * @param[in] ellMax upper edge of the last bin, 0 to use the highest mode of the map
+   * @param[in] logBins set to true for logarithmic bins, false for linear bins
+   *
+   */
+  PowerSpectrum(unsigned int nbBins, double ellMin = 0., double ellMax = 0., bool logBins = true);
+
+  /**
+   * @brief Computes the E and B power spectra of a convergence map
+   * @param[in] convMap the convergence map, E-mode in the first Z plan and B-mode in the second one
+   * @return false if the map or the binning is not valid, true otherwise
+   */
+  bool computePowerSpectrum(ConvergenceMap &convMap);
+
+  /**
+   * @brief Computes the E and B power spectra of a shear map
+   * @param[in] shearMap the shear map, gamma1 in the first Z plan and gamma2 in the second one
+   * @return false if the map or the binning is not valid, true otherwise
+   *
+   * The shear modes are rotated to the convergence E and B modes in Fourier space
+   * as in the Kaiser & Squires inversion, without any backward transform
+   *
+   */
+  bool computePowerSpectrum(ShearMap &shearMap);
+
+  /**
+   * @brief Computes the E and B power spectra from the Fourier transform of a convergence map
+   * @param[in] fftKappa the forward Fourier transform of kappaE + i kappaB, the mode (i, j)
+   * being at index j*sizeXaxis + i
+   * @param[in] sizeXaxis number of pixels in the X axis
+   * @param[in] sizeYaxis number of pixels in the Y axis
+   * @param[in] boundaries the boundaries of the map used to compute the pixel sizes
+   * @return false if the map or the binning is not valid, true otherwise
+   */
+  bool computePowerSpectrum(const fftw_complex *fftKappa, unsigned int sizeXaxis, unsigned int sizeYaxis,
+                            const Boundaries &boundaries);
+
+  /**
+   * @brief Returns the mean multipole of the modes in each bin
+   * @return the mean ell of each bin, the center of the bin if no mode is in it
+   */
+  std::vector<double> getEll() const;
+
+  /**
+   * @brief Returns the E-mode power spectrum
+   * @return the E-mode power in each bin
+   */
+  std::vector<double> getPowerE() const;
+
+  /**
+   * @brief Returns the B-mode power spectrum
+   * @return the B-mode power in each bin
+   */
+  std::vector<double> getPowerB() const;
+
+  /**
+   * @brief Returns the EB cross power spectrum
+   * @return the EB cross power in each bin
+   */
+  std::vector<double> getPowerEB() const;
+
+  /**
+   * @brief Returns the number of Fourier modes in each bin
+   * @return the number of modes in each bin
+   */
+  std::vector<long> getNumberOfModes() const;
+
+  /**
+   * @brief Saves the power spectra as a FITS table
+   * @param[in] filename name of the file where to save the power spectra
+   * @param[in] overwrite to be set to true to overwrite eventually already existing file filename
+   * @return false if could not save properly, true otherwise
+   */
+  bool saveToFITSfile(std::string filename, bool overwrite) const;
+
+private:
+
+  unsigned int m_nbBins;
+  double m_ellMin;
+  double m_ellMax;
+  bool m_logBins;
+
+  std::vector<double> m_ell;
+  std::vector<double> m_powerE;
+  std::vector<double> m_powerB;
+  std::vector<double> m_powerEB;
+  std::vector<long> m_nbModes;
+
+}; /* End of PowerSpectrum class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_MassMapping/ReducedShearSolver.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_MASSMAPPING_REDUCEDSHEARSOLVER_H
+#define TWOD_MASS_WL_MASSMAPPING_REDUCEDSHEARSOLVER_H
+
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+#include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+#include "TWOD_MASS_WL_MassMapping/MassMappingStage.h"
+
+#include <vector>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+/**
+ * @class ReducedShearSolver
+ * @brief Iterative reduced shear correction performed in memory
+ *
+ * The solver keeps the original shear map, the current E mode convergence and the
+ * corrected shear map. At each iteration the convergence is computed from the corrected
+ * shear, then the corrected shear is recomputed from the original one as g/(1-kappa).
+ * The iterations stop after the maximum number of iterations or when the convergence
+ * does not change by more than the tolerance anymore.
+ *
+ */
+class ReducedShearSolver {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~ReducedShearSolver() = default;
+
+  /**
+   * @brief Constructor of a ReducedShearSolver
+   * @param[in] shearMap the original shear map, copied by the solver
+   * @param[in] maxIterations the maximum number of convergence map computations, at least 1
+   * @param[in] tolerance the iterations stop when the largest change of the convergence
+   * between two iterations is not greater than this value
+   */
+  ReducedShearSolver(const ShearMap &shearMap, unsigned int maxIterations = 1, double tolerance = 0.);
+
+  ReducedShearSolver(const ReducedShearSolver&) = delete;
+  ReducedShearSolver& operator=(const ReducedShearSolver&) = delete;
+
+  /**
+   * @brief Performs the iterations
+   * @param[in] massMappingStage the stage computing the convergence map of a shear map
+   * @return true if all the convergence maps could be computed, false otherwise
+   *
+   * The iterations restart from the original shear map. The final convergence map is
+   * the one of the mass mapping stage, computed from the final corrected shear map
+   *
+   */
+  bool solve(MassMappingStage &massMappingStage);
+
+  /**
+   * @brief Updates the current convergence and returns its largest change
+   * @param[in] convMap the new convergence map, of the same size as the shear map
+   * @return the largest absolute change of the E mode convergence, -1 if the sizes differ
+   */
+  double updateConvergence(const ConvergenceMap &convMap);
+
+  /**
+   * @brief Computes the corrected shear map from the original one and the current convergence
+   *
+   * The two shear plans of the corrected map are set to g/(1-kappa), the other plans are
+   * the ones of the original map
+   *
+   */
+  void correctShear();
+
+  /**
+   * @brief Returns the original shear map
+   */
+  const ShearMap& getOriginalShearMap() const;
+
+  /**
+   * @brief Returns the corrected shear map
+   */
+  ShearMap& getCorrectedShearMap();
+
+  /**
+   * @brief Returns the number of convergence map computations of the last solve
+   */
+  unsigned int getNbIterations() const;
+
+  /**
+   * @brief Returns the largest change of the convergence at the last iteration
+   */
+  double getLastChange() const;
+
+private:
+
+  ShearMap m_originalShearMap;
+  ShearMap m_correctedShearMap;
+
+  // E mode convergence of the last iteration, the pixel (i, j) being at index i*sizeY + j
+  std::vector<double> m_kappa;
+
+  unsigned int m_maxIterations;
+  double m_tolerance;
+
+  unsigned int m_nbIterations;
+  double m_lastChange;
+
+}; /* End of ReducedShearSolver class */
+
+} /* namespace TWOD_MASS_WL_MassMapping */
+
+
+#endif
@@ -88,6 +88,25 @@ public:
    */
   ShearMap(std::string filename);
 
+  /**
+   * @brief Constructor of a ShearMap from a pixel cutout of a FITS file
+   * @see GlobalMap(std::string, unsigned int, unsigned int, unsigned int, unsigned int)
+   */
+  ShearMap(std::string filename, unsigned int offsetX, unsigned int offsetY,
+     unsigned int sizeX, unsigned int sizeY);
+
+  /**
+   * @brief Constructor of a ShearMap from a sky cutout of a FITS file
+   * @see GlobalMap(std::string, const Boundaries&)
+   */
+  ShearMap(std::string filename, const Boundaries &skyCutout);
+
+  /**
+   * @brief Constructor of a ShearMap from a named extension of a product file
+   * @see GlobalMap(std::string, std::string)
+   */
+  ShearMap(std::string filename, std::string extName);
+
   /**
     * @brief Returns a ConvergenceMap using K&S algorithm
     * @return a ConvergenceMap corresponding to the input ShearMap
@@ -105,7 +124,7 @@ public:
     * provided convergence map
     *
     */
-  void computeReducedShear(ConvergenceMap inputConvMap);
+  void computeReducedShear(const ConvergenceMap &inputConvMap);
 
 private:
 
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/BlockPrefetcher.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/BlockPrefetcher.h"
+
+namespace TWOD_MASS_WL_MassMapping {
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+  stop();
+}
+
+BlockPrefetcher::BlockPrefetcher(unsigned int nbPrefetched, bool useThread):
+m_buffers(useThread ? nbPrefetched+1 : 1), m_useThread(useThread), m_nextBlock(0),
+m_currentBuffer(nullptr), m_readDone(true), m_failed(false), m_stopped(false)
+{
+}
+
+void BlockPrefetcher::start(const std::vector<std::pair<long, long> > &blocks, const BlockReader &readBlock)
+{
+  stop();
+
+  m_blocks = blocks;
+  m_readBlock = readBlock;
+  m_freeBuffers.clear();
+  m_readBuffers.clear();
+  for (auto &buffer : m_buffers)
+  {
+    m_freeBuffers.push_back(&buffer);
+  }
+  m_currentBuffer = nullptr;
+  m_readDone = false;
+  m_failed = false;
+  m_stopped = false;
+  m_nextBlock = 0;
+
+  if (m_useThread)
+  {
+    m_thread = std::thread(&BlockPrefetcher::readBlocks, this);
+  }
+}
+
+const PrefetchBlock* BlockPrefetcher::nextBlock()
+{
+  // Without I/O thread the block is read now, in the same buffer as the previous one
+  if (m_useThread==false)
+  {
+    if (m_failed || m_nextBlock>=m_blocks.size())
+    {
+      return nullptr;
+    }
+    PrefetchBlock &buffer = m_buffers.front();
+    buffer.m_firstRow = m_blocks[m_nextBlock].first;
+    buffer.m_nbRows = m_blocks[m_nextBlock].second;
+    m_nextBlock++;
+    try
+    {
+      m_failed = (m_readBlock(buffer)==false);
+    }
+    catch (...)
+    {
+      m_failed = true;
+    }
+    return m_failed ? nullptr : &buffer;
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  // The block processed so far can be read again
+  if (m_currentBuffer!=nullptr)
+  {
+    m_freeBuffers.push_back(m_currentBuffer);
+    m_currentBuffer = nullptr;
+    m_condition.notify_all();
+  }
+
+  m_condition.wait(lock, [this]{ return m_readBuffers.empty()==false || m_readDone; });
+  if (m_failed || m_readBuffers.empty())
+  {
+    return nullptr;
+  }
+  m_currentBuffer = m_readBuffers.front();
+  m_readBuffers.pop_front();
+
+  return m_currentBuffer;
+}
+
+bool BlockPrefetcher::hasFailed() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_failed;
+}
+
+void BlockPrefetcher::readBlocks()
+{
+  for (auto &block : m_blocks)
+  {
+    // Wait for a free buffer
+    PrefetchBlock *buffer(nullptr);
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(lock, [this]{ return m_freeBuffers.empty()==false || m_stopped; });
+      if (m_stopped)
+      {
+        break;
+      }
+      buffer = m_freeBuffers.front();
+      m_freeBuffers.pop_front();
+    }
+
+    // The block is read without holding the lock, while the caller processes the previous ones
+    buffer->m_firstRow = block.first;
+    buffer->m_nbRows = block.second;
+    bool readOK(false);
+    try
+    {
+      readOK = m_readBlock(*buffer);
+    }
+    catch (...)
+    {
+      readOK = false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (readOK==false)
+    {
+      m_failed = true;
+      break;
+    }
+    m_readBuffers.push_back(buffer);
+    m_condition.notify_all();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_readDone = true;
+  m_condition.notify_all();
+}
+
+void BlockPrefetcher::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    m_condition.notify_all();
+  }
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
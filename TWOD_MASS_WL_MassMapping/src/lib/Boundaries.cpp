@@ -27,7 +27,8 @@
 namespace TWOD_MASS_WL_MassMapping {
 
 Boundaries::Boundaries(double raMin, double raMax, double decMin, double decMax, double zMin, double zMax):
-m_raMin(raMin), m_raMax(raMax), m_decMin(decMin), m_decMax(decMax), m_zMin(zMin), m_zMax(zMax)
+m_raMin(raMin), m_raMax(raMax), m_decMin(decMin), m_decMax(decMax), m_zMin(zMin), m_zMax(zMax),
+m_raTangent(0.5*(raMin + raMax)), m_decTangent(0.5*(decMin + decMax))
 {
 }
 
@@ -61,4 +62,20 @@ double Boundaries::getZMax() const
   return m_zMax;
 }
 
+void Boundaries::setTangentPoint(double ra, double dec)
+{
+  m_raTangent = ra;
+  m_decTangent = dec;
+}
+
+double Boundaries::getRaTangent() const
+{
+  return m_raTangent;
+}
+
+double Boundaries::getDecTangent() const
+{
+  return m_decTangent;
+}
+
 } // TWOD_MASS_WL_MassMapping namespace
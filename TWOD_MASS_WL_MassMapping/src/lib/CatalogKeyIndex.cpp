@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/CatalogKeyIndex.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+namespace {
+// Names of the columns of a saved index
+const std::vector<std::string> keyIndexColumnNames = {"cell", "firstRow", "nbRows", "raMin", "raMax",
+                                                      "decMin", "decMax", "zMin", "zMax"};
+
+// Names of the columns of the index of some catalog columns
+std::vector<std::string> getSidecarColumnNames(const std::vector<std::string> &columnNames)
+{
+  std::vector<std::string> names = keyIndexColumnNames;
+  for (unsigned int c=3; c<names.size(); c++)
+  {
+    names[c] += ":" + columnNames[(c-3)/2];
+  }
+  return names;
+}
+
+// Highest order of the keys, for the keys to be exact as doubles in the saved index
+const unsigned int maxKeyOrder = 24;
+
+// Tells if a file was modified before another one
+bool isOlder(const struct stat &fileStatus, const struct stat &otherStatus)
+{
+  return fileStatus.st_mtim.tv_sec<otherStatus.st_mtim.tv_sec
+      || (fileStatus.st_mtim.tv_sec==otherStatus.st_mtim.tv_sec
+          && fileStatus.st_mtim.tv_nsec<otherStatus.st_mtim.tv_nsec);
+}
+
+// Spreads the bits of a value of 32 bits over the even bits of a value of 64 bits
+unsigned long spreadBits(unsigned long value)
+{
+  value &= 0xffffffffUL;
+  value = (value | (value<<16)) & 0x0000ffff0000ffffUL;
+  value = (value | (value<<8)) & 0x00ff00ff00ff00ffUL;
+  value = (value | (value<<4)) & 0x0f0f0f0f0f0f0f0fUL;
+  value = (value | (value<<2)) & 0x3333333333333333UL;
+  value = (value | (value<<1)) & 0x5555555555555555UL;
+  return value;
+}
+
+// Returns the index of a position in a cell of n values over [0, 1)
+long getCellIndex(double position, long n)
+{
+  return std::min(std::max(long(position*n), 0l), n-1);
+}
+} // anonymous namespace
+
+CatalogKeyIndex::CatalogKeyIndex(spatialKey keyType, unsigned int order, unsigned int indexOrder):
+m_keyType(keyType), m_order(std::min(order, maxKeyOrder)), m_indexOrder(std::min(indexOrder, m_order)), m_nbRows(0),
+m_columnNames({"ra", "dec", "z"})
+{
+}
+
+std::string CatalogKeyIndex::getSidecarFilename(const std::string &catalogFilename)
+{
+  return catalogFilename + ".keyindex";
+}
+
+unsigned long CatalogKeyIndex::getNbKeys(spatialKey keyType, unsigned int order)
+{
+  return (keyType==nestedPixelKey ? 12UL : 1UL) << (2*order);
+}
+
+unsigned long CatalogKeyIndex::getKey(spatialKey keyType, unsigned int order, double ra, double dec)
+{
+  if (std::isnan(ra) || std::isnan(dec))
+  {
+    return getNbKeys(keyType, order);
+  }
+  long nside = 1l << order;
+  double phi = std::fmod(ra, 360.);
+  if (phi<0.)
+  {
+    phi += 360.;
+  }
+
+  // Morton curve over the plate carree projection
+  if (keyType==mortonKey)
+  {
+    long ix = getCellIndex(phi/360., nside);
+    long iy = getCellIndex((dec+90.)/180., nside);
+    return spreadBits(ix) | (spreadBits(iy)<<1);
+  }
+
+  // Nested HEALPix pixel, the face being found from the equatorial or polar region of the position
+  double z = std::sin(std::min(std::max(dec, -90.), 90.)*M_PI/180.);
+  double za = std::fabs(z);
+  double tt = std::min(phi/90., std::nextafter(4., 0.));
+  long face, ix, iy;
+  if (za<=2./3.)
+  {
+    double temp1 = nside*(0.5+tt);
+    double temp2 = nside*z*0.75;
+    long jp = long(temp1-temp2);
+    long jm = long(temp1+temp2);
+    long ifp = jp >> order;
+    long ifm = jm >> order;
+    face = (ifp==ifm) ? (ifp|4) : ((ifp<ifm) ? ifp : (ifm+8));
+    ix = jm & (nside-1);
+    iy = nside - (jp & (nside-1)) - 1;
+  }
+  else
+  {
+    long ntt = std::min(long(tt), 3l);
+    double tp = tt-ntt;
+    double tmp = nside*std::sqrt(3.*(1.-za));
+    long jp = std::min(long(tp*tmp), nside-1);
+    long jm = std::min(long((1.-tp)*tmp), nside-1);
+    if (z>=0.)
+    {
+      face = ntt;
+      ix = nside-jm-1;
+      iy = nside-jp-1;
+    }
+    else
+    {
+      face = ntt+8;
+      ix = jp;
+      iy = jm;
+    }
+  }
+
+  return (static_cast<unsigned long>(face) << (2*order)) + spreadBits(ix) + (spreadBits(iy)<<1);
+}
+
+void CatalogKeyIndex::mergeRowRanges(std::vector<std::pair<unsigned long, unsigned long> > &rowRanges)
+{
+  std::sort(rowRanges.begin(), rowRanges.end());
+  std::vector<std::pair<unsigned long, unsigned long> > merged;
+  for (auto &range : rowRanges)
+  {
+    if (range.second==0)
+    {
+      continue;
+    }
+    if (merged.empty()==false && merged.back().first+merged.back().second>=range.first)
+    {
+      merged.back().second = std::max(merged.back().first+merged.back().second,
+                                      range.first+range.second) - merged.back().first;
+    }
+    else
+    {
+      merged.push_back(range);
+    }
+  }
+  rowRanges.swap(merged);
+}
+
+std::vector<std::pair<long, long> >
+  CatalogKeyIndex::splitRowRanges(const std::vector<std::pair<unsigned long, unsigned long> > &rowRanges,
+                                  long blockRows)
+{
+  std::vector<std::pair<long, long> > chunkRows;
+  blockRows = std::max(blockRows, 1l);
+  for (auto &range : rowRanges)
+  {
+    long lastRow = range.first + range.second;
+    for (long firstRow = range.first; firstRow<lastRow; )
+    {
+      long nbRows = std::min((firstRow/blockRows + 1)*blockRows, lastRow) - firstRow;
+      chunkRows.push_back(std::make_pair(firstRow, nbRows));
+      firstRow += nbRows;
+    }
+  }
+  return chunkRows;
+}
+
+void CatalogKeyIndex::setColumnNames(const std::string &raName, const std::string &decName, const std::string &zName)
+{
+  m_columnNames = {raName, decName, zName};
+}
+
+const std::vector<std::string>& CatalogKeyIndex::getColumnNames() const
+{
+  return m_columnNames;
+}
+
+spatialKey CatalogKeyIndex::getKeyType() const
+{
+  return m_keyType;
+}
+
+unsigned int CatalogKeyIndex::getOrder() const
+{
+  return m_order;
+}
+
+unsigned int CatalogKeyIndex::getIndexOrder() const
+{
+  return m_indexOrder;
+}
+
+void CatalogKeyIndex::clear()
+{
+  m_nbRows = 0;
+  m_cells.clear();
+  m_firstRows.clear();
+  m_cellRows.clear();
+  m_ranges.clear();
+}
+
+void CatalogKeyIndex::addRows(unsigned long nbRows, const unsigned long *keys, const double *ra,
+                              const double *dec, const double *z)
+{
+  const double *coordinates[3] = {ra, dec, z};
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  unsigned int shift = 2*(m_order-m_indexOrder);
+  for (unsigned long i=0; i<nbRows; i++)
+  {
+    // A new cell starts with the values of its first row
+    unsigned long cell = keys[i] >> shift;
+    if (m_cells.empty() || cell!=m_cells.back())
+    {
+      m_cells.push_back(cell);
+      m_firstRows.push_back(m_nbRows+i);
+      m_cellRows.push_back(1);
+      for (unsigned int c=0; c<3; c++)
+      {
+        double value = coordinates[c]!=nullptr ? coordinates[c][i] : nan;
+        m_ranges.push_back(value);
+        m_ranges.push_back(value);
+      }
+      continue;
+    }
+
+    // A NaN value makes the range unknown for the rest of the cell
+    m_cellRows.back()++;
+    double *cellRanges = &m_ranges[m_ranges.size()-6];
+    for (unsigned int c=0; c<3; c++)
+    {
+      if (coordinates[c]==nullptr || std::isnan(cellRanges[2*c]))
+      {
+        continue;
+      }
+      double value = coordinates[c][i];
+      if (std::isnan(value))
+      {
+        cellRanges[2*c] = value;
+        cellRanges[2*c+1] = value;
+      }
+      else
+      {
+        cellRanges[2*c] = std::min(cellRanges[2*c], value);
+        cellRanges[2*c+1] = std::max(cellRanges[2*c+1], value);
+      }
+    }
+  }
+  m_nbRows += nbRows;
+}
+
+bool CatalogKeyIndex::load(const std::string &catalogFilename)
+{
+  clear();
+
+  // The index must not be older than the last change of the catalog
+  std::string sidecarFilename = getSidecarFilename(catalogFilename);
+  struct stat catalogStatus, sidecarStatus;
+  if (stat(catalogFilename.c_str(), &catalogStatus)!=0 || stat(sidecarFilename.c_str(), &sidecarStatus)!=0
+      || isOlder(sidecarStatus, catalogStatus))
+  {
+    return false;
+  }
+
+  ColumnarCatalog sidecar(sidecarFilename);
+  std::vector<const double*> columns;
+  for (auto &name : getSidecarColumnNames(m_columnNames))
+  {
+    columns.push_back(sidecar.getColumn(name));
+    if (columns.back()==nullptr)
+    {
+      return false;
+    }
+  }
+
+  // The flags hold the curve and the orders
+  unsigned int flags = sidecar.getFlags();
+  m_keyType = (flags & 0xff)==mortonKey ? mortonKey : nestedPixelKey;
+  m_order = std::min((flags>>8) & 0xff, maxKeyOrder);
+  m_indexOrder = std::min((flags>>16) & 0xff, m_order);
+
+  // The cells follow each other in the order of the keys
+  unsigned long nbCells = sidecar.getNbRows();
+  for (unsigned long cell=0; cell<nbCells; cell++)
+  {
+    unsigned long cellIndex = columns[0][cell];
+    unsigned long firstRow = columns[1][cell];
+    unsigned long nbRows = columns[2][cell];
+    if (nbRows==0 || firstRow!=m_nbRows || (m_cells.empty()==false && cellIndex<=m_cells.back()))
+    {
+      clear();
+      return false;
+    }
+    m_cells.push_back(cellIndex);
+    m_firstRows.push_back(firstRow);
+    m_cellRows.push_back(nbRows);
+    m_nbRows += nbRows;
+    for (unsigned int c=3; c<columns.size(); c++)
+    {
+      m_ranges.push_back(columns[c][cell]);
+    }
+  }
+
+  return true;
+}
+
+bool CatalogKeyIndex::save(const std::string &catalogFilename) const
+{
+  // Gather the values of the columns of the index
+  unsigned long nbCells = getNbCells();
+  std::vector<std::vector<double> > values(keyIndexColumnNames.size(), std::vector<double>(nbCells));
+  for (unsigned long cell=0; cell<nbCells; cell++)
+  {
+    values[0][cell] = m_cells[cell];
+    values[1][cell] = m_firstRows[cell];
+    values[2][cell] = m_cellRows[cell];
+    for (unsigned int c=3; c<values.size(); c++)
+    {
+      values[c][cell] = m_ranges[6*cell + c-3];
+    }
+  }
+  std::vector<const double*> columns;
+  for (auto &column : values)
+  {
+    columns.push_back(column.data());
+  }
+
+  // The index is written under a temporary name and then renamed, so that a reader never
+  // sees a partial index
+  std::string sidecarFilename = getSidecarFilename(catalogFilename);
+  std::string tmpFilename = sidecarFilename + ".tmp" + std::to_string(getpid());
+  unsigned int flags = m_keyType | (m_order<<8) | (m_indexOrder<<16);
+  ColumnarCatalogWriter writer(tmpFilename, getSidecarColumnNames(m_columnNames), 65536, flags);
+  if (writer.appendRows(columns, nbCells)==false || writer.close()==false)
+  {
+    std::remove(tmpFilename.c_str());
+    return false;
+  }
+
+  return std::rename(tmpFilename.c_str(), sidecarFilename.c_str())==0;
+}
+
+unsigned long CatalogKeyIndex::getNbRows() const
+{
+  return m_nbRows;
+}
+
+unsigned long CatalogKeyIndex::getNbCells() const
+{
+  return m_cells.size();
+}
+
+std::vector<std::pair<unsigned long, unsigned long> >
+  CatalogKeyIndex::getRowRanges(double raMin, double raMax, double decMin, double decMax,
+                                double zMin, double zMax) const
+{
+  std::vector<std::pair<unsigned long, unsigned long> > rowRanges;
+  const double selection[6] = {raMin, raMax, decMin, decMax, zMin, zMax};
+  for (unsigned long cell=0; cell<getNbCells(); cell++)
+  {
+    // An unknown range never excludes the cell
+    bool overlap = true;
+    for (unsigned int c=0; c<3; c++)
+    {
+      double cellMin = m_ranges[6*cell + 2*c];
+      double cellMax = m_ranges[6*cell + 2*c + 1];
+      if (cellMax<selection[2*c] || cellMin>selection[2*c+1])
+      {
+        overlap = false;
+      }
+    }
+    if (overlap==false)
+    {
+      continue;
+    }
+
+    // The cells following each other make a single range
+    if (rowRanges.empty()==false && rowRanges.back().first+rowRanges.back().second==m_firstRows[cell])
+    {
+      rowRanges.back().second += m_cellRows[cell];
+    }
+    else
+    {
+      rowRanges.push_back(std::make_pair(m_firstRows[cell], m_cellRows[cell]));
+    }
+  }
+
+  return rowRanges;
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/CatalogZoneMap.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+namespace {
+// Names of the columns of a saved index, the range columns being followed by the name of the catalog
+// column they index, e.g. "raMin:RA"
+const std::vector<std::string> zoneColumnNames = {"nbRows", "raMin", "raMax", "decMin", "decMax", "zMin", "zMax"};
+
+// Names of the columns of the index of some catalog columns
+std::vector<std::string> getSidecarColumnNames(const std::vector<std::string> &columnNames)
+{
+  std::vector<std::string> names = zoneColumnNames;
+  for (unsigned int c=1; c<names.size(); c++)
+  {
+    names[c] += ":" + columnNames[(c-1)/2];
+  }
+  return names;
+}
+
+// Tells if a file was modified before another one
+bool isOlder(const struct stat &fileStatus, const struct stat &otherStatus)
+{
+  return fileStatus.st_mtim.tv_sec<otherStatus.st_mtim.tv_sec
+      || (fileStatus.st_mtim.tv_sec==otherStatus.st_mtim.tv_sec
+          && fileStatus.st_mtim.tv_nsec<otherStatus.st_mtim.tv_nsec);
+}
+} // anonymous namespace
+
+CatalogZoneMap::CatalogZoneMap(unsigned long zoneRows): m_zoneRows(zoneRows>0 ? zoneRows : 1), m_nbRows(0),
+m_columnNames({"ra", "dec", "z"})
+{
+}
+
+std::string CatalogZoneMap::getSidecarFilename(const std::string &catalogFilename)
+{
+  return catalogFilename + ".zonemap";
+}
+
+void CatalogZoneMap::setColumnNames(const std::string &raName, const std::string &decName, const std::string &zName)
+{
+  m_columnNames = {raName, decName, zName};
+}
+
+const std::vector<std::string>& CatalogZoneMap::getColumnNames() const
+{
+  return m_columnNames;
+}
+
+void CatalogZoneMap::clear()
+{
+  m_nbRows = 0;
+  m_ranges.clear();
+}
+
+void CatalogZoneMap::addRows(unsigned long nbRows, const double *ra, const double *dec, const double *z)
+{
+  const double *coordinates[3] = {ra, dec, z};
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  for (unsigned long i=0; i<nbRows; i++)
+  {
+    // A new zone starts with the values of its first row
+    if ((m_nbRows+i)%m_zoneRows==0)
+    {
+      for (unsigned int c=0; c<3; c++)
+      {
+        double value = coordinates[c]!=nullptr ? coordinates[c][i] : nan;
+        m_ranges.push_back(value);
+        m_ranges.push_back(value);
+      }
+      continue;
+    }
+
+    // A NaN value makes the range unknown for the rest of the zone
+    double *zoneRanges = &m_ranges[m_ranges.size()-6];
+    for (unsigned int c=0; c<3; c++)
+    {
+      if (coordinates[c]==nullptr || std::isnan(zoneRanges[2*c]))
+      {
+        continue;
+      }
+      double value = coordinates[c][i];
+      if (std::isnan(value))
+      {
+        zoneRanges[2*c] = value;
+        zoneRanges[2*c+1] = value;
+      }
+      else
+      {
+        zoneRanges[2*c] = std::min(zoneRanges[2*c], value);
+        zoneRanges[2*c+1] = std::max(zoneRanges[2*c+1], value);
+      }
+    }
+  }
+  m_nbRows += nbRows;
+}
+
+bool CatalogZoneMap::setFromColumnarCatalog(const ColumnarCatalog &catalog)
+{
+  clear();
+  if (catalog.isValid()==false || catalog.getColumn("ra")==nullptr || catalog.getColumn("dec")==nullptr)
+  {
+    return false;
+  }
+
+  // The blocks of the catalog are the zones, a missing z column giving unknown ranges
+  m_columnNames = {"ra", "dec", "z"};
+  m_zoneRows = catalog.getBlockRows();
+  m_nbRows = catalog.getNbRows();
+  for (unsigned long block=0; block<catalog.getNbBlocks(); block++)
+  {
+    for (std::string name : {"ra", "dec", "z"})
+    {
+      m_ranges.push_back(catalog.getBlockMin(name, block));
+      m_ranges.push_back(catalog.getBlockMax(name, block));
+    }
+  }
+
+  return true;
+}
+
+bool CatalogZoneMap::load(const std::string &catalogFilename)
+{
+  clear();
+
+  // The index must not be older than the last change of the catalog
+  std::string sidecarFilename = getSidecarFilename(catalogFilename);
+  struct stat catalogStatus, sidecarStatus;
+  if (stat(catalogFilename.c_str(), &catalogStatus)!=0 || stat(sidecarFilename.c_str(), &sidecarStatus)!=0
+      || isOlder(sidecarStatus, catalogStatus))
+  {
+    return false;
+  }
+
+  // An index of other catalog columns, e.g. of a reader picking another column as z, is not loaded
+  ColumnarCatalog sidecar(sidecarFilename);
+  std::vector<const double*> columns;
+  for (auto &name : getSidecarColumnNames(m_columnNames))
+  {
+    columns.push_back(sidecar.getColumn(name));
+    if (columns.back()==nullptr)
+    {
+      return false;
+    }
+  }
+
+  // All the zones but the last one are full
+  unsigned long zoneRows = sidecar.getFlags();
+  unsigned long nbZones = sidecar.getNbRows();
+  for (unsigned long zone=0; zone<nbZones; zone++)
+  {
+    unsigned long nbRows = columns[0][zone];
+    if (zoneRows==0 || nbRows==0 || nbRows>zoneRows || (zone+1<nbZones && nbRows!=zoneRows))
+    {
+      clear();
+      return false;
+    }
+    m_nbRows += nbRows;
+    for (unsigned int c=1; c<columns.size(); c++)
+    {
+      m_ranges.push_back(columns[c][zone]);
+    }
+  }
+  m_zoneRows = zoneRows;
+
+  return true;
+}
+
+bool CatalogZoneMap::save(const std::string &catalogFilename) const
+{
+  // Gather the values of the columns of the index
+  unsigned long nbZones = getNbZones();
+  std::vector<std::vector<double> > values(zoneColumnNames.size(), std::vector<double>(nbZones));
+  for (unsigned long zone=0; zone<nbZones; zone++)
+  {
+    values[0][zone] = std::min(m_zoneRows, m_nbRows-zone*m_zoneRows);
+    for (unsigned int c=1; c<values.size(); c++)
+    {
+      values[c][zone] = m_ranges[6*zone + c-1];
+    }
+  }
+  std::vector<const double*> columns;
+  for (auto &column : values)
+  {
+    columns.push_back(column.data());
+  }
+
+  // The index is written under a temporary name and then renamed, so that a reader never
+  // sees a partial index
+  std::string sidecarFilename = getSidecarFilename(catalogFilename);
+  std::string tmpFilename = sidecarFilename + ".tmp" + std::to_string(getpid());
+  ColumnarCatalogWriter writer(tmpFilename, getSidecarColumnNames(m_columnNames), 65536, m_zoneRows);
+  if (writer.appendRows(columns, nbZones)==false || writer.close()==false)
+  {
+    std::remove(tmpFilename.c_str());
+    return false;
+  }
+
+  return std::rename(tmpFilename.c_str(), sidecarFilename.c_str())==0;
+}
+
+unsigned long CatalogZoneMap::getNbRows() const
+{
+  return m_nbRows;
+}
+
+unsigned long CatalogZoneMap::getZoneRows() const
+{
+  return m_zoneRows;
+}
+
+unsigned long CatalogZoneMap::getNbZones() const
+{
+  return m_ranges.size()/6;
+}
+
+double CatalogZoneMap::getMin(unsigned long zone, zoneCoordinate coordinate) const
+{
+  if (zone>=getNbZones())
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return m_ranges[6*zone + 2*coordinate];
+}
+
+double CatalogZoneMap::getMax(unsigned long zone, zoneCoordinate coordinate) const
+{
+  if (zone>=getNbZones())
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return m_ranges[6*zone + 2*coordinate + 1];
+}
+
+bool CatalogZoneMap::mayOverlap(unsigned long firstRow, unsigned long nbRows, double raMin, double raMax,
+                                double decMin, double decMax, double zMin, double zMax) const
+{
+  if (nbRows==0)
+  {
+    return false;
+  }
+
+  // Rows which are not indexed may always overlap
+  unsigned long firstZone = firstRow/m_zoneRows;
+  unsigned long lastZone = (firstRow+nbRows-1)/m_zoneRows;
+  if (lastZone>=getNbZones())
+  {
+    return true;
+  }
+
+  const double selection[6] = {raMin, raMax, decMin, decMax, zMin, zMax};
+  for (unsigned long zone=firstZone; zone<=lastZone; zone++)
+  {
+    // An unknown range never excludes the zone
+    bool overlap = true;
+    for (unsigned int c=0; c<3; c++)
+    {
+      double zoneMin = m_ranges[6*zone + 2*c];
+      double zoneMax = m_ranges[6*zone + 2*c + 1];
+      if (zoneMax<selection[2*c] || zoneMin>selection[2*c+1])
+      {
+        overlap = false;
+      }
+    }
+    if (overlap)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
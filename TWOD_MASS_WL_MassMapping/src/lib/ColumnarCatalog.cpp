@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/ColumnarCatalog.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+namespace {
+
+// Magic, version and byte order mark of the columnar format
+const char columnarMagic[8] = {'2', 'D', 'M', 'W', 'L', 'C', 'O', 'L'};
+const uint32_t columnarVersion = 1;
+const uint32_t byteOrderMark = 0x01020304;
+
+// Sizes in bytes of the header, of the description of a column and of its name
+const unsigned long headerSize = 40;
+const unsigned long columnEntrySize = 40;
+const unsigned long columnNameSize = 32;
+
+// Tells if the host stores the values in little endian, as the columnar format
+bool isLittleEndianHost()
+{
+  uint32_t mark = byteOrderMark;
+  unsigned char firstByte;
+  std::memcpy(&firstByte, &mark, 1);
+  return firstByte==0x04;
+}
+
+// Name of the temporary file of a column
+std::string columnFilename(const std::string &filename, unsigned int column)
+{
+  return filename + ".col" + std::to_string(column);
+}
+
+} // anonymous namespace
+
+ColumnarCatalog::~ColumnarCatalog()
+{
+  if (m_mappedFile!=nullptr)
+  {
+    munmap(m_mappedFile, m_mappedSize);
+    m_mappedFile = nullptr;
+  }
+}
+
+ColumnarCatalog::ColumnarCatalog(std::string filename):
+m_mappedFile(nullptr), m_mappedSize(0), m_nbRows(0), m_blockRows(1), m_flags(0)
+{
+  int fileDescriptor = open(filename.c_str(), O_RDONLY);
+  if (fileDescriptor<0)
+  {
+    std::cout<<filename<<": can not open this file"<<std::endl;
+    return;
+  }
+
+  struct stat fileStatus;
+  if (fstat(fileDescriptor, &fileStatus)==0 && fileStatus.st_size>0)
+  {
+    m_mappedSize = fileStatus.st_size;
+    void *mapped = mmap(nullptr, m_mappedSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    m_mappedFile = (mapped==MAP_FAILED) ? nullptr : static_cast<unsigned char*>(mapped);
+  }
+
+  // The mapping stays valid once the file is closed
+  close(fileDescriptor);
+
+  if (m_mappedFile==nullptr)
+  {
+    std::cout<<filename<<": can not map this file"<<std::endl;
+    return;
+  }
+
+  // Read the header, the values being used in place only on little endian hosts
+  uint32_t byteOrder(0), version(0), nbColumns(0), flags(0);
+  uint64_t nbRows(0), blockRows(0);
+  bool valid = isLittleEndianHost() && m_mappedSize>=headerSize
+               && std::memcmp(m_mappedFile, columnarMagic, sizeof(columnarMagic))==0;
+  if (valid)
+  {
+    std::memcpy(&byteOrder, m_mappedFile + 8, 4);
+    std::memcpy(&version, m_mappedFile + 12, 4);
+    std::memcpy(&nbRows, m_mappedFile + 16, 8);
+    std::memcpy(&blockRows, m_mappedFile + 24, 8);
+    std::memcpy(&nbColumns, m_mappedFile + 32, 4);
+    std::memcpy(&flags, m_mappedFile + 36, 4);
+  }
+  valid = valid && byteOrder==byteOrderMark && version==columnarVersion && blockRows>0;
+
+  // Check the columns and their block ranges are in the file
+  unsigned long nbBlocks = valid ? (nbRows + blockRows - 1)/blockRows : 0;
+  unsigned long rangesOffset = headerSize + nbColumns*columnEntrySize;
+  valid = valid && rangesOffset + nbColumns*nbBlocks*2*sizeof(double) <= m_mappedSize;
+  for (unsigned int c=0; valid && c<nbColumns; c++)
+  {
+    const unsigned char *entry = m_mappedFile + headerSize + c*columnEntrySize;
+    uint64_t offset;
+    std::memcpy(&offset, entry + columnNameSize, 8);
+    valid = offset%sizeof(double)==0 && offset + nbRows*sizeof(double) <= m_mappedSize;
+    if (valid)
+    {
+      const char *name = reinterpret_cast<const char*>(entry);
+      m_columnNames.push_back(std::string(name, strnlen(name, columnNameSize)));
+      m_columns.push_back(reinterpret_cast<const double*>(m_mappedFile + offset));
+      m_blockRanges.push_back(reinterpret_cast<const double*>(m_mappedFile + rangesOffset
+                                                              + c*nbBlocks*2*sizeof(double)));
+    }
+  }
+
+  if (valid==false)
+  {
+    std::cout<<filename<<": not a columnar catalog, can not be mapped"<<std::endl;
+    munmap(m_mappedFile, m_mappedSize);
+    m_mappedFile = nullptr;
+    m_columnNames.clear();
+    m_columns.clear();
+    m_blockRanges.clear();
+    return;
+  }
+
+  m_nbRows = nbRows;
+  m_blockRows = blockRows;
+  m_flags = flags;
+
+  // The columns are read in order
+  posix_madvise(m_mappedFile, m_mappedSize, POSIX_MADV_SEQUENTIAL);
+}
+
+bool ColumnarCatalog::isColumnarCatalog(std::string filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  char magic[sizeof(columnarMagic)];
+  file.read(magic, sizeof(magic));
+  if (file.good()==false)
+  {
+    return false;
+  }
+  return std::memcmp(magic, columnarMagic, sizeof(columnarMagic))==0;
+}
+
+bool ColumnarCatalog::isValid() const
+{
+  return m_mappedFile!=nullptr;
+}
+
+unsigned long ColumnarCatalog::getNbRows() const
+{
+  return m_nbRows;
+}
+
+unsigned long ColumnarCatalog::getBlockRows() const
+{
+  return m_blockRows;
+}
+
+unsigned long ColumnarCatalog::getNbBlocks() const
+{
+  return (m_nbRows + m_blockRows - 1)/m_blockRows;
+}
+
+unsigned int ColumnarCatalog::getFlags() const
+{
+  return m_flags;
+}
+
+const std::vector<std::string>& ColumnarCatalog::getColumnNames() const
+{
+  return m_columnNames;
+}
+
+const double* ColumnarCatalog::getColumn(const std::string &name) const
+{
+  int column = findColumn(name);
+  return column<0 ? nullptr : m_columns[column];
+}
+
+double ColumnarCatalog::getBlockMin(const std::string &name, unsigned long block) const
+{
+  int column = findColumn(name);
+  if (column<0 || block>=getNbBlocks())
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return m_blockRanges[column][2*block];
+}
+
+double ColumnarCatalog::getBlockMax(const std::string &name, unsigned long block) const
+{
+  int column = findColumn(name);
+  if (column<0 || block>=getNbBlocks())
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return m_blockRanges[column][2*block+1];
+}
+
+int ColumnarCatalog::findColumn(const std::string &name) const
+{
+  for (unsigned int c=0; c<m_columnNames.size(); c++)
+  {
+    if (m_columnNames[c]==name)
+    {
+      return c;
+    }
+  }
+  return -1;
+}
+
+ColumnarCatalogWriter::~ColumnarCatalogWriter()
+{
+  removeColumnFiles();
+}
+
+ColumnarCatalogWriter::ColumnarCatalogWriter(std::string filename, std::vector<std::string> columnNames,
+                                             unsigned long blockRows, unsigned int flags):
+m_filename(filename), m_columnNames(columnNames), m_blockRows(blockRows), m_flags(flags), m_nbRows(0),
+m_writeOK(isLittleEndianHost() && columnNames.empty()==false && blockRows>0),
+m_blockRanges(columnNames.size())
+{
+  for (unsigned int c=0; c<m_columnNames.size(); c++)
+  {
+    if (m_columnNames[c].empty() || m_columnNames[c].size()>=columnNameSize)
+    {
+      std::cout<<"the column name \""<<m_columnNames[c]<<"\" can not be saved in a columnar catalog"<<std::endl;
+      m_writeOK = false;
+    }
+    m_columnFiles.push_back(std::unique_ptr<std::ofstream>(
+        new std::ofstream(columnFilename(m_filename, c), std::ios::binary | std::ios::trunc)));
+    m_writeOK = m_writeOK && m_columnFiles.back()->is_open();
+  }
+}
+
+bool ColumnarCatalogWriter::appendRows(const std::vector<const double*> &columns, unsigned long nbRows)
+{
+  if (m_writeOK==false || columns.size()!=m_columnNames.size())
+  {
+    m_writeOK = false;
+    return false;
+  }
+
+  for (unsigned int c=0; c<columns.size(); c++)
+  {
+    m_columnFiles[c]->write(reinterpret_cast<const char*>(columns[c]), nbRows*sizeof(double));
+
+    // Update the min and max values of the blocks, a new block starting with its first value
+    // and a NaN value making the range of its block unknown
+    std::vector<double> &ranges = m_blockRanges[c];
+    for (unsigned long i=0; i<nbRows; i++)
+    {
+      double value = columns[c][i];
+      if ((m_nbRows+i)%m_blockRows==0)
+      {
+        ranges.push_back(value);
+        ranges.push_back(value);
+      }
+      else
+      {
+        double &blockMin = ranges[ranges.size()-2];
+        double &blockMax = ranges.back();
+        if (std::isnan(value))
+        {
+          blockMin = value;
+          blockMax = value;
+        }
+        else if (std::isnan(blockMin)==false)
+        {
+          blockMin = std::min(blockMin, value);
+          blockMax = std::max(blockMax, value);
+        }
+      }
+    }
+    m_writeOK = m_writeOK && m_columnFiles[c]->good();
+  }
+  m_nbRows += nbRows;
+
+  return m_writeOK;
+}
+
+bool ColumnarCatalogWriter::close()
+{
+  // Complete the temporary files of the columns
+  for (unsigned int c=0; c<m_columnFiles.size(); c++)
+  {
+    m_columnFiles[c]->close();
+    m_writeOK = m_writeOK && m_columnFiles[c]->fail()==false;
+  }
+  if (m_writeOK==false)
+  {
+    removeColumnFiles();
+    return false;
+  }
+
+  std::ofstream catalog(m_filename, std::ios::binary | std::ios::trunc);
+
+  // Write the header
+  uint32_t version(columnarVersion), byteOrder(byteOrderMark), flags(m_flags);
+  uint32_t nbColumns(m_columnNames.size());
+  uint64_t nbRows(m_nbRows), blockRows(m_blockRows);
+  catalog.write(columnarMagic, sizeof(columnarMagic));
+  catalog.write(reinterpret_cast<const char*>(&byteOrder), 4);
+  catalog.write(reinterpret_cast<const char*>(&version), 4);
+  catalog.write(reinterpret_cast<const char*>(&nbRows), 8);
+  catalog.write(reinterpret_cast<const char*>(&blockRows), 8);
+  catalog.write(reinterpret_cast<const char*>(&nbColumns), 4);
+  catalog.write(reinterpret_cast<const char*>(&flags), 4);
+
+  // Write the names and offsets of the columns, the values following the block ranges
+  unsigned long nbBlocks = (m_nbRows + m_blockRows - 1)/m_blockRows;
+  uint64_t offset = headerSize + nbColumns*(columnEntrySize + nbBlocks*2*sizeof(double));
+  for (unsigned int c=0; c<nbColumns; c++)
+  {
+    char name[columnNameSize] = {0};
+    std::memcpy(name, m_columnNames[c].data(), m_columnNames[c].size());
+    catalog.write(name, columnNameSize);
+    catalog.write(reinterpret_cast<const char*>(&offset), 8);
+    offset += m_nbRows*sizeof(double);
+  }
+  for (unsigned int c=0; c<nbColumns; c++)
+  {
+    catalog.write(reinterpret_cast<const char*>(m_blockRanges[c].data()), nbBlocks*2*sizeof(double));
+  }
+
+  // Append the values of the columns
+  for (unsigned int c=0; c<nbColumns && m_nbRows>0; c++)
+  {
+    std::ifstream columnFile(columnFilename(m_filename, c), std::ios::binary);
+    catalog<<columnFile.rdbuf();
+  }
+  catalog.close();
+
+  removeColumnFiles();
+  m_writeOK = false;
+
+  return catalog.fail()==false;
+}
+
+void ColumnarCatalogWriter::removeColumnFiles()
+{
+  for (unsigned int c=0; c<m_columnFiles.size(); c++)
+  {
+    m_columnFiles[c]->close();
+    std::remove(columnFilename(m_filename, c).c_str());
+  }
+  m_columnFiles.clear();
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
@@ -46,41 +46,41 @@ ConvergenceMap::ConvergenceMap(std::string filename):GlobalMap(filename)
 {
 }
 
+ConvergenceMap::ConvergenceMap(std::string filename, unsigned int offsetX, unsigned int offsetY,
+                                unsigned int sizeX, unsigned int sizeY):
+GlobalMap(filename, offsetX, offsetY, sizeX, sizeY)
+{
+}
+
+ConvergenceMap::ConvergenceMap(std::string filename, const Boundaries &skyCutout):GlobalMap(filename, skyCutout)
+{
+}
+
+ConvergenceMap::ConvergenceMap(std::string filename, std::string extName):GlobalMap(filename, extName)
+{
+}
+
 ShearMap ConvergenceMap::getShearMap()
 {
   double fftFactor = 1.0/m_sizeXaxis/m_sizeYaxis;
 
   // Create the complex maps
-  fftw_complex* kappa_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*m_sizeXaxis*m_sizeYaxis);
-  fftw_complex* fft_kappa_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*m_sizeXaxis*m_sizeYaxis);
   fftw_complex* Psi_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
   fftw_complex* gamma_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
   fftw_complex* fft_gamma_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
 
-  // Create the plans for transformation
-  fftw_plan plan_k_forward;
+  // Create the plan for transformation
   fftw_plan plan_g_backward;
 
   #pragma omp critical
   {
-    plan_k_forward = fftw_plan_dft_2d(m_sizeXaxis, m_sizeYaxis, kappa_complex, fft_kappa_complex,
-                                      FFTW_FORWARD,  FFTW_MEASURE);
-    plan_g_backward = fftw_plan_dft_2d(m_sizeXaxis, m_sizeYaxis, fft_gamma_complex, gamma_complex,
+    // The slowest varying index is on the Y axis
+    plan_g_backward = fftw_plan_dft_2d(m_sizeYaxis, m_sizeXaxis, fft_gamma_complex, gamma_complex,
                                        FFTW_BACKWARD,  FFTW_MEASURE);
   }
 
-  // Fill the complex kappa map with convergence map values
-  for (unsigned int i=0; i<m_sizeXaxis; i++)
-  {
-    for (unsigned int j=0; j<m_sizeYaxis; j++)
-    {
-      kappa_complex[j*m_sizeXaxis +i][0] = (*m_mapValues)[i][j][0];
-      kappa_complex[j*m_sizeXaxis +i][1] = (*m_mapValues)[i][j][1];
-    }
-  }
-
-  // Perform the fourier transform of the complex convergence map
-  fftw_execute(plan_k_forward);
+  // Get the fourier transform of the complex convergence map, reused if already cached
+  const fftw_complex* fft_kappa_complex = getFourierTransform();
 
   // Create the P factor
   for (unsigned int i=0; i<m_sizeXaxis; i++)
@@ -127,18 +127,20 @@ ShearMap ConvergenceMap::getShearMap()
 
   ShearMap gammaMap(gammaArray, m_sizeXaxis, m_sizeYaxis, m_sizeZaxis, m_boundaries, m_numberOfGalaxies);
 
+  // The shear map keeps its fourier transform for the next fourier space operation
+  gammaMap.setFourierTransform(fft_gamma_complex);
+
   // free memory
   delete [] gammaArray;
   gammaArray = nullptr;
 
-  fftw_destroy_plan(plan_k_forward);
-  fftw_destroy_plan(plan_g_backward);
+  #pragma omp critical
+  {
+    fftw_destroy_plan(plan_g_backward);
+  }
 
   fftw_free(gamma_complex);
   fftw_free(Psi_complex);
-  fftw_free(kappa_complex);
-  fftw_free(fft_gamma_complex);
-  fftw_free(fft_kappa_complex);
 
   return gammaMap;
 }
@@ -23,26 +23,73 @@
  */
 
 #include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
+#include "TWOD_MASS_WL_MassMapping/MapStatistics.h"
 #include <CCfits/CCfits>
+#include <algorithm>
+#include <cmath>
+#include <utility>
 
 namespace TWOD_MASS_WL_MassMapping {
 
+namespace {
+
+// Right ascension brought to the half turn around a reference one
+double getRaAround(double ra, double raRef)
+{
+  return raRef - 180. + std::fmod(std::fmod(ra - raRef + 180., 360.) + 360., 360.);
+}
+
+// Right ascension range of a sky cutout in the turn of the map boundaries. A cutout
+// with raMin>raMax wraps around ra=0, the part of it overlapping the map is kept
+std::pair<double, double> getCutoutRaRange(const Boundaries &skyCutout, const Boundaries &mapBoundaries)
+{
+  double raCenter = 0.5*(mapBoundaries.getRaMin() + mapBoundaries.getRaMax());
+  double raMin = getRaAround(skyCutout.getRaMin(), raCenter);
+  double raMax = getRaAround(skyCutout.getRaMax(), raCenter);
+
+  // A cutout crossing the opposite of the map center has a part on each side of the map
+  if (raMax<raMin)
+  {
+    bool overlapsAbove = (raMin<mapBoundaries.getRaMax());
+    bool overlapsBelow = (raMax>mapBoundaries.getRaMin());
+    if (overlapsAbove && overlapsBelow)
+    {
+      return std::make_pair(mapBoundaries.getRaMin(), mapBoundaries.getRaMax());
+    }
+    return overlapsAbove ? std::make_pair(raMin, raCenter + 180.) : std::make_pair(raCenter - 180., raMax);
+  }
+  return std::make_pair(raMin, raMax);
+}
+
+} // anonymous namespace
+
+std::atomic<unsigned long> GlobalMap::s_transformsPerformed(0);
+std::atomic<unsigned long> GlobalMap::s_transformsAvoided(0);
+
 GlobalMap::~GlobalMap()
 {
   delete m_mapValues;
   m_mapValues = nullptr;
+
+  invalidateFourierTransform();
 }
 
 GlobalMap::GlobalMap(double* array, unsigned int sizeXaxis, unsigned int sizeYaxis, unsigned int sizeZaxis,
                      unsigned long nGalaxies):
 m_sizeXaxis(sizeXaxis), m_sizeYaxis(sizeYaxis), m_sizeZaxis(sizeZaxis),
-m_numberOfGalaxies(nGalaxies), m_boundaries(0, 0, 0, 0, 0, 0)
+m_fourierValues(nullptr), m_numberOfGalaxies(nGalaxies), m_boundaries(0, 0, 0, 0, 0, 0)
 {
   typedef boost::multi_array<double, 3>::index index;
 
   // Declare the map of data
   m_mapValues = new boost::multi_array<double, 3>(boost::extents[m_sizeXaxis][m_sizeYaxis][m_sizeZaxis]);
 
+  // The map is already filled with zeros if no input array is provided
+  if (array==nullptr)
+  {
+    return;
+  }
+
   // Assign values from the input array to the map
   for (index k = 0; k != m_sizeZaxis; ++k)
   {
@@ -59,13 +106,19 @@ m_numberOfGalaxies(nGalaxies), m_boundaries(0, 0, 0, 0, 0, 0)
 GlobalMap::GlobalMap(double* array, unsigned int sizeXaxis, unsigned int sizeYaxis, unsigned int sizeZaxis,
                      Boundaries &boundaries, unsigned long nGalaxies):
 m_sizeXaxis(sizeXaxis), m_sizeYaxis(sizeYaxis), m_sizeZaxis(sizeZaxis),
-m_numberOfGalaxies(nGalaxies), m_boundaries(boundaries)
+m_fourierValues(nullptr), m_numberOfGalaxies(nGalaxies), m_boundaries(boundaries)
 {
   typedef boost::multi_array<double, 3>::index index;
 
   // Declare the map of data
   m_mapValues = new boost::multi_array<double, 3>(boost::extents[m_sizeXaxis][m_sizeYaxis][m_sizeZaxis]);
 
+  // The map is already filled with zeros if no input array is provided
+  if (array==nullptr)
+  {
+    return;
+  }
+
   // Assign values from the input array to the map
   for (index k = 0; k != m_sizeZaxis; ++k)
   {
@@ -80,87 +133,220 @@ m_numberOfGalaxies(nGalaxies), m_boundaries(boundaries)
 }
 
 
-GlobalMap::GlobalMap(std::string filename): m_numberOfGalaxies(0), m_boundaries(0, 0, 0, 0, 0, 0)
+GlobalMap::GlobalMap(std::string filename): GlobalMap(filename, 0, 0, 0, 0)
 {
-  try
+}
+
+GlobalMap::GlobalMap(std::string filename, unsigned int offsetX, unsigned int offsetY,
+                     unsigned int sizeX, unsigned int sizeY):
+m_sizeXaxis(0), m_sizeYaxis(0), m_sizeZaxis(0), m_mapValues(nullptr),
+m_fourierValues(nullptr), m_numberOfGalaxies(0), m_boundaries(0, 0, 0, 0, 0, 0)
+{
+  if (readFITSimage(filename, offsetX, offsetY, sizeX, sizeY)==false)
   {
-    // Create a FITS pointer
-    std::shared_ptr<CCfits::FITS> pInputFile(new CCfits::FITS(filename, CCfits::Read, true));
+    // no FITS image at this path, keep an empty map
+    std::cout<<filename<<": can not open a FITS image from this file"<<std::endl;
+    m_sizeXaxis = 0;
+    m_sizeYaxis = 0;
+    m_sizeZaxis = 0;
+    delete m_mapValues;
+    m_mapValues = new boost::multi_array<double, 3>(boost::extents[0][0][0]);
+  }
+}
 
-    // Get the image parameters
-    CCfits::PHDU& image = pInputFile->pHDU();
+GlobalMap::GlobalMap(std::string filename, const Boundaries &skyCutout):
+m_sizeXaxis(0), m_sizeYaxis(0), m_sizeZaxis(0), m_mapValues(nullptr),
+m_fourierValues(nullptr), m_numberOfGalaxies(0), m_boundaries(0, 0, 0, 0, 0, 0)
+{
+  if (readFITSimage(filename, 0, 0, 0, 0, &skyCutout)==false)
+  {
+    // no FITS image at this path or no overlap with the cutout, keep an empty map
+    std::cout<<filename<<": can not read this sky area from this file"<<std::endl;
+    m_sizeXaxis = 0;
+    m_sizeYaxis = 0;
+    m_sizeZaxis = 0;
+    delete m_mapValues;
+    m_mapValues = new boost::multi_array<double, 3>(boost::extents[0][0][0]);
+  }
+}
 
-    // Create an array in the right format the get the data
-    std::valarray<double> contents;
+GlobalMap::GlobalMap(std::string filename, std::string extName): GlobalMap(filename + "[" + extName + "]")
+{
+}
 
-    // Read the image content
-    image.readAllKeys();
-    image.read(contents);
+bool GlobalMap::readFITSimage(const std::string &filename, unsigned int offsetX, unsigned int offsetY,
+                              unsigned int sizeX, unsigned int sizeY, const Boundaries *skyCutout)
+{
+  fitsfile *fptr = nullptr;
+  int status = 0;
 
-    // Define the axis dimensions
-    m_sizeXaxis = image.axis(0);
-    m_sizeYaxis = image.axis(1);
-    m_sizeZaxis = image.axis(2);
+  // Open the file in read only mode
+  if (fits_open_file(&fptr, filename.c_str(), READONLY, &status))
+  {
+    return false;
+  }
 
-    // Write the values into the object map
-    typedef boost::multi_array<double, 3> array_type;
-    typedef array_type::index index;
+  // Get the dimensions of the image, a 2D image being read as a single Z plan
+  int bitpix = 0;
+  int naxis = 0;
+  long naxes[3] = {0, 0, 1};
+  fits_get_img_param(fptr, 3, &bitpix, &naxis, naxes, &status);
 
-    m_mapValues = new boost::multi_array<double, 3>(boost::extents[m_sizeXaxis][m_sizeYaxis][m_sizeZaxis]);
+  // A tile compressed image is stored in the first extension after an empty primary HDU
+  if (status==0 && naxis==0)
+  {
+    fits_movabs_hdu(fptr, 2, nullptr, &status);
+    fits_get_img_param(fptr, 3, &bitpix, &naxis, naxes, &status);
+  }
 
-    // Assign values to the elements
-    for (index k = 0; k != m_sizeZaxis; ++k)
+  // An image with an empty axis has no pixel to read
+  if (status || naxis<2 || naxis>3 || naxes[0]<=0 || naxes[1]<=0 || naxes[2]<=0)
+  {
+    int closeStatus = 0;
+    fits_close_file(fptr, &closeStatus);
+    return false;
+  }
+
+  // Only read the keys used by the map, the number of galaxies and the boundaries
+  const char *keyNames[7] = {"nGalaxies", "raMin", "raMax", "decMin", "decMax", "zMin", "zMax"};
+  std::string keyValues[7];
+  for (unsigned int key=0; key<7 && status==0; key++)
+  {
+    char value[FLEN_VALUE];
+    fits_read_key(fptr, TSTRING, keyNames[key], value, nullptr, &status);
+    keyValues[key] = value;
+  }
+
+  // The keys are optional, if one is not found the map has no galaxy number nor boundaries
+  bool hasKeys = (status==0);
+  if (hasKeys)
+  {
+    m_numberOfGalaxies = std::stol(keyValues[0]);
+    m_boundaries = Boundaries(std::stod(keyValues[1]), std::stod(keyValues[2]),
+                              std::stod(keyValues[3]), std::stod(keyValues[4]),
+                              std::stod(keyValues[5]), std::stod(keyValues[6]));
+
+    // The reference value is the tangent point in maps written with a CRPIX reference pixel,
+    // older maps only had a CPIX one next to the center, which is their tangent point
+    double crpix1(0), crval1(0), crval2(0);
+    fits_read_key(fptr, TDOUBLE, "CRPIX1", &crpix1, nullptr, &status);
+    fits_read_key(fptr, TDOUBLE, "CRVAL1", &crval1, nullptr, &status);
+    fits_read_key(fptr, TDOUBLE, "CRVAL2", &crval2, nullptr, &status);
+    if (status==0)
     {
-      for (index j = 0; j != m_sizeYaxis; ++j)
-      {
-        for (index i = 0; i != m_sizeXaxis; ++i)
-        {
-          (*m_mapValues)[i][j][k] = contents[m_sizeXaxis*m_sizeYaxis*k+m_sizeXaxis*j+i];
-        }
-      }
+      m_boundaries.setTangentPoint(crval1, crval2);
     }
+  }
+  status = 0;
 
-    // Try to get the number of galaxies in the image if any
-    try
+  // Pixel sizes of the full image, the sky coordinates being linear in the pixel indices
+  double raPixel = (m_boundaries.getRaMax()-m_boundaries.getRaMin())/naxes[0];
+  double decPixel = (m_boundaries.getDecMax()-m_boundaries.getDecMin())/naxes[1];
+
+  // Convert a sky cutout to the range of pixels overlapping it
+  if (skyCutout!=nullptr)
+  {
+    if (hasKeys==false || raPixel<=0 || decPixel<=0)
     {
-      std::string nGalString;
-      image.readKey("nGalaxies", nGalString);
-      // if found then fill it
-      m_numberOfGalaxies = std::stol(nGalString);
-
-      std::string raMin;
-      std::string raMax;
-      std::string decMin;
-      std::string decMax;
-      std::string zMin;
-      std::string zMax;
-      image.readKey("raMin", raMin);
-      image.readKey("raMax", raMax);
-      image.readKey("decMin", decMin);
-      image.readKey("decMax", decMax);
-      image.readKey("zMin", zMin);
-      image.readKey("zMax", zMax);
-
-      m_boundaries = Boundaries(std::stod(raMin), std::stod(raMax),
-                                std::stod(decMin), std::stod(decMax),
-                                std::stod(zMin), std::stod(zMax));
+      int closeStatus = 0;
+      fits_close_file(fptr, &closeStatus);
+      return false;
     }
-    catch (CCfits::FitsException)
+    std::pair<double, double> raRange = getCutoutRaRange(*skyCutout, m_boundaries);
+    double firstX = std::max(0., std::floor((raRange.first-m_boundaries.getRaMin())/raPixel));
+    double firstY = std::max(0., std::floor((skyCutout->getDecMin()-m_boundaries.getDecMin())/decPixel));
+    double lastX = std::min(double(naxes[0]), std::ceil((raRange.second-m_boundaries.getRaMin())/raPixel));
+    double lastY = std::min(double(naxes[1]), std::ceil((skyCutout->getDecMax()-m_boundaries.getDecMin())/decPixel));
+    if (lastX<=firstX || lastY<=firstY)
     {
-      // if not found then put zero
-      m_numberOfGalaxies = 0;
+      int closeStatus = 0;
+      fits_close_file(fptr, &closeStatus);
+      return false;
     }
+    offsetX = firstX;
+    offsetY = firstY;
+    sizeX = lastX - firstX;
+    sizeY = lastY - firstY;
   }
-  catch (CCfits::FitsException)
+
+  // A zero size extends the cutout to the edge of the image
+  if (offsetX>=naxes[0] || offsetY>=naxes[1])
   {
-    // no FITS image at this path
-    std::cout<<filename<<": can not open a FITS image from this file"<<std::endl;
+    int closeStatus = 0;
+    fits_close_file(fptr, &closeStatus);
+    return false;
+  }
+  if (sizeX==0 || offsetX+sizeX>naxes[0])
+  {
+    sizeX = naxes[0] - offsetX;
+  }
+  if (sizeY==0 || offsetY+sizeY>naxes[1])
+  {
+    sizeY = naxes[1] - offsetY;
+  }
+
+  m_sizeXaxis = sizeX;
+  m_sizeYaxis = sizeY;
+  m_sizeZaxis = naxes[2];
+  m_mapValues = new boost::multi_array<double, 3>(boost::extents[m_sizeXaxis][m_sizeYaxis][m_sizeZaxis]);
+
+  // Read the image by blocks of rows converted to double by cfitsio, so that only one
+  // block is held in memory on top of the map. Only the pixels of the cutout are read
+  // from the file. The rows are along the X axis in the file while the Z axis is the
+  // fastest varying one in the map, so each block is scattered
+  unsigned long rowsPerBlock = std::max(1ul, std::min(131072ul/m_sizeXaxis, (unsigned long)(m_sizeYaxis)));
+  std::vector<double> buffer(rowsPerBlock*m_sizeXaxis);
+  double *mapData = m_mapValues->data();
+
+  for (unsigned int k=0; k<m_sizeZaxis && status==0; k++)
+  {
+    for (unsigned int firstRow=0; firstRow<m_sizeYaxis && status==0; firstRow+=rowsPerBlock)
+    {
+      unsigned long nRows = std::min(rowsPerBlock, (unsigned long)(m_sizeYaxis-firstRow));
+      long firstPixel[3] = {long(offsetX)+1, long(offsetY+firstRow)+1, long(k)+1};
+      long lastPixel[3] = {long(offsetX+m_sizeXaxis), long(offsetY+firstRow+nRows), long(k)+1};
+      long increment[3] = {1, 1, 1};
+      fits_read_subset(fptr, TDOUBLE, firstPixel, lastPixel, increment, nullptr, buffer.data(), nullptr, &status);
+
+      for (unsigned long j=0; j<nRows; j++)
+      {
+        const double *row = &buffer[j*m_sizeXaxis];
+        double *mapValue = mapData + (firstRow+j)*m_sizeZaxis + k;
+        for (unsigned int i=0; i<m_sizeXaxis; i++)
+        {
+          mapValue[i*m_sizeYaxis*m_sizeZaxis] = row[i];
+        }
+      }
+    }
+  }
+
+  int closeStatus = 0;
+  fits_close_file(fptr, &closeStatus);
+
+  if (status)
+  {
+    return false;
   }
+
+  // The boundaries of a cutout are the edges of its pixels in the full image, and its
+  // pixels are still projected around the tangent point of the full image
+  if (hasKeys && (m_sizeXaxis!=naxes[0] || m_sizeYaxis!=naxes[1]))
+  {
+    Boundaries fullBoundaries(m_boundaries);
+    m_boundaries = Boundaries(fullBoundaries.getRaMin() + offsetX*raPixel,
+                              fullBoundaries.getRaMin() + (offsetX+m_sizeXaxis)*raPixel,
+                              fullBoundaries.getDecMin() + offsetY*decPixel,
+                              fullBoundaries.getDecMin() + (offsetY+m_sizeYaxis)*decPixel,
+                              fullBoundaries.getZMin(), fullBoundaries.getZMax());
+    m_boundaries.setTangentPoint(fullBoundaries.getRaTangent(), fullBoundaries.getDecTangent());
+  }
+
+  return true;
 }
 
 GlobalMap::GlobalMap(GlobalMap const& copyMap):
 m_sizeXaxis(copyMap.m_sizeXaxis), m_sizeYaxis(copyMap.m_sizeYaxis), m_sizeZaxis(copyMap.m_sizeZaxis),
-m_numberOfGalaxies(copyMap.m_numberOfGalaxies), m_boundaries(copyMap.m_boundaries)
+m_fourierValues(nullptr), m_numberOfGalaxies(copyMap.m_numberOfGalaxies), m_boundaries(copyMap.m_boundaries)
 {
   typedef boost::multi_array<double, 3>::index index;
 
@@ -178,6 +364,14 @@ m_numberOfGalaxies(copyMap.m_numberOfGalaxies), m_boundaries(copyMap.m_boundarie
       }
     }
   }
+
+  // Keep the cached Fourier transform of the copied map if it is usable
+  if (copyMap.hasFourierTransform())
+  {
+    m_fourierValues = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*m_sizeXaxis*m_sizeYaxis);
+    std::copy(&copyMap.m_fourierValues[0][0], &copyMap.m_fourierValues[0][0] + 2*m_sizeXaxis*m_sizeYaxis,
+              &m_fourierValues[0][0]);
+  }
 }
 
 double GlobalMap::getBinValue(unsigned int binx, unsigned int biny, unsigned int binz) const
@@ -214,11 +408,11 @@ unsigned int GlobalMap::getZdim() const
   return m_sizeZaxis;
 }
 
-bool GlobalMap::saveToFITSfile(std::string filename, bool overwrite)
+bool GlobalMap::saveToFITSfile(std::string filename, bool overwrite, fitsCompression compression)
 {
   std::map<std::string, po::variable_value> param;
 
-  return saveToFITSfile(filename, overwrite, param);
+  return saveToFITSfile(filename, overwrite, param, compression);
 /*
 
 
@@ -292,149 +486,266 @@ bool GlobalMap::saveToFITSfile(std::string filename, bool overwrite)
 }
 
 
-bool GlobalMap::saveToFITSfile(std::string filename, bool overwrite, std::map<std::string, po::variable_value> param)
+bool GlobalMap::saveToFITSfile(std::string filename, bool overwrite, std::map<std::string, po::variable_value> param,
+                               fitsCompression compression)
 {
+  // A map saved as file.fits[EXTNAME] is written as a named extension of the file
+  std::size_t bracket = filename.find('[');
+  if (bracket!=std::string::npos && filename.back()==']')
+  {
+    return saveToFITSextension(filename.substr(0, bracket), filename.substr(bracket+1, filename.size()-bracket-2),
+                               overwrite, param, compression);
+  }
+
   if (overwrite)
   {
     filename = "!"+filename;
   }
 
-  // Create a FITS pointer and fill it if a file can be created
-  std::shared_ptr<CCfits::FITS> pFits(nullptr);
-  try
+  // Create the FITS file if possible
+  fitsfile *fptr = nullptr;
+  int status = 0;
+  if (fits_create_file(&fptr, filename.c_str(), &status))
   {
-    long naxes[3] = {m_sizeXaxis, m_sizeYaxis, m_sizeZaxis};
-
-    // Create a FITS file with name filename, of floats, 3 axis of sizes naxes
-    pFits.reset(new CCfits::FITS(filename, FLOAT_IMG, 3, naxes));
+    return false;
   }
-  catch (CCfits::FITS::CantCreate)
+
+  bool written = writeFITSimage(fptr, param, compression);
+
+  int closeStatus = 0;
+  fits_close_file(fptr, &closeStatus);
+
+  if (written==false || closeStatus)
   {
+    std::cout<<filename<<": error while writing the FITS image"<<std::endl;
     return false;
   }
 
-  // Create an array to write in the file with the right format
-  std::valarray<double> array(m_sizeXaxis*m_sizeYaxis*m_sizeZaxis);
+  return true;
+}
 
-  // Assign values to the elements
-  for (unsigned int k = 0; k != m_sizeZaxis; ++k)
+bool GlobalMap::saveToFITSextension(std::string filename, std::string extName, bool overwrite,
+                                    fitsCompression compression)
+{
+  std::map<std::string, po::variable_value> param;
+
+  return saveToFITSextension(filename, extName, overwrite, param, compression);
+}
+
+bool GlobalMap::saveToFITSextension(std::string filename, std::string extName, bool overwrite,
+                                    std::map<std::string, po::variable_value> param, fitsCompression compression)
+{
+  fitsfile *fptr = nullptr;
+  int status = 0;
+
+  // Open the product file, or create it with an empty primary HDU
+  if (fits_open_file(&fptr, filename.c_str(), READWRITE, &status))
   {
-    for (unsigned int j = 0; j != m_sizeYaxis; ++j)
+    status = 0;
+    if (fits_create_file(&fptr, filename.c_str(), &status))
     {
-      for (unsigned int i = 0; i != m_sizeXaxis; ++i)
-      {
-        array[m_sizeXaxis*m_sizeYaxis*k+m_sizeXaxis*j+i] = (*m_mapValues)[i][j][k];
-      }
+      return false;
     }
+    fits_create_img(fptr, FLOAT_IMG, 0, nullptr, &status);
+    fits_write_key(fptr, TSTRING, "CREATOR", const_cast<char*>("2D-MASS-WL"),
+                   "Software used to create the product", &status);
+  }
+  // Replace an extension of the same name if allowed
+  else if (fits_movnam_hdu(fptr, ANY_HDU, const_cast<char*>(extName.c_str()), 0, &status)==0)
+  {
+    if (overwrite==false)
+    {
+      std::cout<<filename<<": the extension "<<extName<<" already exists"<<std::endl;
+      fits_close_file(fptr, &status);
+      return false;
+    }
+    fits_delete_hdu(fptr, nullptr, &status);
+  }
+  else
+  {
+    status = 0;
+  }
+
+  // The new extension is appended at the end of the file
+  bool written = (status==0) && writeFITSimage(fptr, param, compression, extName);
+
+  int closeStatus = 0;
+  fits_close_file(fptr, &closeStatus);
+
+  if (written==false || closeStatus)
+  {
+    std::cout<<filename<<": error while writing the FITS extension "<<extName<<std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool GlobalMap::writeFITSimage(fitsfile *fptr, std::map<std::string, po::variable_value> &param,
+                               fitsCompression compression, const std::string &extName)
+{
+  int status = 0;
+
+  // Set the tile compression if asked, one tile per row. The Rice compression of floats
+  // quantizes the values, the dithering method keeping the zeros of the masked areas exact
+  if (compression==riceCompression)
+  {
+    fits_set_compression_type(fptr, RICE_1, &status);
+    fits_set_quantize_method(fptr, SUBTRACTIVE_DITHER_2, &status);
+  }
+  else if (compression==gzipCompression)
+  {
+    fits_set_compression_type(fptr, GZIP_1, &status);
+  }
+
+  // Create an image of floats with 3 axis
+  long naxes[3] = {m_sizeXaxis, m_sizeYaxis, m_sizeZaxis};
+  fits_create_img(fptr, FLOAT_IMG, 3, naxes, &status);
+
+  // Name the HDU if it is an extension of a product file
+  if (extName.empty()==false)
+  {
+    fits_update_key(fptr, TSTRING, "EXTNAME", const_cast<char*>(extName.c_str()), "name of the map", &status);
   }
 
+  // All the keys are written as strings
+  auto writeKey = [&fptr, &status](std::string keyName, std::string value, std::string comment)
+  {
+    fits_write_key(fptr, TSTRING, keyName.c_str(), const_cast<char*>(value.c_str()), comment.c_str(), &status);
+  };
+
   // Write the total number of galaxies into the FITS file
-  pFits->pHDU().addKey("nGalaxies", std::to_string(m_numberOfGalaxies), "total number of galaxies into the map");
+  writeKey("nGalaxies", std::to_string(m_numberOfGalaxies), "total number of galaxies into the map");
 
   // Write the boundaries into the FITS file
-  pFits->pHDU().addKey("raMin", std::to_string(m_boundaries.getRaMin()), "right ascension min of the map");
-  pFits->pHDU().addKey("raMax", std::to_string(m_boundaries.getRaMax()), "right ascension max of the map");
-  pFits->pHDU().addKey("decMin", std::to_string(m_boundaries.getDecMin()), "declination min of the map");
-  pFits->pHDU().addKey("decMax", std::to_string(m_boundaries.getDecMax()), "declination max of the map");
-  pFits->pHDU().addKey("zMin", std::to_string(m_boundaries.getZMin()), "redshift min of the map");
-  pFits->pHDU().addKey("zMax", std::to_string(m_boundaries.getZMax()), "redshift max of the map");
+  writeKey("raMin", std::to_string(m_boundaries.getRaMin()), "right ascension min of the map");
+  writeKey("raMax", std::to_string(m_boundaries.getRaMax()), "right ascension max of the map");
+  writeKey("decMin", std::to_string(m_boundaries.getDecMin()), "declination min of the map");
+  writeKey("decMax", std::to_string(m_boundaries.getDecMax()), "declination max of the map");
+  writeKey("zMin", std::to_string(m_boundaries.getZMin()), "redshift min of the map");
+  writeKey("zMax", std::to_string(m_boundaries.getZMax()), "redshift max of the map");
 
 
   // Fill all the required fields of the fits header
   if (param.find("bModeZeros")!=param.end())
   {
-    pFits->pHDU().addKey("BMODGAP", param["bModeZeros"].as<int>()==1?"True":"False",
-                         "True if B-mode forced to zero in the gaps");
+    writeKey("BMODGAP", param["bModeZeros"].as<int>()==1?"True":"False",
+             "True if B-mode forced to zero in the gaps");
   }
   else
   {
-    pFits->pHDU().addKey("BMODGAP", "False", "True if B-mode forced to zero in the gaps");
+    writeKey("BMODGAP", "False", "True if B-mode forced to zero in the gaps");
   }
 
   if (param.find("sigmaBounded")!=param.end())
   {
-    pFits->pHDU().addKey("VARPERSC", param["sigmaBounded"].as<int>()==1?"True":"False",
-                         "True if equal variance per scale forced in and out of masked area");
+    writeKey("VARPERSC", param["sigmaBounded"].as<int>()==1?"True":"False",
+             "True if equal variance per scale forced in and out of masked area");
   }
   else
   {
-    pFits->pHDU().addKey("VARPERSC", "False", "True if equal variance per scale forced in and out of masked area");
+    writeKey("VARPERSC", "False", "True if equal variance per scale forced in and out of masked area");
   }
 
   if (param.find("numberScales")!=param.end())
   {
-    pFits->pHDU().addKey("NSCINP", std::to_string(param["numberScales"].as<int>()),
-                         "Number of scales for inpainting");
+    writeKey("NSCINP", std::to_string(param["numberScales"].as<int>()),
+             "Number of scales for inpainting");
   }
   else
   {
-    pFits->pHDU().addKey("NSCINP", "Auto", "Number of scales for inpainting");
+    writeKey("NSCINP", "Auto", "Number of scales for inpainting");
   }
 
   if (param.find("numberIteration")!=param.end())
   {
-    pFits->pHDU().addKey("NITINP", std::to_string(param["numberIteration"].as<int>()),
-                         "Number of iterations for inpainting");
+    writeKey("NITINP", std::to_string(param["numberIteration"].as<int>()),
+             "Number of iterations for inpainting");
   }
   else
   {
-    pFits->pHDU().addKey("NITINP", "0", "Number of iterations for inpainting");
+    writeKey("NITINP", "0", "Number of iterations for inpainting");
   }
 
   if (param.find("sigmaShearMap")!=param.end())
   {
-    pFits->pHDU().addKey("STDGAUS", std::to_string((param["sigmaShearMap"].as<std::vector<float> >())[0]),
-                         "Standard deviation of gaussian smoothing");
+    writeKey("STDGAUS", std::to_string((param["sigmaShearMap"].as<std::vector<float> >())[0]),
+             "Standard deviation of gaussian smoothing");
   }
   else
   {
-    pFits->pHDU().addKey("STDGAUS", "0", "Standard deviation of gaussian smoothing");
+    writeKey("STDGAUS", "0", "Standard deviation of gaussian smoothing");
   }
 
   if (param.find("ReducedShearIteration")!=param.end())
   {
-    pFits->pHDU().addKey("NITREDSH", std::to_string(param["ReducedShearIteration"].as<int>()),
-                         "Number of iterations for reduced shear");
+    writeKey("NITREDSH", std::to_string(param["ReducedShearIteration"].as<int>()),
+             "Number of iterations for reduced shear");
   }
   else
   {
-    pFits->pHDU().addKey("NITREDSH", "0", "Number of iterations for reduced shear");
+    writeKey("NITREDSH", "0", "Number of iterations for reduced shear");
   }
 
-  //  pFits->pHDU().addKey("DENTYPE", "RA-TAN", "Denoising type");
-  //  pFits->pHDU().addKey("FDRVAL", "RA-TAN", "False discovery rate threshold");
-
+  //  writeKey("DENTYPE", "RA-TAN", "Denoising type");
+  //  writeKey("FDRVAL", "RA-TAN", "False discovery rate threshold");
 
-  pFits->pHDU().addKey("CTYPE1", "RA-TAN", "First parameter for reference");
-  pFits->pHDU().addKey("CTYPE2", "DEC-TAN", "Second parameter for reference");
 
-  pFits->pHDU().addKey("CPIX1", std::to_string(floor(m_sizeXaxis/2)),
-                       "Pixel number of reference pixel in first dimension");
-  pFits->pHDU().addKey("CPIX2", std::to_string(floor(m_sizeYaxis/2)),
-                       "Pixel number of reference pixel in second dimension");
+  writeKey("CTYPE1", "RA-TAN", "First parameter for reference");
+  writeKey("CTYPE2", "DEC-TAN", "Second parameter for reference");
 
+  // The reference pixel is the tangent point, which is off the center of a cutout. The
+  // pixel of index i covers the FITS pixel coordinates from i+0.5 to i+1.5
   float cd1 = (m_boundaries.getRaMax()-m_boundaries.getRaMin())/m_sizeXaxis;
   float cd2 = (m_boundaries.getDecMax()-m_boundaries.getDecMin())/m_sizeYaxis;
-  float crval1 = (floor(m_sizeXaxis/2)+0.5)*cd1 + m_boundaries.getRaMin();
-  float crval2 = (floor(m_sizeYaxis/2)+0.5)*cd2 + m_boundaries.getDecMin();
-
-  pFits->pHDU().addKey("CRVAL1", std::to_string(crval1), "First reference pixel value for CTYPE1");
-  pFits->pHDU().addKey("CRVAL2", std::to_string(crval2), "Second reference pixel value for CTYPE2");
-
-  pFits->pHDU().addKey("CD1_1", std::to_string(cd1), "Component (1,1) of the coordinate transformation matrix");
-  pFits->pHDU().addKey("CD1_2", std::to_string(0), "Component (1,2) of the coordinate transformation matrix");
-  pFits->pHDU().addKey("CD2_1", std::to_string(0), "Component (2,1) of the coordinate transformation matrix");
-  pFits->pHDU().addKey("CD2_2", std::to_string(cd2), "Component (2,2) of the coordinate transformation matrix");
-
-  pFits->pHDU().addKey("CUNIT1", "deg", "Unit of the first coordinate value");
-  pFits->pHDU().addKey("CUNIT2", "deg", "Unit of the second coordinate value");
-  pFits->pHDU().addKey("CREATOR", "2D-MASS-WL", "Software used to create the product");
-  pFits->pHDU().addKey("VERSION", "0.1", "Software version");
+  float crval1 = m_boundaries.getRaTangent();
+  float crval2 = m_boundaries.getDecTangent();
+  float crpix1 = (cd1!=0) ? (crval1-m_boundaries.getRaMin())/cd1 + 0.5 : 0.5*m_sizeXaxis + 0.5;
+  float crpix2 = (cd2!=0) ? (crval2-m_boundaries.getDecMin())/cd2 + 0.5 : 0.5*m_sizeYaxis + 0.5;
+
+  writeKey("CRPIX1", std::to_string(crpix1),
+           "Pixel number of reference pixel in first dimension");
+  writeKey("CRPIX2", std::to_string(crpix2),
+           "Pixel number of reference pixel in second dimension");
+
+  writeKey("CRVAL1", std::to_string(crval1), "First reference pixel value for CTYPE1");
+  writeKey("CRVAL2", std::to_string(crval2), "Second reference pixel value for CTYPE2");
+
+  writeKey("CD1_1", std::to_string(cd1), "Component (1,1) of the coordinate transformation matrix");
+  writeKey("CD1_2", std::to_string(0), "Component (1,2) of the coordinate transformation matrix");
+  writeKey("CD2_1", std::to_string(0), "Component (2,1) of the coordinate transformation matrix");
+  writeKey("CD2_2", std::to_string(cd2), "Component (2,2) of the coordinate transformation matrix");
+
+  writeKey("CUNIT1", "deg", "Unit of the first coordinate value");
+  writeKey("CUNIT2", "deg", "Unit of the second coordinate value");
+  writeKey("CREATOR", "2D-MASS-WL", "Software used to create the product");
+  writeKey("VERSION", "0.1", "Software version");
+
+  // Write the image by blocks of rows converted to float, so that only one block
+  // is held in memory on top of the map
+  unsigned long rowsPerBlock = std::max(1ul, std::min(262144ul/std::max(1u, m_sizeXaxis),
+                                                      (unsigned long)(m_sizeYaxis)));
+  std::vector<float> buffer(rowsPerBlock*m_sizeXaxis);
+
+  for (unsigned int k=0; k<m_sizeZaxis && status==0; k++)
+  {
+    for (unsigned int firstRow=0; firstRow<m_sizeYaxis && status==0; firstRow+=rowsPerBlock)
+    {
+      unsigned long nRows = std::min(rowsPerBlock, (unsigned long)(m_sizeYaxis-firstRow));
+      for (unsigned int i=0; i<m_sizeXaxis; i++)
+      {
+        for (unsigned long j=0; j<nRows; j++)
+        {
+          buffer[j*m_sizeXaxis+i] = (*m_mapValues)[i][firstRow+j][k];
+        }
+      }
 
-  // Write the array image to the FITS file
-  pFits->pHDU().write(1, m_sizeXaxis*m_sizeYaxis*m_sizeZaxis, array);
+      long firstPixel[3] = {1, long(firstRow)+1, long(k)+1};
+      fits_write_pix(fptr, TFLOAT, firstPixel, nRows*m_sizeXaxis, buffer.data(), &status);
+    }
+  }
 
-  return true;
+  return status==0;
 }
 /*
 fftw_complex* GlobalMap::performFFTforward(fftw_complex* inputMap)
@@ -499,29 +810,11 @@ boost::multi_array<double, 2> GlobalMap::makeGaussianKernel(int sizeX, int sizeY
 
 std::vector<double> GlobalMap::getMeanValues()
 {
-  // Create the vector of mean values
-  std::vector<double> meanValues;
-
-  // Loop over all the values of the map
-  typedef boost::multi_array<double, 3>::index index;
-
-  for (index k = 0; k != m_sizeZaxis; ++k)
-  {
-    double mean(0.);
-    for (index j = 0; j != m_sizeYaxis; ++j)
-    {
-      for (index i = 0; i != m_sizeXaxis; ++i)
-      {
-        mean += (*m_mapValues)[i][j][k];
-      }
-    }
-    // Scale the sum to the mean
-    mean /= m_sizeXaxis*m_sizeYaxis;
-    // Add that value to the output vector
-    meanValues.push_back(mean);
-  }
+  // Compute the statistics of all the Z plans in one pass
+  MapStatistics statistics;
+  statistics.computeStatistics(*this);
 
-  return meanValues;
+  return statistics.getMeanValues();
 }
 
 void GlobalMap::removeOffset(std::vector<double> offset)
@@ -539,6 +832,8 @@ void GlobalMap::removeOffset(std::vector<double> offset)
       }
     }
   }
+
+  invalidateFourierTransform();
 }
 
 /*
@@ -607,38 +902,16 @@ unsigned int GlobalMap::pixelate(float galaxiesPerBin)
   }
 
   // If the best choice means to have one or less pixels then do nothing and return 1
-  if (m_sizeXaxis/int(sqrt(binning)) <= 1 || m_sizeYaxis/int(sqrt(binning)) <= 1)
+  unsigned int factor = int(sqrt(binning));
+  if (m_sizeXaxis/factor <= 1 || m_sizeYaxis/factor <= 1)
   {
     return 1;
   }
 
-  // Create a buffer array to reshape the member array
-  boost::multi_array<double, 3> *buffMapValues = new boost::multi_array<double, 3>
-    (boost::extents[m_sizeXaxis/int(sqrt(binning))][m_sizeYaxis/int(sqrt(binning))][m_sizeZaxis]);
+  // Sum the values of the galaxies in the new bins
+  rebin(factor, factor, false);
 
-  typedef boost::multi_array<double, 3>::index index;
-
-  // Reassign binned values to the map
-  for (index k = 0; k != m_sizeZaxis; ++k)
-  {
-    for (index j = 0; j != m_sizeYaxis; ++j)
-    {
-      for (index i = 0; i != m_sizeXaxis; ++i)
-      {
-        (*buffMapValues)[i/int(sqrt(binning))][j/int(sqrt(binning))][k] += (*m_mapValues)[i][j][k];
-      }
-    }
-  }
-
-  // Delete the old array
-  delete m_mapValues;
-  m_mapValues = buffMapValues;
-
-  // Update the axis dimensions of the map
-  m_sizeXaxis /= int(sqrt(binning));
-  m_sizeYaxis /= int(sqrt(binning));
-
-  return int(sqrt(binning));
+  return factor;
 }
 
 
@@ -653,26 +926,89 @@ bool GlobalMap::pixelate(unsigned int xBinning, unsigned int yBinning)
   xBinning = pow(2, xBinning);
   yBinning = pow(2, yBinning);
 
-  // Check the asked binning is not higher or equal to the number of current bins
-  if (xBinning>m_sizeXaxis || yBinning>m_sizeYaxis)
+  // Average the values in the new bins
+  return rebin(xBinning, yBinning, true);
+}
+
+
+bool GlobalMap::rebin(unsigned int xFactor, unsigned int yFactor, bool mean, const GlobalMap *weights)
+{
+  // Check the asked binning is possible
+  if (xFactor==0 || yFactor==0 || xFactor>m_sizeXaxis || yFactor>m_sizeYaxis)
+  {
+    return false;
+  }
+  if (weights!=nullptr && (weights->m_sizeXaxis!=m_sizeXaxis || weights->m_sizeYaxis!=m_sizeYaxis
+                          || weights->m_sizeZaxis==0))
   {
     return false;
   }
 
+  unsigned int newSizeX = m_sizeXaxis/xFactor;
+  unsigned int newSizeY = m_sizeYaxis/yFactor;
+  unsigned int sizeZ = m_sizeZaxis;
+
   // Create a buffer array to reshape the member array
   boost::multi_array<double, 3> *buffMapValues = new boost::multi_array<double, 3>
-    (boost::extents[m_sizeXaxis/xBinning][m_sizeYaxis/yBinning][m_sizeZaxis]);
-
-  typedef boost::multi_array<double, 3>::index index;
+    (boost::extents[newSizeX][newSizeY][sizeZ]);
 
-  // Reassign binned values to the map
-  for (index k = 0; k != m_sizeZaxis; ++k)
+  // Each output row sums xFactor input rows, the [y][z] plan of a row being contiguous
+  #pragma omp parallel for
+  for (int newI = 0; newI < int(newSizeX); ++newI)
   {
-    for (index j = 0; j != m_sizeYaxis; ++j)
+    double *outRow = &(*buffMapValues)[newI][0][0];
+    std::vector<double> weightSums(newSizeY, 0.);
+
+    for (unsigned int i = newI*xFactor; i != (newI+1)*xFactor; ++i)
     {
-      for (index i = 0; i != m_sizeXaxis; ++i)
+      const double *inRow = &(*m_mapValues)[i][0][0];
+
+      if (weights==nullptr)
       {
-        (*buffMapValues)[i/xBinning][j/yBinning][k] += (*m_mapValues)[i][j][k]/xBinning/yBinning;
+        for (unsigned int newJ = 0; newJ != newSizeY; ++newJ)
+        {
+          double *outBin = outRow + newJ*sizeZ;
+          const double *inBins = inRow + newJ*yFactor*sizeZ;
+          for (unsigned int j = 0; j != yFactor; ++j)
+          {
+            for (unsigned int k = 0; k != sizeZ; ++k)
+            {
+              outBin[k] += inBins[j*sizeZ+k];
+            }
+          }
+        }
+      }
+      else
+      {
+        const double *weightRow = &(*weights->m_mapValues)[i][0][0];
+        unsigned int weightSizeZ = weights->m_sizeZaxis;
+        for (unsigned int newJ = 0; newJ != newSizeY; ++newJ)
+        {
+          double *outBin = outRow + newJ*sizeZ;
+          for (unsigned int j = newJ*yFactor; j != (newJ+1)*yFactor; ++j)
+          {
+            double weight = weightRow[j*weightSizeZ];
+            weightSums[newJ] += weight;
+            for (unsigned int k = 0; k != sizeZ; ++k)
+            {
+              outBin[k] += weight*inRow[j*sizeZ+k];
+            }
+          }
+        }
+      }
+    }
+
+    // Normalize the bins to get the mean values
+    if (mean)
+    {
+      for (unsigned int newJ = 0; newJ != newSizeY; ++newJ)
+      {
+        double norm = weights==nullptr ? xFactor*yFactor : weightSums[newJ];
+        double invNorm = norm!=0 ? 1./norm : 0.;
+        for (unsigned int k = 0; k != sizeZ; ++k)
+        {
+          outRow[newJ*sizeZ+k] *= invNorm;
+        }
       }
     }
   }
@@ -681,8 +1017,10 @@ bool GlobalMap::pixelate(unsigned int xBinning, unsigned int yBinning)
   delete m_mapValues;
   m_mapValues = buffMapValues;
 
-  m_sizeXaxis /= xBinning;
-  m_sizeYaxis /= yBinning;
+  m_sizeXaxis = newSizeX;
+  m_sizeYaxis = newSizeY;
+
+  invalidateFourierTransform();
 
   return true;
 }
@@ -695,8 +1033,10 @@ void GlobalMap::applyGaussianFilter(float sigmax, float sigmay)
   // Generate a normalized gaussian kernel with sigma
   boost::multi_array<double, 2> gaussianKernel = makeGaussianKernel(m_sizeXaxis, m_sizeYaxis, sigmax, sigmay);
 
+  // Get the fourier transform of the map, reused if already cached
+  const fftw_complex* fft_map_complex = getFourierTransform();
+
   // Create the complex maps
-  fftw_complex* kappa_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*m_sizeXaxis*m_sizeYaxis);
   fftw_complex* fft_kappa_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*m_sizeXaxis*m_sizeYaxis);
 
   fftw_complex* kernel_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
@@ -706,35 +1046,42 @@ void GlobalMap::applyGaussianFilter(float sigmax, float sigmay)
   fftw_complex* fft_kappaGauss_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*m_sizeXaxis*m_sizeYaxis);
 
   // Create the plans for transformation
-  fftw_plan plan_k_forward = fftw_plan_dft_2d(m_sizeXaxis, m_sizeYaxis,
-                                              kappa_complex, fft_kappa_complex,
-                                              FFTW_FORWARD,  FFTW_MEASURE);
-
-  fftw_plan plan_kernel_forward = fftw_plan_dft_2d(m_sizeXaxis, m_sizeYaxis,
+  fftw_plan plan_kernel_forward = fftw_plan_dft_2d(m_sizeYaxis, m_sizeXaxis,
                                                    kernel_complex, fft_kernel_complex,
                                                    FFTW_FORWARD,  FFTW_MEASURE);
 
-  fftw_plan plan_kappaGauss_backward = fftw_plan_dft_2d(m_sizeXaxis, m_sizeYaxis,
+  fftw_plan plan_kappaGauss_backward = fftw_plan_dft_2d(m_sizeYaxis, m_sizeXaxis,
                                                         fft_kappaGauss_complex, kappaGauss_complex,
                                                         FFTW_BACKWARD,  FFTW_MEASURE);
 
 
-  // Fill the complex kappa map with convergence map values and kernel values
+  // Fill the complex kernel with kernel values
   for (unsigned int i=0; i<m_sizeXaxis; i++)
   {
     for (unsigned int j=0; j<m_sizeYaxis; j++)
     {
-      kappa_complex[j*m_sizeXaxis +i][0] = (*m_mapValues)[i][j][0];
-      kappa_complex[j*m_sizeXaxis +i][1] = 0;//(*m_mapValues)[i][j][1];
       kernel_complex[j*m_sizeXaxis +i][0] = gaussianKernel[i][j];
       kernel_complex[j*m_sizeXaxis +i][1] = 0;//gaussianKernel[i][j];
     }
   }
 
-  // Perform the fourier transform of the complex convergence map ans complex kernel
-  fftw_execute(plan_k_forward);
-  fftw_execute(plan_kernel_forward);
+  // Extract the transform of the first plan from the transform of the two first plans,
+  // using the hermitian symmetry of the transform of a real map
+  for (unsigned int i=0; i<m_sizeXaxis; i++)
+  {
+    unsigned int iOpp = (m_sizeXaxis-i)%m_sizeXaxis;
+    for (unsigned int j=0; j<m_sizeYaxis; j++)
+    {
+      unsigned int jOpp = (m_sizeYaxis-j)%m_sizeYaxis;
+      fft_kappa_complex[j*m_sizeXaxis+i][0] = 0.5*(fft_map_complex[j*m_sizeXaxis+i][0]
+                                                  +fft_map_complex[jOpp*m_sizeXaxis+iOpp][0]);
+      fft_kappa_complex[j*m_sizeXaxis+i][1] = 0.5*(fft_map_complex[j*m_sizeXaxis+i][1]
+                                                  -fft_map_complex[jOpp*m_sizeXaxis+iOpp][1]);
+    }
+  }
 
+  // Perform the fourier transform of the complex kernel
+  fftw_execute(plan_kernel_forward);
 
   // Multiply the gaussian kernel and the convergence map in the fourier space
   for (unsigned int i=0; i<m_sizeXaxis; i++)
@@ -763,12 +1110,13 @@ void GlobalMap::applyGaussianFilter(float sigmax, float sigmay)
     }
   }
 
+  // The first plan has been modified
+  invalidateFourierTransform();
+
   // free memory
-  fftw_destroy_plan(plan_k_forward);
   fftw_destroy_plan(plan_kernel_forward);
   fftw_destroy_plan(plan_kappaGauss_backward);
 
-  fftw_free(kappa_complex);
   fftw_free(fft_kappa_complex);
   fftw_free(kernel_complex);
   fftw_free(fft_kernel_complex);
@@ -793,70 +1141,207 @@ Boundaries GlobalMap::getBoundaries() const
 
 void GlobalMap::addBorders()
 {
-  // Update the number of pixels on X and Y axis
-  m_sizeXaxis *= 2;
-  m_sizeYaxis *= 2;
+  // Double the size of the map and center the original map in it
+  padMap(2*m_sizeXaxis, 2*m_sizeYaxis, m_sizeXaxis/2, m_sizeYaxis/2);
+}
+
+void GlobalMap::removeBorders()
+{
+  // Get back the central part of the map, half its size
+  cropMap(m_sizeXaxis/2, m_sizeYaxis/2, m_sizeXaxis/4, m_sizeYaxis/4);
+}
+
+bool GlobalMap::padMap(unsigned int newSizeX, unsigned int newSizeY, unsigned int offsetX, unsigned int offsetY,
+                       bool mirror)
+{
+  // Check the current map is not empty and fits in the padded one
+  if (m_sizeXaxis==0 || m_sizeYaxis==0 || offsetX+m_sizeXaxis > newSizeX || offsetY+m_sizeYaxis > newSizeY)
+  {
+    return false;
+  }
 
   typedef boost::multi_array<double, 3>::index index;
 
-  // Declare a new array with the right dimensions
+  // Declare a new array with the right dimensions, initialized with zeros
   boost::multi_array<double, 3> *borderedMap =
-      new boost::multi_array<double, 3>(boost::extents[m_sizeXaxis][m_sizeYaxis][m_sizeZaxis]);
+      new boost::multi_array<double, 3>(boost::extents[newSizeX][newSizeY][m_sizeZaxis]);
 
   // Assign values from the old array to the new bordered one
-  for (index k = 0; k != m_sizeZaxis; ++k)
+  for (index i = 0; i != newSizeX; ++i)
   {
-    for (index j = 0; j != m_sizeYaxis; ++j)
+    // Position of this column in the old map, mirrored with a period of twice the map size
+    long ii = (long(i) - long(offsetX)) % long(2*m_sizeXaxis);
+    ii = ii<0 ? ii+2*m_sizeXaxis : ii;
+    ii = ii<m_sizeXaxis ? ii : 2*m_sizeXaxis-1-ii;
+    bool insideX = i>=offsetX && i<offsetX+m_sizeXaxis;
+
+    for (index j = 0; j != newSizeY; ++j)
     {
-      for (index i = 0; i != m_sizeXaxis; ++i)
+      bool inside = insideX && j>=offsetY && j<offsetY+m_sizeYaxis;
+      if (inside==false && mirror==false)
       {
-        if (i<m_sizeXaxis/4 || i>=3*m_sizeXaxis/4 || j<m_sizeYaxis/4 || j>=3*m_sizeYaxis/4)
-        {
-          (*borderedMap)[i][j][k] = 0.;
-        }
-        else
-        {
-          (*borderedMap)[i][j][k] = (*m_mapValues)[i-m_sizeXaxis/4][j-m_sizeYaxis/4][k];
-        }
+        continue;
+      }
+
+      long jj = (long(j) - long(offsetY)) % long(2*m_sizeYaxis);
+      jj = jj<0 ? jj+2*m_sizeYaxis : jj;
+      jj = jj<m_sizeYaxis ? jj : 2*m_sizeYaxis-1-jj;
+
+      for (index k = 0; k != m_sizeZaxis; ++k)
+      {
+        (*borderedMap)[i][j][k] = (*m_mapValues)[ii][jj][k];
       }
     }
   }
 
-//  m_sizeXaxis /= 2;
-//  m_sizeYaxis /= 2;
   // Delete the old map and assign the new one as a member
   delete m_mapValues;
   m_mapValues = borderedMap;
+
+  m_sizeXaxis = newSizeX;
+  m_sizeYaxis = newSizeY;
+
+  invalidateFourierTransform();
+
+  return true;
 }
 
-void GlobalMap::removeBorders()
+bool GlobalMap::cropMap(unsigned int newSizeX, unsigned int newSizeY, unsigned int offsetX, unsigned int offsetY)
+{
+  // Check the sub-rectangle is inside the current map
+  if (newSizeX==0 || newSizeY==0 || offsetX+newSizeX > m_sizeXaxis || offsetY+newSizeY > m_sizeYaxis)
+  {
+    return false;
+  }
+
+  // Move the origin of the indices to the sub-rectangle, the values outside of it
+  // stay in memory but are not accessible anymore
+  boost::array<boost::multi_array<double, 3>::index, 3> bases = {{m_mapValues->index_bases()[0]-long(offsetX),
+                                                                  m_mapValues->index_bases()[1]-long(offsetY),
+                                                                  m_mapValues->index_bases()[2]}};
+  m_mapValues->reindex(bases);
+
+  m_sizeXaxis = newSizeX;
+  m_sizeYaxis = newSizeY;
+
+  invalidateFourierTransform();
+
+  return true;
+}
+
+MapView GlobalMap::getView(unsigned int offsetX, unsigned int offsetY, unsigned int sizeX, unsigned int sizeY)
 {
-  m_sizeXaxis /= 2;
-  m_sizeYaxis /= 2;
+  typedef boost::multi_array<double, 3>::index_range range;
 
-  typedef boost::multi_array<double, 3>::index index;
+  // The map may be modified through the view
+  invalidateFourierTransform();
 
-  // Declare a new array with the right dimensions
-  boost::multi_array<double, 3> *borderedMap =
-      new boost::multi_array<double, 3>(boost::extents[m_sizeXaxis][m_sizeYaxis][m_sizeZaxis]);
+  // Truncate the sub-rectangle to the map limits
+  offsetX = std::min(offsetX, m_sizeXaxis);
+  offsetY = std::min(offsetY, m_sizeYaxis);
+  sizeX = std::min(sizeX, m_sizeXaxis-offsetX);
+  sizeY = std::min(sizeY, m_sizeYaxis-offsetY);
 
-  // Assign values from the old array to the new without borders
-  for (index k = 0; k != m_sizeZaxis; ++k)
+  return MapView((*m_mapValues)[boost::indices[range(offsetX, offsetX+sizeX)][range(offsetY, offsetY+sizeY)]
+                                              [range(0, m_sizeZaxis)]], m_viewToken);
+}
+
+ConstMapView GlobalMap::getView(unsigned int offsetX, unsigned int offsetY, unsigned int sizeX,
+                                unsigned int sizeY) const
+{
+  typedef boost::multi_array<double, 3>::index_range range;
+
+  // Truncate the sub-rectangle to the map limits
+  offsetX = std::min(offsetX, m_sizeXaxis);
+  offsetY = std::min(offsetY, m_sizeYaxis);
+  sizeX = std::min(sizeX, m_sizeXaxis-offsetX);
+  sizeY = std::min(sizeY, m_sizeYaxis-offsetY);
+
+  const boost::multi_array<double, 3> &mapValues = *m_mapValues;
+  return mapValues[boost::indices[range(offsetX, offsetX+sizeX)][range(offsetY, offsetY+sizeY)]
+                                 [range(0, m_sizeZaxis)]];
+}
+
+const fftw_complex* GlobalMap::getFourierTransform()
+{
+  if (hasFourierTransform())
   {
-    for (index j = 0; j != m_sizeYaxis; ++j)
+    s_transformsAvoided++;
+    return m_fourierValues;
+  }
+
+  // The map may be written through a view alive while it is transformed
+  m_transformWithView = m_viewToken.use_count()>1;
+  if (m_fourierValues==nullptr)
+  {
+    m_fourierValues = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*m_sizeXaxis*m_sizeYaxis);
+  }
+
+  // The slowest varying index is j, so the first dimension of the plan is the Y axis
+  fftw_plan plan_forward;
+  #pragma omp critical
+  {
+    plan_forward = fftw_plan_dft_2d(m_sizeYaxis, m_sizeXaxis, m_fourierValues, m_fourierValues,
+                                    FFTW_FORWARD, FFTW_ESTIMATE);
+  }
+
+  // Fill the complex map with the two first plans of the map
+  for (unsigned int i=0; i<m_sizeXaxis; i++)
+  {
+    for (unsigned int j=0; j<m_sizeYaxis; j++)
     {
-      for (index i = 0; i != m_sizeXaxis; ++i)
-      {
-          (*borderedMap)[i][j][k] = (*m_mapValues)[i+m_sizeXaxis/2][j+m_sizeYaxis/2][k];
-      }
+      m_fourierValues[j*m_sizeXaxis +i][0] = (*m_mapValues)[i][j][0];
+      m_fourierValues[j*m_sizeXaxis +i][1] = m_sizeZaxis>1 ? (*m_mapValues)[i][j][1] : 0.;
     }
   }
 
-//  m_sizeXaxis *= 2;
-//  m_sizeYaxis *= 2;
-  // Delete the old map and assign the new one as a member
-  delete m_mapValues;
-  m_mapValues = borderedMap;
+  fftw_execute(plan_forward);
+
+  #pragma omp critical
+  {
+    fftw_destroy_plan(plan_forward);
+  }
+
+  s_transformsPerformed++;
+
+  return m_fourierValues;
+}
+
+void GlobalMap::setFourierTransform(fftw_complex* fourierValues)
+{
+  invalidateFourierTransform();
+  m_fourierValues = fourierValues;
+  m_transformWithView = m_viewToken.use_count()>1;
+}
+
+bool GlobalMap::hasFourierTransform() const
+{
+  return m_fourierValues!=nullptr && m_transformWithView==false && m_viewToken.use_count()==1;
+}
+
+void GlobalMap::invalidateFourierTransform()
+{
+  if (m_fourierValues!=nullptr)
+  {
+    fftw_free(m_fourierValues);
+    m_fourierValues = nullptr;
+  }
+}
+
+unsigned long GlobalMap::getNumberOfTransformsPerformed()
+{
+  return s_transformsPerformed;
+}
+
+unsigned long GlobalMap::getNumberOfTransformsAvoided()
+{
+  return s_transformsAvoided;
+}
+
+void GlobalMap::resetTransformCounters()
+{
+  s_transformsPerformed = 0;
+  s_transformsAvoided = 0;
 }
 
 } // TWOD_MASS_WL_MassMapping namespace
@@ -23,6 +23,7 @@
  */
 
 #include "TWOD_MASS_WL_MassMapping/Image.h"
+#include "TWOD_MASS_WL_MassMapping/MapStatistics.h"
 #include "math.h"
 
 namespace TWOD_MASS_WL_MassMapping {
@@ -153,21 +154,11 @@ double Image::getMax() const
 
 double Image::getStandardDeviation() const
 {
-  double mean(0);
-  double squareMean(0);
-  unsigned int counts(0);
+  // Compute the statistics on all the pixels of the image
+  MapStatistics statistics;
+  statistics.computeStatistics(*this);
 
-  // Loop over all values to find the max
-  for (unsigned int i=1; i<m_sizeXaxis*m_sizeYaxis; i++)
-  {
-    mean += m_values[i];
-    squareMean += m_values[i]*m_values[i];
-    counts++;
-  }
-
-  double stdev = sqrt(squareMean/counts - mean*mean/counts/counts);
-
-  return stdev;
+  return statistics.getStandardDeviation(0);
 }
 
 void Image::setValue(unsigned int x, unsigned int y, double value)
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/MapStatistics.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/MapStatistics.h"
+#include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
+#include "TWOD_MASS_WL_MassMapping/Image.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace TWOD_MASS_WL_MassMapping {
+
+MapStatistics::MapStatistics(bool computeMAD, unsigned int nbHistogramBins,
+                             double histogramMin, double histogramMax):
+m_computeMAD(computeMAD), m_nbHistogramBins(nbHistogramBins),
+m_histogramMin(histogramMin), m_histogramMax(histogramMax)
+{
+}
+
+bool MapStatistics::computeStatistics(GlobalMap &map, bool removeOffset)
+{
+  if (map.getXdim()==0 || map.getYdim()==0 || map.getZdim()==0)
+  {
+    return false;
+  }
+
+  // The [y][z] values of a row on the X axis are contiguous in the map. The map is
+  // only accessed through a writable view when the offset is removed, so that its
+  // cached Fourier transform is kept otherwise
+  std::vector<double*> rows(map.getXdim());
+  if (removeOffset)
+  {
+    MapView mapView = map.getView(0, 0, map.getXdim(), map.getYdim());
+    for (unsigned int i=0; i<map.getXdim(); i++)
+    {
+      rows[i] = &mapView[i][0][0];
+    }
+  }
+  else
+  {
+    const GlobalMap &constMap = map;
+    ConstMapView mapView = constMap.getView(0, 0, map.getXdim(), map.getYdim());
+    for (unsigned int i=0; i<map.getXdim(); i++)
+    {
+      rows[i] = const_cast<double*>(&mapView[i][0][0]);
+    }
+  }
+
+  computeRows(rows.data(), map.getXdim(), map.getYdim(), map.getZdim(), removeOffset);
+
+  return true;
+}
+
+bool MapStatistics::computeStatistics(const Image &image)
+{
+  if (image.getXdim()==0 || image.getYdim()==0)
+  {
+    return false;
+  }
+
+  // The values of a row on the Y axis are contiguous in the image
+  std::vector<double*> rows(image.getYdim());
+  for (unsigned int j=0; j<image.getYdim(); j++)
+  {
+    rows[j] = image.getArray() + j*image.getXdim();
+  }
+
+  computeRows(rows.data(), image.getYdim(), image.getXdim(), 1, false);
+
+  return true;
+}
+
+void MapStatistics::computeRows(double **rows, unsigned long nbRows, unsigned long rowLength, unsigned int nbPlans,
+                                bool removeOffset)
+{
+  int nbThreads(1);
+#ifdef _OPENMP
+  nbThreads = omp_get_max_threads();
+#endif
+
+  // Reset the outputs
+  m_count.assign(nbPlans, 0);
+  m_mean.assign(nbPlans, 0.);
+  m_variance.assign(nbPlans, 0.);
+  m_min.assign(nbPlans, std::numeric_limits<double>::max());
+  m_max.assign(nbPlans, -std::numeric_limits<double>::max());
+  m_median.assign(nbPlans, 0.);
+  m_MAD.assign(nbPlans, 0.);
+  m_histogram.assign(nbPlans, std::vector<unsigned long>(m_nbHistogramBins, 0));
+
+  // Partial statistics of each thread, merged in the thread order
+  std::vector<std::vector<double> > partCount(nbThreads, std::vector<double>(nbPlans, 0.));
+  std::vector<std::vector<double> > partMean(nbThreads, std::vector<double>(nbPlans, 0.));
+  std::vector<std::vector<double> > partM2(nbThreads, std::vector<double>(nbPlans, 0.));
+  std::vector<std::vector<double> > partMin(nbThreads, m_min);
+  std::vector<std::vector<double> > partMax(nbThreads, m_max);
+  std::vector<std::vector<std::vector<unsigned long> > > partHistogram(nbThreads, m_histogram);
+
+  // Copy of the values needed to compute the median absolute deviation
+  std::vector<std::vector<double> > madValues(m_computeMAD ? nbPlans : 0, std::vector<double>(nbRows*rowLength));
+
+  #pragma omp parallel num_threads(nbThreads)
+  {
+    int thread(0);
+#ifdef _OPENMP
+    thread = omp_get_thread_num();
+#endif
+    std::vector<double> rowMean(nbPlans);
+    std::vector<double> rowM2(nbPlans);
+
+    #pragma omp for schedule(static)
+    for (long r=0; r<long(nbRows); r++)
+    {
+      const double *row = rows[r];
+
+      // First pass on the row for the sums, extrema, histogram and copies
+      std::fill(rowMean.begin(), rowMean.end(), 0.);
+      for (unsigned long p=0; p<rowLength; p++)
+      {
+        for (unsigned int k=0; k<nbPlans; k++)
+        {
+          double value = row[p*nbPlans+k];
+          rowMean[k] += value;
+          partMin[thread][k] = std::min(partMin[thread][k], value);
+          partMax[thread][k] = std::max(partMax[thread][k], value);
+          if (m_nbHistogramBins>0 && removeOffset==false)
+          {
+            fillHistogram(partHistogram[thread][k], value);
+          }
+          if (m_computeMAD)
+          {
+            madValues[k][r*rowLength+p] = value;
+          }
+        }
+      }
+
+      // Second pass on the row, still in cache, for the squared deviations
+      std::fill(rowM2.begin(), rowM2.end(), 0.);
+      for (unsigned int k=0; k<nbPlans; k++)
+      {
+        rowMean[k] /= rowLength;
+      }
+      for (unsigned long p=0; p<rowLength; p++)
+      {
+        for (unsigned int k=0; k<nbPlans; k++)
+        {
+          double delta = row[p*nbPlans+k] - rowMean[k];
+          rowM2[k] += delta*delta;
+        }
+      }
+
+      // Merge the row into the thread statistics
+      for (unsigned int k=0; k<nbPlans; k++)
+      {
+        double count = partCount[thread][k] + rowLength;
+        double delta = rowMean[k] - partMean[thread][k];
+        partMean[thread][k] += delta*rowLength/count;
+        partM2[thread][k] += rowM2[k] + delta*delta*partCount[thread][k]*rowLength/count;
+        partCount[thread][k] = count;
+      }
+    }
+
+    #pragma omp single
+    {
+      // Merge the threads statistics in a fixed order
+      std::vector<double> count(nbPlans, 0.);
+      std::vector<double> m2(nbPlans, 0.);
+      for (int t=0; t<nbThreads; t++)
+      {
+        for (unsigned int k=0; k<nbPlans; k++)
+        {
+          if (partCount[t][k]==0)
+          {
+            continue;
+          }
+          double newCount = count[k] + partCount[t][k];
+          double delta = partMean[t][k] - m_mean[k];
+          m_mean[k] += delta*partCount[t][k]/newCount;
+          m2[k] += partM2[t][k] + delta*delta*count[k]*partCount[t][k]/newCount;
+          count[k] = newCount;
+          m_min[k] = std::min(m_min[k], partMin[t][k]);
+          m_max[k] = std::max(m_max[k], partMax[t][k]);
+          for (unsigned int b=0; b<m_nbHistogramBins; b++)
+          {
+            m_histogram[k][b] += partHistogram[t][k][b];
+            partHistogram[t][k][b] = 0;
+          }
+        }
+      }
+      for (unsigned int k=0; k<nbPlans; k++)
+      {
+        m_count[k] = count[k];
+        m_variance[k] = m2[k]/count[k];
+      }
+    }
+
+    // Remove the offset from the map, filling the histogram with the new values
+    if (removeOffset)
+    {
+      #pragma omp for schedule(static)
+      for (long r=0; r<long(nbRows); r++)
+      {
+        double *row = rows[r];
+        for (unsigned long p=0; p<rowLength; p++)
+        {
+          for (unsigned int k=0; k<nbPlans; k++)
+          {
+            row[p*nbPlans+k] -= m_mean[k];
+            if (m_nbHistogramBins>0)
+            {
+              fillHistogram(partHistogram[thread][k], row[p*nbPlans+k]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Median and median absolute deviation of each plan
+  for (unsigned int k=0; k<nbPlans && m_computeMAD; k++)
+  {
+    std::vector<double> &values = madValues[k];
+    m_median[k] = getMedianValue(values);
+    for (unsigned long i=0; i<values.size(); i++)
+    {
+      values[i] = fabs(values[i]-m_median[k]);
+    }
+    m_MAD[k] = getMedianValue(values);
+  }
+
+  // Shift the statistics by the removed offsets
+  if (removeOffset)
+  {
+    for (unsigned int k=0; k<nbPlans; k++)
+    {
+      m_min[k] -= m_mean[k];
+      m_max[k] -= m_mean[k];
+      m_median[k] -= m_computeMAD ? m_mean[k] : 0.;
+      m_mean[k] = 0.;
+      for (int t=0; t<nbThreads; t++)
+      {
+        for (unsigned int b=0; b<m_nbHistogramBins; b++)
+        {
+          m_histogram[k][b] += partHistogram[t][k][b];
+        }
+      }
+    }
+  }
+}
+
+double MapStatistics::getMedianValue(std::vector<double> &values) const
+{
+  // Partially sort the values around the middle
+  std::vector<double>::iterator middle = values.begin() + values.size()/2;
+  std::nth_element(values.begin(), middle, values.end());
+
+  // For an even number of values take the mean of the two middle ones
+  if (values.size()%2==0)
+  {
+    return 0.5*(*middle + *std::max_element(values.begin(), middle));
+  }
+  return *middle;
+}
+
+void MapStatistics::fillHistogram(std::vector<unsigned long> &histogram, double value) const
+{
+  if (value>=m_histogramMin && value<m_histogramMax)
+  {
+    unsigned int bin = (value-m_histogramMin)/(m_histogramMax-m_histogramMin)*m_nbHistogramBins;
+    histogram[std::min(bin, m_nbHistogramBins-1)]++;
+  }
+}
+
+unsigned int MapStatistics::getNumberOfPlans() const
+{
+  return m_count.size();
+}
+
+unsigned long MapStatistics::getCount(unsigned int plan) const
+{
+  return plan<m_count.size() ? m_count[plan] : 0;
+}
+
+double MapStatistics::getMean(unsigned int plan) const
+{
+  return plan<m_mean.size() ? m_mean[plan] : 0.;
+}
+
+std::vector<double> MapStatistics::getMeanValues() const
+{
+  return m_mean;
+}
+
+double MapStatistics::getVariance(unsigned int plan) const
+{
+  return plan<m_variance.size() ? m_variance[plan] : 0.;
+}
+
+double MapStatistics::getStandardDeviation(unsigned int plan) const
+{
+  return sqrt(getVariance(plan));
+}
+
+double MapStatistics::getMin(unsigned int plan) const
+{
+  return plan<m_min.size() ? m_min[plan] : 0.;
+}
+
+double MapStatistics::getMax(unsigned int plan) const
+{
+  return plan<m_max.size() ? m_max[plan] : 0.;
+}
+
+double MapStatistics::getMedian(unsigned int plan) const
+{
+  return plan<m_median.size() ? m_median[plan] : 0.;
+}
+
+double MapStatistics::getMAD(unsigned int plan) const
+{
+  return plan<m_MAD.size() ? m_MAD[plan] : 0.;
+}
+
+std::vector<unsigned long> MapStatistics::getHistogram(unsigned int plan) const
+{
+  return plan<m_histogram.size() ? m_histogram[plan] : std::vector<unsigned long>();
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
@@ -0,0 +1,488 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/MappedFITSMap.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/MappedFITSMap.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+namespace {
+
+// Size of the FITS header and data blocks
+const unsigned long fitsBlockSize = 2880;
+const unsigned int fitsCardSize = 80;
+
+// Reads a big endian value of nBytes bytes as an unsigned integer
+uint64_t readBigEndian(const unsigned char *bytes, unsigned int nBytes)
+{
+  uint64_t value = 0;
+  for (unsigned int b=0; b<nBytes; b++)
+  {
+    value = (value << 8) | bytes[b];
+  }
+  return value;
+}
+
+// Parses a whole header value as an integer, false if it is malformed or out of the range of the result
+template <typename T>
+bool parseInteger(const std::string &value, T &result)
+{
+  char *end = nullptr;
+  errno = 0;
+  long long parsed = std::strtoll(value.c_str(), &end, 10);
+  if (value.empty() || errno!=0 || *end!='\0'
+      || (long double)(parsed)<(long double)(std::numeric_limits<T>::min())
+      || (long double)(parsed)>(long double)(std::numeric_limits<T>::max()))
+  {
+    return false;
+  }
+  result = parsed;
+  return true;
+}
+
+// Parses a whole header value as a real number, false if it is malformed or overflows
+bool parseReal(const std::string &value, double &result)
+{
+  char *end = nullptr;
+  errno = 0;
+  double parsed = std::strtod(value.c_str(), &end);
+  if (value.empty() || errno==ERANGE || *end!='\0')
+  {
+    return false;
+  }
+  result = parsed;
+  return true;
+}
+
+} // anonymous namespace
+
+MappedFITSMap::~MappedFITSMap()
+{
+  if (m_mappedFile!=nullptr)
+  {
+    munmap(m_mappedFile, m_mappedSize);
+    m_mappedFile = nullptr;
+  }
+}
+
+MappedFITSMap::MappedFITSMap(std::string filename):
+m_mappedFile(nullptr), m_mappedSize(0), m_sizeXaxis(0), m_sizeYaxis(0), m_sizeZaxis(0),
+m_bitpix(0), m_bscale(1.), m_bzero(0.), m_data(nullptr), m_numberOfGalaxies(0),
+m_boundaries(0, 0, 0, 0, 0, 0), m_rowsPerBlock(1)
+{
+  // An extension may be named as in the cfitsio extended filename syntax, file.fits[EXTNAME]
+  std::string extName;
+  std::size_t bracket = filename.find('[');
+  if (bracket!=std::string::npos && filename.back()==']')
+  {
+    extName = filename.substr(bracket+1, filename.size()-bracket-2);
+    std::transform(extName.begin(), extName.end(), extName.begin(), ::toupper);
+    filename.erase(bracket);
+  }
+
+  int fileDescriptor = open(filename.c_str(), O_RDONLY);
+  if (fileDescriptor<0)
+  {
+    std::cout<<filename<<": can not open this file"<<std::endl;
+    return;
+  }
+
+  struct stat fileStatus;
+  if (fstat(fileDescriptor, &fileStatus)==0 && fileStatus.st_size>0)
+  {
+    m_mappedSize = fileStatus.st_size;
+    void *mapped = mmap(nullptr, m_mappedSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    m_mappedFile = (mapped==MAP_FAILED) ? nullptr : static_cast<unsigned char*>(mapped);
+  }
+
+  // The mapping stays valid once the file is closed
+  close(fileDescriptor);
+
+  if (m_mappedFile==nullptr)
+  {
+    std::cout<<filename<<": can not map this file"<<std::endl;
+    return;
+  }
+
+  // Walk the HDUs up to the named extension, or else up to the first one with data
+  unsigned long headerOffset(0);
+  unsigned long dataOffset(0);
+  unsigned long dataSize(0);
+  bool isImage(false);
+  while (headerOffset<m_mappedSize)
+  {
+    std::string hduName;
+    isImage = parseHeader(headerOffset, dataOffset, dataSize, hduName);
+    if (dataOffset==0 || (extName.empty() ? dataSize>0 : hduName==extName))
+    {
+      break;
+    }
+    isImage = false;
+    headerOffset = dataOffset + (dataSize + fitsBlockSize - 1)/fitsBlockSize*fitsBlockSize;
+  }
+
+  if (isImage==false
+      || dataOffset + (unsigned long)(m_sizeXaxis)*m_sizeYaxis*m_sizeZaxis*std::abs(m_bitpix)/8 > m_mappedSize)
+  {
+    std::cout<<filename<<": not an uncompressed FITS image, can not be mapped"<<std::endl;
+    munmap(m_mappedFile, m_mappedSize);
+    m_mappedFile = nullptr;
+    m_sizeXaxis = 0;
+    m_sizeYaxis = 0;
+    m_sizeZaxis = 0;
+    return;
+  }
+
+  m_data = m_mappedFile + dataOffset;
+
+  // The rows are read in order, in blocks of about 64k values
+  posix_madvise(m_mappedFile, m_mappedSize, POSIX_MADV_SEQUENTIAL);
+  m_rowsPerBlock = std::max(1u, 65536u/m_sizeXaxis);
+  unsigned long nbBlocks = ((unsigned long)(m_sizeYaxis)*m_sizeZaxis + m_rowsPerBlock - 1)/m_rowsPerBlock;
+  m_convertedBlocks.resize(nbBlocks);
+  m_blockFlags.reset(new std::once_flag[nbBlocks]);
+}
+
+bool MappedFITSMap::parseHeader(unsigned long headerOffset, unsigned long &dataOffset,
+                                unsigned long &dataSize, std::string &extName)
+{
+  m_sizeXaxis = 0;
+  m_sizeYaxis = 0;
+  m_sizeZaxis = 0;
+  m_bitpix = 0;
+  m_bscale = 1.;
+  m_bzero = 0.;
+  m_numberOfGalaxies = 0;
+  m_boundaries = Boundaries(0, 0, 0, 0, 0, 0);
+  dataOffset = 0;
+
+  std::string raMin, raMax, decMin, decMax, zMin, zMax;
+  std::string crpix1, crval1, crval2;
+  int naxis(-1);
+  bool image(false);
+  unsigned long axesProduct(1);
+  unsigned long pcount(0);
+  unsigned long gcount(1);
+  // A malformed value makes the HDU, and the ones following it, unreadable
+  bool validValues(true);
+
+  // Loop over the 80 characters cards until the END card
+  for (unsigned long card=0; headerOffset+(card+1)*fitsCardSize<=m_mappedSize; card++)
+  {
+    std::string line(reinterpret_cast<const char*>(m_mappedFile) + headerOffset + card*fitsCardSize,
+                     fitsCardSize);
+    std::string keyword = line.substr(0, 8);
+    std::string value;
+
+    // Keywords longer than 8 characters follow the HIERARCH convention
+    if (keyword=="HIERARCH")
+    {
+      std::size_t equal = line.find('=');
+      if (equal==std::string::npos)
+      {
+        continue;
+      }
+      keyword = line.substr(9, equal-9);
+      value = line.substr(equal+1);
+    }
+    else if (line.compare(8, 2, "= ")==0)
+    {
+      value = line.substr(10);
+    }
+
+    keyword.erase(keyword.find_last_not_of(' ')+1);
+    std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::toupper);
+
+    if (keyword=="END")
+    {
+      dataOffset = headerOffset + ((card+1)*fitsCardSize + fitsBlockSize - 1)/fitsBlockSize*fitsBlockSize;
+      break;
+    }
+
+    // Remove the comment and the quotes of string values
+    std::size_t quote = value.find('\'');
+    if (quote!=std::string::npos)
+    {
+      value = value.substr(quote+1, value.find('\'', quote+1)-quote-1);
+    }
+    else
+    {
+      value = value.substr(0, value.find('/'));
+    }
+    value.erase(0, value.find_first_not_of(' '));
+    value.erase(value.find_last_not_of(' ')+1);
+
+    // The primary HDU starts with SIMPLE and the extensions with XTENSION
+    if (card==0)
+    {
+      image = (keyword=="SIMPLE" && value=="T") || (keyword=="XTENSION" && value=="IMAGE");
+    }
+    else if (keyword=="EXTNAME")
+    {
+      extName = value;
+      std::transform(extName.begin(), extName.end(), extName.begin(), ::toupper);
+    }
+    else if (keyword=="PCOUNT")
+    {
+      validValues = parseInteger(value, pcount) && validValues;
+    }
+    else if (keyword=="GCOUNT")
+    {
+      validValues = parseInteger(value, gcount) && validValues;
+    }
+    else if (keyword=="BITPIX")
+    {
+      validValues = parseInteger(value, m_bitpix) && validValues;
+    }
+    else if (keyword=="NAXIS")
+    {
+      validValues = parseInteger(value, naxis) && validValues;
+    }
+    else if (keyword=="NAXIS1")
+    {
+      validValues = parseInteger(value, m_sizeXaxis) && validValues;
+      axesProduct *= m_sizeXaxis;
+    }
+    else if (keyword=="NAXIS2")
+    {
+      validValues = parseInteger(value, m_sizeYaxis) && validValues;
+      axesProduct *= m_sizeYaxis;
+    }
+    else if (keyword=="NAXIS3")
+    {
+      validValues = parseInteger(value, m_sizeZaxis) && validValues;
+      axesProduct *= m_sizeZaxis;
+    }
+    else if (keyword.compare(0, 5, "NAXIS")==0)
+    {
+      unsigned long axisSize(0);
+      validValues = parseInteger(value, axisSize) && validValues;
+      axesProduct *= axisSize;
+    }
+    else if (keyword=="BSCALE")
+    {
+      validValues = parseReal(value, m_bscale) && validValues;
+    }
+    else if (keyword=="BZERO")
+    {
+      validValues = parseReal(value, m_bzero) && validValues;
+    }
+    else if (keyword=="NGALAXIES")
+    {
+      validValues = parseInteger(value, m_numberOfGalaxies) && validValues;
+    }
+    else if (keyword=="RAMIN")
+    {
+      raMin = value;
+    }
+    else if (keyword=="RAMAX")
+    {
+      raMax = value;
+    }
+    else if (keyword=="DECMIN")
+    {
+      decMin = value;
+    }
+    else if (keyword=="DECMAX")
+    {
+      decMax = value;
+    }
+    else if (keyword=="ZMIN")
+    {
+      zMin = value;
+    }
+    else if (keyword=="ZMAX")
+    {
+      zMax = value;
+    }
+    else if (keyword=="CRPIX1")
+    {
+      crpix1 = value;
+    }
+    else if (keyword=="CRVAL1")
+    {
+      crval1 = value;
+    }
+    else if (keyword=="CRVAL2")
+    {
+      crval2 = value;
+    }
+  }
+
+  if (naxis==2)
+  {
+    m_sizeZaxis = 1;
+  }
+
+  if (!raMin.empty() && !raMax.empty() && !decMin.empty() && !decMax.empty() && !zMin.empty() && !zMax.empty())
+  {
+    double bounds[6];
+    const std::string *boundValues[6] = {&raMin, &raMax, &decMin, &decMax, &zMin, &zMax};
+    for (unsigned int b=0; b<6; b++)
+    {
+      validValues = parseReal(*boundValues[b], bounds[b]) && validValues;
+    }
+    if (validValues)
+    {
+      m_boundaries = Boundaries(bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]);
+    }
+
+    // The reference value is the tangent point in maps written with a CRPIX reference pixel
+    double tangent[2];
+    if (!crpix1.empty() && !crval1.empty() && !crval2.empty()
+        && parseReal(crval1, tangent[0]) && parseReal(crval2, tangent[1]))
+    {
+      m_boundaries.setTangentPoint(tangent[0], tangent[1]);
+    }
+  }
+
+  // The data unit of an HDU with a malformed value can not be located
+  if (validValues==false)
+  {
+    dataOffset = 0;
+    return false;
+  }
+
+  bool knownBitpix = (m_bitpix==8 || m_bitpix==16 || m_bitpix==32 || m_bitpix==64
+                      || m_bitpix==-32 || m_bitpix==-64);
+
+  // Size of the data unit, needed to skip it
+  dataSize = (naxis>0) ? std::abs(m_bitpix)/8*gcount*(pcount + axesProduct) : 0;
+
+  return image && knownBitpix && dataOffset>0 && (naxis==2 || naxis==3)
+         && m_sizeXaxis>0 && m_sizeYaxis>0 && m_sizeZaxis>0;
+}
+
+void MappedFITSMap::convertBlock(unsigned long block) const
+{
+  unsigned long firstRow = block*m_rowsPerBlock;
+  unsigned long nRows = std::min((unsigned long)(m_rowsPerBlock),
+                                 (unsigned long)(m_sizeYaxis)*m_sizeZaxis - firstRow);
+  unsigned int nBytes = std::abs(m_bitpix)/8;
+  const unsigned char *bytes = m_data + firstRow*m_sizeXaxis*nBytes;
+
+  std::vector<double> *values = new std::vector<double>(nRows*m_sizeXaxis);
+  for (unsigned long index=0; index<nRows*m_sizeXaxis; index++, bytes+=nBytes)
+  {
+    uint64_t raw = readBigEndian(bytes, nBytes);
+    double value(0.);
+    if (m_bitpix==-32)
+    {
+      uint32_t raw32 = raw;
+      float floatValue;
+      std::memcpy(&floatValue, &raw32, sizeof(float));
+      value = floatValue;
+    }
+    else if (m_bitpix==-64)
+    {
+      std::memcpy(&value, &raw, sizeof(double));
+    }
+    else if (m_bitpix==8)
+    {
+      value = uint8_t(raw);
+    }
+    else if (m_bitpix==16)
+    {
+      value = int16_t(raw);
+    }
+    else if (m_bitpix==32)
+    {
+      value = int32_t(raw);
+    }
+    else
+    {
+      value = int64_t(raw);
+    }
+    (*values)[index] = m_bzero + m_bscale*value;
+  }
+
+  m_convertedBlocks[block].reset(values);
+}
+
+bool MappedFITSMap::isValid() const
+{
+  return m_mappedFile!=nullptr;
+}
+
+unsigned int MappedFITSMap::getXdim() const
+{
+  return m_sizeXaxis;
+}
+
+unsigned int MappedFITSMap::getYdim() const
+{
+  return m_sizeYaxis;
+}
+
+unsigned int MappedFITSMap::getZdim() const
+{
+  return m_sizeZaxis;
+}
+
+const double* MappedFITSMap::getRow(unsigned int biny, unsigned int binz) const
+{
+  if (biny>=m_sizeYaxis || binz>=m_sizeZaxis)
+  {
+    return nullptr;
+  }
+
+  unsigned long row = (unsigned long)(binz)*m_sizeYaxis + biny;
+  unsigned long block = row/m_rowsPerBlock;
+  std::call_once(m_blockFlags[block], &MappedFITSMap::convertBlock, this, block);
+
+  return m_convertedBlocks[block]->data() + (row - block*m_rowsPerBlock)*m_sizeXaxis;
+}
+
+double MappedFITSMap::getBinValue(unsigned int binx, unsigned int biny, unsigned int binz) const
+{
+  if (binx>=m_sizeXaxis || biny>=m_sizeYaxis || binz>=m_sizeZaxis)
+  {
+    return 0.;
+  }
+
+  return getRow(biny, binz)[binx];
+}
+
+unsigned long MappedFITSMap::getNumberOfGalaxies() const
+{
+  return m_numberOfGalaxies;
+}
+
+Boundaries MappedFITSMap::getBoundaries() const
+{
+  return m_boundaries;
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
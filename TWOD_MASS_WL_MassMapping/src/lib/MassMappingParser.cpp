@@ -26,6 +26,8 @@
 #include "TWOD_MASS_WL_MassMapping/ShearMap.h"
 #include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
 #include "TWOD_MASS_WL_MassMapping/InPaintingAlgo.h"
+#include "TWOD_MASS_WL_MassMapping/MapStatistics.h"
+#include "TWOD_MASS_WL_MassMapping/PowerSpectrum.h"
 
 #include <boost/program_options.hpp>
 
@@ -55,7 +57,9 @@ MassMappingParser::MassMappingParser(): m_ShearMap(nullptr), m_ConvergenceMap(nu
     m_inputFITSconvergenceMap(""), m_outputFITSshearMap(""), m_outputFITSconvergenceMap(""), m_workDir(""),
     m_getMeanConv(false), m_getMeanShear(false), m_removeOffsetConv(false), m_removeOffsetShear(false),
     m_sigmaXconv(0.), m_sigmaYconv(0.), m_sigmaXshear(0.), m_sigmaYshear(0.), m_bModes(false), m_addBorders(false),
-    m_sigmaBounded(false), m_nbScales(0), m_minThreshold(0.), m_maxThreshold(-10.), m_numberIter(0)
+    m_borderWidth(0), m_mirrorBorders(false), m_sigmaBounded(false), m_nbScales(0), m_minThreshold(0.), m_maxThreshold(-10.), m_numberIter(0),
+    m_outputFITSpowerSpectrum(""), m_powerSpectrumBins(0), m_ellMin(0.), m_ellMax(0.), m_powerSpectrumLogBins(true),
+    m_outputCompression(noCompression), m_outputFITSproduct("")
 {
 }
 
@@ -75,14 +79,19 @@ po::options_description MassMappingParser::defineSpecificProgramOptions()
 
       ("outputConvMapFITS", po::value<std::string>(), "output file in which to save the convergence map")
       ("outputShearMapFITS", po::value<std::string>(), "output file in which to save the shear map")
+      ("outputCompression", po::value<std::string>()->default_value("none"),
+       "tile compression of the output maps: none, rice (quantized) or gzip (lossless) (default none)")
+      ("outputProductFITS", po::value<std::string>(),
+       "product file in which to save the output map as the CONVERGENCE or SHEAR extension"
+       " (input maps may also be read from extensions, given as file.fits[EXTNAME])")
 
       ("sigmaConvMap", po::value<std::vector<float> >()->multitoken(),
        "sigma to apply gaussian filter to convergence map (default none)")
       ("sigmaShearMap", po::value<std::vector<float> >()->multitoken(),
        "sigma to apply gaussian filter to shear map (default none)")
-/*
+
       ("getMeanConvMap", po::value<int>()->default_value(0),
-       "set to 1 to get the mean values of the shear map (default 0)")
+       "set to 1 to get the mean values of the convergence map (default 0)")
       ("getMeanShearMap", po::value<int>()->default_value(0),
        "set to 1 to get the mean values of the shear map (default 0)")
 
@@ -90,7 +99,16 @@ po::options_description MassMappingParser::defineSpecificProgramOptions()
        "set to 1 to remove the offset value of the convergence map (default 0)")
       ("removeOffsetShearMap", po::value<int>()->default_value(0),
        "set to 1 to remove the offset value of the shear map (default 0)")
-*/
+
+      ("powerSpectrumBins", po::value<int>()->default_value(0),
+       "number of ell bins of the convergence power spectrum (default 0, no power spectrum)")
+      ("powerSpectrumEllMinMax", po::value<std::vector<float> >()->multitoken(),
+       "minimum and maximum ell of the power spectrum bins (default fundamental and highest modes of the map)")
+      ("powerSpectrumLogBins", po::value<int>()->default_value(1),
+       "set to 0 to use linear ell bins for the power spectrum (default 1)")
+      ("outputPowerSpectrumFITS", po::value<std::string>(),
+       "output file in which to save the power spectrum (default outputConvMapFITS with _powerSpectrum suffix)")
+
       ("numberIteration", po::value<int>()->default_value(0),
        "number of iterations used in the inpainting algo")
       ("sigmaBounded", po::value<int>()->default_value(0),
@@ -103,6 +121,11 @@ po::options_description MassMappingParser::defineSpecificProgramOptions()
 
       ("addBorders", po::value<int>()->default_value(0),
        "set to 1 to add borders to the map during the computation (default 0)")
+      ("borderWidth", po::value<int>()->default_value(0),
+       "minimum width in pixels of the borders to add, the map being padded to an FFT friendly size "
+       "(default 0, replaces addBorders when set)")
+      ("mirrorBorders", po::value<int>()->default_value(0),
+       "set to 1 to fill the borders of borderWidth with the mirrored map instead of zeros (default 0)")
       ("bModeZeros", po::value<int>()->default_value(0),
        "set to 1 to force B-mode to zeros during inpainting iterations (default 0)");
 
@@ -274,6 +297,67 @@ bool MassMappingParser::parseInputParameters(std::map<std::string, po::variable_
         m_addBorders = true;
       }
     }
+    else if (it->first=="outputCompression")
+    {
+      std::string compression = args["outputCompression"].as<std::string>();
+      if (compression=="rice")
+      {
+        m_outputCompression = riceCompression;
+      }
+      else if (compression=="gzip")
+      {
+        m_outputCompression = gzipCompression;
+      }
+      else if (compression!="none")
+      {
+        std::cout<<"unknown output compression "<<compression<<", maps saved without compression"<<std::endl;
+      }
+    }
+    else if (it->first=="powerSpectrumBins")
+    {
+      if (args["powerSpectrumBins"].as<int>()>0)
+      {
+        m_powerSpectrumBins = args["powerSpectrumBins"].as<int>();
+      }
+    }
+    else if (it->first=="powerSpectrumEllMinMax")
+    {
+      std::vector<float> ellMinMax = args["powerSpectrumEllMinMax"].as<std::vector<float> >();
+      m_ellMin = ellMinMax[0];
+      if (ellMinMax.size()>1)
+      {
+        m_ellMax = ellMinMax[1];
+      }
+    }
+    else if (it->first=="powerSpectrumLogBins")
+    {
+      if (args["powerSpectrumLogBins"].as<int>()==0)
+      {
+        m_powerSpectrumLogBins = false;
+      }
+    }
+    else if (it->first=="outputPowerSpectrumFITS")
+    {
+      m_outputFITSpowerSpectrum = args["outputPowerSpectrumFITS"].as<std::string>();
+    }
+    else if (it->first=="outputProductFITS")
+    {
+      m_outputFITSproduct = args["outputProductFITS"].as<std::string>();
+    }
+    else if (it->first=="borderWidth")
+    {
+      if (args["borderWidth"].as<int>()>0)
+      {
+        m_borderWidth = args["borderWidth"].as<int>();
+      }
+    }
+    else if (it->first=="mirrorBorders")
+    {
+      if (args["mirrorBorders"].as<int>()==1)
+      {
+        m_mirrorBorders = true;
+      }
+    }
     else if (it->first=="bModeZeros")
     {
       if (args["bModeZeros"].as<int>()==1)
@@ -290,6 +374,19 @@ bool MassMappingParser::parseInputParameters(std::map<std::string, po::variable_
     return false;
   }
 
+  // With a product file the output map is saved as one of its extensions
+  if (m_outputFITSproduct.empty()==false)
+  {
+    if (m_inputFITSshearMap.empty()==false)
+    {
+      m_outputFITSconvergenceMap = m_outputFITSproduct + "[" + convergenceExtension + "]";
+    }
+    else
+    {
+      m_outputFITSshearMap = m_outputFITSproduct + "[" + shearExtension + "]";
+    }
+  }
+
   return true;
 }
 
@@ -310,7 +407,12 @@ bool MassMappingParser::perform2DMassMapping(std::map<std::string, po::variable_
     processShearMap(args);
 
     // In case borders have to be added
-    if (m_addBorders)
+    if (m_borderWidth>0)
+    {
+      m_paddingPolicy = PaddingPolicy(m_borderWidth, m_mirrorBorders ? mirrorPadding : zeroPadding);
+      m_paddingPolicy.padMap(*m_ShearMap);
+    }
+    else if (m_addBorders)
     {
       m_ShearMap->addBorders();
     }
@@ -321,6 +423,12 @@ bool MassMappingParser::perform2DMassMapping(std::map<std::string, po::variable_
     std::cout<<"time to get the conv map out of the shear map: ";
     std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
 
+    // Crop back the borders if inpainting does not need them anymore
+    if (m_borderWidth>0 && m_numberIter==0)
+    {
+      m_paddingPolicy.cropMap(*m_ConvergenceMap);
+    }
+
     // Perform processing of the convergence map
     processConvergenceMap(args);
 
@@ -339,7 +447,12 @@ bool MassMappingParser::perform2DMassMapping(std::map<std::string, po::variable_
     processConvergenceMap(args);
 
     // In case borders have to be added
-    if (m_addBorders)
+    if (m_borderWidth>0)
+    {
+      m_paddingPolicy = PaddingPolicy(m_borderWidth, m_mirrorBorders ? mirrorPadding : zeroPadding);
+      m_paddingPolicy.padMap(*m_ConvergenceMap);
+    }
+    else if (m_addBorders)
     {
       m_ConvergenceMap->addBorders();
     }
@@ -350,6 +463,12 @@ bool MassMappingParser::perform2DMassMapping(std::map<std::string, po::variable_
     std::cout<<"time to get the shear map out of the conv map: ";
     std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
 
+    // Crop back the borders
+    if (m_borderWidth>0)
+    {
+      m_paddingPolicy.cropMap(*m_ShearMap);
+    }
+
     // Perform processing of the shear map
     processShearMap(args);
   }
@@ -387,16 +506,17 @@ void MassMappingParser::processConvergenceMap(std::map<std::string, po::variable
      std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
    }
 
-   // If the offset has to be removed from the map
-   if (m_removeOffsetConv)
+   // Compute the statistics of the map if needed, removing the offset in the same pass
+   MapStatistics statistics;
+   if (m_removeOffsetConv || m_getMeanConv)
    {
-     m_ConvergenceMap->removeOffset(m_ConvergenceMap->getMeanValues());
+     statistics.computeStatistics(*m_ConvergenceMap, m_removeOffsetConv);
    }
 
    // If an output file for the convergence map is provided then save it
    if (m_outputFITSconvergenceMap.empty()==false)
    {
-     if (m_ConvergenceMap->saveToFITSfile(m_workDir + m_outputFITSconvergenceMap, true, args)==false)
+     if (m_ConvergenceMap->saveToFITSfile(m_workDir + m_outputFITSconvergenceMap, true, args, m_outputCompression)==false)
      {
        std::cout<<"could not save the convergence map to a FITS file"<<std::endl;
      }
@@ -405,9 +525,36 @@ void MassMappingParser::processConvergenceMap(std::map<std::string, po::variable
    // If the mean of the map if asked then display it
    if (m_getMeanConv)
    {
-     std::vector<double> tmpMean = m_ConvergenceMap->getMeanValues();
-     std::cout<<"mean value of E-mode: "<<tmpMean[0]<<std::endl;
-     std::cout<<"mean value of B-mode: "<<tmpMean[1]<<std::endl;
+     std::cout<<"mean value of E-mode: "<<statistics.getMean(0)<<std::endl;
+     std::cout<<"mean value of B-mode: "<<statistics.getMean(1)<<std::endl;
+     std::cout<<"standard deviation of E-mode: "<<statistics.getStandardDeviation(0)<<std::endl;
+     std::cout<<"standard deviation of B-mode: "<<statistics.getStandardDeviation(1)<<std::endl;
+   }
+
+   // Compute the power spectrum of the map if needed and save it
+   if (m_powerSpectrumBins>0)
+   {
+     std::string outputName = m_outputFITSpowerSpectrum;
+     if (outputName.empty())
+     {
+       outputName = m_outputFITSconvergenceMap.empty() ? "convergenceMap.fits" : m_outputFITSconvergenceMap;
+       outputName = outputName.substr(0, outputName.find('['));
+       // A name without extension gets the suffix at its end
+       std::size_t found = outputName.rfind(".");
+       std::size_t slash = outputName.rfind("/");
+       if (found==std::string::npos || (slash!=std::string::npos && found<slash))
+       {
+         found = outputName.size();
+       }
+       outputName.insert(found, "_powerSpectrum");
+     }
+
+     PowerSpectrum powerSpectrum(m_powerSpectrumBins, m_ellMin, m_ellMax, m_powerSpectrumLogBins);
+     if (powerSpectrum.computePowerSpectrum(*m_ConvergenceMap)==false
+         || powerSpectrum.saveToFITSfile(m_workDir + outputName, true)==false)
+     {
+       std::cout<<"could not save the power spectrum to a FITS file"<<std::endl;
+     }
    }
 }
 
@@ -422,16 +569,17 @@ void MassMappingParser::processShearMap(std::map<std::string, po::variable_value
     std::cout<<double(clock() - tStart)/CLOCKS_PER_SEC<<std::endl;
   }
 
-  // If the offset has to be removed from the map
-  if (m_removeOffsetShear)
+  // Compute the statistics of the map if needed, removing the offset in the same pass
+  MapStatistics statistics;
+  if (m_removeOffsetShear || m_getMeanShear)
   {
-    m_ShearMap->removeOffset(m_ShearMap->getMeanValues());
+    statistics.computeStatistics(*m_ShearMap, m_removeOffsetShear);
   }
 
   // If an output file is provided for the shear map then save it
   if (m_outputFITSshearMap.empty()==false)
   {
-    if (m_ShearMap->saveToFITSfile(m_workDir + m_outputFITSshearMap, true, args)==false)
+    if (m_ShearMap->saveToFITSfile(m_workDir + m_outputFITSshearMap, true, args, m_outputCompression)==false)
     {
       std::cout<<"could not save the shear map to a FITS file"<<std::endl;
     }
@@ -440,9 +588,10 @@ void MassMappingParser::processShearMap(std::map<std::string, po::variable_value
   // If the mean of the map if asked then display it
   if (m_getMeanShear)
   {
-    std::vector<double> tmpMean = m_ShearMap->getMeanValues();
-    std::cout<<"mean value of G1: "<<tmpMean[0]<<std::endl;
-    std::cout<<"mean value of G2: "<<tmpMean[1]<<std::endl;
+    std::cout<<"mean value of G1: "<<statistics.getMean(0)<<std::endl;
+    std::cout<<"mean value of G2: "<<statistics.getMean(1)<<std::endl;
+    std::cout<<"standard deviation of G1: "<<statistics.getStandardDeviation(0)<<std::endl;
+    std::cout<<"standard deviation of G2: "<<statistics.getStandardDeviation(1)<<std::endl;
   }
 }
 
@@ -467,12 +616,16 @@ bool MassMappingParser::performInPainting(std::map<std::string, po::variable_val
   }
 
   // In case borders were added, remove them
-  if (m_addBorders)
+  if (m_borderWidth>0)
+  {
+    m_paddingPolicy.cropMap(*IPconvMap);
+  }
+  else if (m_addBorders)
   {
     IPconvMap->removeBorders();
   }
 
-  IPconvMap->saveToFITSfile(m_workDir + m_outputFITSconvergenceMap, true, args);
+  IPconvMap->saveToFITSfile(m_workDir + m_outputFITSconvergenceMap, true, args, m_outputCompression);
 
   delete m_ShearMap;
   delete m_ConvergenceMap;
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/MassMappingStage.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/MassMappingStage.h"
+#include "TWOD_MASS_WL_MassMapping/InPaintingAlgo.h"
+
+#include <iostream>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+MassMappingStage::~MassMappingStage()
+{
+  if (m_convergenceMap!=nullptr)
+  {
+    delete m_convergenceMap;
+    m_convergenceMap = nullptr;
+  }
+}
+
+MassMappingStage::MassMappingStage(unsigned int nbIterInpainting, unsigned int nbScales,
+                                   bool sigmaBounded, bool bModeZeros):
+m_nbIterInpainting(nbIterInpainting), m_nbScales(nbScales), m_sigmaBounded(sigmaBounded),
+m_bModeZeros(bModeZeros), m_sigmaX(0.), m_sigmaY(0.), m_borderWidth(0), m_paddingMode(zeroPadding),
+m_outputFile(""), m_outputCompression(noCompression), m_convergenceMap(nullptr)
+{
+}
+
+void MassMappingStage::setGaussianFilter(double sigmaX, double sigmaY)
+{
+  m_sigmaX = sigmaX;
+  m_sigmaY = sigmaY;
+}
+
+void MassMappingStage::setBorders(unsigned int borderWidth, paddingMode mode)
+{
+  m_borderWidth = borderWidth;
+  m_paddingMode = mode;
+}
+
+void MassMappingStage::setOutputFile(std::string filename, fitsCompression compression)
+{
+  m_outputFile = filename;
+  m_outputCompression = compression;
+}
+
+bool MassMappingStage::computeConvergenceMap(ShearMap &shearMap)
+{
+  if (m_convergenceMap!=nullptr)
+  {
+    delete m_convergenceMap;
+    m_convergenceMap = nullptr;
+  }
+
+  if (shearMap.getXdim()==0 || shearMap.getYdim()==0)
+  {
+    return false;
+  }
+
+  // The borders are added to a copy, so that the input shear map can be used again
+  // for instance in reduced shear iterations
+  PaddingPolicy paddingPolicy(m_borderWidth, m_paddingMode);
+  ShearMap *paddedShearMap = nullptr;
+  if (m_borderWidth>0)
+  {
+    paddedShearMap = new ShearMap(shearMap);
+    paddingPolicy.padMap(*paddedShearMap);
+  }
+  ShearMap &inputShearMap = (paddedShearMap!=nullptr) ? *paddedShearMap : shearMap;
+
+  // Perform K&S inversion
+  m_convergenceMap = new ConvergenceMap(inputShearMap.getConvergenceMap());
+
+  // Crop back the borders if inpainting does not need them
+  if (m_borderWidth>0 && m_nbIterInpainting==0)
+  {
+    paddingPolicy.cropMap(*m_convergenceMap);
+  }
+
+  // if needed apply a gaussian filter to the convergence map
+  if (m_sigmaX>0.001)
+  {
+    m_convergenceMap->applyGaussianFilter(m_sigmaX, m_sigmaY);
+  }
+
+  // Perform the inpainting starting from the K&S convergence map
+  if (m_nbIterInpainting>0)
+  {
+    InPaintingAlgo myIPalgo(inputShearMap, *m_convergenceMap, m_nbScales);
+    ConvergenceMap *IPconvMap = myIPalgo.performInPaintingAlgo(m_nbIterInpainting, m_sigmaBounded, m_bModeZeros);
+
+    delete m_convergenceMap;
+    m_convergenceMap = IPconvMap;
+
+    if (m_convergenceMap!=nullptr && m_borderWidth>0)
+    {
+      paddingPolicy.cropMap(*m_convergenceMap);
+    }
+  }
+
+  if (paddedShearMap!=nullptr)
+  {
+    delete paddedShearMap;
+    paddedShearMap = nullptr;
+  }
+
+  if (m_convergenceMap==nullptr)
+  {
+    return false;
+  }
+
+  // Save the convergence map only if asked
+  if (m_outputFile.empty()==false)
+  {
+    if (m_convergenceMap->saveToFITSfile(m_outputFile, true, getHeaderParameters(), m_outputCompression)==false)
+    {
+      std::cout<<"could not save the convergence map to a FITS file"<<std::endl;
+    }
+  }
+
+  return true;
+}
+
+ConvergenceMap* MassMappingStage::getConvergenceMap() const
+{
+  return m_convergenceMap;
+}
+
+std::map<std::string, po::variable_value> MassMappingStage::getHeaderParameters() const
+{
+  std::map<std::string, po::variable_value> param;
+  param["numberIteration"] = po::variable_value(boost::any(int(m_nbIterInpainting)), false);
+  param["bModeZeros"] = po::variable_value(boost::any(m_bModeZeros?int(1):int(0)), false);
+  param["sigmaBounded"] = po::variable_value(boost::any(m_sigmaBounded?int(1):int(0)), false);
+  if (m_nbScales>0)
+  {
+    param["numberScales"] = po::variable_value(boost::any(int(m_nbScales)), false);
+  }
+
+  return param;
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
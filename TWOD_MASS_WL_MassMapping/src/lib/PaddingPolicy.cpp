@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/PaddingPolicy.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/PaddingPolicy.h"
+
+namespace TWOD_MASS_WL_MassMapping {
+
+PaddingPolicy::PaddingPolicy(unsigned int borderWidth, paddingMode mode):
+m_borderWidth(borderWidth), m_mode(mode), m_originalSizeX(0), m_originalSizeY(0),
+m_paddedSizeX(0), m_paddedSizeY(0)
+{
+}
+
+unsigned int PaddingPolicy::getFFTFriendlySize(unsigned int minSize)
+{
+  if (minSize<=1)
+  {
+    return 1;
+  }
+
+  // Look for the smallest size for which only factors 2, 3, 5 and 7 remain
+  unsigned int size = minSize;
+  while (true)
+  {
+    unsigned int remainder = size;
+    for (unsigned int factor : {2, 3, 5, 7})
+    {
+      while (remainder%factor==0)
+      {
+        remainder /= factor;
+      }
+    }
+    if (remainder==1)
+    {
+      return size;
+    }
+    size++;
+  }
+}
+
+unsigned int PaddingPolicy::getPaddedSize(unsigned int size) const
+{
+  return getFFTFriendlySize(size + 2*m_borderWidth);
+}
+
+void PaddingPolicy::preparePadding(unsigned int sizeX, unsigned int sizeY)
+{
+  m_originalSizeX = sizeX;
+  m_originalSizeY = sizeY;
+  m_paddedSizeX = getPaddedSize(sizeX);
+  m_paddedSizeY = getPaddedSize(sizeY);
+}
+
+MapView PaddingPolicy::getInnerView(GlobalMap &paddedMap) const
+{
+  return paddedMap.getView(getXoffset(), getYoffset(), m_originalSizeX, m_originalSizeY);
+}
+
+bool PaddingPolicy::padMap(GlobalMap &map)
+{
+  unsigned int originalSizeX = map.getXdim();
+  unsigned int originalSizeY = map.getYdim();
+  unsigned int paddedSizeX = getPaddedSize(originalSizeX);
+  unsigned int paddedSizeY = getPaddedSize(originalSizeY);
+
+  // Center the map in the padded one
+  if (map.padMap(paddedSizeX, paddedSizeY, (paddedSizeX-originalSizeX)/2, (paddedSizeY-originalSizeY)/2,
+                 m_mode==mirrorPadding)==false)
+  {
+    return false;
+  }
+
+  // Keep the geometry to be able to crop back
+  preparePadding(originalSizeX, originalSizeY);
+
+  return true;
+}
+
+bool PaddingPolicy::cropMap(GlobalMap &map) const
+{
+  // Check a map was padded and this one has the padded dimensions
+  if (m_paddedSizeX==0 || map.getXdim()!=m_paddedSizeX || map.getYdim()!=m_paddedSizeY)
+  {
+    return false;
+  }
+
+  return map.cropMap(m_originalSizeX, m_originalSizeY, getXoffset(), getYoffset());
+}
+
+unsigned int PaddingPolicy::getXoffset() const
+{
+  return (m_paddedSizeX-m_originalSizeX)/2;
+}
+
+unsigned int PaddingPolicy::getYoffset() const
+{
+  return (m_paddedSizeY-m_originalSizeY)/2;
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
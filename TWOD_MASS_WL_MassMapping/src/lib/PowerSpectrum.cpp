@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/PowerSpectrum.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/PowerSpectrum.h"
+#include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+
+#include <CCfits/CCfits>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+PowerSpectrum::PowerSpectrum(unsigned int nbBins, double ellMin, double ellMax, bool logBins):
+  m_nbBins(nbBins), m_ellMin(ellMin), m_ellMax(ellMax), m_logBins(logBins)
+{
+}
+
+bool PowerSpectrum::computePowerSpectrum(ConvergenceMap &convMap)
+{
+  unsigned int sizeX = convMap.getXdim();
+  unsigned int sizeY = convMap.getYdim();
+  if (sizeX*sizeY == 0)
+  {
+    std::cout << "Error: cannot compute the power spectrum of an empty map" << std::endl;
+    return false;
+  }
+
+  // The transform cached in the map is reused, e.g. after a Kaiser & Squires inversion
+  return computePowerSpectrum(convMap.getFourierTransform(), sizeX, sizeY, convMap.getBoundaries());
+}
+
+bool PowerSpectrum::computePowerSpectrum(ShearMap &shearMap)
+{
+  unsigned int sizeX = shearMap.getXdim();
+  unsigned int sizeY = shearMap.getYdim();
+  if (sizeX*sizeY == 0 || shearMap.getZdim() < 2)
+  {
+    std::cout << "Error: cannot compute the power spectrum of a shear map without two components" << std::endl;
+    return false;
+  }
+
+  // Copy the transform of the shear map, reused if already cached
+  const fftw_complex *fft_gamma_complex = shearMap.getFourierTransform();
+  fftw_complex *fft_complex = (fftw_complex *) fftw_malloc(sizeof(fftw_complex)*sizeX*sizeY);
+  std::copy(&fft_gamma_complex[0][0], &fft_gamma_complex[0][0] + 2*sizeX*sizeY, &fft_complex[0][0]);
+
+  // Multiply the shear modes by the Kaiser & Squires kernel to get the convergence modes
+  for (unsigned int j=0; j<sizeY; j++)
+  {
+    for (unsigned int i=0; i<sizeX; i++)
+    {
+      unsigned int index = j*sizeX+i;
+      if (index == 0)
+      {
+        fft_complex[0][0] = 0.;
+        fft_complex[0][1] = 0.;
+        continue;
+      }
+      int l1 = (double(i) <= double(sizeX)/2. ? i : int(i) - int(sizeX));
+      int l2 = (double(j) <= double(sizeY)/2. ? j : int(j) - int(sizeY));
+      double norm = double(l1*l1+l2*l2);
+      double psiRe = double(l1*l1-l2*l2)/norm;
+      double psiIm = -double(2*l1*l2)/norm;
+      double gammaRe = fft_complex[index][0];
+      double gammaIm = fft_complex[index][1];
+      fft_complex[index][0] = psiRe*gammaRe - psiIm*gammaIm;
+      fft_complex[index][1] = psiRe*gammaIm + psiIm*gammaRe;
+    }
+  }
+
+  bool result = computePowerSpectrum(fft_complex, sizeX, sizeY, shearMap.getBoundaries());
+
+  fftw_free(fft_complex);
+
+  return result;
+}
+
+bool PowerSpectrum::computePowerSpectrum(const fftw_complex *fftKappa, unsigned int sizeXaxis,
+                                         unsigned int sizeYaxis, const Boundaries &boundaries)
+{
+  if (m_nbBins == 0 || fftKappa == nullptr || sizeXaxis*sizeYaxis < 2)
+  {
+    std::cout << "Error: power spectrum needs at least one bin and a non empty map" << std::endl;
+    return false;
+  }
+
+  // Pixel sizes in radians, or in pixel units if the boundaries are not set
+  double dx = (boundaries.getRaMax() - boundaries.getRaMin())*M_PI/180./sizeXaxis;
+  double dy = (boundaries.getDecMax() - boundaries.getDecMin())*M_PI/180./sizeYaxis;
+  if (dx <= 0. || dy <= 0.)
+  {
+    dx = 1.;
+    dy = 1.;
+  }
+
+  double ellFactorX = 2.*M_PI/(sizeXaxis*dx);
+  double ellFactorY = 2.*M_PI/(sizeYaxis*dy);
+  double normFactor = dx*dy/(double(sizeXaxis)*double(sizeYaxis));
+
+  // Default edges: the fundamental mode and the highest mode of the map
+  double ellMin = m_ellMin;
+  double ellMax = m_ellMax;
+  if (ellMin <= 0.)
+  {
+    ellMin = std::min(ellFactorX, ellFactorY);
+  }
+  if (ellMax <= 0.)
+  {
+    ellMax = std::sqrt(std::pow(ellFactorX*(sizeXaxis/2), 2) + std::pow(ellFactorY*(sizeYaxis/2), 2));
+  }
+  if (ellMax <= ellMin)
+  {
+    std::cout << "Error: power spectrum maximum ell should be greater than minimum ell" << std::endl;
+    return false;
+  }
+
+  double binMin = m_logBins ? std::log(ellMin) : ellMin;
+  double binWidth = ((m_logBins ? std::log(ellMax) : ellMax) - binMin)/m_nbBins;
+
+  m_ell.assign(m_nbBins, 0.);
+  m_powerE.assign(m_nbBins, 0.);
+  m_powerB.assign(m_nbBins, 0.);
+  m_powerEB.assign(m_nbBins, 0.);
+  m_nbModes.assign(m_nbBins, 0);
+
+  for (unsigned int j=0; j<sizeYaxis; j++)
+  {
+    int fj = (double(j) <= double(sizeYaxis)/2. ? j : int(j) - int(sizeYaxis));
+    unsigned int jOpp = (sizeYaxis - j)%sizeYaxis;
+    for (unsigned int i=0; i<sizeXaxis; i++)
+    {
+      // Skip the zero mode
+      if (i+j == 0)
+      {
+        continue;
+      }
+
+      int fi = (double(i) <= double(sizeXaxis)/2. ? i : int(i) - int(sizeXaxis));
+      double ell = std::sqrt(std::pow(ellFactorX*fi, 2) + std::pow(ellFactorY*fj, 2));
+      if (ell < ellMin || ell > ellMax)
+      {
+        continue;
+      }
+
+      int bin = int(((m_logBins ? std::log(ell) : ell) - binMin)/binWidth);
+      if (bin >= int(m_nbBins))
+      {
+        bin = m_nbBins-1;
+      }
+
+      // E and B modes from the transform of kappaE + i kappaB and its opposite mode
+      unsigned int iOpp = (sizeXaxis - i)%sizeXaxis;
+      double a = fftKappa[j*sizeXaxis+i][0];
+      double b = fftKappa[j*sizeXaxis+i][1];
+      double c = fftKappa[jOpp*sizeXaxis+iOpp][0];
+      double d = fftKappa[jOpp*sizeXaxis+iOpp][1];
+      double eRe = 0.5*(a+c);
+      double eIm = 0.5*(b-d);
+      double bRe = 0.5*(b+d);
+      double bIm = 0.5*(c-a);
+
+      m_ell[bin] += ell;
+      m_powerE[bin] += eRe*eRe + eIm*eIm;
+      m_powerB[bin] += bRe*bRe + bIm*bIm;
+      m_powerEB[bin] += eRe*bRe + eIm*bIm;
+      m_nbModes[bin]++;
+    }
+  }
+
+  for (unsigned int bin=0; bin<m_nbBins; bin++)
+  {
+    if (m_nbModes[bin] == 0)
+    {
+      double center = binMin + (bin+0.5)*binWidth;
+      m_ell[bin] = m_logBins ? std::exp(center) : center;
+      continue;
+    }
+    m_ell[bin] /= m_nbModes[bin];
+    m_powerE[bin] *= normFactor/m_nbModes[bin];
+    m_powerB[bin] *= normFactor/m_nbModes[bin];
+    m_powerEB[bin] *= normFactor/m_nbModes[bin];
+  }
+
+  return true;
+}
+
+std::vector<double> PowerSpectrum::getEll() const
+{
+  return m_ell;
+}
+
+std::vector<double> PowerSpectrum::getPowerE() const
+{
+  return m_powerE;
+}
+
+std::vector<double> PowerSpectrum::getPowerB() const
+{
+  return m_powerB;
+}
+
+std::vector<double> PowerSpectrum::getPowerEB() const
+{
+  return m_powerEB;
+}
+
+std::vector<long> PowerSpectrum::getNumberOfModes() const
+{
+  return m_nbModes;
+}
+
+bool PowerSpectrum::saveToFITSfile(std::string filename, bool overwrite) const
+{
+  if (m_ell.empty())
+  {
+    std::cout << "Error: no power spectrum to save" << std::endl;
+    return false;
+  }
+
+  if (overwrite)
+  {
+    filename = "!"+filename;
+  }
+
+  try
+  {
+    CCfits::FITS *outFits = new CCfits::FITS(filename, CCfits::RWmode::Write, true);
+
+    std::string hduName("powerSpectrum");
+
+    std::vector< CCfits::String > colNames = {"ELL", "POWER_E", "POWER_B", "POWER_EB", "NMODES"};
+    std::vector< CCfits::String > colForms = {"D", "D", "D", "D", "K"};
+    std::vector< CCfits::String > colUnits = {"multipole", "sr", "sr", "sr", "modes"};
+
+    CCfits::Table *table = outFits->addTable(hduName, m_ell.size(), colNames, colForms, colUnits,
+                                             CCfits::BinaryTbl, 1);
+
+    table->column(1).write(m_ell, 0l);
+    table->column(2).write(m_powerE, 0l);
+    table->column(3).write(m_powerB, 0l);
+    table->column(4).write(m_powerEB, 0l);
+    table->column(5).write(m_nbModes, 0l);
+
+    delete outFits;
+    outFits = nullptr;
+  }
+  catch (CCfits::FitsException&)
+  {
+    std::cout << "Error: could not save the power spectrum in " << filename << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
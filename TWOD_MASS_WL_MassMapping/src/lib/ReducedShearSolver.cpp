@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/ReducedShearSolver.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_MassMapping/ReducedShearSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TWOD_MASS_WL_MassMapping {
+
+ReducedShearSolver::ReducedShearSolver(const ShearMap &shearMap, unsigned int maxIterations, double tolerance):
+m_originalShearMap(shearMap), m_correctedShearMap(shearMap),
+m_kappa(shearMap.getXdim()*shearMap.getYdim(), 0.),
+m_maxIterations(std::max(maxIterations, 1u)), m_tolerance(tolerance), m_nbIterations(0), m_lastChange(0.)
+{
+}
+
+bool ReducedShearSolver::solve(MassMappingStage &massMappingStage)
+{
+  // Restart from the original shear
+  std::fill(m_kappa.begin(), m_kappa.end(), 0.);
+  correctShear();
+  m_nbIterations = 0;
+  m_lastChange = 0.;
+
+  for (unsigned int iter=0; iter<m_maxIterations; iter++)
+  {
+    if (massMappingStage.computeConvergenceMap(m_correctedShearMap)==false)
+    {
+      return false;
+    }
+    m_nbIterations++;
+
+    m_lastChange = updateConvergence(*massMappingStage.getConvergenceMap());
+    if (m_lastChange<0.)
+    {
+      return false;
+    }
+
+    // No new correction if the convergence is stable or for the last iteration
+    if (m_lastChange<=m_tolerance || iter+1==m_maxIterations)
+    {
+      break;
+    }
+    correctShear();
+  }
+
+  return true;
+}
+
+double ReducedShearSolver::updateConvergence(const ConvergenceMap &convMap)
+{
+  unsigned int sizeX = m_originalShearMap.getXdim();
+  unsigned int sizeY = m_originalShearMap.getYdim();
+  if (convMap.getXdim()!=sizeX || convMap.getYdim()!=sizeY)
+  {
+    return -1.;
+  }
+
+  // The [y][z] values of a row on the X axis are contiguous
+  ConstMapView convView = convMap.getView(0, 0, sizeX, sizeY);
+  unsigned int convSizeZ = convMap.getZdim();
+
+  double maxChange = 0.;
+  #pragma omp parallel for reduction(max:maxChange)
+  for (int i=0; i<int(sizeX); i++)
+  {
+    const double *convRow = &convView[i][0][0];
+    double *kappaRow = &m_kappa[i*sizeY];
+    for (unsigned int j=0; j<sizeY; j++)
+    {
+      double newKappa = convRow[j*convSizeZ];
+      maxChange = std::max(maxChange, std::fabs(newKappa - kappaRow[j]));
+      kappaRow[j] = newKappa;
+    }
+  }
+
+  return maxChange;
+}
+
+void ReducedShearSolver::correctShear()
+{
+  unsigned int sizeX = m_originalShearMap.getXdim();
+  unsigned int sizeY = m_originalShearMap.getYdim();
+  unsigned int sizeZ = m_originalShearMap.getZdim();
+
+  const ShearMap &originalShearMap = m_originalShearMap;
+  ConstMapView originalView = originalShearMap.getView(0, 0, sizeX, sizeY);
+  MapView correctedView = m_correctedShearMap.getView(0, 0, sizeX, sizeY);
+
+  // Both shear plans are divided by 1-kappa, the following plans are copied
+  unsigned int nbShearPlans = std::min(sizeZ, 2u);
+  #pragma omp parallel for
+  for (int i=0; i<int(sizeX); i++)
+  {
+    const double *originalRow = &originalView[i][0][0];
+    double *correctedRow = &correctedView[i][0][0];
+    const double *kappaRow = &m_kappa[i*sizeY];
+    for (unsigned int j=0; j<sizeY; j++)
+    {
+      double factor = 1./(1. - kappaRow[j]);
+      for (unsigned int k=0; k<nbShearPlans; k++)
+      {
+        correctedRow[j*sizeZ+k] = originalRow[j*sizeZ+k]*factor;
+      }
+      for (unsigned int k=nbShearPlans; k<sizeZ; k++)
+      {
+        correctedRow[j*sizeZ+k] = originalRow[j*sizeZ+k];
+      }
+    }
+  }
+}
+
+const ShearMap& ReducedShearSolver::getOriginalShearMap() const
+{
+  return m_originalShearMap;
+}
+
+ShearMap& ReducedShearSolver::getCorrectedShearMap()
+{
+  return m_correctedShearMap;
+}
+
+unsigned int ReducedShearSolver::getNbIterations() const
+{
+  return m_nbIterations;
+}
+
+double ReducedShearSolver::getLastChange() const
+{
+  return m_lastChange;
+}
+
+} // TWOD_MASS_WL_MassMapping namespace
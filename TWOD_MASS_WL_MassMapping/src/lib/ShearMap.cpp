@@ -44,42 +44,41 @@ ShearMap::ShearMap(std::string filename):GlobalMap(filename)
 {
 }
 
+ShearMap::ShearMap(std::string filename, unsigned int offsetX, unsigned int offsetY,
+                    unsigned int sizeX, unsigned int sizeY):
+GlobalMap(filename, offsetX, offsetY, sizeX, sizeY)
+{
+}
+
+ShearMap::ShearMap(std::string filename, const Boundaries &skyCutout):GlobalMap(filename, skyCutout)
+{
+}
+
+ShearMap::ShearMap(std::string filename, std::string extName):GlobalMap(filename, extName)
+{
+}
+
 ConvergenceMap ShearMap::getConvergenceMap()
 {
   double fftFactor = 1.0/m_sizeXaxis/m_sizeYaxis;
 
   // Create the complex maps
-  fftw_complex *gamma_complex  = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
-  fftw_complex *fft_gamma_complex  = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
   fftw_complex *Psi_complex  = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
   fftw_complex *fft_kappa_complex  = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
   fftw_complex *kappa_complex  = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *m_sizeXaxis*m_sizeYaxis);
 
-  // Create the plans for transformation
+  // Create the plan for transformation
   fftw_plan plan_k_backward;
-  fftw_plan plan_g_forward;
 
   #pragma omp critical
   {
-    // Create the plans for transformation
-    plan_k_backward = fftw_plan_dft_2d(m_sizeXaxis, m_sizeYaxis, fft_kappa_complex, kappa_complex,
+    // Create the plan for transformation, the slowest varying index being on the Y axis
+    plan_k_backward = fftw_plan_dft_2d(m_sizeYaxis, m_sizeXaxis, fft_kappa_complex, kappa_complex,
                                        FFTW_BACKWARD,  FFTW_MEASURE);
-    plan_g_forward = fftw_plan_dft_2d(m_sizeXaxis, m_sizeYaxis, gamma_complex, fft_gamma_complex,
-                                      FFTW_FORWARD,  FFTW_MEASURE);
   }
 
-  // Fill the complex gamma map with shear map values
-  for (unsigned int i=0; i<m_sizeXaxis; i++)
-  {
-    for (unsigned int j=0; j<m_sizeYaxis; j++)
-    {
-      gamma_complex[j*m_sizeXaxis +i][0] = (*m_mapValues)[i][j][0];
-      gamma_complex[j*m_sizeXaxis +i][1] = (*m_mapValues)[i][j][1];
-    }
-  }
-
-  // Perform the fourier transform of the complex shear map
-  fftw_execute(plan_g_forward);
+  // Get the fourier transform of the complex shear map, reused if already cached
+  const fftw_complex *fft_gamma_complex = getFourierTransform();
 
   // Create the P factor
   for (unsigned int i=0; i<m_sizeXaxis; i++)
@@ -124,23 +123,25 @@ ConvergenceMap ShearMap::getConvergenceMap()
 
   ConvergenceMap kappaMap(kappaArray, m_sizeXaxis, m_sizeYaxis, m_sizeZaxis, m_boundaries, m_numberOfGalaxies);
 
+  // The convergence map keeps its fourier transform for the next fourier space operation
+  kappaMap.setFourierTransform(fft_kappa_complex);
+
   // free memory
   delete [] kappaArray;
   kappaArray = nullptr;
 
-  fftw_destroy_plan(plan_g_forward);
-  fftw_destroy_plan(plan_k_backward);
+  #pragma omp critical
+  {
+    fftw_destroy_plan(plan_k_backward);
+  }
 
-  fftw_free(gamma_complex);
   fftw_free(Psi_complex);
   fftw_free(kappa_complex);
-  fftw_free(fft_gamma_complex);
-  fftw_free(fft_kappa_complex);
 
   return kappaMap;
 }
 
-void ShearMap::computeReducedShear(ConvergenceMap inputConvMap)
+void ShearMap::computeReducedShear(const ConvergenceMap &inputConvMap)
 {
   for (unsigned int i=0; i<m_sizeXaxis; i++)
   {
@@ -152,6 +153,8 @@ void ShearMap::computeReducedShear(ConvergenceMap inputConvMap)
       }
     }
   }
+
+  invalidateFourierTransform();
 }
 
 
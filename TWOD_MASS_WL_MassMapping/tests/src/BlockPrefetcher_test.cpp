@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/BlockPrefetcher_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include "TWOD_MASS_WL_MassMapping/BlockPrefetcher.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (BlockPrefetcher_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( blocksInOrder_test )
+{
+  // Blocks of various sizes, each row holding its index
+  std::vector<std::pair<long, long> > blocks = {{0, 100}, {100, 50}, {150, 1000}, {2000, 10}, {2010, 1}};
+  BlockPrefetcher myPrefetcher(2);
+  myPrefetcher.start(blocks, [](PrefetchBlock &block)
+  {
+    block.m_columns.resize(2);
+    for (auto &column : block.m_columns)
+    {
+      column.resize(block.m_nbRows);
+      for (long i=0; i<block.m_nbRows; i++)
+      {
+        column[i] = block.m_firstRow+i;
+      }
+    }
+    return true;
+  });
+
+  // Check the blocks come in order, in a bounded number of recycled buffers
+  std::set<const PrefetchBlock*> buffers;
+  unsigned int nbBlocks(0);
+  while (const PrefetchBlock *block = myPrefetcher.nextBlock())
+  {
+    BOOST_REQUIRE(nbBlocks<blocks.size());
+    BOOST_CHECK(block->m_firstRow==blocks[nbBlocks].first);
+    BOOST_CHECK(block->m_nbRows==blocks[nbBlocks].second);
+    BOOST_CHECK(block->m_columns[1][block->m_nbRows-1]==block->m_firstRow+block->m_nbRows-1);
+    buffers.insert(block);
+    nbBlocks++;
+  }
+  BOOST_CHECK(nbBlocks==blocks.size());
+  BOOST_CHECK(buffers.size()<=3);
+  BOOST_CHECK(myPrefetcher.hasFailed()==false);
+  BOOST_CHECK(myPrefetcher.nextBlock()==nullptr);
+}
+
+BOOST_AUTO_TEST_CASE( boundedPrefetch_test )
+{
+  // The I/O thread reads at most the given number of blocks ahead of the caller
+  std::vector<std::pair<long, long> > blocks;
+  for (long b=0; b<20; b++)
+  {
+    blocks.push_back(std::make_pair(10*b, 10));
+  }
+  std::atomic<int> nbRead(0);
+  BlockPrefetcher myPrefetcher(3);
+  myPrefetcher.start(blocks, [&nbRead](PrefetchBlock&)
+  {
+    nbRead++;
+    return true;
+  });
+  const PrefetchBlock *block = myPrefetcher.nextBlock();
+  BOOST_REQUIRE(block!=nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_CHECK(nbRead==4);
+
+  // The prefetcher can be restarted or destroyed before all the blocks are processed
+  myPrefetcher.start(blocks, [](PrefetchBlock&) { return true; });
+  BOOST_CHECK(myPrefetcher.nextBlock()!=nullptr);
+}
+
+BOOST_AUTO_TEST_CASE( failedRead_test )
+{
+  // A block which can not be read ends the blocks
+  std::vector<std::pair<long, long> > blocks = {{0, 10}, {10, 10}, {20, 10}, {30, 10}};
+  BlockPrefetcher myPrefetcher;
+  myPrefetcher.start(blocks, [](PrefetchBlock &block)
+  {
+    if (block.m_firstRow==20)
+    {
+      throw std::runtime_error("read error");
+    }
+    return true;
+  });
+  unsigned int nbBlocks(0);
+  while (myPrefetcher.nextBlock()!=nullptr)
+  {
+    nbBlocks++;
+  }
+  BOOST_CHECK(nbBlocks<=2);
+  BOOST_CHECK(myPrefetcher.hasFailed()==true);
+}
+
+BOOST_AUTO_TEST_CASE( withoutThread_test )
+{
+  // Without I/O thread each block is read by the caller when it asks for it
+  std::vector<std::pair<long, long> > blocks = {{0, 10}, {10, 10}, {20, 10}, {30, 5}};
+  std::thread::id callerId = std::this_thread::get_id();
+  int nbRead(0);
+  bool sameThread(true);
+  BlockPrefetcher myPrefetcher(2, false);
+  myPrefetcher.start(blocks, [&nbRead, &sameThread, callerId](PrefetchBlock &block)
+  {
+    nbRead++;
+    sameThread = sameThread && (std::this_thread::get_id()==callerId);
+    return block.m_firstRow!=30;
+  });
+  BOOST_CHECK(nbRead==0);
+
+  unsigned int nbBlocks(0);
+  while (const PrefetchBlock *block = myPrefetcher.nextBlock())
+  {
+    BOOST_CHECK(block->m_firstRow==blocks[nbBlocks].first);
+    nbBlocks++;
+    BOOST_CHECK(nbRead==int(nbBlocks));
+  }
+  BOOST_CHECK(nbBlocks==3);
+  BOOST_CHECK(sameThread==true);
+  BOOST_CHECK(myPrefetcher.hasFailed()==true);
+  BOOST_CHECK(myPrefetcher.nextBlock()==nullptr);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -53,6 +53,21 @@ BOOST_AUTO_TEST_CASE( Overall_test ) {
 
 }
 
+BOOST_AUTO_TEST_CASE( tangentPoint_test ) {
+
+  // The tangent point is the center of the area by default
+  Boundaries bounds(1., 3., -2., 4., 0.5, 1.2);
+  BOOST_CHECK_CLOSE(bounds.getRaTangent(), 2., 0.1);
+  BOOST_CHECK_CLOSE(bounds.getDecTangent(), 1., 0.1);
+
+  // A cutout keeps the tangent point of the full area
+  bounds.setTangentPoint(5., 6.);
+  BOOST_CHECK_CLOSE(bounds.getRaTangent(), 5., 0.1);
+  BOOST_CHECK_CLOSE(bounds.getDecTangent(), 6., 0.1);
+  BOOST_CHECK_CLOSE(bounds.getRaMin(), 1., 0.1);
+
+}
+
 //-----------------------------------------------------------------------------
 
 BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/CatalogKeyIndex_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#include "TWOD_MASS_WL_MassMapping/CatalogKeyIndex.h"
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (CatalogKeyIndex_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( keys_test )
+{
+  // The 12 base pixels: 4 around the north pole, 4 on the equator, 4 around the south pole
+  BOOST_CHECK(CatalogKeyIndex::getNbKeys(nestedPixelKey, 0)==12);
+  BOOST_CHECK(CatalogKeyIndex::getKey(nestedPixelKey, 0, 0., 0.)==4);
+  BOOST_CHECK(CatalogKeyIndex::getKey(nestedPixelKey, 0, 90., 0.)==5);
+  BOOST_CHECK(CatalogKeyIndex::getKey(nestedPixelKey, 0, 45., 60.)==0);
+  BOOST_CHECK(CatalogKeyIndex::getKey(nestedPixelKey, 0, 135., 60.)==1);
+  BOOST_CHECK(CatalogKeyIndex::getKey(nestedPixelKey, 0, 315., -60.)==11);
+  BOOST_CHECK(CatalogKeyIndex::getKey(nestedPixelKey, 0, -45., -60.)==11);
+
+  // Morton cells of the plate carree projection
+  BOOST_CHECK(CatalogKeyIndex::getNbKeys(mortonKey, 1)==4);
+  BOOST_CHECK(CatalogKeyIndex::getKey(mortonKey, 1, 10., -10.)==0);
+  BOOST_CHECK(CatalogKeyIndex::getKey(mortonKey, 1, 190., -10.)==1);
+  BOOST_CHECK(CatalogKeyIndex::getKey(mortonKey, 1, 10., 10.)==2);
+  BOOST_CHECK(CatalogKeyIndex::getKey(mortonKey, 1, 360., 90.)==2);
+
+  // A position without coordinates comes after all the keys
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  BOOST_CHECK(CatalogKeyIndex::getKey(nestedPixelKey, 10, nan, 0.)==CatalogKeyIndex::getNbKeys(nestedPixelKey, 10));
+
+  // The curves are nested, and the nested pixels have equal areas
+  std::vector<double> pixelAreas(CatalogKeyIndex::getNbKeys(nestedPixelKey, 1), 0.);
+  double skyArea = 0.;
+  for (double ra=0.25; ra<360.; ra+=0.5)
+  {
+    for (double dec=-89.75; dec<90.; dec+=0.5)
+    {
+      for (spatialKey keyType : {nestedPixelKey, mortonKey})
+      {
+        unsigned long key = CatalogKeyIndex::getKey(keyType, 12, ra, dec);
+        BOOST_REQUIRE(key<CatalogKeyIndex::getNbKeys(keyType, 12));
+        BOOST_CHECK(key>>14==CatalogKeyIndex::getKey(keyType, 5, ra, dec));
+      }
+      // Area around each position
+      pixelAreas[CatalogKeyIndex::getKey(nestedPixelKey, 1, ra, dec)] += std::cos(dec*M_PI/180.);
+      skyArea += std::cos(dec*M_PI/180.);
+    }
+  }
+  for (auto area : pixelAreas)
+  {
+    BOOST_CHECK_CLOSE(area, skyArea/48., 1.);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( rowRanges_test )
+{
+  // Galaxies sorted by key along a line of constant declination
+  std::vector<double> ra, dec, z;
+  for (unsigned int i=0; i<3600; i++)
+  {
+    ra.push_back(0.1*i+0.05);
+    dec.push_back(5.);
+    z.push_back(0.5+0.0001*i);
+  }
+  CatalogKeyIndex myIndex(mortonKey, 16, 4);
+  std::vector<unsigned long> keys;
+  for (unsigned int i=0; i<ra.size(); i++)
+  {
+    keys.push_back(CatalogKeyIndex::getKey(mortonKey, 16, ra[i], dec[i]));
+  }
+  BOOST_REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+  myIndex.addRows(1000, keys.data(), ra.data(), dec.data(), z.data());
+  myIndex.addRows(2600, keys.data()+1000, ra.data()+1000, dec.data()+1000, z.data()+1000);
+  BOOST_CHECK(myIndex.getNbRows()==3600);
+  BOOST_CHECK(myIndex.getNbCells()==16);
+
+  // The cells overlapping a patch make a contiguous range of rows holding all its galaxies
+  std::vector<std::pair<unsigned long, unsigned long> > ranges = myIndex.getRowRanges(40., 50., 0., 10., 0., 10.);
+  BOOST_REQUIRE(ranges.size()==1);
+  BOOST_CHECK(ranges[0].first<=400);
+  BOOST_CHECK(ranges[0].first+ranges[0].second>=500);
+  BOOST_CHECK(ranges[0].second<3600/4);
+  BOOST_CHECK(myIndex.getRowRanges(40., 50., 20., 30., 0., 10.).empty());
+  BOOST_CHECK(myIndex.getRowRanges(40., 50., 0., 10., 2., 3.).empty());
+
+  // Check the index saved next to a catalog is loaded back
+  std::string catalogPath(pathFiles+"tmp/keyIndexCatalog.bin");
+  std::ofstream catalogFile(catalogPath);
+  catalogFile<<"catalog";
+  catalogFile.close();
+  BOOST_REQUIRE(myIndex.save(catalogPath)==true);
+  CatalogKeyIndex myLoadedIndex;
+  BOOST_REQUIRE(myLoadedIndex.load(catalogPath)==true);
+  BOOST_CHECK(myLoadedIndex.getKeyType()==mortonKey);
+  BOOST_CHECK(myLoadedIndex.getOrder()==16);
+  BOOST_CHECK(myLoadedIndex.getIndexOrder()==4);
+  BOOST_CHECK(myLoadedIndex.getNbRows()==3600);
+  BOOST_CHECK(myLoadedIndex.getRowRanges(40., 50., 0., 10., 0., 10.)==ranges);
+
+  // An index saved for other columns is not loaded
+  CatalogKeyIndex myOtherIndex;
+  myOtherIndex.setColumnNames("ra", "dec", "");
+  BOOST_CHECK(myOtherIndex.load(catalogPath)==false);
+  myOtherIndex.setColumnNames("ra", "dec", "z");
+  BOOST_CHECK(myOtherIndex.load(catalogPath)==true);
+
+  // There is no index next to another catalog
+  BOOST_CHECK(myLoadedIndex.load(pathFiles+"tmp/dummyCatalog.bin")==false);
+  BOOST_CHECK(myLoadedIndex.getNbCells()==0);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( mergeSplitRanges_test )
+{
+  // The ranges of several selections are sorted and the overlapping or contiguous ones are merged
+  std::vector<std::pair<unsigned long, unsigned long> > ranges = {{500, 100}, {0, 10}, {550, 100}, {10, 5}, {700, 0}};
+  CatalogKeyIndex::mergeRowRanges(ranges);
+  BOOST_REQUIRE(ranges.size()==2);
+  BOOST_CHECK(ranges[0]==std::make_pair(0UL, 15UL));
+  BOOST_CHECK(ranges[1]==std::make_pair(500UL, 150UL));
+
+  // The chunks do not cross the limits of the blocks
+  std::vector<std::pair<long, long> > chunks = CatalogKeyIndex::splitRowRanges(ranges, 256);
+  BOOST_REQUIRE(chunks.size()==3);
+  BOOST_CHECK(chunks[0]==std::make_pair(0L, 15L));
+  BOOST_CHECK(chunks[1]==std::make_pair(500L, 12L));
+  BOOST_CHECK(chunks[2]==std::make_pair(512L, 138L));
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
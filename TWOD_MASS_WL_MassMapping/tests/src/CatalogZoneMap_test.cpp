@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/CatalogZoneMap_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include "TWOD_MASS_WL_MassMapping/CatalogZoneMap.h"
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (CatalogZoneMap_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( zoneRanges_test )
+{
+  // Galaxies sorted by ra, 10 per degree
+  std::vector<double> ra(1000), dec(1000), z(1000);
+  for (unsigned int i=0; i<ra.size(); i++)
+  {
+    ra[i] = 0.1*i;
+    dec[i] = -10. + (i%20);
+    z[i] = 0.5 + 0.001*i;
+  }
+  z[450] = std::numeric_limits<double>::quiet_NaN();
+
+  // Zones of 100 rows, filled by chunks of any size
+  CatalogZoneMap myZoneMap(100);
+  myZoneMap.addRows(250, ra.data(), dec.data(), z.data());
+  myZoneMap.addRows(750, ra.data()+250, dec.data()+250, z.data()+250);
+  BOOST_CHECK(myZoneMap.getNbRows()==1000);
+  BOOST_CHECK(myZoneMap.getNbZones()==10);
+  BOOST_CHECK_CLOSE(myZoneMap.getMin(3, raCoordinate), 30., 0.001);
+  BOOST_CHECK_CLOSE(myZoneMap.getMax(3, raCoordinate), 39.9, 0.001);
+  BOOST_CHECK(myZoneMap.getMin(3, decCoordinate)==-10.);
+  BOOST_CHECK(myZoneMap.getMax(3, decCoordinate)==9.);
+  BOOST_CHECK(std::isnan(myZoneMap.getMin(4, zCoordinate)));
+  BOOST_CHECK(std::isnan(myZoneMap.getMax(10, raCoordinate)));
+
+  // Only the zones crossing the selection may overlap it
+  BOOST_CHECK(myZoneMap.mayOverlap(0, 1000, 35., 36., -90., 90., 0., 10.)==true);
+  BOOST_CHECK(myZoneMap.mayOverlap(0, 300, 35., 36., -90., 90., 0., 10.)==false);
+  BOOST_CHECK(myZoneMap.mayOverlap(300, 100, 35., 36., -90., 90., 0., 10.)==true);
+  BOOST_CHECK(myZoneMap.mayOverlap(0, 1000, 35., 36., 20., 30., 0., 10.)==false);
+  BOOST_CHECK(myZoneMap.mayOverlap(0, 1000, 35., 36., -90., 90., 2., 3.)==false);
+
+  // An unknown range never excludes a zone
+  BOOST_CHECK(myZoneMap.mayOverlap(400, 100, 40., 50., -90., 90., 2., 3.)==true);
+  BOOST_CHECK(myZoneMap.mayOverlap(500, 100, 50., 60., -90., 90., 2., 3.)==false);
+  BOOST_CHECK(myZoneMap.mayOverlap(950, 100, 0., 1., -90., 90., 0., 10.)==true);
+
+  // Without redshifts the selection on z is not used
+  CatalogZoneMap myNoZZoneMap(100);
+  myNoZZoneMap.addRows(1000, ra.data(), dec.data(), nullptr);
+  BOOST_CHECK(myNoZZoneMap.mayOverlap(300, 100, 35., 36., -90., 90., 2., 3.)==true);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( saveLoad_test )
+{
+  std::string catalogFile = pathFiles+"tmp/zoneMapCatalog.txt";
+  std::remove(CatalogZoneMap::getSidecarFilename(catalogFile).c_str());
+  std::ofstream catalog(catalogFile);
+  catalog<<"ra dec"<<std::endl;
+  catalog.close();
+
+  std::vector<double> ra(250), dec(250);
+  for (unsigned int i=0; i<ra.size(); i++)
+  {
+    ra[i] = 0.1*i;
+    dec[i] = 0.05*i;
+  }
+  CatalogZoneMap myZoneMap(100);
+  myZoneMap.addRows(250, ra.data(), dec.data(), nullptr);
+
+  // There is no index to load before it is saved
+  CatalogZoneMap myLoadedZoneMap;
+  BOOST_CHECK(myLoadedZoneMap.load(catalogFile)==false);
+  BOOST_REQUIRE(myZoneMap.save(catalogFile)==true);
+  BOOST_REQUIRE(myLoadedZoneMap.load(catalogFile)==true);
+  BOOST_CHECK(myLoadedZoneMap.getNbRows()==250);
+  BOOST_CHECK(myLoadedZoneMap.getZoneRows()==100);
+  BOOST_REQUIRE(myLoadedZoneMap.getNbZones()==3);
+  for (unsigned long zone=0; zone<3; zone++)
+  {
+    for (zoneCoordinate coordinate : {raCoordinate, decCoordinate})
+    {
+      BOOST_CHECK(myLoadedZoneMap.getMin(zone, coordinate)==myZoneMap.getMin(zone, coordinate));
+      BOOST_CHECK(myLoadedZoneMap.getMax(zone, coordinate)==myZoneMap.getMax(zone, coordinate));
+    }
+    BOOST_CHECK(std::isnan(myLoadedZoneMap.getMin(zone, zCoordinate)));
+  }
+
+  // An index of other catalog columns is not loaded
+  CatalogZoneMap myOtherZoneMap;
+  myOtherZoneMap.setColumnNames("ra", "dec", "kappa_z");
+  BOOST_CHECK(myOtherZoneMap.load(catalogFile)==false);
+  BOOST_CHECK(myOtherZoneMap.getNbZones()==0);
+  myZoneMap.setColumnNames("ra", "dec", "kappa_z");
+  BOOST_REQUIRE(myZoneMap.save(catalogFile)==true);
+  BOOST_CHECK(myOtherZoneMap.load(catalogFile)==true);
+  BOOST_CHECK(myLoadedZoneMap.load(catalogFile)==false);
+  BOOST_CHECK(myOtherZoneMap.getColumnNames()[2]=="kappa_z");
+
+  // Column names too long to be saved give no index
+  myZoneMap.setColumnNames("ra", "dec", std::string(40, 'z'));
+  BOOST_CHECK(myZoneMap.save(catalogFile)==false);
+  BOOST_REQUIRE(myOtherZoneMap.load(catalogFile)==true);
+
+  // An index older than its catalog is not loaded
+  struct stat sidecarStatus;
+  BOOST_REQUIRE(stat(CatalogZoneMap::getSidecarFilename(catalogFile).c_str(), &sidecarStatus)==0);
+  struct utimbuf sidecarTimes = {sidecarStatus.st_atime, sidecarStatus.st_mtime-10};
+  BOOST_REQUIRE(utime(CatalogZoneMap::getSidecarFilename(catalogFile).c_str(), &sidecarTimes)==0);
+  BOOST_CHECK(myLoadedZoneMap.load(catalogFile)==false);
+  BOOST_CHECK(myLoadedZoneMap.getNbZones()==0);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( columnarCatalog_test )
+{
+  // The index of a columnar catalog is given by its blocks
+  std::string catalogFile = pathFiles+"tmp/zoneMapColumnar.bin";
+  std::vector<double> ra(250), dec(250);
+  for (unsigned int i=0; i<ra.size(); i++)
+  {
+    ra[i] = 0.1*i;
+    dec[i] = 0.05*i;
+  }
+  ColumnarCatalogWriter myWriter(catalogFile, {"ra", "dec"}, 100);
+  BOOST_REQUIRE(myWriter.appendRows({ra.data(), dec.data()}, 250)==true);
+  BOOST_REQUIRE(myWriter.close()==true);
+
+  ColumnarCatalog myCatalog(catalogFile);
+  CatalogZoneMap myZoneMap;
+  BOOST_REQUIRE(myZoneMap.setFromColumnarCatalog(myCatalog)==true);
+  BOOST_CHECK(myZoneMap.getNbRows()==250);
+  BOOST_CHECK(myZoneMap.getZoneRows()==100);
+  BOOST_CHECK(myZoneMap.getNbZones()==3);
+  BOOST_CHECK(myZoneMap.getMax(1, raCoordinate)==ra[199]);
+  BOOST_CHECK(myZoneMap.mayOverlap(0, 250, 25., 30., -90., 90., 0., 10.)==false);
+  BOOST_CHECK(myZoneMap.mayOverlap(0, 250, 20., 30., -90., 90., 0., 10.)==true);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
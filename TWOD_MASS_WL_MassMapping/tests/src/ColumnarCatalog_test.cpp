@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/ColumnarCatalog_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "TWOD_MASS_WL_MassMapping/ColumnarCatalog.h"
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (ColumnarCatalog_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( writeRead_test )
+{
+  std::string catalogFile = pathFiles+"tmp/columnarCatalog.bin";
+
+  // Write 2 columns in 3 chunks, with blocks of 100 rows
+  std::vector<double> ra(1050), dec(1050);
+  for (unsigned int i=0; i<ra.size(); i++)
+  {
+    ra[i] = 10. + 0.01*i;
+    dec[i] = -5. + 0.1*sin(0.3*i);
+  }
+  ColumnarCatalogWriter myWriter(catalogFile, {"ra", "dec"}, 100, 3);
+  BOOST_CHECK(myWriter.appendRows({ra.data(), dec.data()}, 250)==true);
+  BOOST_CHECK(myWriter.appendRows({ra.data()+250, dec.data()+250}, 0)==true);
+  BOOST_CHECK(myWriter.appendRows({ra.data()+250, dec.data()+250}, 800)==true);
+  BOOST_CHECK(myWriter.appendRows({ra.data()}, 10)==false);
+  BOOST_REQUIRE(myWriter.close()==false);
+
+  ColumnarCatalogWriter myOtherWriter(catalogFile, {"ra", "dec"}, 100, 3);
+  BOOST_CHECK(myOtherWriter.appendRows({ra.data(), dec.data()}, 250)==true);
+  BOOST_CHECK(myOtherWriter.appendRows({ra.data()+250, dec.data()+250}, 800)==true);
+  BOOST_REQUIRE(myOtherWriter.close()==true);
+
+  // The columns are read in place
+  BOOST_CHECK(ColumnarCatalog::isColumnarCatalog(catalogFile)==true);
+  ColumnarCatalog myCatalog(catalogFile);
+  BOOST_REQUIRE(myCatalog.isValid()==true);
+  BOOST_CHECK(myCatalog.getNbRows()==1050);
+  BOOST_CHECK(myCatalog.getBlockRows()==100);
+  BOOST_CHECK(myCatalog.getNbBlocks()==11);
+  BOOST_CHECK(myCatalog.getFlags()==3);
+  BOOST_REQUIRE(myCatalog.getColumnNames().size()==2);
+  BOOST_CHECK(myCatalog.getColumnNames()[1]=="dec");
+  BOOST_CHECK(myCatalog.getColumn("z")==nullptr);
+  const double *raColumn = myCatalog.getColumn("ra");
+  const double *decColumn = myCatalog.getColumn("dec");
+  BOOST_REQUIRE(raColumn!=nullptr);
+  BOOST_REQUIRE(decColumn!=nullptr);
+  for (unsigned int i=0; i<ra.size(); i++)
+  {
+    BOOST_CHECK(raColumn[i]==ra[i]);
+    BOOST_CHECK(decColumn[i]==dec[i]);
+  }
+
+  // The min and max values of each block are known
+  for (unsigned long block=0; block<myCatalog.getNbBlocks(); block++)
+  {
+    unsigned long first = block*100;
+    unsigned long last = std::min(first+100, ra.size());
+    BOOST_CHECK(myCatalog.getBlockMin("ra", block)==ra[first]);
+    BOOST_CHECK(myCatalog.getBlockMax("ra", block)==ra[last-1]);
+    BOOST_CHECK(myCatalog.getBlockMin("dec", block)==*std::min_element(dec.begin()+first, dec.begin()+last));
+    BOOST_CHECK(myCatalog.getBlockMax("dec", block)==*std::max_element(dec.begin()+first, dec.begin()+last));
+  }
+  BOOST_CHECK(std::isnan(myCatalog.getBlockMin("ra", 11)));
+  BOOST_CHECK(std::isnan(myCatalog.getBlockMax("z", 0)));
+
+  // The temporary files of the columns are removed
+  std::ifstream columnFile(catalogFile+".col0");
+  BOOST_CHECK(columnFile.is_open()==false);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( invalidCatalog_test )
+{
+  // A file which is not in the columnar format is not mapped
+  std::string textFile = pathFiles+"tmp/notColumnar.txt";
+  std::ofstream text(textFile);
+  text<<"ra dec z"<<std::endl<<"1 2 3"<<std::endl;
+  text.close();
+  BOOST_CHECK(ColumnarCatalog::isColumnarCatalog(textFile)==false);
+  ColumnarCatalog myTextCatalog(textFile);
+  BOOST_CHECK(myTextCatalog.isValid()==false);
+  BOOST_CHECK(myTextCatalog.getNbRows()==0);
+  BOOST_CHECK(myTextCatalog.getColumn("ra")==nullptr);
+
+  // Nor a file which does not exist
+  BOOST_CHECK(ColumnarCatalog::isColumnarCatalog(pathFiles+"dummy.bin")==false);
+  ColumnarCatalog myMissingCatalog(pathFiles+"dummy.bin");
+  BOOST_CHECK(myMissingCatalog.isValid()==false);
+
+  // A column name too long can not be written
+  ColumnarCatalogWriter myWriter(pathFiles+"tmp/badColumnar.bin",
+                                 {"a_column_name_longer_than_31_characters"});
+  BOOST_CHECK(myWriter.close()==false);
+
+  // An empty catalog is valid
+  ColumnarCatalogWriter myEmptyWriter(pathFiles+"tmp/emptyColumnar.bin", {"ra", "dec"});
+  BOOST_REQUIRE(myEmptyWriter.close()==true);
+  ColumnarCatalog myEmptyCatalog(pathFiles+"tmp/emptyColumnar.bin");
+  BOOST_CHECK(myEmptyCatalog.isValid()==true);
+  BOOST_CHECK(myEmptyCatalog.getNbRows()==0);
+  BOOST_CHECK(myEmptyCatalog.getNbBlocks()==0);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
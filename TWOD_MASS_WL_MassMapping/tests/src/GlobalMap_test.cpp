@@ -24,6 +24,7 @@
 
 #include <boost/test/unit_test.hpp>
 #include <fstream>
+#include <cstdio>
 
 #include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
 #include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
@@ -261,6 +262,217 @@ BOOST_AUTO_TEST_CASE( saveGlobalMap_test )
 }
 
 
+BOOST_AUTO_TEST_CASE( FITSroundTrip_test )
+{
+  // Create a map with distinct values in each bin and with boundaries
+  const unsigned int xSize(40);
+  const unsigned int ySize(24);
+  const unsigned int zSize(3);
+  double *array = new double[xSize*ySize*zSize];
+  for (unsigned int index=0; index<xSize*ySize*zSize; index++)
+  {
+    array[index] = index;
+  }
+  Boundaries bounds(-0.1, 0.1, -0.2, 0.2, 0.3, 0.8);
+  GlobalMap myMap(array, xSize, ySize, zSize, bounds, 1234);
+
+  // Save it and read it back
+  BOOST_REQUIRE(myMap.saveToFITSfile(pathFiles+"tmp/roundTripMap.fits", true) == true);
+  GlobalMap myReadMap(pathFiles+"tmp/roundTripMap.fits");
+
+  // Check the dimensions, values and keys are the same
+  BOOST_CHECK(myReadMap.getXdim() == xSize);
+  BOOST_CHECK(myReadMap.getYdim() == ySize);
+  BOOST_CHECK(myReadMap.getZdim() == zSize);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      for (unsigned int k=0; k<zSize; k++)
+      {
+        BOOST_CHECK_CLOSE(myReadMap.getBinValue(i, j, k), array[i + j*xSize + k*xSize*ySize], 0.0001);
+      }
+    }
+  }
+  BOOST_CHECK(myReadMap.getNumberOfGalaxies() == 1234);
+  BOOST_CHECK_CLOSE(myReadMap.getBoundaries().getRaMax(), 0.1, 0.0001);
+  BOOST_CHECK_CLOSE(myReadMap.getBoundaries().getDecMin(), -0.2, 0.0001);
+  BOOST_CHECK_CLOSE(myReadMap.getBoundaries().getZMax(), 0.8, 0.0001);
+
+  // A file which does not exist gives an empty map
+  GlobalMap myEmptyMap(pathFiles+"tmp/notExistingMap.fits");
+  BOOST_CHECK(myEmptyMap.getXdim() == 0);
+  BOOST_CHECK(myEmptyMap.getZdim() == 0);
+
+  delete [] array;
+  array = nullptr;
+}
+
+BOOST_AUTO_TEST_CASE( FITScutout_test )
+{
+  // Create a map with distinct values in each bin and with boundaries, 0.005 degree pixels
+  const unsigned int xSize(40);
+  const unsigned int ySize(24);
+  const unsigned int zSize(2);
+  double *array = new double[xSize*ySize*zSize];
+  for (unsigned int index=0; index<xSize*ySize*zSize; index++)
+  {
+    array[index] = index;
+  }
+  Boundaries bounds(-0.1, 0.1, -0.06, 0.06, 0.3, 0.8);
+  GlobalMap myMap(array, xSize, ySize, zSize, bounds, 1234);
+  BOOST_REQUIRE(myMap.saveToFITSfile(pathFiles+"tmp/cutoutMap.fits", true) == true);
+
+  // Read a pixel cutout
+  GlobalMap myPixelCutout(pathFiles+"tmp/cutoutMap.fits", 10, 4, 8, 6);
+  BOOST_REQUIRE(myPixelCutout.getXdim() == 8);
+  BOOST_REQUIRE(myPixelCutout.getYdim() == 6);
+  BOOST_REQUIRE(myPixelCutout.getZdim() == zSize);
+  for (unsigned int i=0; i<8; i++)
+  {
+    for (unsigned int j=0; j<6; j++)
+    {
+      for (unsigned int k=0; k<zSize; k++)
+      {
+        BOOST_CHECK_CLOSE(myPixelCutout.getBinValue(i, j, k),
+                          array[(i+10) + (j+4)*xSize + k*xSize*ySize], 0.0001);
+      }
+    }
+  }
+  BOOST_CHECK_CLOSE(myPixelCutout.getBoundaries().getRaMin(), -0.05, 0.0001);
+  BOOST_CHECK_CLOSE(myPixelCutout.getBoundaries().getRaMax(), -0.01, 0.0001);
+  BOOST_CHECK_CLOSE(myPixelCutout.getBoundaries().getDecMin(), -0.04, 0.0001);
+  BOOST_CHECK_CLOSE(myPixelCutout.getBoundaries().getDecMax(), -0.01, 0.0001);
+  BOOST_CHECK_CLOSE(myPixelCutout.getBoundaries().getZMax(), 0.8, 0.0001);
+
+  // A cutout going past the image is truncated
+  GlobalMap myTruncatedCutout(pathFiles+"tmp/cutoutMap.fits", 36, 20, 10, 10);
+  BOOST_CHECK(myTruncatedCutout.getXdim() == 4);
+  BOOST_CHECK(myTruncatedCutout.getYdim() == 4);
+  BOOST_CHECK_CLOSE(myTruncatedCutout.getBoundaries().getRaMax(), 0.1, 0.0001);
+
+  // A sky cutout is rounded out to the edges of the overlapping pixels
+  Boundaries skyArea(-0.0475, -0.0125, -0.0375, -0.0125, 0., 0.);
+  GlobalMap mySkyCutout(pathFiles+"tmp/cutoutMap.fits", skyArea);
+  BOOST_REQUIRE(mySkyCutout.getXdim() == 8);
+  BOOST_REQUIRE(mySkyCutout.getYdim() == 6);
+  BOOST_CHECK(mySkyCutout.getBinValue(0, 0, 1) == myPixelCutout.getBinValue(0, 0, 1));
+  BOOST_CHECK(mySkyCutout.getBinValue(7, 5, 0) == myPixelCutout.getBinValue(7, 5, 0));
+  BOOST_CHECK_CLOSE(mySkyCutout.getBoundaries().getRaMin(), -0.05, 0.0001);
+  BOOST_CHECK_CLOSE(mySkyCutout.getBoundaries().getDecMax(), -0.01, 0.0001);
+
+  // The cutouts keep the tangent point of the full map, also when saved and read again
+  BOOST_CHECK_SMALL(myPixelCutout.getBoundaries().getRaTangent(), 0.0001);
+  BOOST_CHECK_SMALL(myPixelCutout.getBoundaries().getDecTangent(), 0.0001);
+  BOOST_REQUIRE(myPixelCutout.saveToFITSfile(pathFiles+"tmp/cutoutOfCutout.fits", true) == true);
+  GlobalMap mySavedCutout(pathFiles+"tmp/cutoutOfCutout.fits");
+  BOOST_CHECK_CLOSE(mySavedCutout.getBoundaries().getRaMin(), -0.05, 0.0001);
+  BOOST_CHECK_SMALL(mySavedCutout.getBoundaries().getRaTangent(), 0.0001);
+  BOOST_CHECK_SMALL(mySavedCutout.getBoundaries().getDecTangent(), 0.0001);
+
+  // Sky cutouts are read in the turn of the map, and may wrap around ra=0
+  Boundaries turnedArea(359.9525, 359.9875, -0.0375, -0.0125, 0., 0.);
+  GlobalMap myTurnedCutout(pathFiles+"tmp/cutoutMap.fits", turnedArea);
+  BOOST_CHECK(myTurnedCutout.getXdim() == 8);
+  BOOST_CHECK(myTurnedCutout.getBinValue(0, 0, 1) == myPixelCutout.getBinValue(0, 0, 1));
+  Boundaries wrappingArea(359.9625, 0.0175, -0.0375, -0.0125, 0., 0.);
+  GlobalMap myWrappingCutout(pathFiles+"tmp/cutoutMap.fits", wrappingArea);
+  BOOST_CHECK(myWrappingCutout.getXdim() == 12);
+  BOOST_CHECK_CLOSE(myWrappingCutout.getBoundaries().getRaMin(), -0.04, 0.0001);
+  BOOST_CHECK_CLOSE(myWrappingCutout.getBoundaries().getRaMax(), 0.02, 0.0001);
+
+  // A cutout outside of the image gives an empty map
+  GlobalMap myOutsideCutout(pathFiles+"tmp/cutoutMap.fits", 40, 0, 4, 4);
+  BOOST_CHECK(myOutsideCutout.getXdim() == 0);
+  Boundaries outsideArea(1., 2., 1., 2., 0., 0.);
+  GlobalMap myOutsideSkyCutout(pathFiles+"tmp/cutoutMap.fits", outsideArea);
+  BOOST_CHECK(myOutsideSkyCutout.getXdim() == 0);
+
+  delete [] array;
+  array = nullptr;
+}
+
+BOOST_FIXTURE_TEST_CASE( productFile_test, GlobalMapFixture )
+{
+  std::string productFile = pathFiles+"tmp/productMap.fits";
+  std::remove(productFile.c_str());
+
+  // Save two maps as extensions of the same file, the second one being compressed
+  BOOST_REQUIRE(myArrayTestMap->saveToFITSextension(productFile, shearExtension, true) == true);
+  MapView myView = myArrayTestMapNoGal->getView(3, 5, 1, 1);
+  myView[0][0][1] = 7.;
+  BOOST_REQUIRE(myArrayTestMapNoGal->saveToFITSfile(productFile+"["+densityExtension+"]", true,
+                                                    gzipCompression) == true);
+
+  // Read them back by name
+  GlobalMap myShearExtension(productFile, shearExtension);
+  GlobalMap myDensityExtension(productFile, densityExtension);
+  BOOST_REQUIRE(myShearExtension.getXdim() == xSize);
+  BOOST_REQUIRE(myDensityExtension.getXdim() == xSize);
+  BOOST_CHECK(myShearExtension.getZdim() == zSize);
+  BOOST_CHECK(myShearExtension.getNumberOfGalaxies() == numberOfGalaxies);
+  BOOST_CHECK(myDensityExtension.getNumberOfGalaxies() == 0);
+  BOOST_CHECK(myShearExtension.getBinValue(3, 5, 1) == myArrayTestMap->getBinValue(3, 5, 1));
+  BOOST_CHECK(myDensityExtension.getBinValue(3, 5, 1) == 7.);
+
+  // An existing extension is only replaced with overwrite
+  BOOST_CHECK(myArrayTestMapNoGal->saveToFITSextension(productFile, shearExtension, false) == false);
+  BOOST_REQUIRE(myArrayTestMapNoGal->saveToFITSextension(productFile, shearExtension, true) == true);
+  GlobalMap myReplacedExtension(productFile, shearExtension);
+  BOOST_CHECK(myReplacedExtension.getBinValue(3, 5, 1) == 7.);
+  GlobalMap myKeptExtension(productFile, densityExtension);
+  BOOST_CHECK(myKeptExtension.getBinValue(3, 5, 1) == 7.);
+
+  // A missing extension gives an empty map
+  GlobalMap myMissingExtension(productFile, convergenceExtension);
+  BOOST_CHECK(myMissingExtension.getXdim() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE( compressedFITS_test, GlobalMapFixture )
+{
+  // Put a masked area of zeros in the map
+  MapView myView = myArrayTestMap->getView(0, 0, 4, 4);
+  for (unsigned int i=0; i<4; i++)
+  {
+    for (unsigned int j=0; j<4; j++)
+    {
+      myView[i][j][0] = 0.;
+      myView[i][j][1] = 0.;
+    }
+  }
+
+  // A GZIP compressed map is read back without any loss
+  BOOST_REQUIRE(myArrayTestMap->saveToFITSfile(pathFiles+"tmp/gzipMap.fits", true, gzipCompression) == true);
+  GlobalMap myGzipMap(pathFiles+"tmp/gzipMap.fits");
+  BOOST_REQUIRE(myGzipMap.getXdim() == xSize);
+  BOOST_CHECK(myGzipMap.getZdim() == zSize);
+  BOOST_CHECK(myGzipMap.getNumberOfGalaxies() == numberOfGalaxies);
+
+  // A Rice compressed map keeps the zeros of the masked area
+  BOOST_REQUIRE(myArrayTestMap->saveToFITSfile(pathFiles+"tmp/riceMap.fits", true, riceCompression) == true);
+  GlobalMap myRiceMap(pathFiles+"tmp/riceMap.fits");
+  BOOST_REQUIRE(myRiceMap.getXdim() == xSize);
+
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      for (unsigned int k=0; k<zSize; k++)
+      {
+        BOOST_CHECK(myGzipMap.getBinValue(i, j, k) == myArrayTestMap->getBinValue(i, j, k));
+        if (i<4 && j<4)
+        {
+          BOOST_CHECK(myRiceMap.getBinValue(i, j, k) == 0.);
+        }
+        else
+        {
+          BOOST_CHECK_CLOSE(myRiceMap.getBinValue(i, j, k), myArrayTestMap->getBinValue(i, j, k), 1.);
+        }
+      }
+    }
+  }
+}
+
 BOOST_FIXTURE_TEST_CASE( pixelateGalaxiesPerBin_test, GlobalMapFixture)
 {
 
@@ -483,6 +695,69 @@ BOOST_FIXTURE_TEST_CASE( pixelatePerBin_test, GlobalMapFixture)
   BOOST_CHECK(isPixelated == false);
 }
 
+BOOST_FIXTURE_TEST_CASE( rebin_test, GlobalMapFixture)
+{
+  // Impossible binnings should return false
+  BOOST_CHECK(myArrayTestMap->rebin(0, 2) == false);
+  BOOST_CHECK(myArrayTestMap->rebin(2, ySize+1) == false);
+
+  // Rebin by 3 in X and 5 in Y, summing the values
+  BOOST_CHECK(myArrayTestMap->rebin(3, 5, false) == true);
+
+  // Check the last pixels which do not fill a bin are dropped
+  BOOST_CHECK(myArrayTestMap->getXdim() == xSize/3);
+  BOOST_CHECK(myArrayTestMap->getYdim() == ySize/5);
+  BOOST_CHECK(myArrayTestMap->getZdim() == zSize);
+
+  // Check the values are the sums of the 15 merged pixels
+  for (unsigned int i=0; i<xSize/3; i++)
+  {
+    for (unsigned int j=0; j<ySize/5; j++)
+    {
+      for (unsigned int k=0; k<zSize; k++)
+      {
+        BOOST_CHECK_CLOSE(myArrayTestMap->getBinValue(i, j, k),
+                          15*(mapUniformValueZ0 + k*mapUniformValueZ1), 0.000001);
+      }
+    }
+  }
+
+  // Rebin the map without galaxy info by 3 in both axis, averaging the values
+  BOOST_CHECK(myArrayTestMapNoGal->rebin(3, 3) == true);
+  BOOST_CHECK(myArrayTestMapNoGal->getXdim() == xSize/3);
+  BOOST_CHECK_CLOSE(myArrayTestMapNoGal->getBinValue(1, 2, 1), mapUniformValueZ0 + mapUniformValueZ1, 0.000001);
+}
+
+BOOST_AUTO_TEST_CASE( weightedRebin_test )
+{
+  // Create a 4x2 map with two plans and a map of weights
+  double values[16] = {1, 2, 3, 4,  5, 6, 7, 8,  10, 20, 30, 40,  50, 60, 70, 80};
+  double weightValues[8] = {1, 0, 2, 2,  3, 1, 0, 0};
+  GlobalMap myMap(values, 4, 2, 2);
+  GlobalMap myWeights(weightValues, 4, 2, 1);
+
+  // Weights with wrong dimensions should be refused
+  GlobalMap myWrongWeights(weightValues, 2, 4, 1);
+  BOOST_CHECK(myMap.rebin(2, 2, true, &myWrongWeights) == false);
+
+  // Weights without any plan should be refused
+  GlobalMap myEmptyWeights(weightValues, 4, 2, 0);
+  BOOST_CHECK(myMap.rebin(2, 2, true, &myEmptyWeights) == false);
+
+  // Compute the weighted sums in 2x2 bins
+  GlobalMap mySumMap(myMap);
+  BOOST_CHECK(mySumMap.rebin(2, 2, false, &myWeights) == true);
+  BOOST_CHECK(mySumMap.getXdim() == 2);
+  BOOST_CHECK(mySumMap.getYdim() == 1);
+  BOOST_CHECK_CLOSE(mySumMap.getBinValue(0, 0, 0), 1*1 + 0*2 + 3*5 + 1*6, 0.000001);
+  BOOST_CHECK_CLOSE(mySumMap.getBinValue(1, 0, 1), 2*30 + 2*40 + 0*70 + 0*80, 0.000001);
+
+  // Compute the weighted means in 2x2 bins
+  BOOST_CHECK(myMap.rebin(2, 2, true, &myWeights) == true);
+  BOOST_CHECK_CLOSE(myMap.getBinValue(0, 0, 0), (1*1 + 0*2 + 3*5 + 1*6)/5., 0.000001);
+  BOOST_CHECK_CLOSE(myMap.getBinValue(1, 0, 1), (2*30 + 2*40)/4., 0.000001);
+}
+
 BOOST_FIXTURE_TEST_CASE( getMeanValues_test, GlobalMapFixture)
 {
   // Perform the check for the map with galaxy info
@@ -603,6 +878,116 @@ BOOST_FIXTURE_TEST_CASE( addBorders_test, GlobalMapFixture)
   }
 }
 
+BOOST_FIXTURE_TEST_CASE( getView_test, GlobalMapFixture)
+{
+  // Get a view on a sub-rectangle of the map and write in it
+  MapView myView = myArrayTestMap->getView(2, 3, 4, 5);
+  BOOST_CHECK(myView.shape()[0] == 4);
+  BOOST_CHECK(myView.shape()[1] == 5);
+  BOOST_CHECK(myView.shape()[2] == zSize);
+  myView[0][0][0] = 42.;
+  myView[3][4][1] = 43.;
+
+  // Check the values are written in the map
+  BOOST_CHECK_CLOSE(myArrayTestMap->getBinValue(2, 3, 0), 42., 0.000001);
+  BOOST_CHECK_CLOSE(myArrayTestMap->getBinValue(5, 7, 1), 43., 0.000001);
+
+  // Check a view going out of the map is truncated
+  MapView myEdgeView = myArrayTestMap->getView(xSize-2, ySize-2, 4, 4);
+  BOOST_CHECK(myEdgeView.shape()[0] == 2);
+  BOOST_CHECK(myEdgeView.shape()[1] == 2);
+
+  // Crop the map without copy and check the view is still indexed from zero
+  BOOST_CHECK(myArrayTestMap->cropMap(8, 8, 2, 3) == true);
+  BOOST_CHECK(myArrayTestMap->getXdim() == 8);
+  BOOST_CHECK_CLOSE(myArrayTestMap->getBinValue(0, 0, 0), 42., 0.000001);
+  MapView myCroppedView = myArrayTestMap->getView(3, 4, 1, 1);
+  BOOST_CHECK_CLOSE(myCroppedView[0][0][1], 43., 0.000001);
+
+  // Check a copy of the cropped map only contains the cropped values
+  GlobalMap myCopyMap(*myArrayTestMap);
+  BOOST_CHECK(myCopyMap.getXdim() == 8);
+  BOOST_CHECK_CLOSE(myCopyMap.getBinValue(3, 4, 1), 43., 0.000001);
+  BOOST_CHECK_CLOSE(myCopyMap.getBinValue(7, 7, 0), mapUniformValueZ0, 0.000001);
+}
+
+
+BOOST_FIXTURE_TEST_CASE( fourierTransformCache_test, GlobalMapFixture)
+{
+  GlobalMap::resetTransformCounters();
+  BOOST_CHECK(myArrayTestMap->hasFourierTransform() == false);
+
+  // The transform of a uniform map only has the zero mode
+  const fftw_complex *fourierValues = myArrayTestMap->getFourierTransform();
+  BOOST_CHECK_CLOSE(fourierValues[0][0], xSize*ySize*mapUniformValueZ0, 0.000001);
+  BOOST_CHECK_CLOSE(fourierValues[0][1], xSize*ySize*(mapUniformValueZ0 + mapUniformValueZ1), 0.000001);
+  BOOST_CHECK_SMALL(fourierValues[5][0], 1e-8);
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsPerformed() == 1);
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsAvoided() == 0);
+
+  // The second call uses the cache, and so does a copy of the map
+  BOOST_CHECK(myArrayTestMap->getFourierTransform() == fourierValues);
+  GlobalMap myCopyMap(*myArrayTestMap);
+  BOOST_CHECK(myCopyMap.hasFourierTransform() == true);
+  BOOST_CHECK_CLOSE(myCopyMap.getFourierTransform()[0][0], xSize*ySize*mapUniformValueZ0, 0.000001);
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsPerformed() == 1);
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsAvoided() == 2);
+
+  // Writing in the map drops the cache
+  std::vector<double> offset = {mapUniformValueZ0, mapUniformValueZ0 + mapUniformValueZ1};
+  myArrayTestMap->removeOffset(offset);
+  BOOST_CHECK(myArrayTestMap->hasFourierTransform() == false);
+  BOOST_CHECK_SMALL(myArrayTestMap->getFourierTransform()[0][0], 1e-8);
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsPerformed() == 2);
+
+  myArrayTestMap->getView(0, 0, 1, 1);
+  BOOST_CHECK(myArrayTestMap->hasFourierTransform() == false);
+}
+
+BOOST_FIXTURE_TEST_CASE( heldViewFourierTransform_test, GlobalMapFixture)
+{
+  GlobalMap::resetTransformCounters();
+  unsigned int nbModes = xSize*ySize;
+
+  {
+    // A view held across a transform is written, the next transform sees the new values
+    MapView myView = myArrayTestMap->getView(1, 2, 3, 4);
+    myArrayTestMap->getFourierTransform();
+    myView[0][0][0] += 5.;
+    myView[2][3][1] -= 2.;
+    BOOST_CHECK(myArrayTestMap->hasFourierTransform() == false);
+    const fftw_complex *fourierValues = myArrayTestMap->getFourierTransform();
+    GlobalMap myUncachedMap(*myArrayTestMap);
+    BOOST_CHECK(myUncachedMap.hasFourierTransform() == false);
+    const fftw_complex *uncachedValues = myUncachedMap.getFourierTransform();
+    for (unsigned int mode=0; mode<nbModes; mode++)
+    {
+      BOOST_CHECK(fourierValues[mode][0] == uncachedValues[mode][0]);
+      BOOST_CHECK(fourierValues[mode][1] == uncachedValues[mode][1]);
+    }
+
+    // Written again after the last transform, while the view is still alive
+    myView[1][1][0] = -7.;
+  }
+
+  // The transform computed while the view was alive is not reused once the view is gone
+  BOOST_CHECK(myArrayTestMap->hasFourierTransform() == false);
+  const fftw_complex *fourierValues = myArrayTestMap->getFourierTransform();
+  GlobalMap myUncachedMap(*myArrayTestMap);
+  myUncachedMap.invalidateFourierTransform();
+  const fftw_complex *uncachedValues = myUncachedMap.getFourierTransform();
+  for (unsigned int mode=0; mode<nbModes; mode++)
+  {
+    BOOST_CHECK(fourierValues[mode][0] == uncachedValues[mode][0]);
+    BOOST_CHECK(fourierValues[mode][1] == uncachedValues[mode][1]);
+  }
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsAvoided() == 0);
+
+  // Without any view alive, the transform is cached again
+  BOOST_CHECK(myArrayTestMap->hasFourierTransform() == true);
+  BOOST_CHECK(myArrayTestMap->getFourierTransform() == fourierValues);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END ()
 
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/MapStatistics_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MassMapping/MapStatistics.h"
+#include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
+#include "TWOD_MASS_WL_MassMapping/Image.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+struct MapStatisticsFixture
+{
+  MapStatisticsFixture():xSize(32), ySize(16), zSize(2), offset(1e8)
+  {
+    // Allocate the test array
+    double *array = new double[xSize*ySize*zSize];
+
+    // Set values i+j on the first plan and a large offset with +/-1 on the second one
+    for (unsigned int i=0; i<xSize; i++)
+    {
+      for (unsigned int j=0; j<ySize; j++)
+      {
+        array[i + j*xSize] = i + j;
+        array[i + j*xSize + xSize*ySize] = offset + ((i+j)%2==0 ? 1 : -1);
+      }
+    }
+
+    // Create a map based on this array
+    myTestMap = new GlobalMap(array, xSize, ySize, zSize);
+
+    delete [] array;
+    array = nullptr;
+  }
+
+  ~MapStatisticsFixture()
+  {
+    delete myTestMap;
+    myTestMap = nullptr;
+  }
+
+  GlobalMap *myTestMap;
+  unsigned int xSize;
+  unsigned int ySize;
+  unsigned int zSize;
+  double offset;
+};
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (MapStatistics_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( computeStatistics_test, MapStatisticsFixture )
+{
+  MapStatistics myStatistics(true, 4, 0., 48.);
+  BOOST_CHECK(myStatistics.computeStatistics(*myTestMap) == true);
+  BOOST_CHECK(myStatistics.getNumberOfPlans() == zSize);
+  BOOST_CHECK(myStatistics.getCount(0) == xSize*ySize);
+
+  // Check the statistics of the first plan, variance of i+j being (32^2-1)/12 + (16^2-1)/12
+  BOOST_CHECK_CLOSE(myStatistics.getMean(0), 23., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getVariance(0), (1023.+255.)/12., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMin(0) + 1., 1., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMax(0), 46., 0.000001);
+
+  // Check the histogram of the first plan with bins of width 12
+  std::vector<unsigned long> histogram = myStatistics.getHistogram(0);
+  BOOST_REQUIRE(histogram.size() == 4);
+  unsigned long total(0);
+  for (unsigned int b=0; b<histogram.size(); b++)
+  {
+    total += histogram[b];
+  }
+  BOOST_CHECK(total == xSize*ySize);
+  BOOST_CHECK(histogram[0] == 78);
+
+  // Check the variance of the second plan is not lost because of the large offset
+  BOOST_CHECK_CLOSE(myStatistics.getMean(1), offset, 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getStandardDeviation(1), 1., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMedian(1), offset, 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMedian(0), 23., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMAD(1), 1., 0.000001);
+
+  // The map should not be modified
+  BOOST_CHECK_CLOSE(myTestMap->getBinValue(3, 2, 0), 5., 0.000001);
+}
+
+BOOST_FIXTURE_TEST_CASE( removeOffset_test, MapStatisticsFixture )
+{
+  MapStatistics myStatistics(true, 2, -2., 2.);
+  BOOST_CHECK(myStatistics.computeStatistics(*myTestMap, true) == true);
+
+  // Check the statistics describe the map without offset
+  BOOST_CHECK_SMALL(myStatistics.getMean(0), 0.000001);
+  BOOST_CHECK_SMALL(myStatistics.getMean(1), 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMin(0), -23., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMax(1), 1., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getStandardDeviation(1), 1., 0.000001);
+  BOOST_CHECK_SMALL(myStatistics.getMedian(1), 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMAD(1), 1., 0.000001);
+
+  // The histogram is filled with the values after offset removal
+  std::vector<unsigned long> histogram = myStatistics.getHistogram(1);
+  BOOST_CHECK(histogram[0] == xSize*ySize/2);
+  BOOST_CHECK(histogram[1] == xSize*ySize/2);
+
+  // Check the offsets were removed from the map
+  BOOST_CHECK_CLOSE(myTestMap->getBinValue(3, 2, 0), -18., 0.000001);
+  BOOST_CHECK_CLOSE(myTestMap->getBinValue(3, 2, 1), -1., 0.000001);
+}
+
+BOOST_AUTO_TEST_CASE( imageStatistics_test )
+{
+  // Create an image with a single value different from zero in its first pixel
+  Image myImage(4, 4);
+  myImage.setValue(0, 0, 16.);
+
+  MapStatistics myStatistics;
+  BOOST_CHECK(myStatistics.computeStatistics(myImage) == true);
+
+  // The first pixel should be taken into account
+  BOOST_CHECK_CLOSE(myStatistics.getMean(0), 1., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getMax(0), 16., 0.000001);
+  BOOST_CHECK_CLOSE(myStatistics.getVariance(0), 15., 0.000001);
+  BOOST_CHECK_CLOSE(myImage.getStandardDeviation(), sqrt(15.), 0.000001);
+
+  // Empty images should be refused
+  Image myEmptyImage(0, 0);
+  BOOST_CHECK(myStatistics.computeStatistics(myEmptyImage) == false);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
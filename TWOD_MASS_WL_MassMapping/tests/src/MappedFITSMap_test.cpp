@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/MappedFITSMap_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+
+#include "TWOD_MASS_WL_MassMapping/MappedFITSMap.h"
+#include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+struct MappedFITSMapFixture
+{
+  MappedFITSMapFixture():xSize(40), ySize(24), zSize(3), numberOfGalaxies(1234)
+  {
+    // Allocate the test array
+    double *array = new double[xSize*ySize*zSize];
+
+    // Set a different value in every bin
+    for (unsigned int i=0; i<xSize; i++)
+    {
+      for (unsigned int j=0; j<ySize; j++)
+      {
+        for (unsigned int k=0; k<zSize; k++)
+        {
+          array[i + j*xSize + k*xSize*ySize] = 0.5*i - 0.25*j + 100.*k;
+        }
+      }
+    }
+
+    // Create a map based on this array
+    Boundaries bounds(10., 12., -3., -1., 0., 3.);
+    myArrayTestMap = new GlobalMap(array, xSize, ySize, zSize, bounds, numberOfGalaxies);
+
+    delete [] array;
+    array = nullptr;
+  }
+
+  ~MappedFITSMapFixture()
+  {
+    delete myArrayTestMap;
+    myArrayTestMap = nullptr;
+  }
+
+  GlobalMap *myArrayTestMap;
+  unsigned int xSize;
+  unsigned int ySize;
+  unsigned int zSize;
+  unsigned long numberOfGalaxies;
+};
+
+// Writes a FITS file made of an image header with the given cards and of a float data unit
+void writeRawFITS(const std::string &filename, const std::vector<std::string> &cards, unsigned long nValues)
+{
+  std::string header;
+  for (auto &card : cards)
+  {
+    header += card + std::string(80-card.size(), ' ');
+  }
+  header += "END" + std::string(77, ' ');
+  header += std::string((2880 - header.size()%2880)%2880, ' ');
+  std::string data(4*nValues, '\0');
+  data += std::string((2880 - data.size()%2880)%2880, '\0');
+  std::ofstream file(filename, std::ios::binary);
+  file<<header<<data;
+}
+
+DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (MappedFITSMap_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( mappedValues_test, MappedFITSMapFixture )
+{
+  BOOST_REQUIRE(myArrayTestMap->saveToFITSfile(pathFiles+"tmp/mappedMap.fits", true) == true);
+
+  MappedFITSMap myMappedMap(pathFiles+"tmp/mappedMap.fits");
+  BOOST_REQUIRE(myMappedMap.isValid() == true);
+  BOOST_REQUIRE(myMappedMap.getXdim() == xSize);
+  BOOST_REQUIRE(myMappedMap.getYdim() == ySize);
+  BOOST_REQUIRE(myMappedMap.getZdim() == zSize);
+  BOOST_CHECK(myMappedMap.getNumberOfGalaxies() == numberOfGalaxies);
+  BOOST_CHECK_CLOSE(myMappedMap.getBoundaries().getRaMin(), 10., 0.0001);
+  BOOST_CHECK_CLOSE(myMappedMap.getBoundaries().getDecMax(), -1., 0.0001);
+  BOOST_CHECK_CLOSE(myMappedMap.getBoundaries().getZMax(), 3., 0.0001);
+
+  // The map is saved as floats, all values of the test map are exact in single precision
+  for (unsigned int k=0; k<zSize; k++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      const double *row = myMappedMap.getRow(j, k);
+      for (unsigned int i=0; i<xSize; i++)
+      {
+        BOOST_CHECK(row[i] == myArrayTestMap->getBinValue(i, j, k));
+        BOOST_CHECK(myMappedMap.getBinValue(i, j, k) == myArrayTestMap->getBinValue(i, j, k));
+      }
+    }
+  }
+
+  // Out of range bins are empty
+  BOOST_CHECK(myMappedMap.getRow(ySize, 0) == nullptr);
+  BOOST_CHECK(myMappedMap.getBinValue(xSize, 0, 0) == 0.);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( mappedExtension_test, MappedFITSMapFixture )
+{
+  std::string productFile = pathFiles+"tmp/mappedProduct.fits";
+  std::remove(productFile.c_str());
+
+  // Save the map after another one in a product file
+  GlobalMap myOtherMap(nullptr, 8, 4, 1);
+  BOOST_REQUIRE(myOtherMap.saveToFITSextension(productFile, shearExtension, true) == true);
+  BOOST_REQUIRE(myArrayTestMap->saveToFITSextension(productFile, densityExtension, true) == true);
+
+  // The named extension is found after the first one
+  MappedFITSMap myMappedExtension(productFile+"["+densityExtension+"]");
+  BOOST_REQUIRE(myMappedExtension.isValid() == true);
+  BOOST_REQUIRE(myMappedExtension.getXdim() == xSize);
+  BOOST_CHECK(myMappedExtension.getNumberOfGalaxies() == numberOfGalaxies);
+  BOOST_CHECK(myMappedExtension.getBinValue(5, 7, 2) == myArrayTestMap->getBinValue(5, 7, 2));
+
+  // Without a name the first extension with data is mapped
+  MappedFITSMap myFirstExtension(productFile);
+  BOOST_REQUIRE(myFirstExtension.isValid() == true);
+  BOOST_CHECK(myFirstExtension.getXdim() == 8);
+
+  MappedFITSMap myMissingExtension(productFile+"["+convergenceExtension+"]");
+  BOOST_CHECK(myMissingExtension.isValid() == false);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( notMappable_test, MappedFITSMapFixture )
+{
+  // A compressed map can not be mapped
+  BOOST_REQUIRE(myArrayTestMap->saveToFITSfile(pathFiles+"tmp/mappedGzipMap.fits", true, gzipCompression) == true);
+  MappedFITSMap myCompressedMap(pathFiles+"tmp/mappedGzipMap.fits");
+  BOOST_CHECK(myCompressedMap.isValid() == false);
+  BOOST_CHECK(myCompressedMap.getXdim() == 0);
+
+  // Neither can a missing file
+  MappedFITSMap myMissingMap(pathFiles+"tmp/missingMap.fits");
+  BOOST_CHECK(myMissingMap.isValid() == false);
+  BOOST_CHECK(myMissingMap.getRow(0, 0) == nullptr);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( malformedHeader_test )
+{
+  std::string filename = pathFiles+"tmp/mappedRawMap.fits";
+  std::vector<std::string> cards = {"SIMPLE  =                    T", "BITPIX  =                  -32",
+                                    "NAXIS   =                    2", "NAXIS1  =                    4",
+                                    "NAXIS2  =                    3", "RAMIN   =                 10.0",
+                                    "RAMAX   =                 12.0", "DECMIN  =                 -3.0",
+                                    "DECMAX  =                 -1.0", "ZMIN    =                  0.0",
+                                    "ZMAX    =                  3.0"};
+
+  // A well formed header is mapped
+  writeRawFITS(filename, cards, 12);
+  MappedFITSMap myMappedMap(filename);
+  BOOST_REQUIRE(myMappedMap.isValid() == true);
+  BOOST_CHECK(myMappedMap.getXdim() == 4);
+  BOOST_CHECK(myMappedMap.getBoundaries().getRaMax() == 12.);
+
+  // Malformed or overflowing values make the map invalid without throwing
+  std::vector<std::pair<unsigned int, std::string> > badCards = {
+    {3, "NAXIS1  =                 four"}, {3, "NAXIS1  =  99999999999999999999"},
+    {3, "NAXIS1  =                   -4"}, {1, "BITPIX  =                -32.5"},
+    {6, "RAMAX   =               1e9999"}, {6, "RAMAX   =                12.0x"}};
+  for (auto &badCard : badCards)
+  {
+    std::vector<std::string> headerCards(cards);
+    headerCards[badCard.first] = badCard.second;
+    writeRawFITS(filename, headerCards, 12);
+    BOOST_CHECK_NO_THROW(MappedFITSMap myBadMap(filename));
+    MappedFITSMap myBadMap(filename);
+    BOOST_CHECK(myBadMap.isValid() == false);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( tangentPoint_test )
+{
+  std::string filename = pathFiles+"tmp/mappedRawMap.fits";
+  std::vector<std::string> cards = {"SIMPLE  =                    T", "BITPIX  =                  -32",
+                                    "NAXIS   =                    2", "NAXIS1  =                    4",
+                                    "NAXIS2  =                    3", "RAMIN   =                 10.0",
+                                    "RAMAX   =                 12.0", "DECMIN  =                 -3.0",
+                                    "DECMAX  =                 -1.0", "ZMIN    =                  0.0",
+                                    "ZMAX    =                  3.0", "CRVAL1  =                  9.0",
+                                    "CRVAL2  =                 -4.0"};
+
+  // Without a CRPIX reference pixel, the reference value is not the tangent point
+  writeRawFITS(filename, cards, 12);
+  MappedFITSMap myCenteredMap(filename);
+  BOOST_REQUIRE(myCenteredMap.isValid() == true);
+  BOOST_CHECK_CLOSE(myCenteredMap.getBoundaries().getRaTangent(), 11., 0.0001);
+  BOOST_CHECK_CLOSE(myCenteredMap.getBoundaries().getDecTangent(), -2., 0.0001);
+
+  // A cutout written with a reference pixel has the tangent point of the full map
+  cards.push_back("CRPIX1  =                 -1.5");
+  writeRawFITS(filename, cards, 12);
+  MappedFITSMap myCutoutMap(filename);
+  BOOST_REQUIRE(myCutoutMap.isValid() == true);
+  BOOST_CHECK_CLOSE(myCutoutMap.getBoundaries().getRaTangent(), 9., 0.0001);
+  BOOST_CHECK_CLOSE(myCutoutMap.getBoundaries().getDecTangent(), -4., 0.0001);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
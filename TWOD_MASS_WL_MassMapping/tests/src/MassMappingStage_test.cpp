@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/MassMappingStage_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MassMapping/MassMappingStage.h"
+
+#include <cmath>
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+struct MassMappingStageFixture
+{
+  MassMappingStageFixture():xSize(64), ySize(64), zSize(3)
+  {
+    // Allocate the test array
+    double *array = new double[xSize*ySize*zSize];
+
+    // Set a convergence without mean value, which is lost in the K&S inversion
+    for (unsigned int i=0; i<xSize; i++)
+    {
+      for (unsigned int j=0; j<ySize; j++)
+      {
+        array[i + j*xSize] = 0.1*cos(2.*M_PI*i/xSize)*cos(4.*M_PI*j/ySize);
+        array[i + j*xSize + xSize*ySize] = 0.;
+        array[i + j*xSize + 2*xSize*ySize] = 1.;
+      }
+    }
+
+    // Create the convergence map and the corresponding shear map
+    myConvMap = new ConvergenceMap(array, xSize, ySize, zSize);
+    myShearMap = new ShearMap(myConvMap->getShearMap());
+
+    delete [] array;
+    array = nullptr;
+  }
+
+  ~MassMappingStageFixture()
+  {
+    delete myShearMap;
+    myShearMap = nullptr;
+    delete myConvMap;
+    myConvMap = nullptr;
+  }
+
+  ConvergenceMap *myConvMap;
+  ShearMap *myShearMap;
+  unsigned int xSize;
+  unsigned int ySize;
+  unsigned int zSize;
+};
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (MassMappingStage_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( kaiserSquires_test, MassMappingStageFixture )
+{
+  MassMappingStage myStage;
+
+  // No convergence map before the first computation
+  BOOST_CHECK(myStage.getConvergenceMap() == nullptr);
+
+  BOOST_REQUIRE(myStage.computeConvergenceMap(*myShearMap) == true);
+  BOOST_REQUIRE(myStage.getConvergenceMap() != nullptr);
+
+  // The convergence map is the one the shear map was computed from
+  ConvergenceMap *outputConvMap = myStage.getConvergenceMap();
+  BOOST_CHECK(outputConvMap->getXdim() == xSize);
+  BOOST_CHECK(outputConvMap->getYdim() == ySize);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      BOOST_CHECK_SMALL(outputConvMap->getBinValue(i, j, 0) - myConvMap->getBinValue(i, j, 0), 1e-6);
+      BOOST_CHECK_SMALL(outputConvMap->getBinValue(i, j, 1), 1e-6);
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE( inputUnchanged_test, MassMappingStageFixture )
+{
+  ShearMap referenceShearMap(*myShearMap);
+
+  // Borders are added to a copy of the input shear map and cropped from the output
+  MassMappingStage myStage;
+  myStage.setBorders(10, mirrorPadding);
+  BOOST_REQUIRE(myStage.computeConvergenceMap(*myShearMap) == true);
+
+  BOOST_CHECK(myStage.getConvergenceMap()->getXdim() == xSize);
+  BOOST_CHECK(myStage.getConvergenceMap()->getYdim() == ySize);
+
+  BOOST_REQUIRE(myShearMap->getXdim() == xSize);
+  BOOST_REQUIRE(myShearMap->getYdim() == ySize);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      for (unsigned int k=0; k<zSize; k++)
+      {
+        BOOST_CHECK(myShearMap->getBinValue(i, j, k) == referenceShearMap.getBinValue(i, j, k));
+      }
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE( reducedShear_test, MassMappingStageFixture )
+{
+  MassMappingStage myStage;
+  myStage.setGaussianFilter(2., 2.);
+
+  // A second computation replaces the convergence map of the stage
+  BOOST_REQUIRE(myStage.computeConvergenceMap(*myShearMap) == true);
+  double firstValue = myStage.getConvergenceMap()->getBinValue(0, 0, 0);
+
+  myShearMap->computeReducedShear(*myStage.getConvergenceMap());
+  BOOST_REQUIRE(myStage.computeConvergenceMap(*myShearMap) == true);
+  BOOST_CHECK(myStage.getConvergenceMap()->getXdim() == xSize);
+  BOOST_CHECK(myStage.getConvergenceMap()->getBinValue(0, 0, 0) != firstValue);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/PaddingPolicy_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MassMapping/PaddingPolicy.h"
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+struct PaddingPolicyFixture
+{
+  PaddingPolicyFixture():xSize(20), ySize(12), zSize(2)
+  {
+    // Allocate the test array
+    double *array = new double[xSize*ySize*zSize];
+
+    // Set a different value to each pixel of the array
+    for (unsigned int i=0; i<xSize; i++)
+    {
+      for (unsigned int j=0; j<ySize; j++)
+      {
+        for (unsigned int k=0; k<zSize; k++)
+        {
+          array[i + j*xSize + k*xSize*ySize] = 1 + i + 100*j + 10000*k;
+        }
+      }
+    }
+
+    // Create a map based on this array
+    myTestMap = new GlobalMap(array, xSize, ySize, zSize);
+
+    delete [] array;
+    array = nullptr;
+  }
+
+  ~PaddingPolicyFixture()
+  {
+    delete myTestMap;
+    myTestMap = nullptr;
+  }
+
+  GlobalMap *myTestMap;
+  unsigned int xSize;
+  unsigned int ySize;
+  unsigned int zSize;
+};
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (PaddingPolicy_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( getFFTFriendlySize_test )
+{
+  // Sizes already made of factors 2, 3, 5 and 7 are kept
+  BOOST_CHECK(PaddingPolicy::getFFTFriendlySize(1) == 1);
+  BOOST_CHECK(PaddingPolicy::getFFTFriendlySize(1024) == 1024);
+  BOOST_CHECK(PaddingPolicy::getFFTFriendlySize(1050) == 1050);
+
+  // Other sizes go up to the next FFT friendly one
+  BOOST_CHECK(PaddingPolicy::getFFTFriendlySize(11) == 12);
+  BOOST_CHECK(PaddingPolicy::getFFTFriendlySize(1128) == 1134);
+  BOOST_CHECK(PaddingPolicy::getFFTFriendlySize(1021) == 1024);
+}
+
+BOOST_AUTO_TEST_CASE( getPaddedSize_test )
+{
+  // A 1000 pixels axis with 64 pixels borders should be padded to 1134 = 2*3^4*7
+  PaddingPolicy myPolicy(64);
+  BOOST_CHECK(myPolicy.getPaddedSize(1000) == 1134);
+
+  // Without borders the size is only rounded to an FFT friendly one
+  PaddingPolicy myNoBorderPolicy;
+  BOOST_CHECK(myNoBorderPolicy.getPaddedSize(1000) == 1000);
+  BOOST_CHECK(myNoBorderPolicy.getPaddedSize(1001) == 1008);
+}
+
+BOOST_FIXTURE_TEST_CASE( zeroPadding_test, PaddingPolicyFixture )
+{
+  PaddingPolicy myPolicy(5);
+
+  // Cropping before padding should not work
+  BOOST_CHECK(myPolicy.cropMap(*myTestMap) == false);
+
+  // Pad the map and check its new dimensions
+  BOOST_CHECK(myPolicy.padMap(*myTestMap) == true);
+  BOOST_CHECK(myTestMap->getXdim() == 30);
+  BOOST_CHECK(myTestMap->getYdim() == 24);
+  BOOST_CHECK(myTestMap->getZdim() == zSize);
+  BOOST_CHECK(myPolicy.getXoffset() == 5);
+  BOOST_CHECK(myPolicy.getYoffset() == 6);
+
+  // Check the borders are zeros and the map is centered
+  for (unsigned int i=0; i<myTestMap->getXdim(); i++)
+  {
+    for (unsigned int j=0; j<myTestMap->getYdim(); j++)
+    {
+      for (unsigned int k=0; k<zSize; k++)
+      {
+        if (i<5 || i>=5+xSize || j<6 || j>=6+ySize)
+        {
+          BOOST_CHECK_SMALL(myTestMap->getBinValue(i, j, k), 0.000001);
+        }
+        else
+        {
+          BOOST_CHECK_CLOSE(myTestMap->getBinValue(i, j, k), 1 + (i-5) + 100*(j-6) + 10000*k, 0.000001);
+        }
+      }
+    }
+  }
+
+  // Crop back and check the original map is recovered
+  BOOST_CHECK(myPolicy.cropMap(*myTestMap) == true);
+  BOOST_CHECK(myTestMap->getXdim() == xSize);
+  BOOST_CHECK(myTestMap->getYdim() == ySize);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      for (unsigned int k=0; k<zSize; k++)
+      {
+        BOOST_CHECK_CLOSE(myTestMap->getBinValue(i, j, k), 1 + i + 100*j + 10000*k, 0.000001);
+      }
+    }
+  }
+
+  // Cropping a map which does not have the padded dimensions should not work
+  BOOST_CHECK(myPolicy.cropMap(*myTestMap) == false);
+}
+
+BOOST_FIXTURE_TEST_CASE( mirrorPadding_test, PaddingPolicyFixture )
+{
+  PaddingPolicy myPolicy(5, mirrorPadding);
+  BOOST_CHECK(myPolicy.padMap(*myTestMap) == true);
+
+  // Check the borders mirror the edges of the map
+  unsigned int offX = myPolicy.getXoffset();
+  unsigned int offY = myPolicy.getYoffset();
+  BOOST_CHECK_CLOSE(myTestMap->getBinValue(offX-1, offY, 0), myTestMap->getBinValue(offX, offY, 0), 0.000001);
+  BOOST_CHECK_CLOSE(myTestMap->getBinValue(offX-2, offY, 0), myTestMap->getBinValue(offX+1, offY, 0), 0.000001);
+  BOOST_CHECK_CLOSE(myTestMap->getBinValue(offX+xSize, offY+ySize, 1),
+                    myTestMap->getBinValue(offX+xSize-1, offY+ySize-1, 1), 0.000001);
+  BOOST_CHECK_CLOSE(myTestMap->getBinValue(offX, offY-3, 1), myTestMap->getBinValue(offX, offY+2, 1), 0.000001);
+
+  // Crop back and check the original map is recovered
+  BOOST_CHECK(myPolicy.cropMap(*myTestMap) == true);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      BOOST_CHECK_CLOSE(myTestMap->getBinValue(i, j, 0), 1 + i + 100*j, 0.000001);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( innerView_test )
+{
+  unsigned int xSize(20);
+  unsigned int ySize(12);
+
+  // Prepare the padding without any map and build the padded map directly
+  PaddingPolicy myPolicy(5);
+  myPolicy.preparePadding(xSize, ySize);
+  GlobalMap myPaddedMap(nullptr, myPolicy.getPaddedSize(xSize), myPolicy.getPaddedSize(ySize), 2);
+
+  // Write the values of the map through the inner view
+  MapView myView = myPolicy.getInnerView(myPaddedMap);
+  BOOST_CHECK(myView.shape()[0] == xSize);
+  BOOST_CHECK(myView.shape()[1] == ySize);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      myView[i][j][0] = 1 + i + 100*j;
+      myView[i][j][1] = -1;
+    }
+  }
+
+  // Check the values are written at the right place in the padded map
+  BOOST_CHECK_CLOSE(myPaddedMap.getBinValue(myPolicy.getXoffset(), myPolicy.getYoffset(), 0), 1, 0.000001);
+  BOOST_CHECK_SMALL(myPaddedMap.getBinValue(myPolicy.getXoffset()-1, myPolicy.getYoffset(), 0), 0.000001);
+
+  // Crop the borders and check the map
+  BOOST_CHECK(myPolicy.cropMap(myPaddedMap) == true);
+  BOOST_CHECK(myPaddedMap.getXdim() == xSize);
+  BOOST_CHECK(myPaddedMap.getYdim() == ySize);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      BOOST_CHECK_CLOSE(myPaddedMap.getBinValue(i, j, 0), 1 + i + 100*j, 0.000001);
+      BOOST_CHECK_CLOSE(myPaddedMap.getBinValue(i, j, 1), -1, 0.000001);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/PowerSpectrum_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MassMapping/PowerSpectrum.h"
+#include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+#include "TWOD_MASS_WL_MassMapping/ShearMap.h"
+
+#include <cmath>
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+struct PowerSpectrumFixture
+{
+  PowerSpectrumFixture():size(32), mode(4)
+  {
+    // Allocate the test array
+    double *array = new double[size*size*2];
+
+    // Set a single E-mode plane wave along the X axis and no B-mode
+    for (unsigned int i=0; i<size; i++)
+    {
+      for (unsigned int j=0; j<size; j++)
+      {
+        array[i + j*size] = std::cos(2.*M_PI*mode*i/size);
+        array[i + j*size + size*size] = 0.;
+      }
+    }
+
+    // Create a convergence map based on this array
+    myConvMap = new ConvergenceMap(array, size, size, 2);
+
+    delete [] array;
+    array = nullptr;
+  }
+
+  ~PowerSpectrumFixture()
+  {
+    delete myConvMap;
+    myConvMap = nullptr;
+  }
+
+  ConvergenceMap *myConvMap;
+  unsigned int size;
+  unsigned int mode;
+};
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (PowerSpectrum_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( convergencePowerSpectrum_test, PowerSpectrumFixture )
+{
+  PowerSpectrum myPowerSpectrum(8, 0., 0., false);
+  BOOST_CHECK(myPowerSpectrum.computePowerSpectrum(*myConvMap) == true);
+
+  std::vector<double> ell = myPowerSpectrum.getEll();
+  std::vector<double> powerE = myPowerSpectrum.getPowerE();
+  std::vector<double> powerB = myPowerSpectrum.getPowerB();
+  std::vector<long> nbModes = myPowerSpectrum.getNumberOfModes();
+  BOOST_CHECK(ell.size() == 8);
+
+  // All the power is in the bin of the plane wave and sums to the variance of the map
+  double ellMode = 2.*M_PI*mode/size;
+  double totalPower = 0.;
+  for (unsigned int bin=0; bin<ell.size(); bin++)
+  {
+    totalPower += powerE[bin]*nbModes[bin];
+    BOOST_CHECK_SMALL(powerB[bin], 1e-10);
+    if (nbModes[bin] > 0 && std::fabs(powerE[bin]) > 1e-10)
+    {
+      BOOST_CHECK(std::fabs(ell[bin] - ellMode) < ell[bin]);
+    }
+  }
+  BOOST_CHECK_CLOSE(totalPower, size*size/2., 1e-8);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( shearPowerSpectrum_test, PowerSpectrumFixture )
+{
+  ShearMap myShearMap = myConvMap->getShearMap();
+
+  PowerSpectrum convPowerSpectrum(5);
+  PowerSpectrum shearPowerSpectrum(5);
+  BOOST_CHECK(convPowerSpectrum.computePowerSpectrum(*myConvMap) == true);
+  BOOST_CHECK(shearPowerSpectrum.computePowerSpectrum(myShearMap) == true);
+
+  // The shear and convergence spectra should be identical for a pure E-mode map
+  std::vector<double> convPowerE = convPowerSpectrum.getPowerE();
+  std::vector<double> shearPowerE = shearPowerSpectrum.getPowerE();
+  std::vector<double> shearPowerB = shearPowerSpectrum.getPowerB();
+  for (unsigned int bin=0; bin<convPowerE.size(); bin++)
+  {
+    BOOST_CHECK_SMALL(shearPowerE[bin] - convPowerE[bin], 1e-8);
+    BOOST_CHECK_SMALL(shearPowerB[bin], 1e-8);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( invalidBinning_test, PowerSpectrumFixture )
+{
+  PowerSpectrum noBins(0);
+  BOOST_CHECK(noBins.computePowerSpectrum(*myConvMap) == false);
+
+  PowerSpectrum wrongEdges(4, 10., 1.);
+  BOOST_CHECK(wrongEdges.computePowerSpectrum(*myConvMap) == false);
+  BOOST_CHECK(wrongEdges.saveToFITSfile("powerSpectrum.fits", true) == false);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/ReducedShearSolver_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_MassMapping/ReducedShearSolver.h"
+
+#include <cmath>
+
+using namespace TWOD_MASS_WL_MassMapping;
+
+struct ReducedShearSolverFixture
+{
+  ReducedShearSolverFixture():xSize(32), ySize(32)
+  {
+    // Allocate the test arrays
+    double *convArray = new double[xSize*ySize*2];
+    double *shearArray = new double[xSize*ySize*3];
+
+    // Set a small convergence without mean value, and a shear with a galaxy count plan
+    for (unsigned int i=0; i<xSize; i++)
+    {
+      for (unsigned int j=0; j<ySize; j++)
+      {
+        convArray[i + j*xSize] = 0.05*cos(2.*M_PI*i/xSize)*sin(2.*M_PI*j/ySize);
+        convArray[i + j*xSize + xSize*ySize] = 0.;
+        shearArray[i + j*xSize] = 0.01*i;
+        shearArray[i + j*xSize + xSize*ySize] = -0.01*j;
+        shearArray[i + j*xSize + 2*xSize*ySize] = 3.;
+      }
+    }
+
+    myConvMap = new ConvergenceMap(convArray, xSize, ySize, 2);
+    myShearMap = new ShearMap(shearArray, xSize, ySize, 3);
+
+    delete [] convArray;
+    convArray = nullptr;
+    delete [] shearArray;
+    shearArray = nullptr;
+  }
+
+  ~ReducedShearSolverFixture()
+  {
+    delete myShearMap;
+    myShearMap = nullptr;
+    delete myConvMap;
+    myConvMap = nullptr;
+  }
+
+  ConvergenceMap *myConvMap;
+  ShearMap *myShearMap;
+  unsigned int xSize;
+  unsigned int ySize;
+};
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (ReducedShearSolver_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_FIXTURE_TEST_CASE( correctShear_test, ReducedShearSolverFixture )
+{
+  ReducedShearSolver mySolver(*myShearMap);
+
+  // The largest change from a null convergence is the largest convergence
+  double maxKappa = 0.;
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      maxKappa = std::max(maxKappa, std::fabs(myConvMap->getBinValue(i, j, 0)));
+    }
+  }
+  BOOST_CHECK_CLOSE(mySolver.updateConvergence(*myConvMap), maxKappa, 0.001);
+  BOOST_CHECK_SMALL(mySolver.updateConvergence(*myConvMap), 1e-12);
+
+  // The shear plans are divided by 1-kappa, the galaxy count is kept
+  mySolver.correctShear();
+  ShearMap &correctedShearMap = mySolver.getCorrectedShearMap();
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      double kappa = myConvMap->getBinValue(i, j, 0);
+      BOOST_CHECK_SMALL(correctedShearMap.getBinValue(i, j, 0) - myShearMap->getBinValue(i, j, 0)/(1.-kappa), 1e-12);
+      BOOST_CHECK_SMALL(correctedShearMap.getBinValue(i, j, 1) - myShearMap->getBinValue(i, j, 1)/(1.-kappa), 1e-12);
+      BOOST_CHECK(correctedShearMap.getBinValue(i, j, 2) == 3.);
+      BOOST_CHECK(mySolver.getOriginalShearMap().getBinValue(i, j, 0) == myShearMap->getBinValue(i, j, 0));
+    }
+  }
+
+  // A convergence map of another size is rejected
+  double array[4*4*2] = {0.};
+  ConvergenceMap smallConvMap(array, 4, 4, 2);
+  BOOST_CHECK(mySolver.updateConvergence(smallConvMap) < 0.);
+}
+
+BOOST_FIXTURE_TEST_CASE( solve_test, ReducedShearSolverFixture )
+{
+  ShearMap inputShearMap(myConvMap->getShearMap());
+  MassMappingStage myStage;
+
+  // A single iteration is a plain mass mapping of the original shear
+  ReducedShearSolver mySolver1(inputShearMap, 1);
+  BOOST_REQUIRE(mySolver1.solve(myStage)==true);
+  BOOST_CHECK(mySolver1.getNbIterations()==1);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      BOOST_CHECK_SMALL(myStage.getConvergenceMap()->getBinValue(i, j, 0) - myConvMap->getBinValue(i, j, 0), 1e-6);
+      BOOST_CHECK(mySolver1.getCorrectedShearMap().getBinValue(i, j, 0) == inputShearMap.getBinValue(i, j, 0));
+    }
+  }
+
+  // The iterations stop once the convergence is stable
+  ReducedShearSolver mySolver2(inputShearMap, 50, 1e-10);
+  BOOST_REQUIRE(mySolver2.solve(myStage)==true);
+  BOOST_CHECK(mySolver2.getNbIterations()>1);
+  BOOST_CHECK(mySolver2.getNbIterations()<50);
+  BOOST_CHECK(mySolver2.getLastChange()<=1e-10);
+
+  // Without tolerance all the iterations are performed
+  ReducedShearSolver mySolver3(inputShearMap, 3);
+  BOOST_REQUIRE(mySolver3.solve(myStage)==true);
+  BOOST_CHECK(mySolver3.getNbIterations()==3);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()
@@ -23,6 +23,7 @@
  */
 
 #include <boost/test/unit_test.hpp>
+#include <cmath>
 #include <fstream>
 
 #include "TWOD_MASS_WL_MassMapping/ShearMap.h"
@@ -122,6 +123,60 @@ BOOST_AUTO_TEST_CASE( arrayConstructor_test )
   array = nullptr;
 }
 
+BOOST_AUTO_TEST_CASE( fourierChaining_test )
+{
+  // Define a rectangular map without mean value
+  const unsigned int xSize(24);
+  const unsigned int ySize(16);
+  const unsigned int zSize(2);
+
+  double *array = new double[xSize*ySize*zSize];
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      array[i + j*xSize] = std::sin(2.*M_PI*i/xSize)*std::cos(4.*M_PI*j/ySize);
+      array[i + j*xSize + xSize*ySize] = std::cos(6.*M_PI*i/xSize) + std::sin(2.*M_PI*j/ySize);
+    }
+  }
+  ShearMap myShearMap(array, xSize, ySize, zSize);
+
+  GlobalMap::resetTransformCounters();
+
+  // The convergence map keeps the transform computed during the inversion
+  ConvergenceMap myConvergenceMap = myShearMap.getConvergenceMap();
+  BOOST_CHECK(myConvergenceMap.hasFourierTransform() == true);
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsPerformed() == 1);
+
+  // The cached transform is the one of the convergence map values
+  ConvergenceMap myUncachedMap(myConvergenceMap);
+  myUncachedMap.invalidateFourierTransform();
+  const fftw_complex *cachedValues = myConvergenceMap.getFourierTransform();
+  const fftw_complex *computedValues = myUncachedMap.getFourierTransform();
+  for (unsigned int index=0; index<xSize*ySize; index++)
+  {
+    BOOST_CHECK_SMALL(cachedValues[index][0] - computedValues[index][0], 1e-8);
+    BOOST_CHECK_SMALL(cachedValues[index][1] - computedValues[index][1], 1e-8);
+  }
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsPerformed() == 2);
+
+  // Going back to the shear map does not need any forward transform
+  ShearMap myBackShearMap = myConvergenceMap.getShearMap();
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsPerformed() == 2);
+  BOOST_CHECK(GlobalMap::getNumberOfTransformsAvoided() == 2);
+  for (unsigned int i=0; i<xSize; i++)
+  {
+    for (unsigned int j=0; j<ySize; j++)
+    {
+      BOOST_CHECK_SMALL(myBackShearMap.getBinValue(i, j, 0) - array[i + j*xSize], 1e-8);
+      BOOST_CHECK_SMALL(myBackShearMap.getBinValue(i, j, 1) - array[i + j*xSize + xSize*ySize], 1e-8);
+    }
+  }
+
+  delete [] array;
+  array = nullptr;
+}
+
 BOOST_AUTO_TEST_CASE( getConvergenceMap_test )
 {
   // Create a map from a test FITS file
@@ -29,6 +29,7 @@
 #include "TWOD_MASS_WL_MassMapping/ImProcessing.h"
 #include "TWOD_MASS_WL_MapMaker/FITSCatalogHandler.h"
 #include "TWOD_MASS_WL_MassMapping/Image.h"
+#include "TWOD_MASS_WL_MassMapping/MappedFITSMap.h"
 
 namespace TWOD_MASS_WL_PeakCount {
 
@@ -51,7 +52,33 @@ public:
    * @param[in] convMap the convergence map on which to compute the peak counting
    * @param[in] densityMap the galaxy density map needed for SNR estimation
    */
-  PeakCountAlgo(TWOD_MASS_WL_MassMapping::ConvergenceMap &convMap, TWOD_MASS_WL_MassMapping::GlobalMap &densityMap);
+  PeakCountAlgo(const TWOD_MASS_WL_MassMapping::ConvergenceMap &convMap,
+                const TWOD_MASS_WL_MassMapping::GlobalMap &densityMap);
+
+  /**
+   * @brief Constructor from memory mapped FITS files, only the first plane of each map is read
+   * @param[in] convMap the memory mapped convergence map on which to compute the peak counting
+   * @param[in] densityMap the memory mapped galaxy density map needed for SNR estimation
+   */
+  PeakCountAlgo(const TWOD_MASS_WL_MassMapping::MappedFITSMap &convMap,
+                const TWOD_MASS_WL_MassMapping::MappedFITSMap &densityMap);
+
+  /**
+   * @brief Global method computing the peak counting
+   *
+   * @return a vector containing the peak information: right ascension, declination,
+   * redshift, SNR and scale
+   */
+  std::vector<std::vector<double> > getPeakCatalog();
+
+  /**
+   * @brief Saves peak information as a FITS catalog
+   * @param[in] filename the FITS catalog output filename
+   * @param[in] peakCatalog the peak information as returned by getPeakCatalog
+   *
+   * @return true if a peak catalog is well created, false otherwise
+   */
+  static bool savePeakCatalog(std::string filename, std::vector<std::vector<double> > &peakCatalog);
 
   /**
    * @brief Global method computing the peak counting and saving it as a FITS catalog
@@ -80,8 +107,10 @@ public:
 
 private:
 
-  TWOD_MASS_WL_MassMapping::ConvergenceMap m_convMap;
-  TWOD_MASS_WL_MassMapping::GlobalMap m_densityMap;
+  // Only the E mode of the convergence and the density plane are needed
+  TWOD_MASS_WL_MassMapping::Image m_kappaE;
+  TWOD_MASS_WL_MassMapping::Image m_density;
+  TWOD_MASS_WL_MassMapping::Boundaries m_boundaries;
 
   TWOD_MASS_WL_MassMapping::ImProcessing m_IP;
 
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file TWOD_MASS_WL_PeakCount/PeakCountStage.h
+ * @date 10/18/26
+ * @author user
+ */
+
+#ifndef TWOD_MASS_WL_PEAKCOUNT_PEAKCOUNTSTAGE_H
+#define TWOD_MASS_WL_PEAKCOUNT_PEAKCOUNTSTAGE_H
+
+#include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+#include "TWOD_MASS_WL_MassMapping/GlobalMap.h"
+
+#include <string>
+#include <vector>
+
+namespace TWOD_MASS_WL_PeakCount {
+
+/**
+ * @class PeakCountStage
+ * @brief In memory peak counting stage, finding the peaks of a convergence map
+ *
+ * The stage keeps the peak catalog in memory, it is only saved as a FITS catalog if an
+ * output file is given.
+ *
+ */
+class PeakCountStage {
+
+public:
+
+  /**
+   * @brief Destructor
+   */
+  virtual ~PeakCountStage() = default;
+
+  /**
+   * @brief Constructor of a PeakCountStage
+   */
+  PeakCountStage();
+
+  /**
+   * @brief Sets a file in which to save the peak catalog at each computation
+   * @param[in] filename name of the FITS catalog, no file is written if empty (default)
+   */
+  void setOutputFile(std::string filename);
+
+  /**
+   * @brief Finds the peaks of a convergence map
+   * @param[in] convMap the convergence map on which to compute the peak counting
+   * @param[in] densityMap the galaxy density map needed for SNR estimation
+   * @return true if the peak counting could be performed, false otherwise
+   */
+  bool findPeaks(const TWOD_MASS_WL_MassMapping::ConvergenceMap &convMap,
+                 const TWOD_MASS_WL_MassMapping::GlobalMap &densityMap);
+
+  /**
+   * @brief Returns the last computed peak catalog
+   * @return the peak information: right ascension, declination, redshift, SNR and scale
+   */
+  const std::vector<std::vector<double> >& getPeakCatalog() const;
+
+private:
+
+  std::string m_outputFile;
+
+  std::vector<std::vector<double> > m_peakCatalog;
+
+}; /* End of PeakCountStage class */
+
+} /* namespace TWOD_MASS_WL_PeakCount */
+
+
+#endif
@@ -23,48 +23,89 @@
  */
 
 #include <iostream>
+#include <algorithm>
 
 #include "TWOD_MASS_WL_PeakCount/PeakCountAlgo.h"
 #include "TWOD_MASS_WL_MassMapping/Image.h"
 
 namespace TWOD_MASS_WL_PeakCount {
 
-PeakCountAlgo::PeakCountAlgo(TWOD_MASS_WL_MassMapping::ConvergenceMap &convMap,
-                             TWOD_MASS_WL_MassMapping::GlobalMap &densityMap):
-    m_convMap(convMap), m_densityMap(densityMap), m_IP(convMap.getXdim(), convMap.getYdim())
+PeakCountAlgo::PeakCountAlgo(const TWOD_MASS_WL_MassMapping::ConvergenceMap &convMap,
+                             const TWOD_MASS_WL_MassMapping::GlobalMap &densityMap):
+    m_kappaE(convMap.getXdim(), convMap.getYdim()), m_density(convMap.getXdim(), convMap.getYdim()),
+    m_boundaries(convMap.getBoundaries()), m_IP(convMap.getXdim(), convMap.getYdim())
 {
   m_sizeXaxis = convMap.getXdim();
   m_sizeYaxis = convMap.getYdim();
   m_sizeZaxis = convMap.getZdim();
+
+  for (unsigned int j=0; j<m_sizeYaxis; j++)
+  {
+    for (unsigned int i=0; i<m_sizeXaxis; i++)
+    {
+      m_kappaE.setValue(i, j, convMap.getBinValue(i, j, 0));
+      m_density.setValue(i, j, densityMap.getBinValue(i, j, 0));
+    }
+  }
 }
 
-bool PeakCountAlgo::savePeakCatalog(std::string filename)
+PeakCountAlgo::PeakCountAlgo(const TWOD_MASS_WL_MassMapping::MappedFITSMap &convMap,
+                             const TWOD_MASS_WL_MassMapping::MappedFITSMap &densityMap):
+    m_kappaE(convMap.getXdim(), convMap.getYdim()), m_density(convMap.getXdim(), convMap.getYdim()),
+    m_boundaries(convMap.getBoundaries()), m_IP(convMap.getXdim(), convMap.getYdim())
 {
-  // Allocate memory for kappa and DCT kappa
-  TWOD_MASS_WL_MassMapping::Image kappaE(m_sizeXaxis, m_sizeYaxis);
-  TWOD_MASS_WL_MassMapping::Image kappaB(m_sizeXaxis, m_sizeYaxis);
+  m_sizeXaxis = convMap.getXdim();
+  m_sizeYaxis = convMap.getYdim();
+  m_sizeZaxis = convMap.getZdim();
 
-  std::cout<<"Initializing kappa map"<<std::endl;
+  // FITS rows and Image rows both run along the X axis: copy the mapped rows directly
+  double *kappaValues = m_kappaE.getArray();
+  double *densityValues = m_density.getArray();
   for (unsigned int j=0; j<m_sizeYaxis; j++)
   {
-    for (unsigned int i=0; i<m_sizeXaxis; i++)
+    const double *kappaRow = convMap.getRow(j, 0);
+    std::copy(kappaRow, kappaRow + m_sizeXaxis, kappaValues + j*m_sizeXaxis);
+
+    // A density map with different dimensions is read bin by bin, out of range bins being empty
+    if (densityMap.getXdim()==m_sizeXaxis && j<densityMap.getYdim())
     {
-      kappaE.setValue(i, j, m_convMap.getBinValue(i, j, 0));
-      kappaB.setValue(i, j, m_convMap.getBinValue(i, j, 1));
+      const double *densityRow = densityMap.getRow(j, 0);
+      std::copy(densityRow, densityRow + m_sizeXaxis, densityValues + j*m_sizeXaxis);
+    }
+    else
+    {
+      for (unsigned int i=0; i<m_sizeXaxis; i++)
+      {
+        densityValues[j*m_sizeXaxis + i] = densityMap.getBinValue(i, j, 0);
+      }
     }
   }
+}
 
+std::vector<std::vector<double> > PeakCountAlgo::getPeakCatalog()
+{
   // Compute the number of scales
   unsigned int nbScales = int(log(m_sizeXaxis)/log(2.))-3.-2.;
   std::cout<<"number of scales: "<<nbScales<<std::endl;
 
   // Perform the kappa map decomposition
-  std::vector<TWOD_MASS_WL_MassMapping::Image> myBand = m_IP.transformBspline(kappaE, nbScales);
+  std::vector<TWOD_MASS_WL_MassMapping::Image> myBand = m_IP.transformBspline(m_kappaE, nbScales);
 
   // Get the peaks data
   std::vector<std::vector<double> > inputData = getPeaks(myBand);
   std::cout<<"number of detected peaks: "<<inputData[0].size()<<std::endl;
 
+  return inputData;
+}
+
+bool PeakCountAlgo::savePeakCatalog(std::string filename)
+{
+  std::vector<std::vector<double> > peakCatalog = getPeakCatalog();
+  return savePeakCatalog(filename, peakCatalog);
+}
+
+bool PeakCountAlgo::savePeakCatalog(std::string filename, std::vector<std::vector<double> > &peakCatalog)
+{
   // Save those data into the catalog and return false if it does not work
   std::vector<std::string> colNames;
   colNames.push_back("RightAsc");
@@ -90,7 +131,7 @@ bool PeakCountAlgo::savePeakCatalog(std::string filename)
   // Create a FITS catalog
   TWOD_MASS_WL_MapMaker::FITSCatalogHandler myCatalog(filename);
   // And save data to this catalog
-  return myCatalog.saveAsFitsCatalog(inputData, columns);
+  return myCatalog.saveAsFitsCatalog(peakCatalog, columns);
 }
 
 TWOD_MASS_WL_MassMapping::Image PeakCountAlgo::getSNRimage(TWOD_MASS_WL_MassMapping::Image inputKappaImage,
@@ -104,7 +145,7 @@ TWOD_MASS_WL_MassMapping::Image PeakCountAlgo::getSNRimage(TWOD_MASS_WL_MassMapp
   {
     for (unsigned int j=0; j<m_sizeYaxis; j++)
     {
-      double density = m_densityMap.getBinValue(i, j, 0);
+      double density = m_density.getValue(i, j);
       if (density>0.)
       {
         mySNRimage.setValue(i, j, mySNRimage.getValue(i, j)/sqrt(density));
@@ -125,12 +166,12 @@ std::vector<std::vector<double> > PeakCountAlgo::getPeaks(std::vector<TWOD_MASS_
   TWOD_MASS_WL_MapMaker::FITSCatalogHandler myCatalog("dummy");
 
   // Get the map characteristics
-  double raMin = m_convMap.getBoundaries().getRaMin();
-  double raMax = m_convMap.getBoundaries().getRaMax();
-  double decMin = m_convMap.getBoundaries().getDecMin();
-  double decMax = m_convMap.getBoundaries().getDecMax();
-  double ra0 = 0.5*(raMin + raMax);
-  double dec0 = 0.5*(decMin + decMax);
+  double raMin = m_boundaries.getRaMin();
+  double raMax = m_boundaries.getRaMax();
+  double decMin = m_boundaries.getDecMin();
+  double decMax = m_boundaries.getDecMax();
+  double ra0 = m_boundaries.getRaTangent();
+  double dec0 = m_boundaries.getDecTangent();
   double raRange = raMax - raMin;
   double decRange = decMax - decMin;
 
@@ -159,9 +200,10 @@ std::vector<std::vector<double> > PeakCountAlgo::getPeaks(std::vector<TWOD_MASS_
         if (mySNRimage.isLocalMax(i, j))
         {
 
-          // Perform transform from pixel location to ra and dec
-          double tmpx = (i+0.5)*raRange/m_convMap.getXdim()*3.14/180-0.5*raRange*3.14/180;
-          double tmpy = (j+0.5)*decRange/m_convMap.getYdim()*3.14/180-0.5*decRange*3.14/180;
+          // Perform transform from pixel location to ra and dec, the tangent point being
+          // off the center of the map for a cutout
+          double tmpx = (i+0.5)*raRange/m_sizeXaxis*3.14/180+(raMin-ra0)*3.14/180;
+          double tmpy = (j+0.5)*decRange/m_sizeYaxis*3.14/180+(decMin-dec0)*3.14/180;
           std::pair<double, double> radec = myCatalog.getInverseGnomonicProjection(tmpx, tmpy, ra0, dec0);
 
           // Save the data into the vectors
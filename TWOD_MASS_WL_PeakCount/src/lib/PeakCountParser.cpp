@@ -24,6 +24,7 @@
 
 #include "TWOD_MASS_WL_PeakCount/PeakCountParser.h"
 #include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
+#include "TWOD_MASS_WL_MassMapping/MappedFITSMap.h"
 #include "TWOD_MASS_WL_PeakCount/PeakCountAlgo.h"
 
 namespace po = boost::program_options;
@@ -113,6 +114,23 @@ bool PeakCountParser::parseInputParameters(std::map<std::string, po::variable_va
 
 bool PeakCountParser::createPeakCatalog()
 {
+  // Uncompressed input maps are memory mapped rather than fully loaded
+  if (m_inputFITSconvergenceMap.empty()==false && m_inputFITSdensMap.empty()==false)
+  {
+    TWOD_MASS_WL_MassMapping::MappedFITSMap myMappedConvergenceMap(m_workDir+m_inputFITSconvergenceMap);
+    TWOD_MASS_WL_MassMapping::MappedFITSMap myMappedDensityMap(m_inputFITSdensMap);
+    if (myMappedConvergenceMap.isValid() && myMappedDensityMap.isValid())
+    {
+      PeakCountAlgo myPeakCounter(myMappedConvergenceMap, myMappedDensityMap);
+      if (m_outputPeakCatalogFITS.empty()==false)
+      {
+        return myPeakCounter.savePeakCatalog(m_workDir+m_outputPeakCatalogFITS);
+      }
+      return false;
+    }
+  }
+
+  // Otherwise (compressed files for instance) load the maps with CCfits
   TWOD_MASS_WL_MassMapping::ConvergenceMap *myConvergenceMap = nullptr;
 
   // Create the convergence map
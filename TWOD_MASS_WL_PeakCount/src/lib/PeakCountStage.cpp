@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file src/lib/PeakCountStage.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include "TWOD_MASS_WL_PeakCount/PeakCountStage.h"
+#include "TWOD_MASS_WL_PeakCount/PeakCountAlgo.h"
+
+#include <iostream>
+
+namespace TWOD_MASS_WL_PeakCount {
+
+PeakCountStage::PeakCountStage(): m_outputFile("")
+{
+}
+
+void PeakCountStage::setOutputFile(std::string filename)
+{
+  m_outputFile = filename;
+}
+
+bool PeakCountStage::findPeaks(const TWOD_MASS_WL_MassMapping::ConvergenceMap &convMap,
+                               const TWOD_MASS_WL_MassMapping::GlobalMap &densityMap)
+{
+  m_peakCatalog.clear();
+
+  if (convMap.getXdim()==0 || convMap.getYdim()==0 ||
+      densityMap.getXdim()!=convMap.getXdim() || densityMap.getYdim()!=convMap.getYdim())
+  {
+    return false;
+  }
+
+  PeakCountAlgo myPeakCountAlgo(convMap, densityMap);
+  m_peakCatalog = myPeakCountAlgo.getPeakCatalog();
+
+  // Save the peak catalog only if asked
+  if (m_outputFile.empty()==false)
+  {
+    if (PeakCountAlgo::savePeakCatalog(m_outputFile, m_peakCatalog)==false)
+    {
+      std::cout<<"could not save the peak catalog"<<std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const std::vector<std::vector<double> >& PeakCountStage::getPeakCatalog() const
+{
+  return m_peakCatalog;
+}
+
+} // TWOD_MASS_WL_PeakCount namespace
@@ -23,6 +23,7 @@
  */
 
 #include <boost/test/unit_test.hpp>
+#include <vector>
 #include "TWOD_MASS_WL_MassMapping/ConvergenceMap.h"
 
 #include "TWOD_MASS_WL_PeakCount/PeakCountAlgo.h"
@@ -107,6 +108,58 @@ BOOST_AUTO_TEST_CASE( getCatalog_test ) {
   BOOST_CHECK(catalogCreated == true);
 }
 
+BOOST_AUTO_TEST_CASE( cutoutPeaks_test ) {
+
+  // Create a convergence map and a density map far from the equator
+  const unsigned int mapSize(64);
+  std::vector<double> kappaValues(2*mapSize*mapSize, 0.);
+  std::vector<double> densityValues(mapSize*mapSize, 1.);
+  TWOD_MASS_WL_MassMapping::Boundaries bounds(30., 40., 50., 60., 0., 3.);
+  TWOD_MASS_WL_MassMapping::ConvergenceMap myConvMap(kappaValues.data(), mapSize, mapSize, 2, bounds);
+  TWOD_MASS_WL_MassMapping::GlobalMap myDensityMap(densityValues.data(), mapSize, mapSize, 1, bounds);
+  BOOST_REQUIRE(myConvMap.saveToFITSfile(pathFiles+"tmp/peakConvMap.fits", true) == true);
+  BOOST_REQUIRE(myDensityMap.saveToFITSfile(pathFiles+"tmp/peakDensMap.fits", true) == true);
+
+  // Read an off-center cutout of both maps
+  const unsigned int offset(32);
+  const unsigned int cutoutSize(24);
+  TWOD_MASS_WL_MassMapping::ConvergenceMap myConvCutout(pathFiles+"tmp/peakConvMap.fits",
+                                                        offset, offset, cutoutSize, cutoutSize);
+  TWOD_MASS_WL_MassMapping::GlobalMap myDensityCutout(pathFiles+"tmp/peakDensMap.fits",
+                                                      offset, offset, cutoutSize, cutoutSize);
+  BOOST_REQUIRE(myConvCutout.getXdim() == cutoutSize);
+  BOOST_REQUIRE(myDensityCutout.getYdim() == cutoutSize);
+
+  // Put a single peak at the same sky position in both, the last band giving the noise
+  std::vector<TWOD_MASS_WL_MassMapping::Image> fullBands;
+  std::vector<TWOD_MASS_WL_MassMapping::Image> cutoutBands;
+  for (unsigned int band=0; band<2; band++)
+  {
+    fullBands.push_back(TWOD_MASS_WL_MassMapping::Image(mapSize, mapSize));
+    cutoutBands.push_back(TWOD_MASS_WL_MassMapping::Image(cutoutSize, cutoutSize));
+  }
+  fullBands[0].setValue(offset+8, offset+13, 10.);
+  cutoutBands[0].setValue(8, 13, 10.);
+  for (unsigned int i=0; i<cutoutSize; i++)
+  {
+    for (unsigned int j=0; j<cutoutSize; j++)
+    {
+      fullBands[1].setValue(i, j, (i+j)%2);
+      cutoutBands[1].setValue(i, j, (i+j)%2);
+    }
+  }
+
+  // The cutout peak is projected around the tangent point of the full map
+  PeakCountAlgo myFullAlgo(myConvMap, myDensityMap);
+  PeakCountAlgo myCutoutAlgo(myConvCutout, myDensityCutout);
+  std::vector<std::vector<double> > fullPeaks = myFullAlgo.getPeaks(fullBands);
+  std::vector<std::vector<double> > cutoutPeaks = myCutoutAlgo.getPeaks(cutoutBands);
+  BOOST_REQUIRE(fullPeaks[0].size() == 1);
+  BOOST_REQUIRE(cutoutPeaks[0].size() == 1);
+  BOOST_CHECK_CLOSE(cutoutPeaks[0][0], fullPeaks[0][0], 0.0001);
+  BOOST_CHECK_CLOSE(cutoutPeaks[1][0], fullPeaks[1][0], 0.0001);
+}
+
 //-----------------------------------------------------------------------------
 
 BOOST_AUTO_TEST_SUITE_END ()
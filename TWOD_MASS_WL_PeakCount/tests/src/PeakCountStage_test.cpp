@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2012-2020 Euclid Science Ground Segment
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 3.0 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file tests/src/PeakCountStage_test.cpp
+ * @date 10/18/26
+ * @author user
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "TWOD_MASS_WL_PeakCount/PeakCountStage.h"
+#include "TWOD_MASS_WL_PeakCount/PeakCountAlgo.h"
+
+#include "TWOD_MASS_WL_MassMapping/DataFilesLoader.h"
+
+using namespace TWOD_MASS_WL_PeakCount;
+
+TWOD_MASS_WL_MassMapping::DataFilesLoader myLoader;
+std::string pathFiles = myLoader.downloadTestFiles();
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE (PeakCountStage_test)
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( findPeaks_test ) {
+
+  TWOD_MASS_WL_MassMapping::ConvergenceMap myConvMap(pathFiles+"convMap.fits");
+  TWOD_MASS_WL_MassMapping::GlobalMap myGlobalMap(pathFiles+"densMap.fits");
+
+  // Without output file the peak catalog is only kept in memory
+  PeakCountStage myStage;
+  BOOST_CHECK(myStage.getPeakCatalog().empty()==true);
+  BOOST_REQUIRE(myStage.findPeaks(myConvMap, myGlobalMap)==true);
+
+  // The peaks are the ones of the peak count algorithm
+  std::vector<std::vector<double> > refCatalog = PeakCountAlgo(myConvMap, myGlobalMap).getPeakCatalog();
+  BOOST_REQUIRE(myStage.getPeakCatalog().size()==refCatalog.size());
+  for (unsigned int i=0; i<refCatalog.size(); i++)
+  {
+    BOOST_CHECK(myStage.getPeakCatalog()[i]==refCatalog[i]);
+  }
+
+  // The peak catalog is saved when asked
+  myStage.setOutputFile(pathFiles+"tmp/peakCountStageCatalog.fits");
+  BOOST_CHECK(myStage.findPeaks(myConvMap, myGlobalMap)==true);
+}
+
+//-----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE_END ()